@@ -607,6 +607,7 @@ static void rcheevos_async_schedule(
    retro_task_t* task = task_init();
    task->when         = cpu_features_get_time_usec() + delay;
    task->handler      = rcheevos_async_task_handler;
+   task->stats_name   = "Achievements request";
    task->user_data    = request;
    task->progress     = -1;
    task_queue_push(task);
@@ -2482,13 +2483,14 @@ bool rcheevos_load(const void *data)
       coro->data       = NULL;
    }
 
-   task->handler   = rcheevos_task_handler;
-   task->state     = (void*)coro;
-   task->mute      = true;
-   task->callback  = NULL;
-   task->user_data = NULL;
-   task->progress  = 0;
-   task->title     = NULL;
+   task->handler    = rcheevos_task_handler;
+   task->stats_name = "Achievements load";
+   task->state      = (void*)coro;
+   task->mute       = true;
+   task->callback   = NULL;
+   task->user_data  = NULL;
+   task->progress   = 0;
+   task->title      = NULL;
 
 #ifdef HAVE_THREADS
    if (!rcheevos_locals.task_lock)
@@ -65,6 +65,9 @@ enum event_command
    CMD_EVENT_REWIND_INIT,
    /* Toggles rewind. */
    CMD_EVENT_REWIND_TOGGLE,
+   /* Jumps back in the rewind history.
+    * Data is the number of seconds, NULL uses the setting. */
+   CMD_EVENT_REWIND_SEEK,
    /* Initializes autosave. */
    CMD_EVENT_AUTOSAVE_INIT,
    /* Stops audio. */
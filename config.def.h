@@ -298,6 +298,11 @@
 #define DEFAULT_THREADED_DATA_RUNLOOP_ENABLE false
 #endif
 
+/* Number of threads running tasks when threaded
+ * tasks are enabled. 0 picks it from the number of
+ * CPU cores. */
+#define DEFAULT_THREADED_DATA_RUNLOOP_WORKERS 0
+
 /* Set to true if HW render cores should get their private context. */
 #define DEFAULT_VIDEO_SHARED_CONTEXT false
 
@@ -865,6 +870,10 @@ static const bool audio_enable_menu_bgm    = false;
 /* Will sync audio. (recommended) */
 #define DEFAULT_AUDIO_SYNC true
 
+/* Run resampling, DSP filters and the mixer on
+ * a thread of their own. */
+#define DEFAULT_AUDIO_PROCESS_THREAD false
+
 /* Audio rate control. */
 #if !defined(RARCH_CONSOLE)
 #define DEFAULT_RATE_CONTROL true
@@ -938,6 +947,25 @@ static const bool audio_enable_menu_bgm    = false;
 /* How many frames to rewind at a time. */
 #define DEFAULT_REWIND_GRANULARITY 1
 
+/* Encode rewind deltas on a worker thread instead of
+ * inside the frame loop. */
+#define DEFAULT_REWIND_THREADED false
+
+/* Rewind deltas older than this many frames get deflated
+ * into a second tier on a worker thread. 0 disables it. */
+#define DEFAULT_REWIND_TIER_AGE 0
+
+/* Size in MB of the file-backed rewind buffer, used instead
+ * of rewind_buffer_size where supported. 0 disables it. */
+#define DEFAULT_REWIND_DISK_BUFFER_SIZE 0
+
+/* Store a full state every this many rewind frames, so that
+ * seeking back does not have to walk every delta. 0 disables it. */
+#define DEFAULT_REWIND_KEYFRAME_INTERVAL 0
+
+/* How many seconds the rewind seek hotkey jumps back. */
+#define DEFAULT_REWIND_SEEK_SECONDS 10
+
 /* Pause gameplay when gameplay loses focus. */
 #ifdef EMSCRIPTEN
 #define DEFAULT_PAUSE_NONACTIVE false
@@ -976,6 +1004,15 @@ static const bool netplay_client_swap_input = true;
 
 static const bool netplay_nat_traversal = false;
 
+/* Also send input over UDP, with the last few frames
+ * repeated in every packet. Experimental, see
+ * tools/netplay_soak/README for what it does and doesn't fix. */
+static const bool netplay_udp_input = false;
+
+/* When hosting, hand spectators over to a relay thread
+ * that sends them the input stream. */
+static const bool netplay_spectator_relay = true;
+
 static const unsigned netplay_delay_frames = 16;
 
 static const int netplay_check_frames = 600;
@@ -1041,6 +1078,20 @@ static const bool savestate_thumbnail_enable = false;
 /* When using the Run Ahead feature, use a secondary instance of the core. */
 #define DEFAULT_RUN_AHEAD_SECONDARY_INSTANCE true
 
+/* Run the secondary instance on a worker thread,
+ * in parallel with the main instance. */
+#define DEFAULT_RUN_AHEAD_SECONDARY_THREAD false
+
+/* When using the Run Ahead feature, keep the states of the last
+ * frames and only roll back when input changes. Takes precedence
+ * over the secondary instance. */
+#define DEFAULT_RUN_AHEAD_PREEMPTIVE false
+
+/* When using the Run Ahead feature, measure the core and pick
+ * the number of frames (up to run_ahead_frames) and the
+ * single or secondary instance that fit in a frame. */
+#define DEFAULT_RUN_AHEAD_AUTO false
+
 /* Hide warning messages when using the Run Ahead feature. */
 #define DEFAULT_RUN_AHEAD_HIDE_WARNINGS false
 
@@ -570,6 +570,13 @@ static const struct retro_keybind retro_keybinds_1[] = {
       RARCH_AI_SERVICE, NO_BTN, NO_BTN, 0,
       true
    },
+   {
+      NULL, NULL,
+      AXIS_NONE, AXIS_NONE, AXIS_NONE,
+      MENU_ENUM_LABEL_VALUE_INPUT_META_REWIND_SEEK, RETROK_UNKNOWN,
+      RARCH_REWIND_SEEK, NO_BTN, NO_BTN, 0,
+      true
+   },
 #elif defined(DINGUX)
    { 
       NULL, NULL,
@@ -1117,6 +1124,13 @@ static const struct retro_keybind retro_keybinds_1[] = {
       RARCH_AI_SERVICE, NO_BTN, NO_BTN, 0,
       true
    },
+   {
+      NULL, NULL,
+      AXIS_NONE, AXIS_NONE, AXIS_NONE,
+      MENU_ENUM_LABEL_VALUE_INPUT_META_REWIND_SEEK, RETROK_UNKNOWN,
+      RARCH_REWIND_SEEK, NO_BTN, NO_BTN, 0,
+      true
+   },
 #else
    { 
       NULL, NULL,
@@ -1674,6 +1688,13 @@ static const struct retro_keybind retro_keybinds_1[] = {
       RARCH_AI_SERVICE, NO_BTN, NO_BTN, 0,
       true
    },
+   {
+      NULL, NULL,
+      AXIS_NONE, AXIS_NONE, AXIS_NONE,
+      MENU_ENUM_LABEL_VALUE_INPUT_META_REWIND_SEEK, RETROK_UNKNOWN,
+      RARCH_REWIND_SEEK, NO_BTN, NO_BTN, 0,
+      true
+   },
 #endif
 };
 
@@ -1435,13 +1435,18 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("ui_menubar_enable",             &settings->bools.ui_menubar_enable, true, DEFAULT_UI_MENUBAR_ENABLE, false);
    SETTING_BOOL("suspend_screensaver_enable",    &settings->bools.ui_suspend_screensaver_enable, true, true, false);
    SETTING_BOOL("rewind_enable",                 &settings->bools.rewind_enable, true, DEFAULT_REWIND_ENABLE, false);
+   SETTING_BOOL("rewind_threaded",               &settings->bools.rewind_threaded, true, DEFAULT_REWIND_THREADED, false);
    SETTING_BOOL("vrr_runloop_enable",            &settings->bools.vrr_runloop_enable, true, DEFAULT_VRR_RUNLOOP_ENABLE, false);
    SETTING_BOOL("apply_cheats_after_toggle",     &settings->bools.apply_cheats_after_toggle, true, DEFAULT_APPLY_CHEATS_AFTER_TOGGLE, false);
    SETTING_BOOL("apply_cheats_after_load",       &settings->bools.apply_cheats_after_load, true, DEFAULT_APPLY_CHEATS_AFTER_LOAD, false);
    SETTING_BOOL("run_ahead_enabled",             &settings->bools.run_ahead_enabled, true, false, false);
    SETTING_BOOL("run_ahead_secondary_instance",  &settings->bools.run_ahead_secondary_instance, true, DEFAULT_RUN_AHEAD_SECONDARY_INSTANCE, false);
+   SETTING_BOOL("run_ahead_secondary_thread",    &settings->bools.run_ahead_secondary_thread, true, DEFAULT_RUN_AHEAD_SECONDARY_THREAD, false);
+   SETTING_BOOL("run_ahead_preemptive",          &settings->bools.run_ahead_preemptive, true, DEFAULT_RUN_AHEAD_PREEMPTIVE, false);
+   SETTING_BOOL("run_ahead_auto",                &settings->bools.run_ahead_auto, true, DEFAULT_RUN_AHEAD_AUTO, false);
    SETTING_BOOL("run_ahead_hide_warnings",       &settings->bools.run_ahead_hide_warnings, true, DEFAULT_RUN_AHEAD_HIDE_WARNINGS, false);
    SETTING_BOOL("audio_sync",                    &settings->bools.audio_sync, true, DEFAULT_AUDIO_SYNC, false);
+   SETTING_BOOL("audio_process_thread",          &settings->bools.audio_process_thread, true, DEFAULT_AUDIO_PROCESS_THREAD, false);
    SETTING_BOOL("video_shader_enable",           &settings->bools.video_shader_enable, true, DEFAULT_SHADER_ENABLE, false);
    SETTING_BOOL("video_shader_watch_files",      &settings->bools.video_shader_watch_files, true, DEFAULT_VIDEO_SHADER_WATCH_FILES, false);
    SETTING_BOOL("video_shader_remember_last_dir", &settings->bools.video_shader_remember_last_dir, true, DEFAULT_VIDEO_SHADER_REMEMBER_LAST_DIR, false);
@@ -1684,6 +1689,8 @@ static struct config_bool_setting *populate_settings_bool(
 #endif
 #ifdef HAVE_NETWORKING
    SETTING_BOOL("netplay_nat_traversal",        &settings->bools.netplay_nat_traversal, true, true, false);
+   SETTING_BOOL("netplay_udp_input",            &settings->bools.netplay_udp_input, true, netplay_udp_input, false);
+   SETTING_BOOL("netplay_spectator_relay",      &settings->bools.netplay_spectator_relay, true, netplay_spectator_relay, false);
 #endif
    SETTING_BOOL("block_sram_overwrite",         &settings->bools.block_sram_overwrite, true, DEFAULT_BLOCK_SRAM_OVERWRITE, false);
    SETTING_BOOL("savestate_auto_index",         &settings->bools.savestate_auto_index, true, savestate_auto_index, false);
@@ -1858,7 +1865,12 @@ static struct config_uint_setting *populate_settings_uint(
 #endif
    SETTING_UINT("rewind_granularity",           &settings->uints.rewind_granularity, true, DEFAULT_REWIND_GRANULARITY, false);
    SETTING_UINT("rewind_buffer_size_step",      &settings->uints.rewind_buffer_size_step, true, DEFAULT_REWIND_BUFFER_SIZE_STEP, false);
+   SETTING_UINT("rewind_tier_age",              &settings->uints.rewind_tier_age, true, DEFAULT_REWIND_TIER_AGE, false);
+   SETTING_UINT("rewind_disk_buffer_size",      &settings->uints.rewind_disk_buffer_size, true, DEFAULT_REWIND_DISK_BUFFER_SIZE, false);
+   SETTING_UINT("rewind_keyframe_interval",     &settings->uints.rewind_keyframe_interval, true, DEFAULT_REWIND_KEYFRAME_INTERVAL, false);
+   SETTING_UINT("rewind_seek_seconds",          &settings->uints.rewind_seek_seconds, true, DEFAULT_REWIND_SEEK_SECONDS, false);
    SETTING_UINT("autosave_interval",            &settings->uints.autosave_interval,  true, DEFAULT_AUTOSAVE_INTERVAL, false);
+   SETTING_UINT("threaded_data_runloop_workers", &settings->uints.threaded_data_runloop_workers, true, DEFAULT_THREADED_DATA_RUNLOOP_WORKERS, false);
    SETTING_UINT("frontend_log_level",           &settings->uints.frontend_log_level, true, DEFAULT_FRONTEND_LOG_LEVEL, false);
    SETTING_UINT("libretro_log_level",           &settings->uints.libretro_log_level, true, DEFAULT_LIBRETRO_LOG_LEVEL, false);
    SETTING_UINT("keyboard_gamepad_mapping_type",&settings->uints.input_keyboard_gamepad_mapping_type, true, 1, false);
@@ -167,7 +167,12 @@ typedef struct settings
       unsigned libretro_log_level;
       unsigned rewind_granularity;
       unsigned rewind_buffer_size_step;
+      unsigned rewind_tier_age;
+      unsigned rewind_disk_buffer_size;
+      unsigned rewind_keyframe_interval;
+      unsigned rewind_seek_seconds;
       unsigned autosave_interval;
+      unsigned threaded_data_runloop_workers;
       unsigned network_cmd_port;
       unsigned network_remote_base_port;
       unsigned keymapper_port;
@@ -491,6 +496,7 @@ typedef struct settings
       bool audio_enable_menu_notice;
       bool audio_enable_menu_bgm;
       bool audio_sync;
+      bool audio_process_thread;
       bool audio_rate_control;
       bool audio_wasapi_exclusive_mode;
       bool audio_wasapi_float_format;
@@ -656,6 +662,8 @@ typedef struct settings
       bool netplay_require_slaves;
       bool netplay_stateless_mode;
       bool netplay_nat_traversal;
+      bool netplay_udp_input;
+      bool netplay_spectator_relay;
       bool netplay_use_mitm_server;
       bool netplay_request_devices[MAX_USERS];
 
@@ -715,11 +723,15 @@ typedef struct settings
       bool history_list_enable;
       bool playlist_entry_rename;
       bool rewind_enable;
+      bool rewind_threaded;
       bool vrr_runloop_enable;
       bool apply_cheats_after_toggle;
       bool apply_cheats_after_load;
       bool run_ahead_enabled;
       bool run_ahead_secondary_instance;
+      bool run_ahead_secondary_thread;
+      bool run_ahead_preemptive;
+      bool run_ahead_auto;
       bool run_ahead_hide_warnings;
       bool pause_nonactive;
       bool block_sram_overwrite;
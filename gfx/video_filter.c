@@ -21,6 +21,7 @@
 #include <lists/dir_list.h>
 #include <dynamic/dylib.h>
 #include <features/features_cpu.h>
+#include <rthreads/parallel.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 
@@ -58,52 +59,18 @@ struct rarch_softfilter
 
    struct softfilter_work_packet *packets;
    unsigned threads;
-
-#ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
-#endif
-};
-
-#ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
-
-struct filter_thread_data
-{
-   sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
-   slock_t *lock;
-   void *userdata;
-   bool die;
-   bool done;
 };
 
-static void filter_thread_loop(void *data)
+/* Packets are independent, so the shared pool may run them in
+ * any order and on any thread, the calling one included */
+static void softfilter_run_packets(void *data, size_t begin, size_t end)
 {
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+   size_t i;
+   rarch_softfilter_t *filt = (rarch_softfilter_t*)data;
 
-   for (;;)
-   {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
-         break;
-
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
-
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
-   }
+   for (i = begin; i < end; i++)
+      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
 }
-#endif
 
 static const struct softfilter_implementation *
 softfilter_find_implementation(rarch_softfilter_t *filt, const char *ident)
@@ -211,7 +178,7 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    filt->impl_data = filt->impl->create(
          &softfilter_config, input_fmt, input_fmt, max_width, max_height,
          threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads :
-         cpu_features_get_core_amount(), cpu_features,
+         parallel_get_threads(), cpu_features,
          &userdata);
    if (!filt->impl_data)
    {
@@ -237,33 +204,6 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
       return false;
    }
 
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      filt->thread_data = (struct filter_thread_data*)
-         calloc(threads, sizeof(*filt->thread_data));
-      if (!filt->thread_data)
-         return false;
-
-      for (i = 0; i < threads; i++)
-      {
-         filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done     = true;
-
-         filt->thread_data[i].lock     = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond     = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread   = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
-            return false;
-      }
-   }
-#endif
-
    return true;
 }
 
@@ -486,27 +426,6 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    free(filt->plugs);
 #endif
 
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!&filt->thread_data[i])
-            continue;
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
-#endif
-
    if (filt->conf)
       config_file_free(filt->conf);
 
@@ -540,8 +459,6 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
       const void *input, unsigned width, unsigned height,
       size_t input_stride)
 {
-   unsigned i;
-
    if (!filt)
       return;
 
@@ -549,37 +466,5 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
       filt->impl->get_work_packets(filt->impl_data, filt->packets,
             output, output_stride, input, width, height, input_stride);
 
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-
-      /* Wait for workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Waiting for filter thread %u ...\n", i);
-#endif
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-      return;
-   }
-#endif
-
-   for (i = 0; i < filt->threads; i++)
-      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
+   parallel_for(0, filt->threads, 1, softfilter_run_packets, filt);
 }
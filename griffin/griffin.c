@@ -826,12 +826,14 @@ INPUT (HID)
 FIFO BUFFER
 ============================================================ */
 #include "../libretro-common/queues/fifo_queue.c"
+#include "../libretro-common/queues/spsc_queue.c"
 
 /*============================================================
 AUDIO RESAMPLER
 ============================================================ */
 #include "../libretro-common/audio/resampler/audio_resampler.c"
 #include "../libretro-common/audio/resampler/drivers/sinc_resampler.c"
+#include "../libretro-common/audio/resampler/drivers/polyphase_resampler.c"
 #ifdef HAVE_NEAREST_RESAMPLER
 #include "../libretro-common/audio/resampler/drivers/nearest_resampler.c"
 #endif
@@ -1018,6 +1020,9 @@ FILTERS
 #include "../libretro-common/audio/dsp_filters/phaser.c"
 #include "../libretro-common/audio/dsp_filters/reverb.c"
 #include "../libretro-common/audio/dsp_filters/wahwah.c"
+#include "../libretro-common/audio/dsp_filters/crystalizer.c"
+#include "../libretro-common/audio/dsp_filters/tremolo.c"
+#include "../libretro-common/audio/dsp_filters/vibrato.c"
 #endif
 #endif
 
@@ -1100,6 +1105,7 @@ CONFIGURATION
 /*============================================================
 STATE MANAGER
 ============================================================ */
+#include "../managers/state_delta.c"
 #ifdef HAVE_REWIND
 #include "../managers/state_manager.c"
 #endif
@@ -1273,6 +1279,9 @@ THREAD
 #include "../audio/audio_thread_wrapper.c"
 #endif
 
+/* Runs serially without threads */
+#include "../libretro-common/rthreads/parallel.c"
+
 /* needed for both playlists and netplay lobbies */
 #include "../libretro-common/formats/json/jsonsax_full.c"
 
@@ -1288,6 +1297,9 @@ NETPLAY
 #include "../network/netplay/netplay_sync.c"
 #include "../network/netplay/netplay_discovery.c"
 #include "../network/netplay/netplay_buf.c"
+#include "../network/netplay/netplay_hash.c"
+#include "../network/netplay/netplay_udp.c"
+#include "../network/netplay/netplay_relay.c"
 #include "../network/netplay/netplay_room_parse.c"
 #include "../libretro-common/net/net_compat.c"
 #include "../libretro-common/net/net_socket.c"
@@ -120,6 +120,8 @@ enum
 
    RARCH_AI_SERVICE,
 
+   RARCH_REWIND_SEEK,
+
    RARCH_BIND_LIST_END,
    RARCH_BIND_LIST_END_NULL
 };
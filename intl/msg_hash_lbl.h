@@ -102,6 +102,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_AUDIO_LATENCY,
    "audio_latency"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_AUDIO_PROCESS_THREAD,
+   "audio_process_thread"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_AUDIO_MAX_TIMING_SKEW,
    "audio_max_timing_skew"
@@ -1784,6 +1788,14 @@ MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL,
    "netplay_nat_traversal"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_UDP_INPUT,
+   "netplay_udp_input"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_SPECTATOR_RELAY,
+   "netplay_spectator_relay"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_NICKNAME,
    "netplay_nickname"
@@ -1844,6 +1856,14 @@ MSG_HASH(
    MENU_ENUM_LABEL_NETWORK_INFO_ENTRY,
    "network_info_entry"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_TASK_STATISTICS,
+   "task_statistics"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_TASK_STATS_ENTRY,
+   "task_stats_entry"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_NETWORK_REMOTE_ENABLE,
    "network_remote_enable"
@@ -2488,6 +2508,38 @@ MSG_HASH(
    MENU_ENUM_LABEL_REWIND_BUFFER_SIZE_STEP,
    "rewind_buffer_size_step"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_REWIND_THREADED,
+   "rewind_threaded"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_REWIND_TIER_AGE,
+   "rewind_tier_age"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_REWIND_DISK_BUFFER_SIZE,
+   "rewind_disk_buffer_size"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_REWIND_KEYFRAME_INTERVAL,
+   "rewind_keyframe_interval"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_REWIND_SEEK_SECONDS,
+   "rewind_seek_seconds"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_REWIND_SEEK_10,
+   "rewind_seek_10"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_REWIND_SEEK_30,
+   "rewind_seek_30"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_REWIND_SEEK_60,
+   "rewind_seek_60"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_REWIND_SETTINGS,
    "rewind_settings"
@@ -2686,6 +2738,18 @@ MSG_HASH(
    MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_INSTANCE,
    "run_ahead_secondary_instance"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD,
+   "run_ahead_secondary_thread"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_RUN_AHEAD_PREEMPTIVE,
+   "run_ahead_preemptive"
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_RUN_AHEAD_AUTO,
+   "run_ahead_auto"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_RUN_AHEAD_HIDE_WARNINGS,
    "run_ahead_hide_warnings"
@@ -2788,6 +2852,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_ENABLE,
    "threaded_data_runloop_enable"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_WORKERS,
+   "threaded_data_runloop_workers"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_THUMBNAILS,
    "thumbnails"
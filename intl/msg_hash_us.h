@@ -1842,6 +1842,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_AUDIO_LATENCY,
    "Desired audio latency in milliseconds. Might not be honored if the audio driver can't provide given latency."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_AUDIO_PROCESS_THREAD,
+   "Audio Processing Thread"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_AUDIO_PROCESS_THREAD,
+   "Resample, filter, mix and output audio on a thread of its own, so that the emulation thread only queues the samples the core produces. Adds up to one frame of latency."
+   )
 
 /* Settings > Audio > Resampler */
 
@@ -2533,6 +2541,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_INPUT_META_AI_SERVICE,
    "Captures an image of the current content then translates and/or reads aloud any on-screen text. Note: 'AI Service' Must be enabled and configured."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_INPUT_META_REWIND_SEEK,
+   "Rewind Seek"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_INPUT_META_REWIND_SEEK,
+   "Jumps back the number of seconds set in 'Rewind Seek Distance'. Rewind must be enabled."
+   )
 
 /* Settings > Input > Port # Binds */
 
@@ -2735,6 +2751,30 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_RUN_AHEAD_SECONDARY_INSTANCE,
    "Use a second instance of the RetroArch core to run-ahead. Prevents audio problems due to loading state."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_RUN_AHEAD_SECONDARY_THREAD,
+   "Run Second Instance on Its Own Thread"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_RUN_AHEAD_SECONDARY_THREAD,
+   "Run the second instance on a separate thread, at the same time as the main one. Needs a spare CPU core and a core that renders in software, other cores keep running both instances one after the other."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_RUN_AHEAD_PREEMPTIVE,
+   "Preemptive Frames"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_RUN_AHEAD_PREEMPTIVE,
+   "Keep the states of the last frames and only roll back and replay them when input changes. Same latency reduction as Run-Ahead at a fraction of the CPU cost while input is unchanged. Overrides 'Use Second Instance for Run-Ahead'."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_RUN_AHEAD_AUTO,
+   "Automatic Run-Ahead"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_RUN_AHEAD_AUTO,
+   "Time the core and its savestates while running and use as many frames as fit in the frame time, up to 'Number of Frames to Run-Ahead'. Also picks the cheaper of one or two instances. Backs off when the system falls behind."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_RUN_AHEAD_HIDE_WARNINGS,
    "Hide Run-Ahead Warnings"
@@ -3150,6 +3190,46 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_REWIND_BUFFER_SIZE_STEP,
    "Each time you increase or decrease the rewind buffer size value via this UI it will change by this amount"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REWIND_THREADED,
+   "Threaded Rewind Capture"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REWIND_THREADED,
+   "Compress rewind states on a separate thread. Reduces the per-frame cost of rewind on cores with large save states. Takes effect on next rewind initialization."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REWIND_TIER_AGE,
+   "Rewind Secondary Compression Age"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REWIND_TIER_AGE,
+   "Rewind history older than this many frames is compressed further on a separate thread, fitting more history into the same buffer size. 0 disables it. Takes effect on next rewind initialization."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REWIND_DISK_BUFFER_SIZE,
+   "Disk Rewind Buffer Size (MB)"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REWIND_DISK_BUFFER_SIZE,
+   "Keep the rewind buffer in a scratch file in the cache directory instead of memory, allowing hours of rewind history. 0 keeps it in memory. Takes effect on next rewind initialization."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REWIND_KEYFRAME_INTERVAL,
+   "Rewind Keyframe Interval"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REWIND_KEYFRAME_INTERVAL,
+   "Store a full state in the rewind buffer every this many rewind frames. Jumping back several seconds then costs about the same however far it goes, at the price of some buffer space. 0 disables it. Takes effect on next rewind initialization."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REWIND_SEEK_SECONDS,
+   "Rewind Seek Distance (Seconds)"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REWIND_SEEK_SECONDS,
+   "How far back the Rewind Seek hotkey jumps."
+   )
 
 /* Settings > Frame Throttle > Frame Time Counter */
 
@@ -3845,6 +3925,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_ENABLE,
    "Perform tasks on a separate thread."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_THREADED_DATA_RUNLOOP_WORKERS,
+   "Task Threads"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_WORKERS,
+   "Number of threads that run tasks. Thumbnails go first, and long scans never take every thread. 'Auto' picks it from the number of CPU cores."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_PAUSE_NONACTIVE,
    "Pause Content When Not Active"
@@ -4875,6 +4963,22 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_NETPLAY_NAT_TRAVERSAL,
    "When hosting, attempt to listen for connections from the public Internet, using UPnP or similar technologies to escape LANs."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_UDP_INPUT,
+   "Netplay UDP Input (Experimental)"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_UDP_INPUT,
+   "Also send input over UDP, repeating the last few frames in every packet, so a lost packet doesn't hold up later input. Both sides must enable it. Needs the UDP port to be reachable as well. Experimental: it cuts stalls on lossy links, but not rollbacks."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_SPECTATOR_RELAY,
+   "Netplay Spectator Relay"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_SPECTATOR_RELAY,
+   "When hosting, send to spectators from a separate thread. Each frame's input is prepared once for all of them, so a large audience doesn't slow down the host."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_NETPLAY_SHARE_DIGITAL,
    "Digital Input Sharing"
@@ -5963,6 +6067,30 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_UNDO_SAVE_STATE,
    "If a state was overwritten, it will roll back to the previous save state."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REWIND_SEEK_10,
+   "Rewind 10 Seconds"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REWIND_SEEK_10,
+   "Jump back 10 seconds in the rewind history."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REWIND_SEEK_30,
+   "Rewind 30 Seconds"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REWIND_SEEK_30,
+   "Jump back 30 seconds in the rewind history."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_REWIND_SEEK_60,
+   "Rewind 60 Seconds"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_REWIND_SEEK_60,
+   "Jump back 60 seconds in the rewind history."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_ADD_TO_FAVORITES,
    "Add to Favorites"
@@ -9416,6 +9544,14 @@ MSG_HASH(
    MENU_ENUM_LABEL_VALUE_FRONTEND_COUNTERS,
    "Frontend Counters"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_TASK_STATISTICS,
+   "Task Statistics"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_TASK_STATISTICS,
+   "Show how long finished background tasks waited to start and ran, per kind of task."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_HORIZONTAL_MENU,
    "Horizontal Menu"
@@ -10736,6 +10872,18 @@ MSG_HASH(
    MSG_INTERFACE,
    "Interface"
    )
+MSG_HASH(
+   MSG_TASK_STATS_WAIT,
+   "Waiting"
+   )
+MSG_HASH(
+   MSG_TASK_STATS_RUN,
+   "Running"
+   )
+MSG_HASH(
+   MSG_TASK_STATS_ITERATIONS,
+   "Handler calls"
+   )
 MSG_HASH(
    MSG_INTERNAL_STORAGE,
    "Internal Storage"
@@ -10940,6 +11088,10 @@ MSG_HASH(
    MSG_REWIND_REACHED_END,
    "Reached end of rewind buffer."
    )
+MSG_HASH(
+   MSG_REWIND_SEEK,
+   "Rewound %.1f seconds."
+   )
 MSG_HASH(
    MSG_SAVED_NEW_CONFIG_TO,
    "Saved new config to"
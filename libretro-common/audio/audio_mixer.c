@@ -31,12 +31,21 @@
 #include <formats/rwav.h>
 #endif
 #include <memalign.h>
+#include <queues/spsc_queue.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 #ifdef HAVE_STB_VORBIS
 #define STB_VORBIS_NO_PUSHDATA_API
 #define STB_VORBIS_NO_STDIO
@@ -61,8 +70,12 @@
 #include <ibxm/ibxm.h>
 #endif
 
-#define AUDIO_MIXER_MAX_VOICES      8
+#define AUDIO_MIXER_MAX_VOICES      16
 #define AUDIO_MIXER_TEMP_BUFFER 8192
+/* Decode steps each compressed voice keeps ready */
+#define AUDIO_MIXER_RING_CHUNKS     4
+/* Samples copied out of a ring at a time when mixing */
+#define AUDIO_MIXER_MIX_CHUNK       512
 
 struct audio_mixer_sound
 {
@@ -131,8 +144,6 @@ struct audio_mixer_voice
          void       *resampler_data;
          const retro_resampler_t *resampler;
          float      *buffer;
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float       ratio;
       } ogg;
@@ -145,8 +156,6 @@ struct audio_mixer_voice
          drflac      *stream;
          void        *resampler_data;
          const retro_resampler_t *resampler;
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float       ratio;
       } flac;
@@ -159,8 +168,6 @@ struct audio_mixer_voice
          void        *resampler_data;
          const retro_resampler_t *resampler;
          float*      buffer;
-         unsigned    position;
-         unsigned    samples;
          unsigned    buf_samples;
          float       ratio;
       } mp3;
@@ -172,12 +179,32 @@ struct audio_mixer_voice
          int*              buffer;
          struct replay*    stream;
          struct module*    module;
-         unsigned          position;
-         unsigned          samples;
          unsigned          buf_samples;
       } mod;
 #endif
    } types;
+
+   /* Compressed voices are decoded ahead of time into a ring of
+    * stereo float samples at the mixer's rate, by the decoder thread
+    * when there is one, so that mixing them only copies. */
+   struct
+   {
+      spsc_queue_t *ring;
+      /* Most samples one decode step writes */
+      unsigned chunk;
+      /* Times the decoder went back to the start, and how many of
+       * those the mix has reported */
+      unsigned loops;
+      unsigned loops_reported;
+      /* The decoder got to the end */
+      bool     ended;
+      /* Cleared once the voice is stopped or has finished */
+      bool     active;
+   } stream;
+#ifdef HAVE_THREADS
+   /* Held by the decoder while it works on the voice */
+   slock_t *lock;
+#endif
    audio_mixer_sound_t *sound;
    audio_mixer_stop_cb_t stop_cb;
    unsigned type;
@@ -189,6 +216,90 @@ struct audio_mixer_voice
 /* TODO/FIXME - static globals */
 static struct audio_mixer_voice s_voices[AUDIO_MIXER_MAX_VOICES] = {0};
 static unsigned s_rate = 0;
+/* Scratch for decoding on the mixing thread, if there is no decoder
+ * thread */
+static float s_decode_buffer[AUDIO_MIXER_TEMP_BUFFER];
+
+#ifdef HAVE_THREADS
+static sthread_t *s_decoder_thread = NULL;
+static slock_t *s_decoder_lock     = NULL;
+static scond_t *s_decoder_cond     = NULL;
+static bool s_decoder_wake         = false;
+static bool s_decoder_quit         = false;
+
+#define audio_mixer_voice_lock(voice)     slock_lock((voice)->lock)
+#define audio_mixer_voice_unlock(voice)   slock_unlock((voice)->lock)
+#define audio_mixer_voice_try_lock(voice) \
+   (!(voice)->lock || slock_try_lock((voice)->lock))
+#define audio_mixer_decoder_running()     (s_decoder_thread != NULL)
+#else
+#define audio_mixer_voice_lock(voice)     ((void)0)
+#define audio_mixer_voice_unlock(voice)   ((void)0)
+#define audio_mixer_voice_try_lock(voice) true
+#define audio_mixer_decoder_running()     false
+#endif
+
+/* buffer += pcm * volume */
+static void audio_mixer_accumulate(float *buffer, const float *pcm,
+      size_t samples, float volume)
+{
+   size_t i = 0;
+#if defined(__SSE__)
+   __m128 gain = _mm_set1_ps(volume);
+
+   for (; i + 8 <= samples; i += 8)
+   {
+      __m128 a = _mm_add_ps(_mm_loadu_ps(buffer + i),
+            _mm_mul_ps(_mm_loadu_ps(pcm + i), gain));
+      __m128 b = _mm_add_ps(_mm_loadu_ps(buffer + i + 4),
+            _mm_mul_ps(_mm_loadu_ps(pcm + i + 4), gain));
+      _mm_storeu_ps(buffer + i,     a);
+      _mm_storeu_ps(buffer + i + 4, b);
+   }
+#endif
+
+   for (; i < samples; i++)
+      buffer[i] += pcm[i] * volume;
+}
+
+static void audio_mixer_clamp(float *buffer, size_t samples)
+{
+   size_t i = 0;
+#if defined(__SSE__)
+   __m128 lo = _mm_set1_ps(-1.0f);
+   __m128 hi = _mm_set1_ps(1.0f);
+
+   for (; i + 4 <= samples; i += 4)
+      _mm_storeu_ps(buffer + i, _mm_min_ps(_mm_max_ps(
+                  _mm_loadu_ps(buffer + i), lo), hi));
+#endif
+
+   for (; i < samples; i++)
+   {
+      if (buffer[i] < -1.0f)
+         buffer[i] = -1.0f;
+      else if (buffer[i] > 1.0f)
+         buffer[i] = 1.0f;
+   }
+}
+
+/* Gives a compressed voice an empty ring with room for a few decode
+ * steps of @chunk samples. Called with the voice locked. */
+static bool audio_mixer_stream_start(audio_mixer_voice_t *voice,
+      unsigned chunk)
+{
+   if (voice->stream.ring)
+      spsc_queue_free(voice->stream.ring);
+
+   voice->stream.ring           = spsc_queue_new(
+         (size_t)chunk * AUDIO_MIXER_RING_CHUNKS * sizeof(float));
+   voice->stream.chunk          = chunk;
+   voice->stream.loops          = 0;
+   voice->stream.loops_reported = 0;
+   voice->stream.ended          = false;
+
+   return voice->stream.ring != NULL;
+}
 
 #ifdef HAVE_RWAV
 static bool wav_to_float(const rwav_t* wav, float** pcm, size_t samples_out)
@@ -305,6 +416,237 @@ static bool one_shot_resample(const float* in, size_t samples_in,
 }
 #endif
 
+/* Resamples @samples of decoded audio to the mixer's rate, if the
+ * sound needs it, and queues them. */
+static void audio_mixer_stream_write(audio_mixer_voice_t *voice,
+      const retro_resampler_t *resampler, void *resampler_data,
+      float ratio, float *resampled, const float *pcm, unsigned samples)
+{
+   if (resampler)
+   {
+      struct resampler_data info;
+      info.data_in       = pcm;
+      info.data_out      = resampled;
+      info.input_frames  = samples / 2;
+      info.output_frames = 0;
+      info.ratio         = ratio;
+
+      resampler->process(resampler_data, &info);
+
+      pcm                = resampled;
+      samples            = (unsigned)(info.output_frames * 2);
+   }
+
+   spsc_queue_write(voice->stream.ring, pcm, samples * sizeof(float));
+}
+
+#ifdef HAVE_STB_VORBIS
+static bool audio_mixer_decode_ogg(audio_mixer_voice_t *voice, float *temp)
+{
+   unsigned samples = stb_vorbis_get_samples_float_interleaved(
+         voice->types.ogg.stream, 2, temp, AUDIO_MIXER_TEMP_BUFFER) * 2;
+
+   if (!samples && voice->repeat)
+   {
+      stb_vorbis_seek_start(voice->types.ogg.stream);
+      voice->stream.loops++;
+      samples = stb_vorbis_get_samples_float_interleaved(
+            voice->types.ogg.stream, 2, temp, AUDIO_MIXER_TEMP_BUFFER) * 2;
+   }
+
+   if (!samples)
+      return false;
+
+   audio_mixer_stream_write(voice, voice->types.ogg.resampler,
+         voice->types.ogg.resampler_data, voice->types.ogg.ratio,
+         voice->types.ogg.buffer, temp, samples);
+   return true;
+}
+#endif
+
+#ifdef HAVE_IBXM
+static bool audio_mixer_decode_mod(audio_mixer_voice_t *voice, float *temp)
+{
+   unsigned i, done;
+   const int *pcm   = voice->types.mod.buffer;
+   unsigned samples = replay_get_audio(
+         voice->types.mod.stream, voice->types.mod.buffer) * 2;
+
+   if (!samples && voice->repeat)
+   {
+      replay_seek(voice->types.mod.stream, 0);
+      voice->stream.loops++;
+      samples = replay_get_audio(
+            voice->types.mod.stream, voice->types.mod.buffer) * 2;
+   }
+
+   if (!samples)
+      return false;
+
+   /* Volume is applied when mixing, like the other types */
+   for (done = 0; done < samples; done += i)
+   {
+      unsigned n = samples - done;
+
+      if (n > AUDIO_MIXER_TEMP_BUFFER)
+         n = AUDIO_MIXER_TEMP_BUFFER;
+
+      for (i = 0; i < n; i++)
+         temp[i] = (float)(pcm[done + i] + 32768) / 65535.0f * 2.0f - 1.0f;
+
+      spsc_queue_write(voice->stream.ring, temp, n * sizeof(float));
+   }
+   return true;
+}
+#endif
+
+#ifdef HAVE_DR_FLAC
+static bool audio_mixer_decode_flac(audio_mixer_voice_t *voice, float *temp)
+{
+   unsigned samples = (unsigned)drflac_read_f32(voice->types.flac.stream,
+         AUDIO_MIXER_TEMP_BUFFER, temp);
+
+   if (!samples && voice->repeat)
+   {
+      drflac_seek_to_sample(voice->types.flac.stream, 0);
+      voice->stream.loops++;
+      samples = (unsigned)drflac_read_f32(voice->types.flac.stream,
+            AUDIO_MIXER_TEMP_BUFFER, temp);
+   }
+
+   if (!samples)
+      return false;
+
+   audio_mixer_stream_write(voice, voice->types.flac.resampler,
+         voice->types.flac.resampler_data, voice->types.flac.ratio,
+         voice->types.flac.buffer, temp, samples);
+   return true;
+}
+#endif
+
+#ifdef HAVE_DR_MP3
+static bool audio_mixer_decode_mp3(audio_mixer_voice_t *voice, float *temp)
+{
+   unsigned samples = (unsigned)drmp3_read_f32(&voice->types.mp3.stream,
+         AUDIO_MIXER_TEMP_BUFFER / 2, temp) * 2;
+
+   if (!samples && voice->repeat)
+   {
+      drmp3_seek_to_frame(&voice->types.mp3.stream, 0);
+      voice->stream.loops++;
+      samples = (unsigned)drmp3_read_f32(&voice->types.mp3.stream,
+            AUDIO_MIXER_TEMP_BUFFER / 2, temp) * 2;
+   }
+
+   if (!samples)
+      return false;
+
+   audio_mixer_stream_write(voice, voice->types.mp3.resampler,
+         voice->types.mp3.resampler_data, voice->types.mp3.ratio,
+         voice->types.mp3.buffer, temp, samples);
+   return true;
+}
+#endif
+
+/* Decodes one step of a compressed voice into its ring, if there is
+ * room for it. Called with the voice locked.
+ * Returns false if there was nothing to do. */
+static bool audio_mixer_stream_decode(audio_mixer_voice_t *voice,
+      float *temp)
+{
+   bool more = false;
+
+   if (     !voice->stream.active
+         ||  voice->stream.ended
+         ||  spsc_queue_write_avail(voice->stream.ring)
+         <   voice->stream.chunk * sizeof(float))
+      return false;
+
+   switch (voice->type)
+   {
+      case AUDIO_MIXER_TYPE_OGG:
+#ifdef HAVE_STB_VORBIS
+         more = audio_mixer_decode_ogg(voice, temp);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MOD:
+#ifdef HAVE_IBXM
+         more = audio_mixer_decode_mod(voice, temp);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_FLAC:
+#ifdef HAVE_DR_FLAC
+         more = audio_mixer_decode_flac(voice, temp);
+#endif
+         break;
+      case AUDIO_MIXER_TYPE_MP3:
+#ifdef HAVE_DR_MP3
+         more = audio_mixer_decode_mp3(voice, temp);
+#endif
+         break;
+      default:
+         break;
+   }
+
+   if (!more)
+      voice->stream.ended = true;
+   return true;
+}
+
+#ifdef HAVE_THREADS
+/* Keeps the rings of all compressed voices topped up, and sleeps
+ * until the mix or a new voice wants more. */
+static void audio_mixer_decoder_loop(void *data)
+{
+   float *temp = (float*)malloc(AUDIO_MIXER_TEMP_BUFFER * sizeof(float));
+
+   if (!temp)
+      return;
+
+   for (;;)
+   {
+      unsigned i;
+      bool quit = false;
+      bool busy = false;
+
+      for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+      {
+         audio_mixer_voice_t *voice = &s_voices[i];
+
+         slock_lock(voice->lock);
+         if (audio_mixer_stream_decode(voice, temp))
+            busy = true;
+         slock_unlock(voice->lock);
+      }
+
+      slock_lock(s_decoder_lock);
+      if (!busy && !s_decoder_wake && !s_decoder_quit)
+         scond_wait(s_decoder_cond, s_decoder_lock);
+      quit           = s_decoder_quit;
+      s_decoder_wake = false;
+      slock_unlock(s_decoder_lock);
+
+      if (quit)
+         break;
+   }
+
+   free(temp);
+}
+#endif
+
+static void audio_mixer_decoder_wake(void)
+{
+#ifdef HAVE_THREADS
+   if (!s_decoder_thread)
+      return;
+
+   slock_lock(s_decoder_lock);
+   s_decoder_wake = true;
+   scond_signal(s_decoder_cond);
+   slock_unlock(s_decoder_lock);
+#endif
+}
+
 void audio_mixer_init(unsigned rate)
 {
    unsigned i;
@@ -313,14 +655,64 @@ void audio_mixer_init(unsigned rate)
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
       s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
+
+#ifdef HAVE_THREADS
+   if (s_decoder_thread)
+      return;
+
+   for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
+   {
+      if (!s_voices[i].lock && !(s_voices[i].lock = slock_new()))
+         return;
+   }
+
+   s_decoder_lock = slock_new();
+   s_decoder_cond = scond_new();
+   s_decoder_wake = false;
+   s_decoder_quit = false;
+
+   /* Without a thread, voices are decoded as they are mixed */
+   if (s_decoder_lock && s_decoder_cond)
+      s_decoder_thread = sthread_create(audio_mixer_decoder_loop, NULL);
+#endif
 }
 
 void audio_mixer_done(void)
 {
    unsigned i;
 
+#ifdef HAVE_THREADS
+   if (s_decoder_thread)
+   {
+      slock_lock(s_decoder_lock);
+      s_decoder_quit = true;
+      scond_signal(s_decoder_cond);
+      slock_unlock(s_decoder_lock);
+
+      sthread_join(s_decoder_thread);
+      s_decoder_thread = NULL;
+   }
+
+   slock_free(s_decoder_lock);
+   scond_free(s_decoder_cond);
+   s_decoder_lock = NULL;
+   s_decoder_cond = NULL;
+#endif
+
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++)
-      s_voices[i].type = AUDIO_MIXER_TYPE_NONE;
+   {
+      s_voices[i].type          = AUDIO_MIXER_TYPE_NONE;
+      s_voices[i].stream.active = false;
+
+      if (s_voices[i].stream.ring)
+         spsc_queue_free(s_voices[i].stream.ring);
+      s_voices[i].stream.ring   = NULL;
+
+#ifdef HAVE_THREADS
+      slock_free(s_voices[i].lock);
+      s_voices[i].lock          = NULL;
+#endif
+   }
 }
 
 audio_mixer_sound_t* audio_mixer_load_wav(void *buffer, int32_t size)
@@ -561,10 +953,9 @@ static bool audio_mixer_play_ogg(
    voice->types.ogg.buf_samples    = samples;
    voice->types.ogg.ratio          = ratio;
    voice->types.ogg.stream         = stb_vorbis;
-   voice->types.ogg.position       = 0;
-   voice->types.ogg.samples        = 0;
 
-   return true;
+   /* The resampler may write a few samples more than the ratio says */
+   return audio_mixer_stream_start(voice, samples + 16);
 
 error:
    stb_vorbis_close(stb_vorbis);
@@ -636,10 +1027,8 @@ static bool audio_mixer_play_mod(
    voice->types.mod.buffer         = (int*)mod_buffer;
    voice->types.mod.buf_samples    = buf_samples;
    voice->types.mod.stream         = replay;
-   voice->types.mod.position       = 0;
-   voice->types.mod.samples        = 0; /* samples; */
 
-   return true;
+   return audio_mixer_stream_start(voice, buf_samples);
 
 error:
    if (mod_buffer)
@@ -701,10 +1090,8 @@ static bool audio_mixer_play_flac(
    voice->types.flac.buf_samples    = samples;
    voice->types.flac.ratio          = ratio;
    voice->types.flac.stream         = dr_flac;
-   voice->types.flac.position       = 0;
-   voice->types.flac.samples        = 0;
 
-   return true;
+   return audio_mixer_stream_start(voice, samples + 16);
 
 error:
    drflac_close(dr_flac);
@@ -769,10 +1156,8 @@ static bool audio_mixer_play_mp3(
    voice->types.mp3.buffer         = (float*)mp3_buffer;
    voice->types.mp3.buf_samples    = samples;
    voice->types.mp3.ratio          = ratio;
-   voice->types.mp3.position       = 0;
-   voice->types.mp3.samples        = 0;
 
-   return true;
+   return audio_mixer_stream_start(voice, samples + 16);
 
 error:
    drmp3_uninit(&voice->types.mp3.stream);
@@ -795,6 +1180,10 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
       if (voice->type != AUDIO_MIXER_TYPE_NONE)
          continue;
 
+      /* The decoder may still be finishing a step of what the voice
+       * played last */
+      audio_mixer_voice_lock(voice);
+
       switch (sound->type)
       {
          case AUDIO_MIXER_TYPE_WAV:
@@ -827,16 +1216,26 @@ audio_mixer_voice_t* audio_mixer_play(audio_mixer_sound_t* sound, bool repeat,
       break;
    }
 
+   if (i == AUDIO_MIXER_MAX_VOICES)
+      return NULL;
+
    if (res)
    {
-      voice->type     = sound->type;
-      voice->repeat   = repeat;
-      voice->volume   = volume;
-      voice->sound    = sound;
-      voice->stop_cb  = stop_cb;
+      voice->type          = sound->type;
+      voice->repeat        = repeat;
+      voice->volume        = volume;
+      voice->sound         = sound;
+      voice->stop_cb       = stop_cb;
+      voice->stream.active = sound->type != AUDIO_MIXER_TYPE_WAV;
    }
-   else
-      voice = NULL;
+
+   audio_mixer_voice_unlock(voice);
+
+   if (!res)
+      return NULL;
+
+   if (voice->stream.active)
+      audio_mixer_decoder_wake();
 
    return voice;
 }
@@ -851,6 +1250,12 @@ void audio_mixer_stop(audio_mixer_voice_t* voice)
       stop_cb     = voice->stop_cb;
       sound       = voice->sound;
 
+      /* Once this returns the decoder is done with the sound, and it
+       * can be destroyed */
+      audio_mixer_voice_lock(voice);
+      voice->stream.active = false;
+      audio_mixer_voice_unlock(voice);
+
       voice->type = AUDIO_MIXER_TYPE_NONE;
 
       if (stop_cb)
@@ -862,7 +1267,6 @@ static void audio_mixer_mix_wav(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
       float volume)
 {
-   int i;
    unsigned buf_free                = (unsigned)(num_frames * 2);
    const audio_mixer_sound_t* sound = voice->sound;
    unsigned pcm_available           = sound->types.wav.frames
@@ -873,8 +1277,8 @@ static void audio_mixer_mix_wav(float* buffer, size_t num_frames,
 again:
    if (pcm_available < buf_free)
    {
-      for (i = pcm_available; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+      audio_mixer_accumulate(buffer, pcm, pcm_available, volume);
+      buffer += pcm_available;
 
       if (voice->repeat)
       {
@@ -895,311 +1299,82 @@ again:
    }
    else
    {
-      for (i = buf_free; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+      audio_mixer_accumulate(buffer, pcm, buf_free, volume);
 
       voice->types.wav.position += buf_free;
    }
 }
 
-#ifdef HAVE_STB_VORBIS
-static void audio_mixer_mix_ogg(float* buffer, size_t num_frames,
+static void audio_mixer_mix_stream(float* buffer, size_t num_frames,
       audio_mixer_voice_t* voice,
-      float volume)
+      float volume, bool *refill)
 {
-   int i;
-   float* temp_buffer = NULL;
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
+   float pcm[AUDIO_MIXER_MIX_CHUNK];
+   bool finished      = false;
+   unsigned loops     = voice->stream.loops_reported;
+   size_t samples     = num_frames * 2;
+   spsc_queue_t *ring = voice->stream.ring;
 
-   if (voice->types.ogg.position == voice->types.ogg.samples)
+   if (!audio_mixer_decoder_running())
    {
-again:
-      if (temp_buffer == NULL)
-         temp_buffer = (float*)malloc(AUDIO_MIXER_TEMP_BUFFER * sizeof(float));
-
-      temp_samples = stb_vorbis_get_samples_float_interleaved(
-            voice->types.ogg.stream, 2, temp_buffer,
-            AUDIO_MIXER_TEMP_BUFFER) * 2;
-
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            stb_vorbis_seek_start(voice->types.ogg.stream);
-            goto again;
-         }
-
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-         voice->type = AUDIO_MIXER_TYPE_NONE;
-         goto cleanup;
-      }
-
-      if (voice->types.ogg.resampler)
-      {
-         struct resampler_data info;
-         info.data_in = temp_buffer;
-         info.data_out = voice->types.ogg.buffer;
-         info.input_frames = temp_samples / 2;
-         info.output_frames = 0;
-         info.ratio = voice->types.ogg.ratio;
-
-         voice->types.ogg.resampler->process(
-               voice->types.ogg.resampler_data, &info);
-      }
-      else
-         memcpy(voice->types.ogg.buffer, temp_buffer,
-               temp_samples * sizeof(float));
-
-      voice->types.ogg.position = 0;
-      voice->types.ogg.samples  = voice->types.ogg.buf_samples;
-   }
-
-   pcm = voice->types.ogg.buffer + voice->types.ogg.position;
-
-   if (voice->types.ogg.samples < buf_free)
-   {
-      for (i = voice->types.ogg.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.ogg.samples;
-      goto again;
+      audio_mixer_voice_lock(voice);
+      while (     spsc_queue_read_avail(ring) < samples * sizeof(float)
+            &&    audio_mixer_stream_decode(voice, s_decode_buffer))
+         ;
+      audio_mixer_voice_unlock(voice);
    }
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
-
-   voice->types.ogg.position += buf_free;
-   voice->types.ogg.samples  -= buf_free;
-
-cleanup:
-   if (temp_buffer != NULL)
-      free(temp_buffer);
-}
-#endif
-
-#ifdef HAVE_IBXM
-static void audio_mixer_mix_mod(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   float samplef                    = 0.0f;
-   int samplei                      = 0;
-   unsigned temp_samples            = 0;
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   int* pcm                         = NULL;
-
-   if (voice->types.mod.position == voice->types.mod.samples)
+   while (samples)
    {
-again:
-      temp_samples = replay_get_audio(
-            voice->types.mod.stream, voice->types.mod.buffer );
-
-      temp_samples *= 2; /* stereo */
-
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
+      size_t n = spsc_queue_read(ring, pcm, (samples < AUDIO_MIXER_MIX_CHUNK
+               ? samples : AUDIO_MIXER_MIX_CHUNK) * sizeof(float))
+         / sizeof(float);
 
-            replay_seek( voice->types.mod.stream, 0);
-            goto again;
-         }
-
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-         voice->type = AUDIO_MIXER_TYPE_NONE;
-         return;
-      }
-
-      voice->types.mod.position = 0;
-      voice->types.mod.samples  = temp_samples;
-   }
-   pcm = voice->types.mod.buffer + voice->types.mod.position;
-
-   if (voice->types.mod.samples < buf_free)
-   {
-      for (i = voice->types.mod.samples; i != 0; i--)
-      {
-         samplei     = *pcm++ * volume;
-         samplef     = (float)((int)samplei + 32768) / 65535.0f;
-         samplef     = samplef * 2.0f - 1.0f;
-         *buffer++  += samplef;
-      }
-
-      buf_free -= voice->types.mod.samples;
-      goto again;
-   }
-
-   for (i = buf_free; i != 0; --i )
-   {
-      samplei     = *pcm++ * volume;
-      samplef     = (float)((int)samplei + 32768) / 65535.0f;
-      samplef     = samplef * 2.0f - 1.0f;
-      *buffer++  += samplef;
-   }
-
-   voice->types.mod.position += buf_free;
-   voice->types.mod.samples  -= buf_free;
-}
-#endif
-
-#ifdef HAVE_DR_FLAC
-static void audio_mixer_mix_flac(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   struct resampler_data info;
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float *pcm                       = NULL;
-
-   if (voice->types.flac.position == voice->types.flac.samples)
-   {
-again:
-      temp_samples = (unsigned)drflac_read_f32( voice->types.flac.stream, AUDIO_MIXER_TEMP_BUFFER, temp_buffer);
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            drflac_seek_to_sample(voice->types.flac.stream,0);
-            goto again;
-         }
-
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-         voice->type = AUDIO_MIXER_TYPE_NONE;
-         return;
-      }
+      if (!n)
+         break;
 
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.flac.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.flac.ratio;
-
-      if (voice->types.flac.resampler)
-         voice->types.flac.resampler->process(
-               voice->types.flac.resampler_data, &info);
-      else
-         memcpy(voice->types.flac.buffer, temp_buffer, temp_samples * sizeof(float));
-      voice->types.flac.position = 0;
-      voice->types.flac.samples  = voice->types.flac.buf_samples;
+      audio_mixer_accumulate(buffer, pcm, n, volume);
+      buffer  += n;
+      samples -= n;
    }
 
-   pcm = voice->types.flac.buffer + voice->types.flac.position;
-
-   if (voice->types.flac.samples < buf_free)
+   /* Never wait for the decoder here. If it is busy with this voice,
+    * whatever it has to tell keeps until the next mix. */
+   if (audio_mixer_voice_try_lock(voice))
    {
-      for (i = voice->types.flac.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
-
-      buf_free -= voice->types.flac.samples;
-      goto again;
+      loops    = voice->stream.loops;
+      finished = voice->stream.ended && !spsc_queue_read_avail(ring);
+      if (finished)
+         voice->stream.active = false;
+      audio_mixer_voice_unlock(voice);
    }
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
-
-   voice->types.flac.position += buf_free;
-   voice->types.flac.samples  -= buf_free;
-}
-#endif
-
-#ifdef HAVE_DR_MP3
-static void audio_mixer_mix_mp3(float* buffer, size_t num_frames,
-      audio_mixer_voice_t* voice,
-      float volume)
-{
-   int i;
-   struct resampler_data info;
-   float temp_buffer[AUDIO_MIXER_TEMP_BUFFER] = { 0 };
-   unsigned buf_free                = (unsigned)(num_frames * 2);
-   unsigned temp_samples            = 0;
-   float* pcm                       = NULL;
-
-   if (voice->types.mp3.position == voice->types.mp3.samples)
+   /* Reported as the decoder gets there, which is a little early */
+   while (voice->stream.loops_reported != loops)
    {
-again:
-      temp_samples = (unsigned)drmp3_read_f32(
-            &voice->types.mp3.stream,
-            AUDIO_MIXER_TEMP_BUFFER / 2, temp_buffer) * 2;
-
-      if (temp_samples == 0)
-      {
-         if (voice->repeat)
-         {
-            if (voice->stop_cb)
-               voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
-
-            drmp3_seek_to_frame(&voice->types.mp3.stream,0);
-            goto again;
-         }
-
-         if (voice->stop_cb)
-            voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
-
-         voice->type = AUDIO_MIXER_TYPE_NONE;
-         return;
-      }
-
-      info.data_in              = temp_buffer;
-      info.data_out             = voice->types.mp3.buffer;
-      info.input_frames         = temp_samples / 2;
-      info.output_frames        = 0;
-      info.ratio                = voice->types.mp3.ratio;
-
-      if (voice->types.mp3.resampler)
-         voice->types.mp3.resampler->process(
-               voice->types.mp3.resampler_data, &info);
-      else
-         memcpy(voice->types.mp3.buffer, temp_buffer,
-               temp_samples * sizeof(float));
-      voice->types.mp3.position = 0;
-      voice->types.mp3.samples  = voice->types.mp3.buf_samples;
+      voice->stream.loops_reported++;
+      if (voice->stop_cb)
+         voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_REPEATED);
    }
 
-   pcm = voice->types.mp3.buffer + voice->types.mp3.position;
-
-   if (voice->types.mp3.samples < buf_free)
+   if (finished)
    {
-      for (i = voice->types.mp3.samples; i != 0; i--)
-         *buffer++ += *pcm++ * volume;
+      if (voice->stop_cb)
+         voice->stop_cb(voice->sound, AUDIO_MIXER_SOUND_FINISHED);
 
-      buf_free -= voice->types.mp3.samples;
-      goto again;
+      voice->type = AUDIO_MIXER_TYPE_NONE;
+      return;
    }
 
-   for (i = buf_free; i != 0; --i )
-      *buffer++ += *pcm++ * volume;
-
-   voice->types.mp3.position += buf_free;
-   voice->types.mp3.samples  -= buf_free;
+   if (spsc_queue_read_avail(ring) < spsc_queue_size(ring) / 2)
+      *refill = true;
 }
-#endif
 
 void audio_mixer_mix(float* buffer, size_t num_frames,
       float volume_override, bool override)
 {
    unsigned i;
-   size_t j                   = 0;
-   float* sample              = NULL;
+   bool refill                = false;
    audio_mixer_voice_t* voice = s_voices;
 
    for (i = 0; i < AUDIO_MIXER_MAX_VOICES; i++, voice++)
@@ -1212,37 +1387,21 @@ void audio_mixer_mix(float* buffer, size_t num_frames,
             audio_mixer_mix_wav(buffer, num_frames, voice, volume);
             break;
          case AUDIO_MIXER_TYPE_OGG:
-#ifdef HAVE_STB_VORBIS
-            audio_mixer_mix_ogg(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_MOD:
-#ifdef HAVE_IBXM
-            audio_mixer_mix_mod(buffer, num_frames, voice, volume);
-#endif
-            break;
          case AUDIO_MIXER_TYPE_FLAC:
-#ifdef HAVE_DR_FLAC
-            audio_mixer_mix_flac(buffer, num_frames, voice, volume);
-#endif
-            break;
-            case AUDIO_MIXER_TYPE_MP3:
-#ifdef HAVE_DR_MP3
-            audio_mixer_mix_mp3(buffer, num_frames, voice, volume);
-#endif
+         case AUDIO_MIXER_TYPE_MP3:
+            audio_mixer_mix_stream(buffer, num_frames, voice, volume,
+                  &refill);
             break;
          case AUDIO_MIXER_TYPE_NONE:
             break;
       }
    }
 
-   for (j = 0, sample = buffer; j < num_frames * 2; j++, sample++)
-   {
-      if (*sample < -1.0f)
-         *sample = -1.0f;
-      else if (*sample > 1.0f)
-         *sample = 1.0f;
-   }
+   audio_mixer_clamp(buffer, num_frames * 2);
+
+   if (refill)
+      audio_mixer_decoder_wake();
 }
 
 float audio_mixer_voice_get_volume(audio_mixer_voice_t *voice)
@@ -22,6 +22,7 @@
 
 #include <stdlib.h>
 
+#include <boolean.h>
 #include <retro_miscellaneous.h>
 
 #include <compat/posix_string.h>
@@ -36,6 +37,10 @@
 
 #include <audio/dsp_filter.h>
 
+/* Frames each stage gets at a time once the whole graph is known to
+ * work in place. Small enough to stay in the cache between stages. */
+#define DSP_GRAPH_BLOCK_FRAMES 256
+
 struct retro_dsp_plug
 {
 #ifdef HAVE_DYLIB
@@ -59,6 +64,11 @@ struct retro_dsp_filter
 
    struct retro_dsp_instance *instances;
    unsigned num_instances;
+
+   /* Set after the first call if every stage wrote its output over
+    * its input, frame for frame. */
+   bool graph_probed;
+   bool graph_in_place;
 };
 
 static const struct dspfilter_implementation *find_implementation(
@@ -141,6 +151,10 @@ extern const struct dspfilter_implementation *phaser_dspfilter_get_implementatio
 extern const struct dspfilter_implementation *wahwah_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 extern const struct dspfilter_implementation *eq_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 extern const struct dspfilter_implementation *chorus_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *reverb_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *delta_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *tremolo_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *vibrato_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
 
 static const dspfilter_get_implementation_t dsp_plugs_builtin[] = {
    panning_dspfilter_get_implementation,
@@ -150,6 +164,10 @@ static const dspfilter_get_implementation_t dsp_plugs_builtin[] = {
    wahwah_dspfilter_get_implementation,
    eq_dspfilter_get_implementation,
    chorus_dspfilter_get_implementation,
+   reverb_dspfilter_get_implementation,
+   delta_dspfilter_get_implementation,
+   tremolo_dspfilter_get_implementation,
+   vibrato_dspfilter_get_implementation,
 };
 
 static bool append_plugs(retro_dsp_filter_t *dsp, struct string_list *list)
@@ -301,13 +319,50 @@ void retro_dsp_filter_free(retro_dsp_filter_t *dsp)
    free(dsp);
 }
 
+/* Runs every stage over one block before moving on to the next, on
+ * the caller's buffer. */
+static void retro_dsp_filter_process_in_place(retro_dsp_filter_t *dsp,
+      struct retro_dsp_data *data)
+{
+   unsigned i, start;
+   struct dspfilter_output output = {0};
+   struct dspfilter_input input   = {0};
+
+   for (start = 0; start < data->input_frames;
+         start += DSP_GRAPH_BLOCK_FRAMES)
+   {
+      input.samples = data->input + start * 2;
+      input.frames  = MIN(data->input_frames - start,
+            DSP_GRAPH_BLOCK_FRAMES);
+
+      /* Some filters take the buffer to write to from @output. */
+      for (i = 0; i < dsp->num_instances; i++)
+      {
+         output.samples = input.samples;
+         output.frames  = input.frames;
+         dsp->instances[i].impl->process(
+               dsp->instances[i].impl_data, &output, &input);
+      }
+   }
+
+   data->output        = data->input;
+   data->output_frames = data->input_frames;
+}
+
 void retro_dsp_filter_process(retro_dsp_filter_t *dsp,
       struct retro_dsp_data *data)
 {
    unsigned i;
+   bool in_place                  = true;
    struct dspfilter_output output = {0};
    struct dspfilter_input input   = {0};
 
+   if (dsp->graph_in_place)
+   {
+      retro_dsp_filter_process_in_place(dsp, data);
+      return;
+   }
+
    output.samples = data->input;
    output.frames  = data->input_frames;
 
@@ -317,8 +372,20 @@ void retro_dsp_filter_process(retro_dsp_filter_t *dsp,
       input.frames  = output.frames;
       dsp->instances[i].impl->process(
             dsp->instances[i].impl_data, &output, &input);
+
+      if (     output.samples != input.samples
+            || output.frames  != input.frames)
+         in_place = false;
    }
 
    data->output        = output.samples;
    data->output_frames = output.frames;
+
+   /* Filters either always work in place or never do, so one look
+    * with some audio in it is enough. */
+   if (!dsp->graph_probed && data->input_frames)
+   {
+      dsp->graph_probed   = true;
+      dsp->graph_in_place = in_place;
+   }
 }
@@ -25,6 +25,10 @@
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 struct echo_channel
 {
    float *buffer;
@@ -56,6 +60,7 @@ static void echo_process(void *data, struct dspfilter_output *output,
 {
    unsigned i, c;
    float *out             = NULL;
+   unsigned frames        = input->frames;
    struct echo_data *echo = (struct echo_data*)data;
 
    output->samples        = input->samples;
@@ -63,37 +68,82 @@ static void echo_process(void *data, struct dspfilter_output *output,
 
    out                    = output->samples;
 
-   for (i = 0; i < input->frames; i++, out += 2)
+   while (frames)
    {
-      float left, right;
-      float echo_left  = 0.0f;
-      float echo_right = 0.0f;
+      /* Run up to the first delay line that wraps. Until then every
+       * frame of a line is read and written once, by the same frame
+       * of the run, so the frames don't depend on each other. */
+      unsigned run = frames;
 
       for (c = 0; c < echo->num_channels; c++)
       {
-         echo_left  += echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 0];
-         echo_right += echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 1];
+         unsigned until_wrap = echo->channels[c].frames - echo->channels[c].ptr;
+         if (until_wrap < run)
+            run = until_wrap;
       }
 
-      echo_left  *= echo->amp;
-      echo_right *= echo->amp;
+      i = 0;
 
-      left        = out[0] + echo_left;
-      right       = out[1] + echo_right;
-
-      for (c = 0; c < echo->num_channels; c++)
+#if defined(__SSE__)
+      for (; i + 2 <= run; i += 2)
       {
-         float feedback_left  = out[0] + echo->channels[c].feedback * echo_left;
-         float feedback_right = out[1] + echo->channels[c].feedback * echo_right;
+         __m128 dry = _mm_loadu_ps(out + (i << 1));
+         __m128 wet = _mm_setzero_ps();
+
+         for (c = 0; c < echo->num_channels; c++)
+            wet = _mm_add_ps(wet, _mm_loadu_ps(echo->channels[c].buffer
+                     + ((echo->channels[c].ptr + i) << 1)));
+
+         wet = _mm_mul_ps(wet, _mm_set1_ps(echo->amp));
+
+         for (c = 0; c < echo->num_channels; c++)
+            _mm_storeu_ps(echo->channels[c].buffer
+                  + ((echo->channels[c].ptr + i) << 1),
+                  _mm_add_ps(dry, _mm_mul_ps(
+                        _mm_set1_ps(echo->channels[c].feedback), wet)));
 
-         echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 0] = feedback_left;
-         echo->channels[c].buffer[(echo->channels[c].ptr << 1) + 1] = feedback_right;
+         _mm_storeu_ps(out + (i << 1), _mm_add_ps(dry, wet));
+      }
+#endif
 
-         echo->channels[c].ptr = (echo->channels[c].ptr + 1) % echo->channels[c].frames;
+      for (; i < run; i++)
+      {
+         float *frame     = out + (i << 1);
+         float echo_left  = 0.0f;
+         float echo_right = 0.0f;
+
+         for (c = 0; c < echo->num_channels; c++)
+         {
+            const float *delayed = echo->channels[c].buffer
+               + ((echo->channels[c].ptr + i) << 1);
+            echo_left  += delayed[0];
+            echo_right += delayed[1];
+         }
+
+         echo_left  *= echo->amp;
+         echo_right *= echo->amp;
+
+         for (c = 0; c < echo->num_channels; c++)
+         {
+            float *delayed = echo->channels[c].buffer
+               + ((echo->channels[c].ptr + i) << 1);
+            delayed[0]     = frame[0] + echo->channels[c].feedback * echo_left;
+            delayed[1]     = frame[1] + echo->channels[c].feedback * echo_right;
+         }
+
+         frame[0] += echo_left;
+         frame[1] += echo_right;
+      }
+
+      for (c = 0; c < echo->num_channels; c++)
+      {
+         echo->channels[c].ptr += run;
+         if (echo->channels[c].ptr >= echo->channels[c].frames)
+            echo->channels[c].ptr = 0;
       }
 
-      out[0] = left;
-      out[1] = right;
+      out    += run << 1;
+      frames -= run;
    }
 }
 
@@ -34,10 +34,11 @@
 struct eq_data
 {
    fft_t *fft;
-   float buffer[8 * 1024];
 
    float *save;
    float *block;
+   /* The last convolved block, handed out while the next one fills */
+   float *ready;
    fft_complex_t *filter;
    fft_complex_t *fftblock;
    unsigned block_size;
@@ -59,25 +60,47 @@ static void eq_free(void *data)
    fft_free(eq->fft);
    free(eq->save);
    free(eq->block);
+   free(eq->ready);
    free(eq->fftblock);
    free(eq->filter);
    free(eq);
 }
 
+/* Convolves the stereo pair as one complex signal, left in the real
+ * part and right in the imaginary one. The filter is real, so the
+ * two stay apart, and it takes one transform each way instead of
+ * two. */
+static void eq_convolve(struct eq_data *eq)
+{
+   unsigned i;
+   const float *conv = (const float*)eq->fftblock;
+
+   fft_process_forward_complex(eq->fft, eq->fftblock,
+         (const fft_complex_t*)eq->block, 1);
+   for (i = 0; i < 2 * eq->block_size; i++)
+      eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
+   fft_process_inverse_complex(eq->fft, eq->fftblock, eq->fftblock, 1);
+
+   /* Overlap add method, so add in saved block now. */
+   for (i = 0; i < 2 * eq->block_size; i++)
+      eq->ready[i] = conv[i] + eq->save[i];
+
+   /* Save block for later. */
+   memcpy(eq->save, conv + 2 * eq->block_size,
+         2 * eq->block_size * sizeof(float));
+}
+
+/* Works in place with a fixed latency of one block: each frame
+ * coming in is swapped for the one a block earlier. */
 static void eq_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
-   float *out;
-   const float *in;
-   unsigned input_frames;
-   struct eq_data *eq = (struct eq_data*)data;
+   struct eq_data *eq    = (struct eq_data*)data;
+   float *samples        = input->samples;
+   unsigned input_frames = input->frames;
 
-   output->samples    = eq->buffer;
-   output->frames     = 0;
-
-   out                = eq->buffer;
-   in                 = input->samples;
-   input_frames       = input->frames;
+   output->samples       = input->samples;
+   output->frames        = input->frames;
 
    while (input_frames)
    {
@@ -86,34 +109,19 @@ static void eq_process(void *data, struct dspfilter_output *output,
       if (input_frames < write_avail)
          write_avail = input_frames;
 
-      memcpy(eq->block + eq->block_ptr * 2, in, write_avail * 2 * sizeof(float));
+      memcpy(eq->block + eq->block_ptr * 2, samples,
+            write_avail * 2 * sizeof(float));
+      memcpy(samples, eq->ready + eq->block_ptr * 2,
+            write_avail * 2 * sizeof(float));
 
-      in += write_avail * 2;
-      input_frames -= write_avail;
+      samples       += write_avail * 2;
+      input_frames  -= write_avail;
       eq->block_ptr += write_avail;
 
-      // Convolve a new block.
+      /* Convolve a new block. */
       if (eq->block_ptr == eq->block_size)
       {
-         unsigned i, c;
-
-         for (c = 0; c < 2; c++)
-         {
-            fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2);
-            for (i = 0; i < 2 * eq->block_size; i++)
-               eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
-            fft_process_inverse(eq->fft, out + c, eq->fftblock, 2);
-         }
-
-         // Overlap add method, so add in saved block now.
-         for (i = 0; i < 2 * eq->block_size; i++)
-            out[i] += eq->save[i];
-
-         // Save block for later.
-         memcpy(eq->save, out + 2 * eq->block_size, 2 * eq->block_size * sizeof(float));
-
-         out += eq->block_size * 2;
-         output->frames += eq->block_size;
+         eq_convolve(eq);
          eq->block_ptr = 0;
       }
    }
@@ -305,6 +313,7 @@ static void *eq_init(const struct dspfilter_info *info,
 
    eq->save     = (float*)calloc(    size, 2 * sizeof(*eq->save));
    eq->block    = (float*)calloc(2 * size, 2 * sizeof(*eq->block));
+   eq->ready    = (float*)calloc(    size, 2 * sizeof(*eq->ready));
    eq->fftblock = (fft_complex_t*)calloc(2 * size, sizeof(*eq->fftblock));
    eq->filter   = (fft_complex_t*)calloc(2 * size, sizeof(*eq->filter));
 
@@ -313,7 +322,8 @@ static void *eq_init(const struct dspfilter_info *info,
     */
    eq->fft = fft_new(size_log2 + 1);
 
-   if (!eq->fft || !eq->fftblock || !eq->save || !eq->block || !eq->filter)
+   if (!eq->fft || !eq->fftblock || !eq->save || !eq->block || !eq->ready
+         || !eq->filter)
       goto error;
 
    create_filter(eq, size_log2, gains, num_gain, beta, filter_path);
@@ -23,14 +23,22 @@
 #include <math.h>
 #include <stdlib.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 #include "fft.h"
 
+#include <boolean.h>
 #include <retro_miscellaneous.h>
 
 struct fft
 {
    fft_complex_t *interleave_buffer;
-   fft_complex_t *phase_lut;
+   /* The forward twiddle factors of each pass, one after the other,
+    * so that a pass reads them in order. The pass which combines
+    * blocks of step_size starts at step_size - 1. */
+   fft_complex_t *twiddles;
    unsigned *bitinverse_buffer;
    unsigned size;
 };
@@ -58,21 +66,31 @@ static fft_complex_t exp_imag(double phase)
    return out;
 }
 
-static void build_phase_lut(fft_complex_t *out, int size)
+static void build_twiddles(fft_complex_t *out, unsigned size)
 {
-   int i;
-   out += size;
-   for (i = -size; i <= size; i++)
-      out[i] = exp_imag((M_PI * i) / size);
+   unsigned step_size, i;
+   for (step_size = 1; step_size < size; step_size <<= 1)
+      for (i = 0; i < step_size; i++)
+         out[step_size - 1 + i] = exp_imag(-M_PI * i / step_size);
 }
 
+/* The inverse transforms run the forward butterflies on the
+ * conjugate and conjugate the result, so @conj is set for them. */
 static void interleave_complex(const unsigned *bitinverse,
       fft_complex_t *out, const fft_complex_t *in,
-      unsigned samples, unsigned step)
+      unsigned samples, unsigned step, bool conj)
 {
    unsigned i;
-   for (i = 0; i < samples; i++, in += step)
-      out[bitinverse[i]] = *in;
+   if (conj)
+   {
+      for (i = 0; i < samples; i++, in += step)
+         out[bitinverse[i]] = fft_complex_conj(*in);
+   }
+   else
+   {
+      for (i = 0; i < samples; i++, in += step)
+         out[bitinverse[i]] = *in;
+   }
 }
 
 static void interleave_float(const unsigned *bitinverse,
@@ -96,6 +114,17 @@ static void resolve_float(float *out, const fft_complex_t *in, unsigned samples,
       *out = gain * in->real;
 }
 
+static void resolve_complex(fft_complex_t *out, const fft_complex_t *in,
+      unsigned samples, float gain, unsigned step)
+{
+   unsigned i;
+   for (i = 0; i < samples; i++, in++, out += step)
+   {
+      out->real =  gain * in->real;
+      out->imag = -gain * in->imag;
+   }
+}
+
 fft_t *fft_new(unsigned block_size_log2)
 {
    unsigned size;
@@ -106,15 +135,15 @@ fft_t *fft_new(unsigned block_size_log2)
    size                   = 1 << block_size_log2;
    fft->interleave_buffer = (fft_complex_t*)calloc(size, sizeof(*fft->interleave_buffer));
    fft->bitinverse_buffer = (unsigned*)calloc(size, sizeof(*fft->bitinverse_buffer));
-   fft->phase_lut         = (fft_complex_t*)calloc(2 * size + 1, sizeof(*fft->phase_lut));
+   fft->twiddles          = (fft_complex_t*)calloc(size, sizeof(*fft->twiddles));
 
-   if (!fft->interleave_buffer || !fft->bitinverse_buffer || !fft->phase_lut)
+   if (!fft->interleave_buffer || !fft->bitinverse_buffer || !fft->twiddles)
       goto error;
 
    fft->size = size;
 
    build_bitinverse(fft->bitinverse_buffer, block_size_log2);
-   build_phase_lut(fft->phase_lut, size);
+   build_twiddles(fft->twiddles, size);
    return fft;
 
 error:
@@ -129,76 +158,116 @@ void fft_free(fft_t *fft)
 
    free(fft->interleave_buffer);
    free(fft->bitinverse_buffer);
-   free(fft->phase_lut);
+   free(fft->twiddles);
    free(fft);
 }
 
+#if defined(__SSE__)
+/* Two butterflies at a time, with a complex number in each half of
+ * a register. */
+static void butterflies_sse(fft_complex_t *buf,
+      const fft_complex_t *twiddles, unsigned step_size, unsigned samples)
+{
+   unsigned i, j;
+   const __m128 sign = _mm_set_ps(1.0f, -1.0f, 1.0f, -1.0f);
+
+   for (i = 0; i < samples; i += step_size << 1)
+   {
+      float *a = (float*)(buf + i);
+      float *b = (float*)(buf + i + step_size);
+
+      for (j = 0; j < step_size; j += 2, a += 4, b += 4)
+      {
+         __m128 w      = _mm_loadu_ps((const float*)(twiddles + j));
+         __m128 va     = _mm_loadu_ps(a);
+         __m128 vb     = _mm_loadu_ps(b);
+         __m128 w_real = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+         __m128 w_imag = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+         __m128 b_swap = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1));
+         __m128 mod    = _mm_add_ps(_mm_mul_ps(vb, w_real),
+               _mm_mul_ps(_mm_mul_ps(b_swap, w_imag), sign));
+
+         _mm_storeu_ps(b, _mm_sub_ps(va, mod));
+         _mm_storeu_ps(a, _mm_add_ps(va, mod));
+      }
+   }
+}
+#else
 static void butterfly(fft_complex_t *a, fft_complex_t *b, fft_complex_t mod)
 {
    mod = fft_complex_mul(mod, *b);
    *b  = fft_complex_sub(*a, mod);
    *a  = fft_complex_add(*a, mod);
 }
+#endif
 
 static void butterflies(fft_complex_t *butterfly_buf,
-      const fft_complex_t *phase_lut,
-      int phase_dir, unsigned step_size, unsigned samples)
+      const fft_complex_t *twiddles, unsigned step_size, unsigned samples)
 {
-   unsigned i, j;
+   unsigned i;
+
+   /* The first pass only multiplies by one. */
+   if (step_size == 1)
+   {
+      for (i = 0; i < samples; i += 2)
+      {
+         fft_complex_t a      = butterfly_buf[i];
+         butterfly_buf[i]     = fft_complex_add(a, butterfly_buf[i + 1]);
+         butterfly_buf[i + 1] = fft_complex_sub(a, butterfly_buf[i + 1]);
+      }
+      return;
+   }
+
+#if defined(__SSE__)
+   butterflies_sse(butterfly_buf, twiddles, step_size, samples);
+#else
    for (i = 0; i < samples; i += step_size << 1)
    {
-      int phase_step = (int)samples * phase_dir / (int)step_size;
-      for (j = i; j < i + step_size; j++)
-         butterfly(&butterfly_buf[j], &butterfly_buf[j + step_size],
-               phase_lut[phase_step * (int)(j - i)]);
+      unsigned j;
+      for (j = 0; j < step_size; j++)
+         butterfly(&butterfly_buf[i + j], &butterfly_buf[i + j + step_size],
+               twiddles[j]);
    }
+#endif
 }
 
-void fft_process_forward_complex(fft_t *fft,
-      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+static void fft_process(fft_t *fft, fft_complex_t *buf)
 {
    unsigned step_size;
-   unsigned samples = fft->size;
-   interleave_complex(fft->bitinverse_buffer, out, in, samples, step);
+   for (step_size = 1; step_size < fft->size; step_size <<= 1)
+      butterflies(buf, fft->twiddles + step_size - 1, step_size, fft->size);
+}
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
-   {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
-   }
+void fft_process_forward_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   interleave_complex(fft->bitinverse_buffer, out, in, fft->size, step, false);
+   fft_process(fft, out);
 }
 
 void fft_process_forward(fft_t *fft,
       fft_complex_t *out, const float *in, unsigned step)
 {
-   unsigned step_size;
-   unsigned samples = fft->size;
-   interleave_float(fft->bitinverse_buffer, out, in, samples, step);
-
-   for (step_size = 1; step_size < fft->size; step_size <<= 1)
-   {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
-   }
+   interleave_float(fft->bitinverse_buffer, out, in, fft->size, step);
+   fft_process(fft, out);
 }
 
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step)
 {
-   unsigned step_size;
-   unsigned samples = fft->size;
-
    interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer,
-         in, samples, 1);
-
-   for (step_size = 1; step_size < samples; step_size <<= 1)
-   {
-      butterflies(fft->interleave_buffer,
-            fft->phase_lut + samples,
-            1, step_size, samples);
-   }
+         in, fft->size, 1, true);
+   fft_process(fft, fft->interleave_buffer);
+   resolve_float(out, fft->interleave_buffer, fft->size,
+         1.0f / fft->size, step);
+}
 
-   resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+void fft_process_inverse_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer,
+         in, fft->size, 1, true);
+   fft_process(fft, fft->interleave_buffer);
+   resolve_complex(out, fft->interleave_buffer, fft->size,
+         1.0f / fft->size, step);
 }
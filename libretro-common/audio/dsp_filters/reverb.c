@@ -27,6 +27,10 @@
 #include <retro_inline.h>
 #include <libretro_dspfilter.h>
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
 struct comb
 {
    float *buffer;
@@ -123,6 +127,114 @@ static float revmodel_process(struct revmodel *rev, float in)
    return mono_in * rev->dry + mono_out * rev->wet1;
 }
 
+#if defined(__SSE__)
+/* Four samples in a row from a delay line. Lines are far longer
+ * than four samples, so only the end of a line needs a copy. */
+static INLINE __m128 delay_load4(const float *buffer,
+      unsigned idx, unsigned size)
+{
+   unsigned i;
+   float tmp[4];
+
+   if (idx + 4 <= size)
+      return _mm_loadu_ps(buffer + idx);
+
+   for (i = 0; i < 4; i++, idx++)
+      tmp[i] = buffer[idx < size ? idx : idx - size];
+   return _mm_loadu_ps(tmp);
+}
+
+static INLINE void delay_store4(float *buffer,
+      unsigned idx, unsigned size, __m128 v)
+{
+   unsigned i;
+   float tmp[4];
+
+   if (idx + 4 <= size)
+   {
+      _mm_storeu_ps(buffer + idx, v);
+      return;
+   }
+
+   _mm_storeu_ps(tmp, v);
+   for (i = 0; i < 4; i++, idx++)
+      buffer[idx < size ? idx : idx - size] = tmp[i];
+}
+
+static INLINE unsigned delay_advance4(unsigned idx, unsigned size)
+{
+   idx += 4;
+   return idx >= size ? idx - size : idx;
+}
+
+/* revmodel_process() for four samples at a time. A delay line is
+ * not read back within four samples, so each line is read and then
+ * written four samples at a time. The allpasses run across the four
+ * samples. The combs' damping filters run across four combs at a
+ * time instead, as each sample needs the one before. */
+static __m128 revmodel_process4(struct revmodel *rev, __m128 in)
+{
+   unsigned i, j;
+   __m128 input    = _mm_mul_ps(in, _mm_set1_ps(rev->gain));
+   __m128 mono_out = _mm_setzero_ps();
+   __m128 feedback = _mm_set1_ps(rev->combL[0].feedback);
+   __m128 damp1    = _mm_set1_ps(rev->combL[0].damp1);
+   __m128 damp2    = _mm_set1_ps(rev->combL[0].damp2);
+
+   for (i = 0; i < numcombs; i += 4)
+   {
+      float store[4];
+      __m128 filterstore;
+      __m128 v[4];
+      struct comb *c = &rev->combL[i];
+
+      for (j = 0; j < 4; j++)
+      {
+         v[j]     = delay_load4(c[j].buffer, c[j].bufidx, c[j].bufsize);
+         mono_out = _mm_add_ps(mono_out, v[j]);
+      }
+
+      /* From a sample per lane to a comb per lane, and back. */
+      _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+
+      filterstore = _mm_set_ps(c[3].filterstore, c[2].filterstore,
+            c[1].filterstore, c[0].filterstore);
+      for (j = 0; j < 4; j++)
+      {
+         filterstore = _mm_add_ps(_mm_mul_ps(v[j], damp2),
+               _mm_mul_ps(filterstore, damp1));
+         v[j]        = filterstore;
+      }
+      _mm_storeu_ps(store, filterstore);
+
+      _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+
+      for (j = 0; j < 4; j++)
+      {
+         c[j].filterstore = store[j];
+         delay_store4(c[j].buffer, c[j].bufidx, c[j].bufsize,
+               _mm_add_ps(input, _mm_mul_ps(v[j], feedback)));
+         c[j].bufidx      = delay_advance4(c[j].bufidx, c[j].bufsize);
+      }
+   }
+
+   for (i = 0; i < numallpasses; i++)
+   {
+      struct allpass *a = &rev->allpassL[i];
+      __m128 bufout     = delay_load4(a->buffer, a->bufidx, a->bufsize);
+
+      delay_store4(a->buffer, a->bufidx, a->bufsize,
+            _mm_add_ps(mono_out, _mm_mul_ps(bufout,
+                  _mm_set1_ps(a->feedback))));
+      a->bufidx         = delay_advance4(a->bufidx, a->bufsize);
+      mono_out          = _mm_sub_ps(bufout, mono_out);
+   }
+
+   return _mm_add_ps(_mm_mul_ps(in, _mm_set1_ps(rev->dry)),
+         _mm_mul_ps(mono_out, _mm_set1_ps(rev->wet1)));
+}
+#endif
+
 static void revmodel_update(struct revmodel *rev)
 {
    int i;
@@ -250,8 +362,24 @@ static void reverb_process(void *data, struct dspfilter_output *output,
    output->samples         = input->samples;
    output->frames          = input->frames;
    out                     = output->samples;
+   i                       = 0;
+
+#if defined(__SSE__)
+   for (; i + 4 <= input->frames; i += 4, out += 8)
+   {
+      __m128 lr0   = _mm_loadu_ps(out);
+      __m128 lr1   = _mm_loadu_ps(out + 4);
+      __m128 left  = revmodel_process4(&rev->left,
+            _mm_shuffle_ps(lr0, lr1, _MM_SHUFFLE(2, 0, 2, 0)));
+      __m128 right = revmodel_process4(&rev->right,
+            _mm_shuffle_ps(lr0, lr1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+      _mm_storeu_ps(out,     _mm_unpacklo_ps(left, right));
+      _mm_storeu_ps(out + 4, _mm_unpackhi_ps(left, right));
+   }
+#endif
 
-   for (i = 0; i < input->frames; i++, out += 2)
+   for (; i < input->frames; i++, out += 2)
    {
       float in[2] = { out[0], out[1] };
 
@@ -44,6 +44,7 @@ retro_resampler_t null_resampler = {
 
 static const retro_resampler_t *resampler_drivers[] = {
    &sinc_resampler,
+   &polyphase_resampler,
 #ifdef HAVE_CC_RESAMPLER
    &CC_resampler,
 #endif
@@ -116,7 +117,14 @@ static bool resampler_append_plugs(void **re,
       enum resampler_quality quality,
       double bw_ratio)
 {
-   resampler_simd_mask_t mask = (resampler_simd_mask_t)cpu_features_get();
+   uint64_t cpu               = cpu_features_get();
+   resampler_simd_mask_t mask = (resampler_simd_mask_t)
+      (cpu & CPU_FEATURES_LIBRETRO_MASK);
+
+   if (cpu & CPU_FEATURE_FMA3)
+      mask |= RESAMPLER_SIMD_FMA3;
+   if (cpu & CPU_FEATURE_AVX512F)
+      mask |= RESAMPLER_SIMD_AVX512F;
 
    if (*backend)
       *re = (*backend)->init(&resampler_config, bw_ratio, quality, mask);
@@ -0,0 +1,472 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (polyphase_resampler.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Polyphase FIR resampler, with the filter bank designed for the
+ * expected ratio (the bandwidth_mod passed to init()).
+ *
+ * Unlike sinc, the filter is designed from a stopband attenuation
+ * and a passband edge, and lets the transition band alias above
+ * the passband instead of ending it at the lower Nyquist rate.
+ * That about halves the taps for the same passband and
+ * attenuation.
+ *
+ * When the ratio is a fraction L/M with a small enough L, the bank
+ * gets a multiple of L phases, so that at exactly that ratio every
+ * output lands on a phase and no interpolation is needed. Dynamic
+ * rate control moves the ratio by a fraction of a percent, which
+ * is handled by interpolating between the two adjacent phases.
+ * Other ratios work the same way, but the cutoff stays where
+ * init() put it. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <filters.h>
+#include <memalign.h>
+
+#include <audio/audio_resampler.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
+#define POLYPHASE_X86
+#endif
+
+/* Same runtime dispatch as the sinc resampler */
+#if defined(POLYPHASE_X86) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define POLYPHASE_TARGET(x) __attribute__((target(x)))
+#define POLYPHASE_X86_DISPATCH
+#elif defined(POLYPHASE_X86) && defined(_MSC_VER) && _MSC_VER >= 1910
+#define POLYPHASE_X86_DISPATCH
+#endif
+
+#ifndef POLYPHASE_TARGET
+#define POLYPHASE_TARGET(x)
+#endif
+
+#if defined(POLYPHASE_X86_DISPATCH) || defined(__SSE__)
+#define POLYPHASE_SSE
+#include <xmmintrin.h>
+#endif
+
+/* One input frame is (phases << frac_bits) units of time */
+#define POLYPHASE_TIME_BITS   24
+/* Above this, ratios are treated as irrational */
+#define POLYPHASE_MAX_PHASES  4096
+/* Every kernel steps through the taps 4 at a time or less */
+#define POLYPHASE_TAP_ALIGN   4
+
+struct polyphase_quality
+{
+   /* Stopband attenuation, in dB */
+   double attenuation;
+   /* Passband edge, as a fraction of the lower Nyquist rate */
+   double passband;
+   /* Enough phases for the linear interpolation
+    * to stay under the stopband */
+   unsigned min_phases;
+};
+
+/* Close to or better than the sinc levels of the same name */
+static const struct polyphase_quality polyphase_qualities[] = {
+   {  70.0, 0.700, 128  }, /* DONTCARE */
+   {  40.0, 0.500, 64   }, /* LOWEST */
+   {  50.0, 0.600, 64   }, /* LOWER */
+   {  70.0, 0.700, 128  }, /* NORMAL */
+   { 110.0, 0.850, 256  }, /* HIGHER */
+   { 140.0, 0.925, 512  }, /* HIGHEST */
+};
+
+/* Writes the stereo output frame for one position.
+ * @delta is NULL when the position falls exactly on a phase. */
+typedef void (*polyphase_dot_t)(float *out,
+      const float *left, const float *right,
+      const float *coeff, const float *delta, float mu,
+      unsigned taps);
+
+typedef struct rarch_polyphase_resampler
+{
+   /* Bank and history in one allocation, like sinc.
+    * Each phase is a row of taps coefficients followed
+    * by a row of deltas to the next phase. */
+   float *main_buffer;
+   float *bank;
+   float *buffer_l;
+   float *buffer_r;
+   polyphase_dot_t dot;
+   polyphase_dot_t dot_interp;
+   unsigned phases;
+   unsigned taps;
+   unsigned ptr;
+   unsigned frac_bits;
+   uint32_t frac_mask;
+   uint32_t time;
+   float frac_mod;
+} rarch_polyphase_resampler_t;
+
+static void polyphase_dot_c(float *out,
+      const float *left, const float *right,
+      const float *coeff, const float *delta, float mu,
+      unsigned taps)
+{
+   unsigned i;
+   float sum_l = 0.0f;
+   float sum_r = 0.0f;
+
+   for (i = 0; i < taps; i++)
+   {
+      sum_l += left[i]  * coeff[i];
+      sum_r += right[i] * coeff[i];
+   }
+
+   out[0] = sum_l;
+   out[1] = sum_r;
+}
+
+static void polyphase_dot_interp_c(float *out,
+      const float *left, const float *right,
+      const float *coeff, const float *delta, float mu,
+      unsigned taps)
+{
+   unsigned i;
+   float sum_l = 0.0f;
+   float sum_r = 0.0f;
+
+   for (i = 0; i < taps; i++)
+   {
+      float c = coeff[i] + delta[i] * mu;
+      sum_l  += left[i]  * c;
+      sum_r  += right[i] * c;
+   }
+
+   out[0] = sum_l;
+   out[1] = sum_r;
+}
+
+#ifdef POLYPHASE_SSE
+POLYPHASE_TARGET("sse")
+static INLINE void polyphase_store_sse(float *out, __m128 sum_l, __m128 sum_r)
+{
+   /* Same reduction as the sinc SSE kernel */
+   __m128 sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
+            _MM_SHUFFLE(1, 0, 1, 0)),
+         _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
+   sum        = _mm_add_ps(_mm_shuffle_ps(sum, sum,
+            _MM_SHUFFLE(3, 3, 1, 1)), sum);
+
+   _mm_store_ss(out + 0, sum);
+   _mm_store_ss(out + 1, _mm_movehl_ps(sum, sum));
+}
+
+POLYPHASE_TARGET("sse")
+static void polyphase_dot_sse(float *out,
+      const float *left, const float *right,
+      const float *coeff, const float *delta, float mu,
+      unsigned taps)
+{
+   unsigned i;
+   __m128 sum_l = _mm_setzero_ps();
+   __m128 sum_r = _mm_setzero_ps();
+
+   for (i = 0; i < taps; i += 4)
+   {
+      __m128 c = _mm_load_ps(coeff + i);
+      sum_l    = _mm_add_ps(sum_l, _mm_mul_ps(_mm_loadu_ps(left + i),  c));
+      sum_r    = _mm_add_ps(sum_r, _mm_mul_ps(_mm_loadu_ps(right + i), c));
+   }
+
+   polyphase_store_sse(out, sum_l, sum_r);
+}
+
+POLYPHASE_TARGET("sse")
+static void polyphase_dot_interp_sse(float *out,
+      const float *left, const float *right,
+      const float *coeff, const float *delta, float mu,
+      unsigned taps)
+{
+   unsigned i;
+   __m128 m     = _mm_set1_ps(mu);
+   __m128 sum_l = _mm_setzero_ps();
+   __m128 sum_r = _mm_setzero_ps();
+
+   for (i = 0; i < taps; i += 4)
+   {
+      __m128 c = _mm_add_ps(_mm_load_ps(coeff + i),
+            _mm_mul_ps(_mm_load_ps(delta + i), m));
+      sum_l    = _mm_add_ps(sum_l, _mm_mul_ps(_mm_loadu_ps(left + i),  c));
+      sum_r    = _mm_add_ps(sum_r, _mm_mul_ps(_mm_loadu_ps(right + i), c));
+   }
+
+   polyphase_store_sse(out, sum_l, sum_r);
+}
+#endif
+
+struct polyphase_kernel
+{
+   polyphase_dot_t dot;
+   polyphase_dot_t dot_interp;
+   resampler_simd_mask_t simd;
+};
+
+/* Fastest first */
+static const struct polyphase_kernel polyphase_kernels[] = {
+#ifdef POLYPHASE_SSE
+   { polyphase_dot_sse,      polyphase_dot_interp_sse,
+      RESAMPLER_SIMD_SSE },
+#endif
+   { polyphase_dot_c,        polyphase_dot_interp_c,
+      0 },
+};
+
+static void resampler_polyphase_process(void *re_,
+      struct resampler_data *data)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)re_;
+   uint32_t frame_time             = re->phases << re->frac_bits;
+   /* Exact when the ratio is the one the bank was built for */
+   uint32_t step                   = (uint32_t)
+      floor(frame_time / data->ratio + 0.5);
+   unsigned taps                   = re->taps;
+   const float *input              = data->data_in;
+   float *output                   = data->data_out;
+   size_t frames                   = data->input_frames;
+   size_t out_frames               = 0;
+
+   while (frames)
+   {
+      while (frames && re->time >= frame_time)
+      {
+         /* Push in reverse, like sinc */
+         if (!re->ptr)
+            re->ptr = taps;
+         re->ptr--;
+
+         re->buffer_l[re->ptr + taps] =
+            re->buffer_l[re->ptr]     = *input++;
+
+         re->buffer_r[re->ptr + taps] =
+            re->buffer_r[re->ptr]     = *input++;
+
+         re->time                    -= frame_time;
+         frames--;
+      }
+
+      while (re->time < frame_time)
+      {
+         uint32_t frac      = re->time & re->frac_mask;
+         const float *coeff = re->bank +
+            (re->time >> re->frac_bits) * taps * 2;
+
+         if (frac)
+            re->dot_interp(output,
+                  re->buffer_l + re->ptr, re->buffer_r + re->ptr,
+                  coeff, coeff + taps, frac * re->frac_mod, taps);
+         else
+            re->dot(output,
+                  re->buffer_l + re->ptr, re->buffer_r + re->ptr,
+                  coeff, NULL, 0.0f, taps);
+
+         output   += 2;
+         out_frames++;
+         re->time += step;
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+
+static void resampler_polyphase_free(void *data)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)data;
+   if (re)
+      memalign_free(re->main_buffer);
+   free(re);
+}
+
+/* Kaiser's estimate of the window shape
+ * for a given stopband attenuation. */
+static double polyphase_kaiser_beta(double attenuation)
+{
+   if (attenuation > 50.0)
+      return 0.1102 * (attenuation - 8.7);
+   if (attenuation >= 21.0)
+      return 0.5842 * pow(attenuation - 21.0, 0.4)
+         + 0.07886 * (attenuation - 21.0);
+   return 0.0;
+}
+
+/* Returns L if @ratio is L/M for some L <= @max, otherwise 0. */
+static unsigned polyphase_ratio_numerator(double ratio, unsigned max)
+{
+   unsigned i;
+   double x  = ratio;
+   double h0 = 0.0, h1 = 1.0;
+   double k0 = 1.0, k1 = 0.0;
+
+   /* Walk the continued fraction convergents */
+   for (i = 0; i < 32; i++)
+   {
+      double a  = floor(x);
+      double h2 = a * h1 + h0;
+      double k2 = a * k1 + k0;
+
+      if (h2 > max)
+         break;
+      if (fabs(h2 / k2 - ratio) <= ratio * 1e-9)
+         return (unsigned)h2;
+      if (x - a <= 0.0)
+         break;
+
+      x  = 1.0 / (x - a);
+      h0 = h1;
+      h1 = h2;
+      k0 = k1;
+      k1 = k2;
+   }
+
+   return 0;
+}
+
+/* Windowed sinc at @t input frames from the center of the filter */
+static INLINE float polyphase_tap(double t, double half,
+      double cutoff, double beta, double window_mod)
+{
+   return (float)(cutoff * sinc(M_PI * t * cutoff) *
+         kaiser_window_function(t / half, beta) / window_mod);
+}
+
+static void polyphase_init_bank(float *bank,
+      unsigned phases, unsigned taps, double cutoff, double beta)
+{
+   unsigned i, j;
+   double window_mod = kaiser_window_function(0.0, beta);
+   double half       = taps / 2.0;
+
+   for (i = 0; i < phases; i++)
+      for (j = 0; j < taps; j++)
+         bank[i * taps * 2 + j] = polyphase_tap(
+               j + (double)i / phases - half,
+               half, cutoff, beta, window_mod);
+
+   for (i = 0; i < phases; i++)
+   {
+      for (j = 0; j < taps; j++)
+      {
+         float next = (i + 1 < phases)
+            ? bank[(i + 1) * taps * 2 + j]
+            : polyphase_tap(j + 1.0 - half,
+                  half, cutoff, beta, window_mod);
+
+         bank[i * taps * 2 + taps + j] = next - bank[i * taps * 2 + j];
+      }
+   }
+}
+
+static void *resampler_polyphase_new(const struct resampler_config *config,
+      double bandwidth_mod, enum resampler_quality quality,
+      resampler_simd_mask_t mask)
+{
+   unsigned i, num;
+   size_t bank_elems;
+   double bandwidth, transition, beta;
+   const struct polyphase_quality *q  = NULL;
+   const struct polyphase_kernel *k   = NULL;
+   rarch_polyphase_resampler_t *re    = NULL;
+
+   if (bandwidth_mod <= 0.0)
+      return NULL;
+   if ((unsigned)quality >= sizeof(polyphase_qualities)
+         / sizeof(polyphase_qualities[0]))
+      quality = RESAMPLER_QUALITY_NORMAL;
+
+   if (!(re = (rarch_polyphase_resampler_t*)calloc(1, sizeof(*re))))
+      return NULL;
+
+   q          = &polyphase_qualities[quality];
+   bandwidth  = bandwidth_mod < 1.0 ? bandwidth_mod : 1.0;
+   beta       = polyphase_kaiser_beta(q->attenuation);
+
+   /* From the passband edge to its mirror image
+    * around the lower Nyquist rate, in cycles
+    * per input frame. */
+   transition = (1.0 - q->passband) * bandwidth;
+   re->taps   = (unsigned)ceil((q->attenuation - 7.95)
+         / (14.36 * transition));
+   re->taps   = (re->taps + POLYPHASE_TAP_ALIGN - 1)
+      & ~(POLYPHASE_TAP_ALIGN - 1);
+
+   /* A multiple of L phases for L/M ratios */
+   re->phases = q->min_phases;
+   num        = polyphase_ratio_numerator(bandwidth_mod,
+         POLYPHASE_MAX_PHASES);
+   if (num)
+      re->phases = num * ((q->min_phases + num - 1) / num);
+
+   /* Whatever is left of the time bits goes to the
+    * position between two phases */
+   for (re->frac_bits = 0;
+         ((uint64_t)re->phases << (re->frac_bits + 1))
+         <= (1u << POLYPHASE_TIME_BITS); re->frac_bits++);
+   re->frac_mask = (1u << re->frac_bits) - 1;
+   re->frac_mod  = 1.0f / (1u << re->frac_bits);
+
+   bank_elems      = (size_t)re->phases * re->taps * 2;
+   re->main_buffer = (float*)memalign_alloc(64,
+         sizeof(float) * (bank_elems + 4 * re->taps));
+   if (!re->main_buffer)
+      goto error;
+
+   memset(re->main_buffer, 0,
+         sizeof(float) * (bank_elems + 4 * re->taps));
+
+   re->bank     = re->main_buffer;
+   re->buffer_l = re->main_buffer + bank_elems;
+   re->buffer_r = re->buffer_l + 2 * re->taps;
+
+   polyphase_init_bank(re->bank, re->phases, re->taps, bandwidth, beta);
+
+   for (i = 0; i < sizeof(polyphase_kernels)
+         / sizeof(polyphase_kernels[0]); i++)
+   {
+      k = &polyphase_kernels[i];
+      if ((mask & k->simd) == k->simd)
+         break;
+   }
+   re->dot        = k->dot;
+   re->dot_interp = k->dot_interp;
+
+   return re;
+
+error:
+   resampler_polyphase_free(re);
+   return NULL;
+}
+
+retro_resampler_t polyphase_resampler = {
+   resampler_polyphase_new,
+   resampler_polyphase_process,
+   resampler_polyphase_free,
+   RESAMPLER_API_VERSION,
+   "polyphase",
+   "polyphase"
+};
@@ -34,14 +34,42 @@
 #include <audio/audio_resampler.h>
 #include <filters.h>
 
-#ifdef __SSE__
+#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
+#define SINC_X86
+#endif
+
+/* The x86 kernels are compiled for their own target and
+ * picked at runtime, so that baseline builds can still
+ * use them. */
+#if defined(SINC_X86) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define SINC_TARGET(x) __attribute__((target(x)))
+#define SINC_X86_DISPATCH
+#elif defined(SINC_X86) && defined(_MSC_VER) && _MSC_VER >= 1910
+#define SINC_X86_DISPATCH
+#endif
+
+#ifndef SINC_TARGET
+#define SINC_TARGET(x)
+#endif
+
+#if defined(SINC_X86_DISPATCH) || defined(__SSE__)
+#define SINC_SSE
 #include <xmmintrin.h>
 #endif
 
-#if defined(__AVX__)
+#if defined(SINC_X86_DISPATCH) || defined(__AVX__)
+#define SINC_AVX
 #include <immintrin.h>
 #endif
 
+#if defined(SINC_X86_DISPATCH) || (defined(__AVX2__) && defined(__FMA__))
+#define SINC_AVX2_FMA
+#endif
+
+#if defined(SINC_X86_DISPATCH) || defined(__AVX512F__)
+#define SINC_AVX512
+#endif
+
 /* Rough SNR values for upsampling:
  * LOWEST: 40 dB
  * LOWER: 55 dB
@@ -65,8 +93,12 @@ enum sinc_window
  * of sinc taps, the AVX code is clearly faster than SSE1.
  */
 
+struct sinc_kernel;
+
 typedef struct rarch_sinc_resampler
 {
+   /* Picked per instance, the taps are padded for it */
+   const struct sinc_kernel *kernel;
    /* A buffer for phase_table, buffer_l and buffer_r
     * are created in a single calloc().
     * Ensure that we get as good cache locality as we can hope for. */
@@ -148,7 +180,29 @@ static void resampler_sinc_process_neon(void *re_, struct resampler_data *data)
 }
 #endif
 
-#if defined(__AVX__)
+#ifdef SINC_AVX
+/* Adds up the lanes of @l and @r, and stores
+ * the two sums in out[0] and out[1]. */
+SINC_TARGET("avx")
+static INLINE void resampler_sinc_store_avx(float *out, __m256 l, __m256 r)
+{
+   __m128 sum_l = _mm_add_ps(_mm256_castps256_ps128(l),
+         _mm256_extractf128_ps(l, 1));
+   __m128 sum_r = _mm_add_ps(_mm256_castps256_ps128(r),
+         _mm256_extractf128_ps(r, 1));
+
+   /* Same as in the SSE kernel */
+   __m128 sum   = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
+            _MM_SHUFFLE(1, 0, 1, 0)),
+         _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
+   sum          = _mm_add_ps(_mm_shuffle_ps(sum, sum,
+            _MM_SHUFFLE(3, 3, 1, 1)), sum);
+
+   _mm_store_ss(out + 0, sum);
+   _mm_store_ss(out + 1, _mm_movehl_ps(sum, sum));
+}
+
+SINC_TARGET("avx")
 static void resampler_sinc_process_avx(void *re_, struct resampler_data *data)
 {
    rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
@@ -253,7 +307,6 @@ static void resampler_sinc_process_avx(void *re_, struct resampler_data *data)
          while (resamp->time < phases)
          {
             unsigned i;
-            __m256 delta;
             const float *buffer_l    = resamp->buffer_l + resamp->ptr;
             const float *buffer_r    = resamp->buffer_r + resamp->ptr;
             unsigned taps            = resamp->taps;
@@ -298,7 +351,307 @@ static void resampler_sinc_process_avx(void *re_, struct resampler_data *data)
 }
 #endif
 
-#if defined(__SSE__)
+#ifdef SINC_AVX2_FMA
+/* Assumes that taps is a multiple of 16. Two sums per
+ * channel, so that the FMAs don't wait on each other. */
+SINC_TARGET("avx2,fma")
+static void resampler_sinc_process_avx2_fma(void *re_,
+      struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
+   unsigned phases                = 1 << (resamp->phase_bits + resamp->subphase_bits);
+
+   uint32_t ratio                 = phases / data->ratio;
+   const float *input             = data->data_in;
+   float *output                  = data->data_out;
+   size_t frames                  = data->input_frames;
+   size_t out_frames              = 0;
+
+   if (resamp->window_type == SINC_WINDOW_KAISER)
+   {
+      while (frames)
+      {
+         while (frames && resamp->time >= phases)
+         {
+            /* Push in reverse to make filter more obvious. */
+            if (!resamp->ptr)
+               resamp->ptr = resamp->taps;
+            resamp->ptr--;
+
+            resamp->buffer_l[resamp->ptr + resamp->taps] =
+               resamp->buffer_l[resamp->ptr]                = *input++;
+
+            resamp->buffer_r[resamp->ptr + resamp->taps] =
+               resamp->buffer_r[resamp->ptr]                = *input++;
+
+            resamp->time                                -= phases;
+            frames--;
+         }
+
+         while (resamp->time < phases)
+         {
+            unsigned i;
+            const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+            const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+            unsigned taps            = resamp->taps;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps * 2;
+            const float *delta_table = phase_table + taps;
+            __m256 delta             = _mm256_set1_ps((float)
+                  (resamp->time & resamp->subphase_mask) * resamp->subphase_mod);
+            __m256 sum_l0            = _mm256_setzero_ps();
+            __m256 sum_r0            = _mm256_setzero_ps();
+            __m256 sum_l1            = _mm256_setzero_ps();
+            __m256 sum_r1            = _mm256_setzero_ps();
+
+            for (i = 0; i < taps; i += 16)
+            {
+               __m256 sinc0 = _mm256_fmadd_ps(
+                     _mm256_load_ps(delta_table + i), delta,
+                     _mm256_load_ps(phase_table + i));
+               __m256 sinc1 = _mm256_fmadd_ps(
+                     _mm256_load_ps(delta_table + i + 8), delta,
+                     _mm256_load_ps(phase_table + i + 8));
+
+               sum_l0       = _mm256_fmadd_ps(
+                     _mm256_loadu_ps(buffer_l + i),     sinc0, sum_l0);
+               sum_r0       = _mm256_fmadd_ps(
+                     _mm256_loadu_ps(buffer_r + i),     sinc0, sum_r0);
+               sum_l1       = _mm256_fmadd_ps(
+                     _mm256_loadu_ps(buffer_l + i + 8), sinc1, sum_l1);
+               sum_r1       = _mm256_fmadd_ps(
+                     _mm256_loadu_ps(buffer_r + i + 8), sinc1, sum_r1);
+            }
+
+            resampler_sinc_store_avx(output,
+                  _mm256_add_ps(sum_l0, sum_l1),
+                  _mm256_add_ps(sum_r0, sum_r1));
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+   else
+   {
+      while (frames)
+      {
+         while (frames && resamp->time >= phases)
+         {
+            /* Push in reverse to make filter more obvious. */
+            if (!resamp->ptr)
+               resamp->ptr = resamp->taps;
+            resamp->ptr--;
+
+            resamp->buffer_l[resamp->ptr + resamp->taps] =
+               resamp->buffer_l[resamp->ptr]                = *input++;
+
+            resamp->buffer_r[resamp->ptr + resamp->taps] =
+               resamp->buffer_r[resamp->ptr]                = *input++;
+
+            resamp->time                                -= phases;
+            frames--;
+         }
+
+         while (resamp->time < phases)
+         {
+            unsigned i;
+            const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+            const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+            unsigned taps            = resamp->taps;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps;
+            __m256 sum_l0            = _mm256_setzero_ps();
+            __m256 sum_r0            = _mm256_setzero_ps();
+            __m256 sum_l1            = _mm256_setzero_ps();
+            __m256 sum_r1            = _mm256_setzero_ps();
+
+            for (i = 0; i < taps; i += 16)
+            {
+               __m256 sinc0 = _mm256_load_ps(phase_table + i);
+               __m256 sinc1 = _mm256_load_ps(phase_table + i + 8);
+
+               sum_l0       = _mm256_fmadd_ps(
+                     _mm256_loadu_ps(buffer_l + i),     sinc0, sum_l0);
+               sum_r0       = _mm256_fmadd_ps(
+                     _mm256_loadu_ps(buffer_r + i),     sinc0, sum_r0);
+               sum_l1       = _mm256_fmadd_ps(
+                     _mm256_loadu_ps(buffer_l + i + 8), sinc1, sum_l1);
+               sum_r1       = _mm256_fmadd_ps(
+                     _mm256_loadu_ps(buffer_r + i + 8), sinc1, sum_r1);
+            }
+
+            resampler_sinc_store_avx(output,
+                  _mm256_add_ps(sum_l0, sum_l1),
+                  _mm256_add_ps(sum_r0, sum_r1));
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+#endif
+
+#ifdef SINC_AVX512
+/* Folds the upper half of @v onto the lower one */
+SINC_TARGET("avx512f")
+static INLINE __m256 resampler_sinc_fold_avx512(__m512 v)
+{
+   return _mm256_add_ps(_mm512_castps512_ps256(v),
+         _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+}
+
+/* Assumes that taps is a multiple of 32 */
+SINC_TARGET("avx512f")
+static void resampler_sinc_process_avx512(void *re_,
+      struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
+   unsigned phases                = 1 << (resamp->phase_bits + resamp->subphase_bits);
+
+   uint32_t ratio                 = phases / data->ratio;
+   const float *input             = data->data_in;
+   float *output                  = data->data_out;
+   size_t frames                  = data->input_frames;
+   size_t out_frames              = 0;
+
+   if (resamp->window_type == SINC_WINDOW_KAISER)
+   {
+      while (frames)
+      {
+         while (frames && resamp->time >= phases)
+         {
+            /* Push in reverse to make filter more obvious. */
+            if (!resamp->ptr)
+               resamp->ptr = resamp->taps;
+            resamp->ptr--;
+
+            resamp->buffer_l[resamp->ptr + resamp->taps] =
+               resamp->buffer_l[resamp->ptr]                = *input++;
+
+            resamp->buffer_r[resamp->ptr + resamp->taps] =
+               resamp->buffer_r[resamp->ptr]                = *input++;
+
+            resamp->time                                -= phases;
+            frames--;
+         }
+
+         while (resamp->time < phases)
+         {
+            unsigned i;
+            const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+            const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+            unsigned taps            = resamp->taps;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps * 2;
+            const float *delta_table = phase_table + taps;
+            __m512 delta             = _mm512_set1_ps((float)
+                  (resamp->time & resamp->subphase_mask) * resamp->subphase_mod);
+            __m512 sum_l0            = _mm512_setzero_ps();
+            __m512 sum_r0            = _mm512_setzero_ps();
+            __m512 sum_l1            = _mm512_setzero_ps();
+            __m512 sum_r1            = _mm512_setzero_ps();
+
+            for (i = 0; i < taps; i += 32)
+            {
+               __m512 sinc0 = _mm512_fmadd_ps(
+                     _mm512_load_ps(delta_table + i), delta,
+                     _mm512_load_ps(phase_table + i));
+               __m512 sinc1 = _mm512_fmadd_ps(
+                     _mm512_load_ps(delta_table + i + 16), delta,
+                     _mm512_load_ps(phase_table + i + 16));
+
+               sum_l0       = _mm512_fmadd_ps(
+                     _mm512_loadu_ps(buffer_l + i),      sinc0, sum_l0);
+               sum_r0       = _mm512_fmadd_ps(
+                     _mm512_loadu_ps(buffer_r + i),      sinc0, sum_r0);
+               sum_l1       = _mm512_fmadd_ps(
+                     _mm512_loadu_ps(buffer_l + i + 16), sinc1, sum_l1);
+               sum_r1       = _mm512_fmadd_ps(
+                     _mm512_loadu_ps(buffer_r + i + 16), sinc1, sum_r1);
+            }
+
+            resampler_sinc_store_avx(output,
+                  resampler_sinc_fold_avx512(_mm512_add_ps(sum_l0, sum_l1)),
+                  resampler_sinc_fold_avx512(_mm512_add_ps(sum_r0, sum_r1)));
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+   else
+   {
+      while (frames)
+      {
+         while (frames && resamp->time >= phases)
+         {
+            /* Push in reverse to make filter more obvious. */
+            if (!resamp->ptr)
+               resamp->ptr = resamp->taps;
+            resamp->ptr--;
+
+            resamp->buffer_l[resamp->ptr + resamp->taps] =
+               resamp->buffer_l[resamp->ptr]                = *input++;
+
+            resamp->buffer_r[resamp->ptr + resamp->taps] =
+               resamp->buffer_r[resamp->ptr]                = *input++;
+
+            resamp->time                                -= phases;
+            frames--;
+         }
+
+         while (resamp->time < phases)
+         {
+            unsigned i;
+            const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+            const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+            unsigned taps            = resamp->taps;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps;
+            __m512 sum_l0            = _mm512_setzero_ps();
+            __m512 sum_r0            = _mm512_setzero_ps();
+            __m512 sum_l1            = _mm512_setzero_ps();
+            __m512 sum_r1            = _mm512_setzero_ps();
+
+            for (i = 0; i < taps; i += 32)
+            {
+               __m512 sinc0 = _mm512_load_ps(phase_table + i);
+               __m512 sinc1 = _mm512_load_ps(phase_table + i + 16);
+
+               sum_l0       = _mm512_fmadd_ps(
+                     _mm512_loadu_ps(buffer_l + i),      sinc0, sum_l0);
+               sum_r0       = _mm512_fmadd_ps(
+                     _mm512_loadu_ps(buffer_r + i),      sinc0, sum_r0);
+               sum_l1       = _mm512_fmadd_ps(
+                     _mm512_loadu_ps(buffer_l + i + 16), sinc1, sum_l1);
+               sum_r1       = _mm512_fmadd_ps(
+                     _mm512_loadu_ps(buffer_r + i + 16), sinc1, sum_r1);
+            }
+
+            resampler_sinc_store_avx(output,
+                  resampler_sinc_fold_avx512(_mm512_add_ps(sum_l0, sum_l1)),
+                  resampler_sinc_fold_avx512(_mm512_add_ps(sum_r0, sum_r1)));
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+#endif
+
+#ifdef SINC_SSE
+SINC_TARGET("sse")
 static void resampler_sinc_process_sse(void *re_, struct resampler_data *data)
 {
    rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
@@ -586,6 +939,76 @@ static void resampler_sinc_process_c(void *re_, struct resampler_data *data)
    data->output_frames = out_frames;
 }
 
+struct sinc_kernel
+{
+   void (*process)(void *re_, struct resampler_data *data);
+   resampler_simd_mask_t simd;
+   unsigned tap_align;
+   /* Only worth it with the long filters of the
+    * higher quality levels, see enable_avx */
+   bool wide;
+   bool kaiser;
+};
+
+/* Fastest first. resampler_sinc_new() takes the first one
+ * the CPU can run, and pads the taps to its tap_align. */
+static const struct sinc_kernel sinc_kernels[] = {
+#ifdef SINC_AVX512
+   { resampler_sinc_process_avx512,   RESAMPLER_SIMD_AVX512F,
+      32, true,  true },
+#endif
+#ifdef SINC_AVX2_FMA
+   { resampler_sinc_process_avx2_fma, RESAMPLER_SIMD_AVX
+      | RESAMPLER_SIMD_AVX2 | RESAMPLER_SIMD_FMA3,
+      16, true,  true },
+#endif
+#ifdef SINC_AVX
+   { resampler_sinc_process_avx,      RESAMPLER_SIMD_AVX,
+      8,  true,  true },
+#endif
+#ifdef SINC_SSE
+   { resampler_sinc_process_sse,      RESAMPLER_SIMD_SSE,
+      4,  false, true },
+#endif
+#ifdef WANT_NEON
+   { resampler_sinc_process_neon,     RESAMPLER_SIMD_NEON,
+      8,  false, false },
+   { resampler_sinc_process_c,        0,
+      8,  false, true },
+#else
+   { resampler_sinc_process_c,        0,
+      4,  false, true },
+#endif
+};
+
+static const struct sinc_kernel *sinc_pick_kernel(
+      const rarch_sinc_resampler_t *re, resampler_simd_mask_t mask)
+{
+   unsigned i;
+   size_t count = sizeof(sinc_kernels) / sizeof(sinc_kernels[0]);
+
+   for (i = 0; i < count - 1; i++)
+   {
+      const struct sinc_kernel *kernel = &sinc_kernels[i];
+
+      if ((mask & kernel->simd) != kernel->simd)
+         continue;
+      if (kernel->wide && !re->enable_avx)
+         continue;
+      if (!kernel->kaiser && re->window_type == SINC_WINDOW_KAISER)
+         continue;
+      return kernel;
+   }
+
+   return &sinc_kernels[count - 1];
+}
+
+static void resampler_sinc_process(void *re_, struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)re_;
+   re->kernel->process(re, data);
+}
+
 static void resampler_sinc_free(void *data)
 {
    rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)data;
@@ -714,6 +1137,7 @@ static void *resampler_sinc_new(const struct resampler_config *config,
       resampler_simd_mask_t mask)
 {
    double cutoff                  = 0.0;
+   const struct sinc_kernel *kernel = NULL;
    size_t phase_elems             = 0;
    size_t elems                   = 0;
    unsigned sidelobes             = 0;
@@ -786,18 +1210,10 @@ static void *resampler_sinc_new(const struct resampler_config *config,
    }
 
    /* Be SIMD-friendly. */
-#if defined(__AVX__)
-   if (re->enable_avx)
-      re->taps  = (re->taps + 7) & ~7;
-   else
-#endif
-   {
-#if defined(WANT_NEON)
-      re->taps     = (re->taps + 7) & ~7;
-#else
-      re->taps     = (re->taps + 3) & ~3;
-#endif
-   }
+   kernel          = sinc_pick_kernel(re, mask);
+   re->kernel      = kernel;
+   re->taps        = (re->taps + kernel->tap_align - 1)
+      & ~(kernel->tap_align - 1);
 
    phase_elems     = ((1 << re->phase_bits) * re->taps);
    if (re->window_type == SINC_WINDOW_KAISER)
@@ -828,27 +1244,6 @@ static void *resampler_sinc_new(const struct resampler_config *config,
          goto error;
    }
 
-   sinc_resampler.process = resampler_sinc_process_c;
-
-   if (mask & RESAMPLER_SIMD_AVX && re->enable_avx)
-   {
-#if defined(__AVX__)
-      sinc_resampler.process = resampler_sinc_process_avx;
-#endif
-   }
-   else if (mask & RESAMPLER_SIMD_SSE)
-   {
-#if defined(__SSE__)
-      sinc_resampler.process = resampler_sinc_process_sse;
-#endif
-   }
-   else if (mask & RESAMPLER_SIMD_NEON && re->window_type != SINC_WINDOW_KAISER)
-   {
-#if defined(WANT_NEON)
-      sinc_resampler.process = resampler_sinc_process_neon;
-#endif
-   }
-
    return re;
 
 error:
@@ -858,7 +1253,7 @@ error:
 
 retro_resampler_t sinc_resampler = {
    resampler_sinc_new,
-   resampler_sinc_process_c,
+   resampler_sinc_process,
    resampler_sinc_free,
    RESAMPLER_API_VERSION,
    "sinc",
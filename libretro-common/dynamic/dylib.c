@@ -20,6 +20,11 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* For dlmopen() */
+#define _GNU_SOURCE
+#endif
+
 #include <string.h>
 #include <stdio.h>
 #include <dynamic/dylib.h>
@@ -126,6 +131,27 @@ dylib_t dylib_load(const char *path)
    return lib;
 }
 
+/**
+ * dylib_load_isolated:
+ * @path                         : Path to library.
+ *
+ * Loads @path into a new link-map namespace, so it gets
+ * its own copy of the library and its global state even if
+ * it is loaded already. Needs glibc. The namespace also gets
+ * its own copy of libc, and glibc only has room for about 16
+ * namespaces, so prefer other ways of getting a second copy.
+ *
+ * Returns: library handle on success, otherwise NULL.
+ **/
+dylib_t dylib_load_isolated(const char *path)
+{
+#if !defined(_WIN32) && defined(LM_ID_NEWLM)
+   return dlmopen(LM_ID_NEWLM, path, RTLD_LAZY | RTLD_LOCAL);
+#else
+   return NULL;
+#endif
+}
+
 char *dylib_error(void)
 {
 #ifdef _WIN32
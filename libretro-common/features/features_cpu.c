@@ -722,11 +722,22 @@ uint64_t cpu_features_get(void)
          && ((xgetbv_x86(0) & 0x6) == 0x6))
       cpu |= RETRO_SIMD_AVX;
 
+   /* FMA3 works on the AVX register state */
+   if ((cpu & RETRO_SIMD_AVX) && (flags[2] & (1 << 12)))
+      cpu |= CPU_FEATURE_FMA3;
+
    if (max_flag >= 7)
    {
       x86_cpuid(7, flags);
       if (flags[1] & (1 << 5))
          cpu |= RETRO_SIMD_AVX2;
+
+      /* AVX-512 Foundation; the OS must also save
+       * the opmask and upper ZMM register state. */
+      if (     (flags[1] & (1 << 16))
+            && (cpu & RETRO_SIMD_AVX)
+            && ((xgetbv_x86(0) & 0xe6) == 0xe6))
+         cpu |= CPU_FEATURE_AVX512F;
    }
 
    x86_cpuid(0x80000000, flags);
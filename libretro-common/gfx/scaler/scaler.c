@@ -29,6 +29,10 @@
 #include <gfx/scaler/scaler_int.h>
 #include <gfx/scaler/filter.h>
 #include <gfx/scaler/pixconv.h>
+#include <rthreads/parallel.h>
+
+/* Roughly how many output pixels are worth handing to another thread */
+#define SCALER_PARALLEL_PIXELS (64 * 1024)
 
 static bool allocate_frames(struct scaler_ctx *ctx)
 {
@@ -305,6 +309,35 @@ void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
    ctx->output.stride       = 0;
 }
 
+struct scaler_pass
+{
+   const struct scaler_ctx *ctx;
+   const void *input;
+   void *output;
+   int stride;
+};
+
+static void scaler_horiz_rows(void *data, size_t begin, size_t end)
+{
+   const struct scaler_pass *pass = (const struct scaler_pass*)data;
+   pass->ctx->scaler_horiz(pass->ctx, pass->input, pass->stride,
+         (int)begin, (int)end);
+}
+
+static void scaler_vert_rows(void *data, size_t begin, size_t end)
+{
+   const struct scaler_pass *pass = (const struct scaler_pass*)data;
+   pass->ctx->scaler_vert(pass->ctx, pass->output, pass->stride,
+         (int)begin, (int)end);
+}
+
+/* Rows per band, so that small frames stay on one thread */
+static size_t scaler_grain(int width)
+{
+   size_t rows = SCALER_PARALLEL_PIXELS / (width > 0 ? width : 1);
+   return rows ? rows : 1;
+}
+
 /**
  * scaler_ctx_scale:
  * @ctx          : pointer to scaler context object.
@@ -345,11 +378,28 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
             output_stride, input_stride);
    else
    {
-      /* Take generic filter path. */
+      /* Take generic filter path. Rows are independent within
+       * each pass, so both are split into bands. */
+      struct scaler_pass pass;
+
+      pass.ctx    = ctx;
+      pass.input  = input_frame;
+      pass.output = output;
+
       if (ctx->scaler_horiz)
-         ctx->scaler_horiz(ctx, input_frame, input_stride);
+      {
+         pass.stride = input_stride;
+         parallel_for(0, ctx->scaled.height,
+               scaler_grain(ctx->scaled.width),
+               scaler_horiz_rows, &pass);
+      }
       if (ctx->scaler_vert)
-         ctx->scaler_vert (ctx, output, output_stride);
+      {
+         pass.stride = output_stride;
+         parallel_for(0, ctx->out_height,
+               scaler_grain(ctx->out_width),
+               scaler_vert_rows, &pass);
+      }
    }
 
    if (ctx->out_fmt != SCALER_FMT_ARGB8888)
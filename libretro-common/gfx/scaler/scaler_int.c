@@ -62,15 +62,17 @@
  * SIMD code for testing purposes.
  */
 
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride,
+      int first, int last)
 {
    int h, w, y;
    const uint64_t      *input = ctx->scaled.frame;
-   uint32_t           *output = (uint32_t*)output_;
+   uint32_t           *output = (uint32_t*)output_ + first * (stride >> 2);
 
-   const int16_t *filter_vert = ctx->vert.filter;
+   const int16_t *filter_vert = ctx->vert.filter
+      + first * ctx->vert.filter_stride;
 
-   for (h = 0; h < ctx->out_height; h++,
+   for (h = first; h < last; h++,
          filter_vert += ctx->vert.filter_stride, output += stride >> 2)
    {
       const uint64_t *input_base = input + ctx->vert.filter_pos[h]
@@ -145,13 +147,15 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
    }
 }
 
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride,
+      int first, int last)
 {
    int h, w, x;
-   const uint32_t *input = (uint32_t*)input_;
-   uint64_t *output      = ctx->scaled.frame;
+   const uint32_t *input = (const uint32_t*)input_ + first * (stride >> 2);
+   uint64_t *output      = ctx->scaled.frame
+      + first * (ctx->scaled.stride >> 3);
 
-   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2,
+   for (h = first; h < last; h++, input += stride >> 2,
          output += ctx->scaled.stride >> 3)
    {
       const int16_t *filter_horiz = ctx->horiz.filter;
@@ -47,6 +47,11 @@ RETRO_BEGIN_DECLS
 #define RESAMPLER_SIMD_VFPU     (1 << 13)
 #define RESAMPLER_SIMD_PS       (1 << 14)
 
+/* Not RETRO_SIMD_* bits, resampler_append_plugs()
+ * translates them from the CPU_FEATURE_* ones */
+#define RESAMPLER_SIMD_FMA3     (1 << 24)
+#define RESAMPLER_SIMD_AVX512F  (1 << 25)
+
 enum resampler_quality
 {
    RESAMPLER_QUALITY_DONTCARE = 0,
@@ -151,6 +156,7 @@ typedef struct audio_frame_float
 } audio_frame_float_t;
 
 extern retro_resampler_t sinc_resampler;
+extern retro_resampler_t polyphase_resampler;
 #ifdef HAVE_CC_RESAMPLER
 extern retro_resampler_t CC_resampler;
 #endif
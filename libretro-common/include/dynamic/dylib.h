@@ -53,6 +53,20 @@ typedef void (*function_t)(void);
  **/
 dylib_t dylib_load(const char *path);
 
+/**
+ * dylib_load_isolated:
+ * @path                         : Path to library.
+ *
+ * Loads @path into a new link-map namespace, so it gets
+ * its own copy of the library and its global state even if
+ * it is loaded already. Needs glibc. The namespace also gets
+ * its own copy of libc, and glibc only has room for about 16
+ * namespaces, so prefer other ways of getting a second copy.
+ *
+ * Returns: library handle on success, otherwise NULL.
+ **/
+dylib_t dylib_load_isolated(const char *path);
+
 /**
  * dylib_close:
  * @lib                          : Library handle.
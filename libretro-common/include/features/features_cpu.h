@@ -31,6 +31,14 @@
 
 RETRO_BEGIN_DECLS
 
+/* Features that are not part of the libretro API. They sit above
+ * the RETRO_SIMD_* bits and must be masked out with
+ * CPU_FEATURES_LIBRETRO_MASK before handing the result to cores. */
+#define CPU_FEATURE_AVX512F         (UINT64_C(1) << 32)
+#define CPU_FEATURE_FMA3            (UINT64_C(1) << 33)
+
+#define CPU_FEATURES_LIBRETRO_MASK  UINT64_C(0xffffffff)
+
 /**
  * cpu_features_get_perf_counter:
  *
@@ -55,7 +63,8 @@ retro_time_t cpu_features_get_time_usec(void);
  *
  * Gets CPU features.
  *
- * Returns: bitmask of all CPU features available.
+ * Returns: bitmask of all CPU features available,
+ * RETRO_SIMD_* and CPU_FEATURE_*.
  **/
 uint64_t cpu_features_get(void);
 
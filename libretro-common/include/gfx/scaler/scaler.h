@@ -61,10 +61,12 @@ struct scaler_filter
 
 struct scaler_ctx
 {
+   /* Filter the rows [first, last), so that bands of rows
+    * can be filtered in parallel */
    void (*scaler_horiz)(const struct scaler_ctx*,
-         const void*, int);
+         const void*, int, int, int);
    void (*scaler_vert)(const struct scaler_ctx*,
-         void*, int);
+         void*, int, int, int);
    void (*scaler_special)(const struct scaler_ctx*,
          void*, const void*, int, int, int, int, int, int);
 
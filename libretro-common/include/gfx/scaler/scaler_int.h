@@ -30,10 +30,10 @@
 RETRO_BEGIN_DECLS
 
 void scaler_argb8888_vert(const struct scaler_ctx *ctx,
-      void *output, int stride);
+      void *output, int stride, int first, int last);
 
 void scaler_argb8888_horiz(const struct scaler_ctx *ctx,
-      const void *input, int stride);
+      const void *input, int stride, int first, int last);
 
 void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
       void *output, const void *input,
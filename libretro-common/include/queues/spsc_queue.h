@@ -0,0 +1,155 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_queue.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_SPSC_QUEUE_H
+#define __LIBRETRO_SDK_SPSC_QUEUE_H
+
+#include <stddef.h>
+
+#include <retro_common_api.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/* A byte ring for exactly one producer thread and one consumer
+ * thread. Reads and writes take no locks; a side only touches a
+ * lock when it has to sleep in spsc_queue_wait_read() or
+ * spsc_queue_wait_write(), or has to wake the other side from one.
+ *
+ * The write functions may only be called from the producer and the
+ * read functions only from the consumer. Either thread may close
+ * the queue. Without HAVE_THREADS the waits never sleep. */
+
+typedef struct spsc_queue spsc_queue_t;
+
+/**
+ * spsc_queue_new:
+ * @size         : Capacity in bytes.
+ *
+ * Returns: a new empty queue, or NULL on failure.
+ **/
+spsc_queue_t *spsc_queue_new(size_t size);
+
+/**
+ * spsc_queue_free:
+ * @queue        : Queue to free. Neither side may still be using it.
+ **/
+void spsc_queue_free(spsc_queue_t *queue);
+
+/**
+ * spsc_queue_size:
+ * @queue        : Queue.
+ *
+ * Returns: capacity in bytes.
+ **/
+size_t spsc_queue_size(spsc_queue_t *queue);
+
+/**
+ * spsc_queue_write_avail:
+ * @queue        : Queue.
+ *
+ * Producer only. The consumer may free up more at any time.
+ *
+ * Returns: bytes that can be written right now.
+ **/
+size_t spsc_queue_write_avail(spsc_queue_t *queue);
+
+/**
+ * spsc_queue_read_avail:
+ * @queue        : Queue.
+ *
+ * Consumer only. The producer may add more at any time.
+ *
+ * Returns: bytes that can be read right now.
+ **/
+size_t spsc_queue_read_avail(spsc_queue_t *queue);
+
+/**
+ * spsc_queue_write:
+ * @queue        : Queue.
+ * @data         : Bytes to write.
+ * @size         : Number of bytes to write.
+ *
+ * Producer only. Writes as much of @data as fits.
+ *
+ * Returns: number of bytes written.
+ **/
+size_t spsc_queue_write(spsc_queue_t *queue, const void *data, size_t size);
+
+/**
+ * spsc_queue_read:
+ * @queue        : Queue.
+ * @data         : Buffer to read into.
+ * @size         : Number of bytes to read.
+ *
+ * Consumer only. Reads as much as is queued, up to @size.
+ *
+ * Returns: number of bytes read.
+ **/
+size_t spsc_queue_read(spsc_queue_t *queue, void *data, size_t size);
+
+/**
+ * spsc_queue_wait_write:
+ * @queue        : Queue.
+ * @size         : Bytes of free space to wait for, capped to the
+ *                 capacity.
+ *
+ * Producer only. Sleeps until @size bytes can be written.
+ *
+ * Returns: false if the queue was closed instead.
+ **/
+bool spsc_queue_wait_write(spsc_queue_t *queue, size_t size);
+
+/**
+ * spsc_queue_wait_read:
+ * @queue        : Queue.
+ * @size         : Bytes to wait for, capped to the capacity.
+ *
+ * Consumer only. Sleeps until @size bytes can be read, the queue
+ * is closed or spsc_queue_wake_reader() is called.
+ *
+ * Returns: true if @size bytes can be read.
+ **/
+bool spsc_queue_wait_read(spsc_queue_t *queue, size_t size);
+
+/**
+ * spsc_queue_wake_reader:
+ * @queue        : Queue.
+ *
+ * Makes the consumer's current or next spsc_queue_wait_read()
+ * return early, for consumers that also wait on other queues fed
+ * by the same producer.
+ **/
+void spsc_queue_wake_reader(spsc_queue_t *queue);
+
+/**
+ * spsc_queue_close:
+ * @queue        : Queue.
+ *
+ * Makes every current and future wait return false. Data can
+ * still be read and written.
+ **/
+void spsc_queue_close(spsc_queue_t *queue);
+
+RETRO_END_DECLS
+
+#endif
@@ -44,6 +44,21 @@ enum task_type
    TASK_TYPE_BLOCKING
 };
 
+/* Which tasks the threaded task queue runs first.
+ * Bulk tasks are never given every worker, so
+ * interactive and I/O tasks pushed behind a long
+ * scan still start right away. */
+enum task_priority
+{
+   /* Work the user is waiting to see, e.g. thumbnails */
+   TASK_PRIORITY_INTERACTIVE = 0,
+   /* The default: downloads, savestates, ... */
+   TASK_PRIORITY_IO,
+   /* Long jobs that can take their time, e.g. scans */
+   TASK_PRIORITY_BULK,
+   TASK_PRIORITY_LAST
+};
+
 typedef struct retro_task retro_task_t;
 typedef void (*retro_task_callback_t)(retro_task_t *task,
       void *task_data,
@@ -100,6 +115,11 @@ struct retro_task
     * free()d automatically if non-NULL. */
    char *title;
 
+   /* what task_queue_get_stats() files the task
+    * under, along with the handler; if NULL, the
+    * first title seen names the entry */
+   const char *stats_name;
+
    /* frontend userdata
     * (e.g. associate a sticky notification to a task) */
    void *frontend_userdata;
@@ -107,6 +127,13 @@ struct retro_task
    /* don't touch this. */
    retro_task_t *next;
 
+   /* don't touch these either: timings kept
+    * for task_queue_get_stats(). */
+   retro_time_t queued_time;
+   retro_time_t start_time;
+   retro_time_t run_time;
+   uint32_t iterations;
+
    /* -1 = unmetered/indeterminate, 0-100 = current progress percentage */
    int8_t progress;
 
@@ -115,6 +142,9 @@ struct retro_task
 
    enum task_type type;
 
+   /* TASK_PRIORITY_IO unless the pusher says otherwise */
+   enum task_priority priority;
+
    /* if set to true, frontend will
    use an alternative look for the
    task progress display */
@@ -130,8 +160,42 @@ struct retro_task
 
    /* if true no OSD messages will be displayed. */
    bool mute;
+
+   /* don't touch this either: set while a
+    * worker thread runs the handler. */
+   bool running;
 };
 
+#define TASK_STATS_BUCKETS 24
+
+/* What the tasks that finished so far spent,
+ * per handler and stats_name. Times are in microseconds.
+ * The histograms are base 2: bucket i counts
+ * values from 2^i up to 2^(i+1), bucket 0
+ * also counts 0 and the last one everything
+ * past it. */
+typedef struct task_queue_stats
+{
+   retro_task_handler_t handler;
+   const char *stats_name;
+   /* stats_name, or else the first title seen */
+   char name[64];
+   uint64_t count;
+   /* from task_queue_push(), or from 'when'
+    * for scheduled tasks, to the first run */
+   retro_time_t wait_total;
+   retro_time_t wait_max;
+   /* time spent in the handler */
+   retro_time_t run_total;
+   retro_time_t run_max;
+   /* calls to the handler */
+   uint64_t iterations_total;
+   uint64_t iterations_max;
+   uint32_t wait_hist[TASK_STATS_BUCKETS];
+   uint32_t run_hist[TASK_STATS_BUCKETS];
+   uint32_t iterations_hist[TASK_STATS_BUCKETS];
+} task_queue_stats_t;
+
 typedef struct task_finder_data
 {
    retro_task_finder_t func;
@@ -197,6 +261,12 @@ void task_queue_unset_threaded(void);
 
 bool task_queue_is_threaded(void);
 
+/* Sets how many worker threads the threaded
+ * task queue runs, 0 to pick from the number
+ * of CPU cores. Takes effect on the next
+ * task_queue_check(). */
+void task_queue_set_workers(unsigned workers);
+
 /**
  * Calls func for every running task
  * until it returns true.
@@ -252,6 +322,23 @@ void task_queue_deinit(void);
  * This must only be called from the main thread. */
 void task_queue_init(bool threaded, retro_task_queue_msg_t msg_push);
 
+/* Points *stats at the statistics of the
+ * tasks finished so far, one entry per handler
+ * and stats_name, and returns how many entries there are.
+ * Tasks past the last entry are counted in it.
+ * This must only be called from the main thread. */
+size_t task_queue_get_stats(const task_queue_stats_t **stats);
+
+/* Forgets all statistics.
+ * This must only be called from the main thread. */
+void task_queue_reset_stats(void);
+
+/* Returns the upper bound of the histogram bucket
+ * that holds the given percentile of the values,
+ * or max if that is lower. */
+uint64_t task_queue_stats_percentile(const uint32_t *hist,
+      uint64_t count, uint64_t max, unsigned percent);
+
 /* Allocates and inits a new retro_task_t */
 retro_task_t *task_init(void);
 
@@ -0,0 +1,131 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (parallel.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_PARALLEL_H__
+#define __LIBRETRO_SDK_PARALLEL_H__
+
+#include <stddef.h>
+
+#include <retro_common_api.h>
+
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/* A process-wide pool of worker threads for splitting frame-sized
+ * work, so that every subsystem doesn't have to keep its own.
+ *
+ * Each worker has its own deque of jobs. A thread that splits work
+ * pushes the pieces onto its own deque and works through them
+ * newest first, while idle workers steal the oldest (and so
+ * largest) pieces from the other end. Threads that wait on a group
+ * run queued jobs instead of sleeping, so jobs may split further
+ * and wait on groups of their own.
+ *
+ * Without HAVE_THREADS, or before parallel_init(), everything runs
+ * on the calling thread. */
+
+typedef void (*parallel_for_fn_t)(void *data, size_t begin, size_t end);
+
+typedef void (*parallel_job_fn_t)(void *data);
+
+/* A set of jobs to wait for. Initialize with parallel_group_init();
+ * it needs no cleanup. */
+typedef struct parallel_group
+{
+   volatile long pending;
+} parallel_group_t;
+
+/**
+ * parallel_init:
+ * @workers      : Number of worker threads, 0 to pick from the
+ *                 number of CPU cores.
+ *
+ * Starts the worker threads. The thread calling parallel_for()
+ * or parallel_group_wait() works too, so 0 picks one less than
+ * the number of cores.
+ *
+ * Returns: true if workers are running.
+ **/
+bool parallel_init(unsigned workers);
+
+/**
+ * parallel_deinit:
+ *
+ * Stops the worker threads. Nothing may be running in parallel
+ * at the time.
+ **/
+void parallel_deinit(void);
+
+/**
+ * parallel_get_threads:
+ *
+ * Returns: how many threads work on a parallel_for(),
+ * the caller included.
+ **/
+unsigned parallel_get_threads(void);
+
+/**
+ * parallel_for:
+ * @begin        : First index.
+ * @end          : One past the last index.
+ * @grain        : Ranges of at most this many indices are not
+ *                 split further. 0 splits into one range per
+ *                 thread.
+ * @fn           : Called with disjoint subranges covering
+ *                 [begin, end), from any thread.
+ * @data         : Passed to @fn.
+ *
+ * Runs @fn over the range and returns once all of it is done.
+ **/
+void parallel_for(size_t begin, size_t end, size_t grain,
+      parallel_for_fn_t fn, void *data);
+
+/**
+ * parallel_group_init:
+ * @group        : Group to initialize.
+ **/
+void parallel_group_init(parallel_group_t *group);
+
+/**
+ * parallel_group_run:
+ * @group        : Group the job belongs to.
+ * @fn           : Job, called from any thread.
+ * @data         : Passed to @fn.
+ *
+ * Queues a job. It may also run right away on the calling thread.
+ **/
+void parallel_group_run(parallel_group_t *group,
+      parallel_job_fn_t fn, void *data);
+
+/**
+ * parallel_group_wait:
+ * @group        : Group to wait for.
+ *
+ * Returns once every job of @group has finished, running queued
+ * jobs meanwhile.
+ **/
+void parallel_group_wait(parallel_group_t *group);
+
+RETRO_END_DECLS
+
+#endif
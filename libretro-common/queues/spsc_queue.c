@@ -0,0 +1,327 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_queue.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memalign.h>
+#include <queues/spsc_queue.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+#define SPSC_CACHE_LINE 64
+
+/* Acquire loads and release stores for the positions, and a full
+ * fence for the sleep handshake. */
+#if defined(__clang__) || (defined(__GNUC__) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define SPSC_LOAD(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SPSC_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define SPSC_XCHG(p, v)   __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+#define SPSC_FENCE()      __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#elif defined(__GNUC__)
+#define SPSC_FENCE()      __sync_synchronize()
+#elif defined(_MSC_VER)
+#define SPSC_FENCE()      MemoryBarrier()
+#else
+/* Single core targets only */
+#define SPSC_FENCE()
+#endif
+
+#ifndef SPSC_LOAD
+static size_t spsc_load(volatile size_t *p)
+{
+   size_t v = *p;
+   SPSC_FENCE();
+   return v;
+}
+
+static int spsc_xchg(volatile int *p, int v)
+{
+   int old;
+   SPSC_FENCE();
+   old = *p;
+   *p  = v;
+   SPSC_FENCE();
+   return old;
+}
+
+#define SPSC_LOAD(p)      spsc_load((p))
+#define SPSC_STORE(p, v)  do { SPSC_FENCE(); *(p) = (v); } while (0)
+#define SPSC_XCHG(p, v)   spsc_xchg((p), (v))
+#endif
+
+/* Positions run over [0, 2 * size) rather than [0, size), so that
+ * a full ring can be told apart from an empty one without wasting
+ * a byte, and they never overflow. Each side keeps the position it
+ * writes and its last look at the other side's on a cache line of
+ * its own, so the lines only bounce when a side runs out. */
+struct spsc_queue
+{
+   /* Producer */
+   volatile size_t head;
+   size_t tail_seen;
+   uint8_t pad_producer[SPSC_CACHE_LINE - 2 * sizeof(size_t)];
+
+   /* Consumer */
+   volatile size_t tail;
+   size_t head_seen;
+   uint8_t pad_consumer[SPSC_CACHE_LINE - 2 * sizeof(size_t)];
+
+   uint8_t *buffer;
+   size_t size;
+   size_t wrap;
+
+   /* Set by a side about to sleep, checked by the other one */
+   volatile int reader_waiting;
+   volatile int writer_waiting;
+   volatile int woken;
+   volatile int closed;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+#endif
+};
+
+static size_t spsc_queue_used(const spsc_queue_t *queue,
+      size_t head, size_t tail)
+{
+   return head >= tail ? head - tail : head + queue->wrap - tail;
+}
+
+static size_t spsc_queue_advance(const spsc_queue_t *queue,
+      size_t pos, size_t size)
+{
+   pos += size;
+   if (pos >= queue->wrap)
+      pos -= queue->wrap;
+   return pos;
+}
+
+/* Wakes the other side if it said it is going to sleep. The fence
+ * orders our position update before the check, and the sleeper
+ * fences between its flag and its last look at the position, so
+ * at least one of us sees the other. */
+static void spsc_queue_notify(spsc_queue_t *queue, volatile int *waiting)
+{
+#ifdef HAVE_THREADS
+   SPSC_FENCE();
+   if (!*waiting)
+      return;
+   slock_lock(queue->lock);
+   scond_broadcast(queue->cond);
+   slock_unlock(queue->lock);
+#endif
+}
+
+spsc_queue_t *spsc_queue_new(size_t size)
+{
+   spsc_queue_t *queue;
+
+   if (!size)
+      return NULL;
+
+   queue = (spsc_queue_t*)memalign_alloc(SPSC_CACHE_LINE, sizeof(*queue));
+   if (!queue)
+      return NULL;
+
+   memset(queue, 0, sizeof(*queue));
+   queue->size   = size;
+   queue->wrap   = size * 2;
+   queue->buffer = (uint8_t*)malloc(size);
+   if (!queue->buffer)
+      goto error;
+
+#ifdef HAVE_THREADS
+   if (!(queue->lock = slock_new()))
+      goto error;
+   if (!(queue->cond = scond_new()))
+      goto error;
+#endif
+
+   return queue;
+
+error:
+   spsc_queue_free(queue);
+   return NULL;
+}
+
+void spsc_queue_free(spsc_queue_t *queue)
+{
+   if (!queue)
+      return;
+
+#ifdef HAVE_THREADS
+   if (queue->cond)
+      scond_free(queue->cond);
+   if (queue->lock)
+      slock_free(queue->lock);
+#endif
+   free(queue->buffer);
+   memalign_free(queue);
+}
+
+size_t spsc_queue_size(spsc_queue_t *queue)
+{
+   return queue->size;
+}
+
+size_t spsc_queue_write_avail(spsc_queue_t *queue)
+{
+   queue->tail_seen = SPSC_LOAD(&queue->tail);
+   return queue->size - spsc_queue_used(queue,
+         queue->head, queue->tail_seen);
+}
+
+size_t spsc_queue_read_avail(spsc_queue_t *queue)
+{
+   queue->head_seen = SPSC_LOAD(&queue->head);
+   return spsc_queue_used(queue, queue->head_seen, queue->tail);
+}
+
+size_t spsc_queue_write(spsc_queue_t *queue, const void *data, size_t size)
+{
+   size_t first;
+   size_t head  = queue->head;
+   size_t pos   = head >= queue->size ? head - queue->size : head;
+   size_t avail = queue->size -
+      spsc_queue_used(queue, head, queue->tail_seen);
+
+   if (avail < size)
+      avail = spsc_queue_write_avail(queue);
+   if (size > avail)
+      size = avail;
+   if (!size)
+      return 0;
+
+   first = queue->size - pos;
+   if (first > size)
+      first = size;
+   memcpy(queue->buffer + pos, data, first);
+   memcpy(queue->buffer, (const uint8_t*)data + first, size - first);
+
+   SPSC_STORE(&queue->head, spsc_queue_advance(queue, head, size));
+   spsc_queue_notify(queue, &queue->reader_waiting);
+
+   return size;
+}
+
+size_t spsc_queue_read(spsc_queue_t *queue, void *data, size_t size)
+{
+   size_t first;
+   size_t tail  = queue->tail;
+   size_t pos   = tail >= queue->size ? tail - queue->size : tail;
+   size_t avail = spsc_queue_used(queue, queue->head_seen, tail);
+
+   if (avail < size)
+      avail = spsc_queue_read_avail(queue);
+   if (size > avail)
+      size = avail;
+   if (!size)
+      return 0;
+
+   first = queue->size - pos;
+   if (first > size)
+      first = size;
+   memcpy(data, queue->buffer + pos, first);
+   memcpy((uint8_t*)data + first, queue->buffer, size - first);
+
+   SPSC_STORE(&queue->tail, spsc_queue_advance(queue, tail, size));
+   spsc_queue_notify(queue, &queue->writer_waiting);
+
+   return size;
+}
+
+bool spsc_queue_wait_write(spsc_queue_t *queue, size_t size)
+{
+   if (size > queue->size)
+      size = queue->size;
+
+   while (spsc_queue_write_avail(queue) < size)
+   {
+      if (queue->closed)
+         return false;
+#ifdef HAVE_THREADS
+      slock_lock(queue->lock);
+      queue->writer_waiting = 1;
+      SPSC_FENCE();
+      if (spsc_queue_write_avail(queue) < size && !queue->closed)
+         scond_wait(queue->cond, queue->lock);
+      queue->writer_waiting = 0;
+      slock_unlock(queue->lock);
+#else
+      return false;
+#endif
+   }
+
+   return true;
+}
+
+bool spsc_queue_wait_read(spsc_queue_t *queue, size_t size)
+{
+   if (size > queue->size)
+      size = queue->size;
+
+   while (spsc_queue_read_avail(queue) < size)
+   {
+      if (queue->closed || SPSC_XCHG(&queue->woken, 0))
+         return false;
+#ifdef HAVE_THREADS
+      slock_lock(queue->lock);
+      queue->reader_waiting = 1;
+      SPSC_FENCE();
+      if (        spsc_queue_read_avail(queue) < size
+            && !queue->closed
+            && !queue->woken)
+         scond_wait(queue->cond, queue->lock);
+      queue->reader_waiting = 0;
+      slock_unlock(queue->lock);
+#else
+      return false;
+#endif
+   }
+
+   return true;
+}
+
+void spsc_queue_wake_reader(spsc_queue_t *queue)
+{
+   SPSC_XCHG(&queue->woken, 1);
+   spsc_queue_notify(queue, &queue->reader_waiting);
+}
+
+void spsc_queue_close(spsc_queue_t *queue)
+{
+   queue->closed = 1;
+#ifdef HAVE_THREADS
+   slock_lock(queue->lock);
+   scond_broadcast(queue->cond);
+   slock_unlock(queue->lock);
+#endif
+}
@@ -22,11 +22,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include <queues/task_queue.h>
 
 #include <features/features_cpu.h>
+#include <compat/strl.h>
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
@@ -37,6 +40,8 @@
 #define SLOCK_UNLOCK(x)
 #endif
 
+#define TASK_STATS_MAX 32
+
 typedef struct
 {
    retro_task_t *front;
@@ -64,6 +69,11 @@ static task_queue_t tasks_finished          = {NULL, NULL};
 
 static struct retro_task_impl *impl_current = NULL;
 static bool task_threaded_enable            = false;
+static unsigned task_workers_want           = 0;
+
+/* only touched from the main thread */
+static task_queue_stats_t task_stats[TASK_STATS_MAX];
+static size_t task_stats_count              = 0;
 
 #ifdef HAVE_THREADS
 static slock_t *running_lock                = NULL;
@@ -71,9 +81,13 @@ static slock_t *finished_lock               = NULL;
 static slock_t *property_lock               = NULL;
 static slock_t *queue_lock                  = NULL;
 static scond_t *worker_cond                 = NULL;
-static sthread_t *worker_thread             = NULL;
+static sthread_t **worker_threads           = NULL;
+static unsigned worker_count                = 0;
+static unsigned task_workers_current        = 0;
 static bool worker_continue                 = true; 
-/* use running_lock when touching it */
+/* use running_lock when touching these */
+static retro_task_handler_t *worker_handlers = NULL;
+static unsigned worker_bulk                 = 0;
 #endif
 
 static void task_queue_msg_push(retro_task_t *task,
@@ -167,11 +181,100 @@ static retro_task_t *task_queue_get(task_queue_t *queue)
    return task;
 }
 
+/* Called after each run of the handler, from
+ * whichever thread ran it. */
+static void task_queue_account_run(retro_task_t *task, retro_time_t start)
+{
+   if (!task->iterations++)
+      task->start_time = start;
+   task->run_time     += cpu_features_get_time_usec() - start;
+}
+
+static void task_stats_hist_add(uint32_t *hist, uint64_t value)
+{
+   unsigned bucket = 0;
+
+   while (value > 1 && bucket < TASK_STATS_BUCKETS - 1)
+   {
+      value >>= 1;
+      bucket++;
+   }
+
+   hist[bucket]++;
+}
+
+static void task_stats_add(retro_task_t *task)
+{
+   size_t i;
+   task_queue_stats_t *stats = NULL;
+   retro_time_t wait         = 0;
+
+   /* The last slot is reserved for "(other)", never match it */
+   for (i = 0; i < task_stats_count && i < TASK_STATS_MAX - 1; i++)
+   {
+      if (     task_stats[i].handler    == task->handler
+            && task_stats[i].stats_name == task->stats_name)
+      {
+         stats = &task_stats[i];
+         break;
+      }
+   }
+
+   if (!stats)
+   {
+      if (task_stats_count < TASK_STATS_MAX - 1)
+      {
+         stats             = &task_stats[task_stats_count++];
+         stats->handler    = task->handler;
+         stats->stats_name = task->stats_name;
+         if (task->stats_name)
+            strlcpy(stats->name, task->stats_name, sizeof(stats->name));
+      }
+      else
+      {
+         stats             = &task_stats[TASK_STATS_MAX - 1];
+         if (task_stats_count < TASK_STATS_MAX)
+         {
+            task_stats_count  = TASK_STATS_MAX;
+            strlcpy(stats->name, "(other)", sizeof(stats->name));
+         }
+      }
+   }
+
+   if (!*stats->name && task->title)
+      strlcpy(stats->name, task->title, sizeof(stats->name));
+
+   if (task->iterations)
+   {
+      wait = task->start_time - task->queued_time;
+      if (task->when > task->queued_time)
+         wait = task->start_time - task->when;
+      if (wait < 0)
+         wait = 0;
+   }
+
+   stats->count++;
+   stats->wait_total       += wait;
+   stats->run_total        += task->run_time;
+   stats->iterations_total += task->iterations;
+   if (wait > stats->wait_max)
+      stats->wait_max       = wait;
+   if (task->run_time > stats->run_max)
+      stats->run_max        = task->run_time;
+   if (task->iterations > stats->iterations_max)
+      stats->iterations_max = task->iterations;
+
+   task_stats_hist_add(stats->wait_hist, wait);
+   task_stats_hist_add(stats->run_hist, task->run_time);
+   task_stats_hist_add(stats->iterations_hist, task->iterations);
+}
+
 static void retro_task_internal_gather(void)
 {
    retro_task_t *task = NULL;
    while ((task = task_queue_get(&tasks_finished)))
    {
+      task_stats_add(task);
       task_queue_push_progress(task);
 
       if (task->callback)
@@ -215,11 +318,14 @@ static void retro_task_regular_gather(void)
 
    for (task = queue; task; task = next)
    {
-      next = task->next;
+      retro_time_t now = cpu_features_get_time_usec();
+
+      next             = task->next;
 
-      if (!task->when || task->when < cpu_features_get_time_usec())
+      if (!task->when || task->when < now)
       {
          task->handler(task);
+         task_queue_account_run(task, now);
 
          task_queue_push_progress(task);
       }
@@ -467,77 +573,141 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
    slock_unlock(running_lock);
 }
 
+/* 'running_lock' must be held for the duration of this function.
+ *
+ * Picks the next task for a worker: the first one that is due in
+ * the most urgent priority class. Tasks sharing a handler may
+ * share state, so those never run on two workers at once, and
+ * bulk tasks leave at least one worker free for the others.
+ * If nothing can run yet, *wake is set to when the next
+ * scheduled task is due, or left at 0. */
+static retro_task_t *threaded_worker_pick(retro_time_t *wake)
+{
+   retro_task_t *task = NULL;
+   retro_task_t *best = NULL;
+   retro_time_t now   = 0;
+   bool bulk_full     = worker_count > 1 && worker_bulk >= worker_count - 1;
+
+   for (task = tasks_running.front; task; task = task->next)
+   {
+      unsigned i;
+
+      if (task->running)
+         continue;
+      if (best && task->priority >= best->priority)
+         continue;
+      if (task->priority == TASK_PRIORITY_BULK && bulk_full)
+         continue;
+
+      for (i = 0; i < worker_count; i++)
+         if (worker_handlers[i] == task->handler)
+            break;
+      if (i < worker_count)
+         continue;
+
+      if (task->when)
+      {
+         if (!now)
+            now = cpu_features_get_time_usec();
+         /* allow half a millisecond for context switching */
+         if (task->when - now - 500 > 0)
+         {
+            if (!*wake || task->when < *wake)
+               *wake = task->when;
+            continue;
+         }
+      }
+
+      best = task;
+      if (best->priority == TASK_PRIORITY_INTERACTIVE)
+         break;
+   }
+
+   return best;
+}
+
 static void threaded_worker(void *userdata)
 {
-   (void)userdata;
+   unsigned id = (unsigned)(uintptr_t)userdata;
 
    for (;;)
    {
       retro_task_t *task  = NULL;
+      retro_time_t wake   = 0;
+      retro_time_t start  = 0;
       bool       finished = false;
 
-      if (!worker_continue)
-         break; /* should we keep running until all tasks finished? */
-
       slock_lock(running_lock);
 
-      /* Get first task to run */
-      task = tasks_running.front;
-      if (!task)
+      if (!worker_continue)
       {
-         scond_wait(worker_cond, running_lock);
+         /* should we keep running until all tasks finished? */
          slock_unlock(running_lock);
-         continue;
+         break;
       }
 
-      if (task->when)
+      task = threaded_worker_pick(&wake);
+      if (!task)
       {
-         retro_time_t now   = cpu_features_get_time_usec();
-         retro_time_t delay = task->when - now - 500; /* allow half a millisecond for context switching */
-         if (delay > 0)
+         if (wake)
          {
-            scond_wait_timeout(worker_cond, running_lock, delay);
-            slock_unlock(running_lock);
-            continue;
+            retro_time_t delay = wake - cpu_features_get_time_usec() - 500;
+            scond_wait_timeout(worker_cond, running_lock,
+                  delay > 0 ? delay : 1);
          }
+         else
+            scond_wait(worker_cond, running_lock);
+         slock_unlock(running_lock);
+         continue;
       }
 
+      task->running       = true;
+      worker_handlers[id] = task->handler;
+      if (task->priority == TASK_PRIORITY_BULK)
+         worker_bulk++;
+
       slock_unlock(running_lock);
 
+      start = cpu_features_get_time_usec();
       task->handler(task);
+      task_queue_account_run(task, start);
 
       slock_lock(property_lock);
       finished = task->finished;
       slock_unlock(property_lock);
 
+      slock_lock(running_lock);
+      slock_lock(queue_lock);
+
+      task->running       = false;
+      worker_handlers[id] = NULL;
+      if (task->priority == TASK_PRIORITY_BULK)
+         worker_bulk--;
+
       /* Update queue */
       if (!finished)
       {
          /* Move the task to the back of the queue */
          /* mimics retro_task_threaded_push_running, 
           * but also includes a task_queue_remove */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
-
-         /* do nothing if only item in queue */
          if (task->next) 
          {
             task_queue_remove(&tasks_running, task);
             task_queue_put(&tasks_running, task);
-            scond_signal(worker_cond);
          }
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
       }
       else
-      {
-         /* Remove task from running queue */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
          task_queue_remove(&tasks_running, task);
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
 
+      /* Tasks this one held back can run now */
+      if (worker_count > 1)
+         scond_broadcast(worker_cond);
+
+      slock_unlock(queue_lock);
+      slock_unlock(running_lock);
+
+      if (finished)
+      {
          /* Add task to finished queue */
          slock_lock(finished_lock);
          task_queue_put(&tasks_finished, task);
@@ -546,37 +716,73 @@ static void threaded_worker(void *userdata)
    }
 }
 
+static unsigned retro_task_threaded_workers(void)
+{
+   unsigned cores;
+
+   if (task_workers_want)
+      return task_workers_want;
+
+   /* One core is kept for the main thread */
+   cores = cpu_features_get_core_amount();
+   if (cores > 5)
+      return 4;
+   if (cores > 3)
+      return cores - 1;
+   return 2;
+}
+
 static void retro_task_threaded_init(void)
 {
+   unsigned i;
+
    running_lock    = slock_new();
    finished_lock   = slock_new();
    property_lock   = slock_new();
    queue_lock      = slock_new();
    worker_cond     = scond_new();
 
+   task_workers_current = task_workers_want;
+   worker_count         = retro_task_threaded_workers();
+   worker_threads       = (sthread_t**)calloc(worker_count,
+         sizeof(*worker_threads));
+   worker_handlers      = (retro_task_handler_t*)calloc(worker_count,
+         sizeof(*worker_handlers));
+   worker_bulk          = 0;
+
    slock_lock(running_lock);
    worker_continue = true;
    slock_unlock(running_lock);
 
-   worker_thread   = sthread_create(threaded_worker, NULL);
+   for (i = 0; i < worker_count; i++)
+      worker_threads[i] = sthread_create(threaded_worker,
+            (void*)(uintptr_t)i);
 }
 
 static void retro_task_threaded_deinit(void)
 {
+   unsigned i;
+
    slock_lock(running_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
+   scond_broadcast(worker_cond);
    slock_unlock(running_lock);
 
-   sthread_join(worker_thread);
+   for (i = 0; i < worker_count; i++)
+      if (worker_threads[i])
+         sthread_join(worker_threads[i]);
 
    scond_free(worker_cond);
    slock_free(running_lock);
    slock_free(finished_lock);
    slock_free(property_lock);
    slock_free(queue_lock);
+   free(worker_threads);
+   free(worker_handlers);
 
-   worker_thread   = NULL;
+   worker_threads  = NULL;
+   worker_handlers = NULL;
+   worker_count    = 0;
    worker_cond     = NULL;
    running_lock    = NULL;
    finished_lock   = NULL;
@@ -642,6 +848,11 @@ bool task_queue_is_threaded(void)
    return task_threaded_enable;
 }
 
+void task_queue_set_workers(unsigned workers)
+{
+   task_workers_want = workers;
+}
+
 bool task_queue_find(task_finder_data_t *find_data)
 {
    if (!impl_current->find(find_data->func, find_data->userdata))
@@ -660,7 +871,8 @@ void task_queue_check(void)
    bool current_threaded = (impl_current == &impl_threaded);
    bool want_threaded    = task_threaded_enable;
 
-   if (want_threaded != current_threaded)
+   if (want_threaded != current_threaded ||
+         (current_threaded && task_workers_want != task_workers_current))
       task_queue_deinit();
 
    if (!impl_current)
@@ -697,6 +909,11 @@ bool task_queue_push(retro_task_t *task)
          return false;
    }
 
+   task->queued_time = cpu_features_get_time_usec();
+   task->start_time  = 0;
+   task->run_time    = 0;
+   task->iterations  = 0;
+
    /* The lack of NULL checks in the following functions
     * is proposital to ensure correct control flow by the users. */
    impl_current->push_running(task);
@@ -722,6 +939,37 @@ void task_queue_cancel_task(void *task)
    impl_current->cancel(task);
 }
 
+size_t task_queue_get_stats(const task_queue_stats_t **stats)
+{
+   *stats = task_stats;
+   return task_stats_count;
+}
+
+void task_queue_reset_stats(void)
+{
+   memset(task_stats, 0, sizeof(task_stats));
+   task_stats_count = 0;
+}
+
+uint64_t task_queue_stats_percentile(const uint32_t *hist,
+      uint64_t count, uint64_t max, unsigned percent)
+{
+   unsigned i;
+   uint64_t seen   = 0;
+   uint64_t target = (count * percent + 99) / 100;
+
+   for (i = 0; i < TASK_STATS_BUCKETS - 1; i++)
+   {
+      seen += hist[i];
+      if (seen >= target)
+         break;
+   }
+
+   if (i == TASK_STATS_BUCKETS - 1 || ((uint64_t)2 << i) > max)
+      return max;
+   return (uint64_t)2 << i;
+}
+
 void *task_queue_retriever_info_next(task_retriever_info_t **link)
 {
    void *data = NULL;
@@ -907,12 +1155,19 @@ retro_task_t *task_init(void)
    task->progress          = 0;
    task->progress_cb       = NULL;
    task->title             = NULL;
+   task->stats_name        = NULL;
    task->type              = TASK_TYPE_NONE;
+   task->priority          = TASK_PRIORITY_IO;
+   task->running           = false;
    task->ident             = task_count++;
    task->frontend_userdata = NULL;
    task->alternative_look  = false;
    task->next              = NULL;
    task->when              = 0;
+   task->queued_time       = 0;
+   task->start_time        = 0;
+   task->run_time          = 0;
+   task->iterations        = 0;
 
    return task;
 }
@@ -0,0 +1,517 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (parallel.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <rthreads/parallel.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+/* Jobs a deque holds. A thread that fills its deque runs the
+ * rest of its work itself, so this only limits how finely
+ * work spreads, not how much there can be. */
+#define PARALLEL_DEQUE_SIZE  256
+#define PARALLEL_MAX_WORKERS 32
+
+struct parallel_job
+{
+   void (*run)(struct parallel_job *job, unsigned self);
+   parallel_job_fn_t fn;
+   void *data;
+   parallel_group_t *group;
+   size_t begin;
+   size_t end;
+};
+
+/* The owner pushes and pops at 'bottom', thieves take from 'top'.
+ * rthreads has no atomics, so each deque has a lock of its own;
+ * only the owner and the odd thief ever contend for it. */
+struct parallel_deque
+{
+   slock_t *lock;
+   unsigned top;
+   unsigned bottom;
+   struct parallel_job jobs[PARALLEL_DEQUE_SIZE];
+};
+
+struct parallel_for_ctx
+{
+   parallel_for_fn_t fn;
+   void *data;
+   size_t grain;
+};
+
+/* TODO/FIXME - static globals */
+static sthread_t *parallel_threads[PARALLEL_MAX_WORKERS];
+static uintptr_t parallel_thread_ids[PARALLEL_MAX_WORKERS];
+/* One deque per worker, plus a shared one at index
+ * 'parallel_workers' for every other thread */
+static struct parallel_deque *parallel_deques = NULL;
+static unsigned parallel_deque_count          = 0;
+static unsigned parallel_workers              = 0;
+static slock_t *parallel_sched_lock           = NULL;
+static scond_t *parallel_sched_cond           = NULL;
+/* use parallel_sched_lock when touching it */
+static bool parallel_running                  = false;
+/* Jobs in all deques, and threads about to sleep or sleeping */
+static volatile long parallel_queued          = 0;
+static volatile long parallel_sleepers        = 0;
+
+#if defined(_MSC_VER)
+#define PARALLEL_ATOMIC_ADD(p, v) \
+   (InterlockedExchangeAdd((volatile LONG*)(p), (v)) + (v))
+#elif defined(__GNUC__)
+#define PARALLEL_ATOMIC_ADD(p, v) __sync_add_and_fetch((p), (v))
+#else
+static slock_t *parallel_atomic_lock          = NULL;
+
+static long parallel_atomic_add(volatile long *p, long v)
+{
+   long ret;
+   slock_lock(parallel_atomic_lock);
+   ret = (*p += v);
+   slock_unlock(parallel_atomic_lock);
+   return ret;
+}
+#define PARALLEL_ATOMIC_ADD(p, v) parallel_atomic_add((p), (v))
+#endif
+
+#define PARALLEL_ATOMIC_GET(p) PARALLEL_ATOMIC_ADD((p), 0)
+
+/* Returns the index of the calling thread's deque */
+static unsigned parallel_self(void)
+{
+   unsigned i;
+   uintptr_t id = sthread_get_current_thread_id();
+
+   for (i = 0; i < parallel_workers; i++)
+      if (parallel_thread_ids[i] == id)
+         return i;
+   return parallel_workers;
+}
+
+static bool parallel_push(unsigned self, const struct parallel_job *job)
+{
+   struct parallel_deque *deque = &parallel_deques[self];
+
+   slock_lock(deque->lock);
+   if (deque->bottom - deque->top >= PARALLEL_DEQUE_SIZE)
+   {
+      slock_unlock(deque->lock);
+      return false;
+   }
+   deque->jobs[deque->bottom & (PARALLEL_DEQUE_SIZE - 1)] = *job;
+   deque->bottom++;
+   slock_unlock(deque->lock);
+
+   PARALLEL_ATOMIC_ADD(&parallel_queued, 1);
+
+   /* Checked after 'parallel_queued' went up, and sleepers check
+    * that after going up themselves, so one of us sees the other */
+   if (PARALLEL_ATOMIC_GET(&parallel_sleepers))
+   {
+      slock_lock(parallel_sched_lock);
+      scond_signal(parallel_sched_cond);
+      slock_unlock(parallel_sched_lock);
+   }
+
+   return true;
+}
+
+static bool parallel_pop(unsigned self, struct parallel_job *job)
+{
+   struct parallel_deque *deque = &parallel_deques[self];
+   bool found                   = false;
+
+   slock_lock(deque->lock);
+   if (deque->bottom != deque->top)
+   {
+      deque->bottom--;
+      *job  = deque->jobs[deque->bottom & (PARALLEL_DEQUE_SIZE - 1)];
+      found = true;
+   }
+   slock_unlock(deque->lock);
+
+   if (found)
+      PARALLEL_ATOMIC_ADD(&parallel_queued, -1);
+   return found;
+}
+
+static bool parallel_steal(unsigned self, struct parallel_job *job)
+{
+   unsigned i;
+   unsigned deques = parallel_workers + 1;
+
+   for (i = 1; i < deques; i++)
+   {
+      struct parallel_deque *deque = &parallel_deques[(self + i) % deques];
+      bool found                   = false;
+
+      /* Don't wait on a busy deque, try the next one */
+      if (deque->bottom == deque->top || !slock_try_lock(deque->lock))
+         continue;
+      if (deque->bottom != deque->top)
+      {
+         *job  = deque->jobs[deque->top & (PARALLEL_DEQUE_SIZE - 1)];
+         deque->top++;
+         found = true;
+      }
+      slock_unlock(deque->lock);
+
+      if (found)
+      {
+         PARALLEL_ATOMIC_ADD(&parallel_queued, -1);
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static void parallel_group_done(parallel_group_t *group)
+{
+   if (PARALLEL_ATOMIC_ADD(&group->pending, -1))
+      return;
+
+   slock_lock(parallel_sched_lock);
+   scond_broadcast(parallel_sched_cond);
+   slock_unlock(parallel_sched_lock);
+}
+
+static bool parallel_run_one(unsigned self)
+{
+   struct parallel_job job;
+
+   if (!parallel_pop(self, &job) && !parallel_steal(self, &job))
+      return false;
+
+   job.run(&job, self);
+   parallel_group_done(job.group);
+   return true;
+}
+
+static void parallel_worker(void *data)
+{
+   unsigned self = (unsigned)(uintptr_t)data;
+
+   for (;;)
+   {
+      if (parallel_run_one(self))
+         continue;
+
+      slock_lock(parallel_sched_lock);
+      if (!parallel_running)
+      {
+         slock_unlock(parallel_sched_lock);
+         break;
+      }
+      PARALLEL_ATOMIC_ADD(&parallel_sleepers, 1);
+      if (!PARALLEL_ATOMIC_GET(&parallel_queued))
+         scond_wait(parallel_sched_cond, parallel_sched_lock);
+      PARALLEL_ATOMIC_ADD(&parallel_sleepers, -1);
+      slock_unlock(parallel_sched_lock);
+   }
+}
+
+/* Keeps pushing the upper half of the range for others to steal
+ * and runs what's left once it's down to the grain size */
+static void parallel_for_split(struct parallel_job *job, unsigned self)
+{
+   const struct parallel_for_ctx *ctx = (const struct parallel_for_ctx*)
+      job->data;
+   size_t begin                       = job->begin;
+   size_t end                         = job->end;
+
+   while (end - begin > ctx->grain)
+   {
+      struct parallel_job half = *job;
+
+      half.begin = begin + (end - begin) / 2;
+      half.end   = end;
+
+      PARALLEL_ATOMIC_ADD(&job->group->pending, 1);
+      if (!parallel_push(self, &half))
+      {
+         PARALLEL_ATOMIC_ADD(&job->group->pending, -1);
+         break;
+      }
+      end        = half.begin;
+   }
+
+   ctx->fn(ctx->data, begin, end);
+}
+
+static void parallel_group_job_run(struct parallel_job *job, unsigned self)
+{
+   job->fn(job->data);
+}
+
+bool parallel_init(unsigned workers)
+{
+   unsigned i;
+
+   if (parallel_workers)
+      return true;
+
+   if (!workers)
+   {
+      workers = cpu_features_get_core_amount();
+      workers = workers > 1 ? workers - 1 : 0;
+   }
+   if (workers > PARALLEL_MAX_WORKERS)
+      workers = PARALLEL_MAX_WORKERS;
+   if (!workers)
+      return false;
+
+#if !defined(_MSC_VER) && !defined(__GNUC__)
+   if (!(parallel_atomic_lock = slock_new()))
+      return false;
+#endif
+
+   parallel_sched_lock = slock_new();
+   parallel_sched_cond = scond_new();
+   parallel_deques     = (struct parallel_deque*)calloc(workers + 1,
+         sizeof(*parallel_deques));
+   if (!parallel_sched_lock || !parallel_sched_cond || !parallel_deques)
+      goto error;
+
+   for (i = 0; i <= workers; i++)
+      if (!(parallel_deques[i].lock = slock_new()))
+         goto error;
+   parallel_deque_count = workers + 1;
+
+   parallel_queued   = 0;
+   parallel_sleepers = 0;
+   parallel_running  = true;
+   parallel_workers  = workers;
+
+   /* Workers don't look themselves up before there is work, and
+    * there's none before this returns */
+   for (i = 0; i < workers; i++)
+   {
+      parallel_threads[i] = sthread_create(parallel_worker,
+            (void*)(uintptr_t)i);
+      if (!parallel_threads[i])
+      {
+         parallel_workers = i;
+         parallel_deinit();
+         return false;
+      }
+      parallel_thread_ids[i] = sthread_get_thread_id(parallel_threads[i]);
+   }
+
+   return true;
+
+error:
+   parallel_running = false;
+   if (parallel_deques)
+   {
+      for (i = 0; i <= workers; i++)
+         if (parallel_deques[i].lock)
+            slock_free(parallel_deques[i].lock);
+      free(parallel_deques);
+   }
+   if (parallel_sched_cond)
+      scond_free(parallel_sched_cond);
+   if (parallel_sched_lock)
+      slock_free(parallel_sched_lock);
+#if !defined(_MSC_VER) && !defined(__GNUC__)
+   slock_free(parallel_atomic_lock);
+   parallel_atomic_lock = NULL;
+#endif
+   parallel_deques     = NULL;
+   parallel_sched_cond = NULL;
+   parallel_sched_lock = NULL;
+   return false;
+}
+
+void parallel_deinit(void)
+{
+   unsigned i;
+
+   if (!parallel_workers)
+      return;
+
+   slock_lock(parallel_sched_lock);
+   parallel_running = false;
+   scond_broadcast(parallel_sched_cond);
+   slock_unlock(parallel_sched_lock);
+
+   for (i = 0; i < parallel_workers; i++)
+   {
+      sthread_join(parallel_threads[i]);
+      parallel_threads[i]    = NULL;
+      parallel_thread_ids[i] = 0;
+   }
+
+   for (i = 0; i < parallel_deque_count; i++)
+      slock_free(parallel_deques[i].lock);
+   free(parallel_deques);
+   scond_free(parallel_sched_cond);
+   slock_free(parallel_sched_lock);
+
+#if !defined(_MSC_VER) && !defined(__GNUC__)
+   slock_free(parallel_atomic_lock);
+   parallel_atomic_lock = NULL;
+#endif
+
+   parallel_deques      = NULL;
+   parallel_deque_count = 0;
+   parallel_sched_cond  = NULL;
+   parallel_sched_lock  = NULL;
+   parallel_workers     = 0;
+}
+
+unsigned parallel_get_threads(void)
+{
+   return parallel_workers + 1;
+}
+
+void parallel_for(size_t begin, size_t end, size_t grain,
+      parallel_for_fn_t fn, void *data)
+{
+   struct parallel_for_ctx ctx;
+   struct parallel_job job;
+   parallel_group_t group;
+
+   if (end <= begin)
+      return;
+
+   if (!parallel_workers)
+   {
+      fn(data, begin, end);
+      return;
+   }
+
+   if (!grain)
+      grain = (end - begin + parallel_workers) / (parallel_workers + 1);
+   if (!grain)
+      grain = 1;
+
+   ctx.fn        = fn;
+   ctx.data      = data;
+   ctx.grain     = grain;
+
+   group.pending = 1;
+   job.run       = parallel_for_split;
+   job.fn        = NULL;
+   job.data      = &ctx;
+   job.group     = &group;
+   job.begin     = begin;
+   job.end       = end;
+
+   parallel_for_split(&job, parallel_self());
+   parallel_group_done(&group);
+   parallel_group_wait(&group);
+}
+
+void parallel_group_init(parallel_group_t *group)
+{
+   group->pending = 0;
+}
+
+void parallel_group_run(parallel_group_t *group,
+      parallel_job_fn_t fn, void *data)
+{
+   struct parallel_job job;
+
+   if (parallel_workers)
+   {
+      job.run   = parallel_group_job_run;
+      job.fn    = fn;
+      job.data  = data;
+      job.group = group;
+      job.begin = 0;
+      job.end   = 0;
+
+      PARALLEL_ATOMIC_ADD(&group->pending, 1);
+      if (parallel_push(parallel_self(), &job))
+         return;
+      PARALLEL_ATOMIC_ADD(&group->pending, -1);
+   }
+
+   fn(data);
+}
+
+void parallel_group_wait(parallel_group_t *group)
+{
+   unsigned self;
+
+   if (!parallel_workers)
+      return;
+
+   self = parallel_self();
+
+   while (PARALLEL_ATOMIC_GET(&group->pending))
+   {
+      if (parallel_run_one(self))
+         continue;
+
+      slock_lock(parallel_sched_lock);
+      PARALLEL_ATOMIC_ADD(&parallel_sleepers, 1);
+      if (PARALLEL_ATOMIC_GET(&group->pending) &&
+            !PARALLEL_ATOMIC_GET(&parallel_queued))
+         scond_wait(parallel_sched_cond, parallel_sched_lock);
+      PARALLEL_ATOMIC_ADD(&parallel_sleepers, -1);
+      slock_unlock(parallel_sched_lock);
+   }
+}
+#else
+bool parallel_init(unsigned workers)
+{
+   return false;
+}
+
+void parallel_deinit(void) { }
+
+unsigned parallel_get_threads(void)
+{
+   return 1;
+}
+
+void parallel_for(size_t begin, size_t end, size_t grain,
+      parallel_for_fn_t fn, void *data)
+{
+   if (end > begin)
+      fn(data, begin, end);
+}
+
+void parallel_group_init(parallel_group_t *group)
+{
+   group->pending = 0;
+}
+
+void parallel_group_run(parallel_group_t *group,
+      parallel_job_fn_t fn, void *data)
+{
+   fn(data);
+}
+
+void parallel_group_wait(parallel_group_t *group) { }
+#endif
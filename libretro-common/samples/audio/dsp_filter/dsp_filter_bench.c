@@ -0,0 +1,161 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (dsp_filter_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Runs every .dsp preset in a directory (the stock presets by
+ * default) through the built-in filter graph, a video frame's worth
+ * of audio at a time like the audio driver does, and prints the
+ * cost per frame, the share of one core that is at 48 kHz, and the
+ * level of the output so that a broken filter stands out. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <audio/dsp_filter.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <lists/string_list.h>
+
+#define SAMPLE_RATE  48000.0f
+#define FRAMES       (1 << 18)
+/* What one 60 Hz video frame hands the audio driver */
+#define CHUNK        800
+#define RUNS         3
+
+static const char *default_dir = "../../../audio/dsp_filters";
+
+/* Returns false if the preset could not be set up. */
+static bool run(const char *path, const float *in, float *work,
+      double *ns_frame, unsigned *frames_out, double *rms)
+{
+   unsigned r;
+
+   *ns_frame = 0.0;
+
+   for (r = 0; r < RUNS; r++)
+   {
+      size_t i;
+      double ns;
+      double sum       = 0.0;
+      unsigned out     = 0;
+      retro_time_t elapsed = 0;
+      retro_dsp_filter_t *dsp = retro_dsp_filter_new(path, NULL,
+            SAMPLE_RATE);
+
+      if (!dsp)
+         return false;
+
+      for (i = 0; i < FRAMES; i += CHUNK)
+      {
+         size_t j;
+         retro_time_t start;
+         struct retro_dsp_data data;
+         unsigned frames = FRAMES - i < CHUNK ? FRAMES - i : CHUNK;
+
+         /* Filters may work in place, so each chunk gets a fresh copy
+          * like the driver's conversion buffer. */
+         memcpy(work, in + i * 2, frames * 2 * sizeof(float));
+
+         data.input        = work;
+         data.input_frames = frames;
+
+         start    = cpu_features_get_time_usec();
+         retro_dsp_filter_process(dsp, &data);
+         elapsed += cpu_features_get_time_usec() - start;
+
+         for (j = 0; j < data.output_frames * 2; j++)
+            sum += data.output[j] * data.output[j];
+         out += data.output_frames;
+      }
+
+      ns = elapsed * 1000.0 / FRAMES;
+      if (!r || ns < *ns_frame)
+         *ns_frame = ns;
+      *frames_out = out;
+      *rms        = out ? sqrt(sum / (out * 2.0)) : 0.0;
+
+      retro_dsp_filter_free(dsp);
+   }
+
+   return true;
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i;
+   uint32_t seed              = 1;
+   const char *dir            = argc > 1 ? argv[1] : default_dir;
+   struct string_list *list   = dir_list_new(dir, "dsp",
+         false, false, false, false);
+   float *in                  = (float*)malloc(FRAMES * 2 * sizeof(float));
+   float *work                = (float*)malloc(CHUNK * 2 * sizeof(float));
+   double in_sum              = 0.0;
+
+   if (!list || !list->size)
+   {
+      printf("No presets in %s\n", dir);
+      return 1;
+   }
+   dir_list_sort(list, false);
+
+   /* Noise under a sweep, so that every band has something in it */
+   for (i = 0; i < FRAMES; i++)
+   {
+      double t = (double)i / FRAMES;
+      float sweep;
+
+      seed           = seed * 1664525u + 1013904223u;
+      sweep          = (float)(0.3 * sin(i * t * 3.14159));
+      in[i * 2]      = sweep + ((seed >> 9) / 8388608.0f - 1.0f) * 0.1f;
+      seed           = seed * 1664525u + 1013904223u;
+      in[i * 2 + 1]  = sweep + ((seed >> 9) / 8388608.0f - 1.0f) * 0.1f;
+      in_sum        += in[i * 2] * in[i * 2] + in[i * 2 + 1] * in[i * 2 + 1];
+   }
+
+   printf("%u frames at %.0f Hz, %u frames per call, input RMS %.4f\n\n",
+         FRAMES, SAMPLE_RATE, CHUNK, sqrt(in_sum / (FRAMES * 2.0)));
+   printf("%-22s %10s %10s %10s %10s\n",
+         "preset", "ns/frame", "% of core", "frames", "RMS");
+
+   for (i = 0; i < list->size; i++)
+   {
+      double ns, rms;
+      unsigned frames;
+      const char *path = list->elems[i].data;
+
+      if (!run(path, in, work, &ns, &frames, &rms))
+      {
+         printf("%-22s %10s\n", path_basename(path), "failed");
+         continue;
+      }
+
+      printf("%-22s %10.1f %10.3f %10u %10.4f\n", path_basename(path),
+            ns, ns * SAMPLE_RATE / 1e7, frames, rms);
+   }
+
+   dir_list_free(list);
+   free(in);
+   free(work);
+   return 0;
+}
@@ -0,0 +1,350 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (audio_mixer_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Plays 16 voices at once, MOD and FLAC streams and WAV sounds, all
+ * made up here so that no files are needed, and mixes them a video
+ * frame's worth at a time at real time pace, the way the audio driver
+ * does. Prints what each mix call cost the calling thread, and checks
+ * that the output is sane and that a one shot voice finishes.
+ *
+ * OGG and MP3 go through the same path as FLAC, but can't be made up
+ * without an encoder, so they are left out. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <audio/audio_mixer.h>
+#include <features/features_cpu.h>
+#include <retro_timers.h>
+
+#define MIXER_RATE   48000
+#define SOUND_RATE   44100
+#define VOICES       16
+/* What one 60 Hz video frame hands the audio driver */
+#define CHUNK        800
+#define CALLS        (3 * 60)
+#define FLAC_BLOCK   4096
+
+static unsigned finished = 0;
+static unsigned repeated = 0;
+
+static void stop_cb(audio_mixer_sound_t *sound, unsigned reason)
+{
+   if (reason == AUDIO_MIXER_SOUND_FINISHED)
+      finished++;
+   else if (reason == AUDIO_MIXER_SOUND_REPEATED)
+      repeated++;
+}
+
+static int16_t tone(size_t i, double freq)
+{
+   return (int16_t)(8000.0 * sin(2.0 * M_PI * freq * i / SOUND_RATE));
+}
+
+static void put_be16(uint8_t *p, unsigned v)
+{
+   p[0] = (uint8_t)(v >> 8);
+   p[1] = (uint8_t)v;
+}
+
+static void put_le16(uint8_t *p, unsigned v)
+{
+   p[0] = (uint8_t)v;
+   p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+   put_le16(p, v & 0xffff);
+   put_le16(p + 2, v >> 16);
+}
+
+/* A four channel ProTracker module, with a looped saw wave playing a
+ * chord that is struck again every eight rows */
+static void *make_mod(size_t *size)
+{
+   static const unsigned periods[] = { 428, 339, 285, 214 };
+   const unsigned sample_len = 32;
+   uint8_t *mod, *pattern;
+   unsigned row, ch, i;
+
+   *size   = 1084 + 64 * 4 * 4 + sample_len;
+   mod     = (uint8_t*)calloc(1, *size);
+   pattern = mod + 1084;
+
+   memcpy(mod, "mixer test", 10);
+   /* Sample 1 */
+   memcpy(mod + 20, "saw", 3);
+   put_be16(mod + 42, sample_len / 2);
+   mod[45] = 64;
+   put_be16(mod + 46, 0);
+   put_be16(mod + 48, sample_len / 2);
+   /* The other 30 are empty, with the usual one word loop */
+   for (i = 1; i < 31; i++)
+      put_be16(mod + 20 + i * 30 + 28, 1);
+   /* One pattern, played once */
+   mod[950] = 1;
+   mod[951] = 127;
+   memcpy(mod + 1080, "M.K.", 4);
+
+   for (row = 0; row < 64; row += 8)
+   {
+      for (ch = 0; ch < 4; ch++)
+      {
+         uint8_t *note = pattern + (row * 4 + ch) * 4;
+         note[0]       = (uint8_t)(periods[ch] >> 8);
+         note[1]       = (uint8_t)periods[ch];
+         note[2]       = 1 << 4;
+      }
+   }
+
+   for (i = 0; i < sample_len; i++)
+      pattern[64 * 4 * 4 + i] = (uint8_t)(int8_t)(i * 8 - 128);
+
+   return mod;
+}
+
+static uint8_t crc8(const uint8_t *p, size_t n)
+{
+   uint8_t crc = 0;
+
+   while (n--)
+   {
+      unsigned b;
+      crc ^= *p++;
+      for (b = 0; b < 8; b++)
+         crc = (uint8_t)(crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1);
+   }
+   return crc;
+}
+
+static uint16_t crc16(const uint8_t *p, size_t n)
+{
+   uint16_t crc = 0;
+
+   while (n--)
+   {
+      unsigned b;
+      crc ^= (uint16_t)(*p++ << 8);
+      for (b = 0; b < 8; b++)
+         crc = (uint16_t)(crc & 0x8000 ? (crc << 1) ^ 0x8005 : crc << 1);
+   }
+   return crc;
+}
+
+/* A 16 bit stereo FLAC stream of a tone, in verbatim subframes. At
+ * most 127 blocks, so that frame numbers fit in one byte. */
+static void *make_flac(size_t frames, double freq, size_t *size)
+{
+   size_t i, frame = 0;
+   uint8_t *flac  = (uint8_t*)calloc(1, 50
+         + (frames / FLAC_BLOCK + 1) * (16 + FLAC_BLOCK * 4));
+   uint8_t *p     = flac;
+
+   memcpy(p, "fLaC", 4);
+   /* STREAMINFO, 34 bytes */
+   p[7]  = 34;
+   p    += 8;
+   put_be16(p, FLAC_BLOCK);
+   put_be16(p + 2, FLAC_BLOCK);
+   /* Rate (20 bits), channels - 1 (3), bits - 1 (5), frames (36) */
+   p[10] = (uint8_t)(SOUND_RATE >> 12);
+   p[11] = (uint8_t)(SOUND_RATE >> 4);
+   p[12] = (uint8_t)(((SOUND_RATE & 0xf) << 4) | (1 << 1));
+   p[13] = (uint8_t)((15 << 4) | ((frames >> 32) & 0xf));
+   p[14] = (uint8_t)(frames >> 24);
+   p[15] = (uint8_t)(frames >> 16);
+   p[16] = (uint8_t)(frames >> 8);
+   p[17] = (uint8_t)frames;
+   p    += 34;
+   /* dr_flac can only seek back to the start if something follows
+    * STREAMINFO, as there always is in real files. The last metadata
+    * block, 4 bytes of padding. */
+   p[0]  = 0x81;
+   p[3]  = 4;
+   p    += 8;
+
+   for (i = 0; i < frames; i += FLAC_BLOCK, frame++)
+   {
+      unsigned ch;
+      size_t j;
+      size_t block   = frames - i < FLAC_BLOCK ? frames - i : FLAC_BLOCK;
+      uint8_t *start = p;
+
+      put_be16(p, 0xfff8);
+      /* Block size from the end of the header, rate from STREAMINFO */
+      p[2] = 0x70;
+      /* Two independent channels, 16 bits */
+      p[3] = 0x18;
+      p[4] = (uint8_t)frame;
+      put_be16(p + 5, (unsigned)(block - 1));
+      p[7] = crc8(p, 7);
+      p   += 8;
+
+      for (ch = 0; ch < 2; ch++)
+      {
+         /* Verbatim */
+         *p++ = 0x02;
+         for (j = 0; j < block; j++, p += 2)
+            put_be16(p, (uint16_t)tone(i + j, ch ? freq * 1.5 : freq));
+      }
+
+      put_be16(p, crc16(start, p - start));
+      p += 2;
+   }
+
+   *size = p - flac;
+   return flac;
+}
+
+static void *make_wav(size_t frames, size_t *size)
+{
+   size_t i;
+   uint8_t *wav = (uint8_t*)malloc(44 + frames * 4);
+
+   memcpy(wav, "RIFF", 4);
+   put_le32(wav + 4, (uint32_t)(36 + frames * 4));
+   memcpy(wav + 8, "WAVEfmt ", 8);
+   put_le32(wav + 16, 16);
+   put_le16(wav + 20, 1);
+   put_le16(wav + 22, 2);
+   put_le32(wav + 24, SOUND_RATE);
+   put_le32(wav + 28, SOUND_RATE * 4);
+   put_le16(wav + 32, 4);
+   put_le16(wav + 34, 16);
+   memcpy(wav + 36, "data", 4);
+   put_le32(wav + 40, (uint32_t)(frames * 4));
+
+   for (i = 0; i < frames; i++)
+   {
+      put_le16(wav + 44 + i * 4,     (uint16_t)tone(i, 660.0));
+      put_le16(wav + 44 + i * 4 + 2, (uint16_t)tone(i, 990.0));
+   }
+
+   *size = 44 + frames * 4;
+   return wav;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   size_t size;
+   void *data;
+   audio_mixer_sound_t *mod, *bgm, *sfx, *wav;
+   float *out          = (float*)malloc(CHUNK * 2 * sizeof(float));
+   unsigned voices     = 0;
+   unsigned bad        = 0;
+   double sum          = 0.0;
+   retro_time_t total  = 0;
+   retro_time_t worst  = 0;
+   retro_time_t next;
+
+   audio_mixer_init(MIXER_RATE);
+
+   /* The streamed types keep the data, WAV makes a copy */
+   data     = make_mod(&size);
+   mod      = audio_mixer_load_mod(data, (int32_t)size);
+   data     = make_flac(SOUND_RATE * 2, 220.0, &size);
+   bgm      = audio_mixer_load_flac(data, (int32_t)size);
+   data     = make_flac(SOUND_RATE / 2, 880.0, &size);
+   sfx      = audio_mixer_load_flac(data, (int32_t)size);
+   data     = make_wav(SOUND_RATE / 3, &size);
+   wav      = audio_mixer_load_wav(data, (int32_t)size);
+   free(data);
+
+   if (!mod || !bgm || !sfx || !wav)
+   {
+      printf("[FAIL] could not load the sounds\n");
+      return 1;
+   }
+
+   /* One one shot, the rest looping */
+   if (audio_mixer_play(sfx, false, 0.05f, stop_cb))
+      voices++;
+   for (i = 1; i < VOICES; i++)
+   {
+      audio_mixer_sound_t *sound = i % 3 == 0 ? mod : i % 3 == 1 ? bgm : wav;
+      if (audio_mixer_play(sound, true, 0.05f, stop_cb))
+         voices++;
+   }
+
+#ifdef HAVE_THREADS
+   printf("%u voices, decoding on a thread\n", voices);
+#else
+   printf("%u voices, decoding inline\n", voices);
+#endif
+
+   next = cpu_features_get_time_usec();
+
+   for (i = 0; i < CALLS; i++)
+   {
+      unsigned j;
+      retro_time_t start, elapsed;
+
+      memset(out, 0, CHUNK * 2 * sizeof(float));
+
+      start   = cpu_features_get_time_usec();
+      audio_mixer_mix(out, CHUNK, 0.0f, false);
+      elapsed = cpu_features_get_time_usec() - start;
+
+      total  += elapsed;
+      if (elapsed > worst)
+         worst = elapsed;
+
+      for (j = 0; j < CHUNK * 2; j++)
+      {
+         if (!(out[j] >= -1.0f && out[j] <= 1.0f))
+            bad++;
+         else
+            sum += out[j] * out[j];
+      }
+
+      /* The driver only asks for more audio this often */
+      next += 1000000 * CHUNK / MIXER_RATE;
+      while (cpu_features_get_time_usec() < next)
+         retro_sleep(1);
+   }
+
+   printf("%u calls of %u frames: %.1f us average, %.1f us worst\n",
+         CALLS, CHUNK, (double)total / CALLS, (double)worst);
+   printf("output RMS %.4f, %u repeats, %u finished\n",
+         sqrt(sum / (CALLS * CHUNK * 2.0)), repeated, finished);
+
+   audio_mixer_done();
+   audio_mixer_destroy(mod);
+   audio_mixer_destroy(bgm);
+   audio_mixer_destroy(sfx);
+   audio_mixer_destroy(wav);
+   free(out);
+
+   if (voices != VOICES || bad || sum == 0.0 || finished != 1)
+   {
+      printf("\n[FAIL] %u voices, %u bad samples, %u finished\n",
+            voices, bad, finished);
+      return 1;
+   }
+
+   printf("\n[OK]\n");
+   return 0;
+}
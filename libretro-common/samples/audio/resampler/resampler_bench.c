@@ -0,0 +1,310 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (resampler_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Runs the sinc resampler at every quality level with each SIMD
+ * level the CPU has, and prints the cost per input frame and how
+ * far the output is from the plain C kernel.
+ *
+ * Then compares sinc with the polyphase resampler, at the ratio
+ * both were set up for and at a ratio nudged the way dynamic rate
+ * control does it, with the SNR of a resampled tone. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <audio/audio_resampler.h>
+#include <features/features_cpu.h>
+
+#define IN_FRAMES   (1 << 18)
+#define CHUNK       512
+#define RUNS        3
+/* About as far as dynamic rate control goes */
+#define DRC_NUDGE   1.003
+/* Output frames skipped before measuring the SNR */
+#define SETTLE      4096
+#define SNR_BLOCK   2048
+/* Room for stereo output at up to twice the input rate */
+#define OUT_FLOATS  (IN_FRAMES * 4 + 1024)
+
+struct simd_level
+{
+   const char *ident;
+   resampler_simd_mask_t mask;
+};
+
+static const struct simd_level simd_levels[] = {
+   { "AVX-512",  RESAMPLER_SIMD_AVX512F | RESAMPLER_SIMD_FMA3
+      | RESAMPLER_SIMD_AVX2 | RESAMPLER_SIMD_AVX | RESAMPLER_SIMD_SSE },
+   { "AVX2+FMA", RESAMPLER_SIMD_FMA3 | RESAMPLER_SIMD_AVX2
+      | RESAMPLER_SIMD_AVX | RESAMPLER_SIMD_SSE },
+   { "AVX",      RESAMPLER_SIMD_AVX | RESAMPLER_SIMD_SSE },
+   { "SSE",      RESAMPLER_SIMD_SSE },
+   { "NEON",     RESAMPLER_SIMD_NEON },
+   { "C",        0 },
+};
+
+static const char *quality_names[] = {
+   "DONTCARE", "LOWEST", "LOWER", "NORMAL", "HIGHER", "HIGHEST"
+};
+
+/* Same translation as resampler_append_plugs() */
+static resampler_simd_mask_t cpu_mask(void)
+{
+   uint64_t cpu                = cpu_features_get();
+   resampler_simd_mask_t mask  = (resampler_simd_mask_t)
+      (cpu & CPU_FEATURES_LIBRETRO_MASK);
+
+   if (cpu & CPU_FEATURE_FMA3)
+      mask |= RESAMPLER_SIMD_FMA3;
+   if (cpu & CPU_FEATURE_AVX512F)
+      mask |= RESAMPLER_SIMD_AVX512F;
+   return mask;
+}
+
+/* Keeps the fastest of RUNS passes.
+ * Returns the number of output frames. */
+static size_t run(const retro_resampler_t *drv,
+      enum resampler_quality quality, resampler_simd_mask_t mask,
+      double nominal, double ratio,
+      const float *in, float *out, double *ns_frame)
+{
+   unsigned r;
+   size_t out_frames  = 0;
+
+   *ns_frame          = 0.0;
+
+   for (r = 0; r < RUNS; r++)
+   {
+      size_t i;
+      double ns;
+      retro_time_t start;
+      void *re           = drv->init(NULL, nominal, quality, mask);
+
+      if (!re)
+         return 0;
+
+      out_frames = 0;
+      start      = cpu_features_get_time_usec();
+      for (i = 0; i < IN_FRAMES; i += CHUNK)
+      {
+         struct resampler_data data;
+
+         data.data_in       = in + i * 2;
+         data.data_out      = out + out_frames * 2;
+         data.input_frames  = CHUNK;
+         data.output_frames = 0;
+         data.ratio         = ratio;
+
+         drv->process(re, &data);
+         out_frames        += data.output_frames;
+      }
+      ns = (cpu_features_get_time_usec() - start) * 1000.0 / IN_FRAMES;
+      if (!r || ns < *ns_frame)
+         *ns_frame = ns;
+
+      drv->free(re);
+   }
+
+   return out_frames;
+}
+
+static void bench_ratio(const char *name, double ratio,
+      resampler_simd_mask_t cpu, const float *in)
+{
+   unsigned q, l;
+   float *ref = (float*)malloc(OUT_FLOATS * sizeof(float));
+   float *out = (float*)malloc(OUT_FLOATS * sizeof(float));
+
+   printf("\n%s (ratio %.4f), ns per input frame\n", name, ratio);
+   printf("%-9s", "");
+   for (l = 0; l < sizeof(simd_levels) / sizeof(simd_levels[0]); l++)
+      if ((cpu & simd_levels[l].mask) == simd_levels[l].mask)
+         printf(" %10s", simd_levels[l].ident);
+   printf("   max diff vs C\n");
+
+   for (q = RESAMPLER_QUALITY_LOWEST; q <= RESAMPLER_QUALITY_HIGHEST; q++)
+   {
+      double ns;
+      float worst     = 0.0f;
+      size_t ref_size = run(&sinc_resampler,
+            (enum resampler_quality)q, 0, ratio, ratio, in, ref, &ns);
+
+      printf("%-9s", quality_names[q]);
+      for (l = 0; l < sizeof(simd_levels) / sizeof(simd_levels[0]); l++)
+      {
+         size_t i, size;
+
+         if ((cpu & simd_levels[l].mask) != simd_levels[l].mask)
+            continue;
+
+         size = run(&sinc_resampler, (enum resampler_quality)q,
+               simd_levels[l].mask, ratio, ratio, in, out, &ns);
+         printf(" %10.1f", ns);
+
+         /* Downsampling stretches the filter, and the wider
+          * kernels pad it to more taps than the C one, which
+          * changes its delay. */
+         if (ratio < 1.0 || size != ref_size)
+            continue;
+         for (i = 0; i < size * 2; i++)
+         {
+            float diff = (float)fabs(out[i] - ref[i]);
+            if (diff > worst)
+               worst = diff;
+         }
+      }
+      if (ratio < 1.0)
+         printf("   -\n");
+      else
+         printf("   %g\n", worst);
+   }
+
+   free(ref);
+   free(out);
+}
+
+/* Fits a tone of @freq cycles per frame to the left channel, a
+ * block at a time so that the rounding of the ratio into the
+ * resamplers' fixed point steps doesn't count as noise, and
+ * returns the power of the fit over what is left, in dB. */
+static double snr_db(const float *out, size_t frames, double freq)
+{
+   size_t block;
+   double signal = 0.0, noise = 0.0;
+
+   for (block = SETTLE; block + SNR_BLOCK <= frames; block += SNR_BLOCK)
+   {
+      size_t i;
+      double ss = 0.0, cc = 0.0, sc = 0.0, ys = 0.0, yc = 0.0;
+      double a, b, det;
+
+      for (i = block; i < block + SNR_BLOCK; i++)
+      {
+         double s = sin(2.0 * M_PI * freq * i);
+         double c = cos(2.0 * M_PI * freq * i);
+         ss      += s * s;
+         cc      += c * c;
+         sc      += s * c;
+         ys      += out[i * 2] * s;
+         yc      += out[i * 2] * c;
+      }
+
+      det = ss * cc - sc * sc;
+      a   = (ys * cc - yc * sc) / det;
+      b   = (yc * ss - ys * sc) / det;
+
+      for (i = block; i < block + SNR_BLOCK; i++)
+      {
+         double fit = a * sin(2.0 * M_PI * freq * i)
+            + b * cos(2.0 * M_PI * freq * i);
+         double err = out[i * 2] - fit;
+         signal    += fit * fit;
+         noise     += err * err;
+      }
+   }
+
+   return 10.0 * log10(signal / noise);
+}
+
+static void compare_rates(double in_rate, double out_rate,
+      resampler_simd_mask_t cpu, const char *note)
+{
+   static const double tones[] = { 1000.0, 10000.0 };
+   unsigned q, t;
+   double nominal = out_rate / in_rate;
+   double nudged  = nominal * DRC_NUDGE;
+   float *in      = (float*)malloc(IN_FRAMES * 2 * sizeof(float));
+   float *out     = (float*)malloc(OUT_FLOATS * sizeof(float));
+
+   printf("\n%.1f -> %.1f, sinc vs polyphase%s\n",
+         in_rate, out_rate, note);
+   printf("%-9s %19s %19s %19s %19s\n", "",
+         "ns/frame, nominal", "ns/frame, DRC",
+         "SNR 1 kHz, DRC", "SNR 10 kHz, DRC");
+
+   for (q = RESAMPLER_QUALITY_LOWEST; q <= RESAMPLER_QUALITY_HIGHEST; q++)
+   {
+      double ns[2][2], snr[2][2];
+      unsigned d;
+
+      for (d = 0; d < 2; d++)
+      {
+         const retro_resampler_t *drv = d ? &polyphase_resampler
+            : &sinc_resampler;
+
+         for (t = 0; t < 2; t++)
+         {
+            size_t i, frames;
+            double freq = tones[t] / in_rate;
+
+            for (i = 0; i < IN_FRAMES; i++)
+               in[i * 2] = in[i * 2 + 1] =
+                  (float)(0.5 * sin(2.0 * M_PI * freq * i));
+
+            if (!t)
+               run(drv, (enum resampler_quality)q, cpu,
+                     nominal, nominal, in, out, &ns[d][0]);
+            frames = run(drv, (enum resampler_quality)q, cpu,
+                  nominal, nudged, in, out, &ns[d][1]);
+            snr[d][t] = snr_db(out, frames, freq / nudged);
+         }
+      }
+
+      printf("%-9s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+            quality_names[q],
+            ns[0][0], ns[1][0], ns[0][1], ns[1][1],
+            snr[0][0], snr[1][0], snr[0][1], snr[1][1]);
+   }
+
+   free(in);
+   free(out);
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i;
+   resampler_simd_mask_t cpu = cpu_mask();
+   float *in                 = (float*)malloc(IN_FRAMES * 2 * sizeof(float));
+
+   /* A sweep, so that the whole passband is exercised */
+   for (i = 0; i < IN_FRAMES; i++)
+   {
+      double t  = (double)i / IN_FRAMES;
+      in[i * 2] = in[i * 2 + 1] = (float)(0.5 * sin(i * t * 3.14159));
+   }
+
+   bench_ratio("44100 -> 48000", 48000.0 / 44100.0, cpu, in);
+   bench_ratio("48000 -> 44100", 44100.0 / 48000.0, cpu, in);
+   bench_ratio("32040 -> 48000", 48000.0 / 32040.0, cpu, in);
+
+   printf("\nEach pair is sinc, then polyphase\n");
+   compare_rates(44100.0, 48000.0, cpu, "");
+   compare_rates(48000.0, 44100.0, cpu, "");
+   compare_rates(32040.5, 48000.0, cpu, "");
+   /* What a CPU without AVX gets */
+   compare_rates(44100.0, 48000.0, cpu & RESAMPLER_SIMD_SSE, ", SSE only");
+
+   free(in);
+   return 0;
+}
@@ -0,0 +1,303 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Streams a byte pattern through an spsc_queue between two threads
+ * and checks that it arrives intact, then compares throughput and
+ * round trip latency against a fifo_queue guarded by a lock and a
+ * condition variable, the way the audio drivers used to do it. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <queues/fifo_queue.h>
+#include <queues/spsc_queue.h>
+#include <rthreads/rthreads.h>
+
+#define STREAM_BYTES (64 * 1024 * 1024)
+#define PING_ROUNDS  20000
+
+/* The fifo_queue version, for comparison */
+struct locked_fifo
+{
+   fifo_buffer_t *fifo;
+   slock_t *lock;
+   scond_t *cond;
+};
+
+static struct locked_fifo *locked_fifo_new(size_t size)
+{
+   struct locked_fifo *q = (struct locked_fifo*)calloc(1, sizeof(*q));
+   q->fifo = fifo_new(size);
+   q->lock = slock_new();
+   q->cond = scond_new();
+   return q;
+}
+
+static void locked_fifo_free(struct locked_fifo *q)
+{
+   fifo_free(q->fifo);
+   slock_free(q->lock);
+   scond_free(q->cond);
+   free(q);
+}
+
+static size_t locked_fifo_write(struct locked_fifo *q,
+      const void *data, size_t size)
+{
+   slock_lock(q->lock);
+   while (!FIFO_WRITE_AVAIL(q->fifo))
+      scond_wait(q->cond, q->lock);
+   if (size > FIFO_WRITE_AVAIL(q->fifo))
+      size = FIFO_WRITE_AVAIL(q->fifo);
+   fifo_write(q->fifo, data, size);
+   scond_signal(q->cond);
+   slock_unlock(q->lock);
+   return size;
+}
+
+static size_t locked_fifo_read(struct locked_fifo *q, void *data, size_t size)
+{
+   slock_lock(q->lock);
+   while (!FIFO_READ_AVAIL(q->fifo))
+      scond_wait(q->cond, q->lock);
+   if (size > FIFO_READ_AVAIL(q->fifo))
+      size = FIFO_READ_AVAIL(q->fifo);
+   fifo_read(q->fifo, data, size);
+   scond_signal(q->cond);
+   slock_unlock(q->lock);
+   return size;
+}
+
+struct stream
+{
+   spsc_queue_t *spsc;
+   struct locked_fifo *locked;
+   size_t chunk;
+   bool ok;
+};
+
+static uint8_t pattern(size_t i)
+{
+   return (uint8_t)((i * 2654435761u) >> 13);
+}
+
+static void stream_producer(void *data)
+{
+   struct stream *s = (struct stream*)data;
+   uint8_t *buf     = (uint8_t*)malloc(s->chunk);
+   size_t sent      = 0;
+
+   while (sent < STREAM_BYTES)
+   {
+      size_t i, n = s->chunk;
+
+      if (n > STREAM_BYTES - sent)
+         n = STREAM_BYTES - sent;
+      for (i = 0; i < n; i++)
+         buf[i] = pattern(sent + i);
+
+      for (i = 0; i < n; )
+      {
+         if (s->spsc)
+         {
+            i += spsc_queue_write(s->spsc, buf + i, n - i);
+            if (i < n)
+               spsc_queue_wait_write(s->spsc, 1);
+         }
+         else
+            i += locked_fifo_write(s->locked, buf + i, n - i);
+      }
+      sent += n;
+   }
+
+   free(buf);
+}
+
+static void stream_consumer(struct stream *s)
+{
+   uint8_t *buf  = (uint8_t*)malloc(s->chunk);
+   size_t recvd  = 0;
+
+   s->ok = true;
+
+   while (recvd < STREAM_BYTES)
+   {
+      size_t i, n;
+
+      if (s->spsc)
+      {
+         if (!(n = spsc_queue_read(s->spsc, buf, s->chunk)))
+         {
+            spsc_queue_wait_read(s->spsc, 1);
+            continue;
+         }
+      }
+      else
+         n = locked_fifo_read(s->locked, buf, s->chunk);
+
+      for (i = 0; i < n && s->ok; i++)
+      {
+         if (buf[i] != pattern(recvd + i))
+         {
+            printf("[FAIL] byte %u is wrong\n", (unsigned)(recvd + i));
+            s->ok = false;
+         }
+      }
+      recvd += n;
+   }
+
+   free(buf);
+}
+
+static bool run_stream(bool lock_free, size_t size, size_t chunk)
+{
+   struct stream s;
+   sthread_t *thread;
+   retro_time_t start;
+   double secs;
+
+   memset(&s, 0, sizeof(s));
+   s.chunk = chunk;
+   if (lock_free)
+      s.spsc   = spsc_queue_new(size);
+   else
+      s.locked = locked_fifo_new(size);
+
+   start  = cpu_features_get_time_usec();
+   thread = sthread_create(stream_producer, &s);
+   stream_consumer(&s);
+   sthread_join(thread);
+   secs   = (cpu_features_get_time_usec() - start) / 1000000.0;
+
+   printf("%-12s ring %6u chunk %5u: %8.1f MB/s %s\n",
+         lock_free ? "spsc_queue" : "fifo+lock",
+         (unsigned)size, (unsigned)chunk,
+         STREAM_BYTES / secs / (1024.0 * 1024.0),
+         s.ok ? "" : "CORRUPT");
+
+   if (s.spsc)
+      spsc_queue_free(s.spsc);
+   else
+      locked_fifo_free(s.locked);
+   return s.ok;
+}
+
+struct ping
+{
+   spsc_queue_t *spsc[2];
+   struct locked_fifo *locked[2];
+};
+
+static void ping_send(struct ping *p, unsigned q, uint32_t v)
+{
+   if (p->spsc[q])
+      spsc_queue_write(p->spsc[q], &v, sizeof(v));
+   else
+      locked_fifo_write(p->locked[q], &v, sizeof(v));
+}
+
+static uint32_t ping_recv(struct ping *p, unsigned q)
+{
+   uint32_t v = 0;
+
+   if (p->spsc[q])
+   {
+      spsc_queue_wait_read(p->spsc[q], sizeof(v));
+      spsc_queue_read(p->spsc[q], &v, sizeof(v));
+   }
+   else
+      locked_fifo_read(p->locked[q], &v, sizeof(v));
+   return v;
+}
+
+static void ping_echo(void *data)
+{
+   unsigned i;
+   struct ping *p = (struct ping*)data;
+
+   for (i = 0; i < PING_ROUNDS; i++)
+      ping_send(p, 1, ping_recv(p, 0) + 1);
+}
+
+static void run_ping(bool lock_free)
+{
+   unsigned i;
+   struct ping p;
+   sthread_t *thread;
+   retro_time_t start;
+
+   memset(&p, 0, sizeof(p));
+   for (i = 0; i < 2; i++)
+   {
+      if (lock_free)
+         p.spsc[i]   = spsc_queue_new(64);
+      else
+         p.locked[i] = locked_fifo_new(64);
+   }
+
+   thread = sthread_create(ping_echo, &p);
+   start  = cpu_features_get_time_usec();
+   for (i = 0; i < PING_ROUNDS; i++)
+   {
+      ping_send(&p, 0, i);
+      if (ping_recv(&p, 1) != i + 1)
+         printf("[FAIL] wrong reply\n");
+   }
+   printf("%-12s round trip: %8.2f us\n",
+         lock_free ? "spsc_queue" : "fifo+lock",
+         (double)(cpu_features_get_time_usec() - start) / PING_ROUNDS);
+   sthread_join(thread);
+
+   for (i = 0; i < 2; i++)
+   {
+      if (lock_free)
+         spsc_queue_free(p.spsc[i]);
+      else
+         locked_fifo_free(p.locked[i]);
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t chunks[] = { 64, 1024, 4096 };
+   bool ok = true;
+   unsigned i;
+
+   /* An odd size so that reads and writes straddle the end */
+   ok = run_stream(true, 4093, 1000) && ok;
+
+   printf("\nThroughput, %u MB\n", STREAM_BYTES / (1024 * 1024));
+   for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+   {
+      ok = run_stream(false, 32768, chunks[i]) && ok;
+      ok = run_stream(true,  32768, chunks[i]) && ok;
+   }
+
+   printf("\nLatency, %u round trips\n", PING_ROUNDS);
+   run_ping(false);
+   run_ping(true);
+
+   printf("\n%s\n", ok ? "[OK]" : "[FAIL]");
+   return ok ? 0 : 1;
+}
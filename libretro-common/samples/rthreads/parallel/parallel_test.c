@@ -0,0 +1,197 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (parallel_test.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Checks that parallel_for() and task groups cover all of their work
+ * exactly once, then times a frame-sized workload against running it
+ * serially.
+ *
+ * Usage: parallel_test [workers]  (0 or nothing picks from the cores) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <rthreads/parallel.h>
+
+#define TEST_SIZE   (1 << 20)
+#define BENCH_ROWS  1080
+#define BENCH_COLS  1920
+#define BENCH_RUNS  200
+
+static unsigned char *visits;
+static unsigned      *pixels;
+
+static void visit_range(void *data, size_t begin, size_t end)
+{
+   size_t i;
+   for (i = begin; i < end; i++)
+      visits[i]++;
+}
+
+static void visit_nested(void *data, size_t begin, size_t end)
+{
+   size_t i;
+   /* Each outer index owns 1024 inner ones */
+   for (i = begin; i < end; i++)
+      parallel_for(i * 1024, (i + 1) * 1024, 64, visit_range, NULL);
+}
+
+struct group_item
+{
+   parallel_group_t *group;
+   size_t index;
+   unsigned depth;
+};
+
+static void visit_job(void *data)
+{
+   struct group_item *item = (struct group_item*)data;
+
+   /* Each job spawns two children into its own group and waits,
+    * so waiting threads have to keep running jobs */
+   if (item->depth)
+   {
+      parallel_group_t group;
+      struct group_item children[2];
+
+      parallel_group_init(&group);
+      children[0].index = item->index * 2;
+      children[1].index = item->index * 2 + 1;
+      children[0].depth = children[1].depth = item->depth - 1;
+      parallel_group_run(&group, visit_job, &children[0]);
+      parallel_group_run(&group, visit_job, &children[1]);
+      parallel_group_wait(&group);
+      return;
+   }
+
+   visits[item->index]++;
+}
+
+static bool check_visits(const char *name, size_t count)
+{
+   size_t i;
+
+   for (i = 0; i < count; i++)
+   {
+      if (visits[i] != 1)
+      {
+         printf("[FAIL] %s: index %u visited %u times\n",
+               name, (unsigned)i, (unsigned)visits[i]);
+         return false;
+      }
+   }
+
+   printf("[OK]   %s\n", name);
+   memset(visits, 0, TEST_SIZE);
+   return true;
+}
+
+/* Stands in for a softfilter: a bit of arithmetic per pixel */
+static void shade_rows(void *data, size_t begin, size_t end)
+{
+   size_t y, x;
+
+   for (y = begin; y < end; y++)
+   {
+      unsigned *row = pixels + y * BENCH_COLS;
+      for (x = 0; x < BENCH_COLS; x++)
+      {
+         unsigned p = row[x];
+         p      = (p * 2654435761u) ^ (p >> 13);
+         row[x] = ((p & 0xfefefe) >> 1) + (unsigned)(x ^ y);
+      }
+   }
+}
+
+static double bench(size_t grain)
+{
+   unsigned i;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   for (i = 0; i < BENCH_RUNS; i++)
+   {
+      if (grain)
+         parallel_for(0, BENCH_ROWS, grain, shade_rows, NULL);
+      else
+         shade_rows(NULL, 0, BENCH_ROWS);
+   }
+
+   return (double)(cpu_features_get_time_usec() - start) / BENCH_RUNS;
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t grains[] = { 1, 4, 16, 64, 0 };
+   unsigned workers             = argc > 1 ? (unsigned)atoi(argv[1]) : 0;
+   bool ok                      = true;
+   double serial;
+   unsigned i;
+
+   visits = (unsigned char*)calloc(1, TEST_SIZE);
+   pixels = (unsigned*)calloc(BENCH_ROWS * BENCH_COLS, sizeof(*pixels));
+   if (!visits || !pixels)
+      return 1;
+
+   if (!parallel_init(workers))
+      printf("No worker threads, everything runs serially.\n");
+   printf("Threads: %u\n", parallel_get_threads());
+
+   parallel_for(0, TEST_SIZE, 1, visit_range, NULL);
+   ok = check_visits("parallel_for, grain 1", TEST_SIZE) && ok;
+   parallel_for(0, TEST_SIZE, 0, visit_range, NULL);
+   ok = check_visits("parallel_for, grain 0", TEST_SIZE) && ok;
+   parallel_for(0, TEST_SIZE - 7, 1000, visit_range, NULL);
+   visits[TEST_SIZE - 7] = visits[TEST_SIZE - 6] = visits[TEST_SIZE - 5] =
+   visits[TEST_SIZE - 4] = visits[TEST_SIZE - 3] = visits[TEST_SIZE - 2] =
+   visits[TEST_SIZE - 1] = 1;
+   ok = check_visits("parallel_for, odd range", TEST_SIZE) && ok;
+   parallel_for(0, TEST_SIZE / 1024, 1, visit_nested, NULL);
+   ok = check_visits("nested parallel_for", TEST_SIZE) && ok;
+
+   {
+      struct group_item root;
+      root.index = 0;
+      root.depth = 16;
+      visit_job(&root);
+      ok = check_visits("nested groups", 1 << 16) && ok;
+   }
+
+   serial = bench(0);
+   printf("\n%ux%u rows, %u runs\n", BENCH_COLS, BENCH_ROWS, BENCH_RUNS);
+   printf("serial        : %8.1f us/run\n", serial);
+   for (i = 0; i < sizeof(grains) / sizeof(grains[0]); i++)
+   {
+      size_t grain = grains[i] ? grains[i]
+         : (BENCH_ROWS + parallel_get_threads() - 1) / parallel_get_threads();
+      double t     = bench(grain);
+      printf("grain %4u    : %8.1f us/run, %.2fx, %.2f ns/pixel\n",
+            (unsigned)grain, t, serial / t,
+            t * 1000.0 / (BENCH_ROWS * BENCH_COLS));
+   }
+
+   parallel_deinit();
+   free(visits);
+   free(pixels);
+
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,609 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *  Copyright (C) 2014-2017 - Alfred Agrell
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libretro.h>
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
+#include <compat/intrinsics.h>
+#include <features/features_cpu.h>
+
+#include "state_delta.h"
+
+#ifndef UINT16_MAX
+#define UINT16_MAX 0xffff
+#endif
+
+#ifndef UINT32_MAX
+#define UINT32_MAX 0xffffffffu
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
+#define CPU_X86
+#endif
+
+/* Other arches SIGBUS (usually) on unaligned accesses. */
+#ifndef CPU_X86
+#define NO_UNALIGNED_MEM
+#endif
+
+/* Wider kernels are compiled for a specific target and
+ * only picked at runtime, so that baseline builds can
+ * still use them. */
+#if defined(CPU_X86) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define STATE_DELTA_TARGET(x) __attribute__((target(x)))
+#define STATE_DELTA_X86_DISPATCH
+#elif defined(CPU_X86) && defined(_MSC_VER) && _MSC_VER >= 1910
+#define STATE_DELTA_X86_DISPATCH
+#endif
+
+#ifndef STATE_DELTA_TARGET
+#define STATE_DELTA_TARGET(x)
+#endif
+
+#if defined(STATE_DELTA_X86_DISPATCH) || __SSE2__
+#define STATE_DELTA_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef STATE_DELTA_X86_DISPATCH
+#define STATE_DELTA_AVX2
+#define STATE_DELTA_AVX512
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define STATE_DELTA_NEON
+#include <arm_neon.h>
+#endif
+
+/* Patch format (pseudocode): */
+#if 0
+repeat {
+   uint16 numchanged; /* everything is counted in units of uint16 */
+   if (numchanged)
+   {
+      uint16 numunchanged; /* skip these before handling numchanged */
+      uint16[numchanged] changeddata;
+   }
+   else
+   {
+      uint32 numunchanged;
+      if (!numunchanged)
+         break;
+   }
+}
+#endif
+
+/* Every kernel must agree on these so that the resulting
+ * patches are the same:
+ *
+ * find_change returns the first differing uint16.
+ *
+ * find_same compares pairs of uint16s and returns the first
+ * equal pair, moved back by one if the uint16 right before it
+ * is equal as well. With this, it's random whether two
+ * consecutive identical words are caught.
+ *
+ * Luckily, compression rate is the same for both cases, and
+ * three is always caught.
+ *
+ * (We prefer to miss two-word blocks, anyways; fewer iterations
+ * of the outer loop, as well as in the decompressor.)
+ *
+ * Which pairs get compared depends on where counting starts.
+ * On x86 every kernel counts from the start of the buffer and
+ * the patches match byte for byte. The generic kernel on
+ * strict-alignment CPUs counts from an aligned address while
+ * NEON counts from the buffer, so their patches may differ in
+ * how two-word runs are split. Either one decodes to the same
+ * state. */
+
+/* There's no equivalent in libc, you'd think so ...
+ * std::mismatch exists, but it's not optimized at all. */
+static size_t find_change_generic(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+#ifdef NO_UNALIGNED_MEM
+   while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
+   {
+      a++;
+      b++;
+   }
+   if (*a == *b)
+#endif
+   {
+      const size_t *a_big = (const size_t*)a;
+      const size_t *b_big = (const size_t*)b;
+
+      while (*a_big == *b_big)
+      {
+         a_big++;
+         b_big++;
+      }
+      a = (const uint16_t*)a_big;
+      b = (const uint16_t*)b_big;
+
+      while (*a == *b)
+      {
+         a++;
+         b++;
+      }
+   }
+   return a - a_org;
+}
+
+static size_t find_same_generic(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+#ifdef NO_UNALIGNED_MEM
+   if (((uintptr_t)a & (sizeof(uint32_t) - 1)) && *a != *b)
+   {
+      a++;
+      b++;
+   }
+   if (*a != *b)
+#endif
+   {
+      const uint32_t *a_big = (const uint32_t*)a;
+      const uint32_t *b_big = (const uint32_t*)b;
+
+      while (*a_big != *b_big)
+      {
+         a_big++;
+         b_big++;
+      }
+      a = (const uint16_t*)a_big;
+      b = (const uint16_t*)b_big;
+
+      if (a != a_org && a[-1] == b[-1])
+      {
+         a--;
+         b--;
+      }
+   }
+   return a - a_org;
+}
+
+#ifdef STATE_DELTA_SSE2
+STATE_DELTA_TARGET("sse2")
+static size_t find_change_sse2(const uint16_t *a, const uint16_t *b)
+{
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+
+   for (;;)
+   {
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
+
+      if (mask != 0xffff) /* Something has changed, figure out where. */
+      {
+         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+         return ret | (a[ret] == b[ret]);
+      }
+
+      a128++;
+      b128++;
+   }
+}
+
+STATE_DELTA_TARGET("sse2")
+static size_t find_same_sse2(const uint16_t *a, const uint16_t *b)
+{
+   size_t ret;
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+
+   for (;;)
+   {
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
+
+      if (mask)
+      {
+         ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(mask))) >> 1;
+         break;
+      }
+
+      a128++;
+      b128++;
+   }
+
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return ret;
+}
+#endif
+
+#ifdef STATE_DELTA_AVX2
+STATE_DELTA_TARGET("avx2")
+static size_t find_change_avx2(const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0    = _mm256_loadu_si256(a256);
+      __m256i v1    = _mm256_loadu_si256(b256);
+      __m256i c     = _mm256_cmpeq_epi32(v0, v1);
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(c);
+
+      if (mask != 0xffffffff)
+      {
+         size_t ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+         return ret | (a[ret] == b[ret]);
+      }
+
+      a256++;
+      b256++;
+   }
+}
+
+STATE_DELTA_TARGET("avx2")
+static size_t find_same_avx2(const uint16_t *a, const uint16_t *b)
+{
+   size_t ret;
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0    = _mm256_loadu_si256(a256);
+      __m256i v1    = _mm256_loadu_si256(b256);
+      __m256i c     = _mm256_cmpeq_epi32(v0, v1);
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(c);
+
+      if (mask)
+      {
+         ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(mask))) >> 1;
+         break;
+      }
+
+      a256++;
+      b256++;
+   }
+
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return ret;
+}
+#endif
+
+#ifdef STATE_DELTA_AVX512
+/* One mask bit per 32-bit lane, i.e. per two uint16s. */
+STATE_DELTA_TARGET("avx512f")
+static size_t find_change_avx512(const uint16_t *a, const uint16_t *b)
+{
+   const __m512i *a512 = (const __m512i*)a;
+   const __m512i *b512 = (const __m512i*)b;
+
+   for (;;)
+   {
+      __m512i v0    = _mm512_loadu_si512(a512);
+      __m512i v1    = _mm512_loadu_si512(b512);
+      uint32_t mask = _mm512_cmpeq_epi32_mask(v0, v1);
+
+      if (mask != 0xffff)
+      {
+         size_t ret = (((uint8_t*)a512 - (uint8_t*)a) >> 1)
+            + compat_ctz(~mask) * 2;
+         return ret | (a[ret] == b[ret]);
+      }
+
+      a512++;
+      b512++;
+   }
+}
+
+STATE_DELTA_TARGET("avx512f")
+static size_t find_same_avx512(const uint16_t *a, const uint16_t *b)
+{
+   size_t ret;
+   const __m512i *a512 = (const __m512i*)a;
+   const __m512i *b512 = (const __m512i*)b;
+
+   for (;;)
+   {
+      __m512i v0    = _mm512_loadu_si512(a512);
+      __m512i v1    = _mm512_loadu_si512(b512);
+      uint32_t mask = _mm512_cmpeq_epi32_mask(v0, v1);
+
+      if (mask)
+      {
+         ret = (((uint8_t*)a512 - (uint8_t*)a) >> 1)
+            + compat_ctz(mask) * 2;
+         break;
+      }
+
+      a512++;
+      b512++;
+   }
+
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return ret;
+}
+#endif
+
+#ifdef STATE_DELTA_NEON
+static INLINE uint32x4_t state_delta_cmpeq_neon(
+      const uint16_t *a, const uint16_t *b)
+{
+   /* Byte loads, the uint16 pointers are not necessarily
+    * 32-bit aligned. */
+   return vceqq_u32(
+         vreinterpretq_u32_u8(vld1q_u8((const uint8_t*)a)),
+         vreinterpretq_u32_u8(vld1q_u8((const uint8_t*)b)));
+}
+
+static size_t find_change_neon(const uint16_t *a, const uint16_t *b)
+{
+   size_t ret = 0;
+
+   while (vminvq_u32(state_delta_cmpeq_neon(a + ret, b + ret))
+         == 0xffffffff)
+      ret += 8;
+
+   /* Changed lane is within the next eight uint16s. */
+   while (a[ret] == b[ret])
+      ret++;
+   return ret;
+}
+
+static size_t find_same_neon(const uint16_t *a, const uint16_t *b)
+{
+   uint32_t lanes[4];
+   unsigned i;
+   size_t ret = 0;
+   uint32x4_t c;
+
+   for (;;)
+   {
+      c = state_delta_cmpeq_neon(a + ret, b + ret);
+      if (vmaxvq_u32(c))
+         break;
+      ret += 8;
+   }
+
+   vst1q_u32(lanes, c);
+   for (i = 0; !lanes[i]; i++)
+      ret += 2;
+
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return ret;
+}
+#endif
+
+/* Fastest first */
+static const state_delta_kernel_t state_delta_kernels[] = {
+#ifdef STATE_DELTA_AVX512
+   { find_change_avx512,  find_same_avx512,
+      RETRO_SIMD_AVX | CPU_FEATURE_AVX512F, "avx512" },
+#endif
+#ifdef STATE_DELTA_AVX2
+   { find_change_avx2,    find_same_avx2,
+      RETRO_SIMD_AVX | RETRO_SIMD_AVX2,   "avx2"    },
+#endif
+#ifdef STATE_DELTA_NEON
+   /* Always there on AArch64 */
+   { find_change_neon,    find_same_neon,    0, "neon"    },
+#endif
+#ifdef STATE_DELTA_SSE2
+#if __SSE2__
+   { find_change_sse2,    find_same_sse2,    0, "sse2"    },
+#else
+   { find_change_sse2,    find_same_sse2,
+      RETRO_SIMD_SSE2,                    "sse2"    },
+#endif
+#endif
+   { find_change_generic, find_same_generic, 0, "generic" },
+};
+
+const state_delta_kernel_t *state_delta_kernel_get(uint64_t cpu)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(state_delta_kernels); i++)
+   {
+      uint64_t simd = state_delta_kernels[i].simd;
+      if ((cpu & simd) == simd)
+         return &state_delta_kernels[i];
+   }
+
+   return &state_delta_kernels[ARRAY_SIZE(state_delta_kernels) - 1];
+}
+
+const state_delta_kernel_t *state_delta_kernel_get_by_index(unsigned i)
+{
+   if (i >= ARRAY_SIZE(state_delta_kernels))
+      return NULL;
+   return &state_delta_kernels[i];
+}
+
+size_t state_delta_maxsize(size_t uncomp)
+{
+   /* bytes covered by a compressed block */
+   const int maxcblkcover = UINT16_MAX * sizeof(uint16_t);
+   /* uncompressed size, rounded to 16 bits */
+   size_t uncomp16        = (uncomp + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
+   /* number of blocks */
+   size_t maxcblks        = (uncomp + maxcblkcover - 1) / maxcblkcover;
+   return uncomp16 + maxcblks * sizeof(uint16_t) * 2 /* two u16 overhead per block */ + sizeof(uint16_t) *
+      3; /* three u16 to end it */
+}
+
+void *state_delta_alloc(size_t len, uint16_t uniq)
+{
+   size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
+   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 64, 1);
+
+   /* Force in a different byte at the end, so we don't need to check
+    * bounds in the innermost loop (it's expensive).
+    *
+    * There is also a large amount of data that's the same, to stop
+    * the other scan.
+    *
+    * There is also some padding at the end. This is so we don't
+    * read outside the buffer end if we're reading in large blocks;
+    * the widest kernel reads 64 bytes at a time.
+    *
+    * It doesn't make any difference to us, but sacrificing 64 bytes to get
+    * Valgrind happy is worth it. */
+   ret[len16/sizeof(uint16_t) + 3] = uniq;
+
+   return ret;
+}
+
+size_t state_delta_compress(const state_delta_kernel_t *kernel,
+      const void *src, const void *dst, size_t len, void *patch)
+{
+   const uint16_t  *old16 = (const uint16_t*)src;
+   const uint16_t  *new16 = (const uint16_t*)dst;
+   uint16_t *compressed16 = (uint16_t*)patch;
+   size_t          num16s = (len + sizeof(uint16_t) - 1)
+      / sizeof(uint16_t);
+   state_delta_scan_t find_change = kernel->find_change;
+   state_delta_scan_t find_same   = kernel->find_same;
+
+   while (num16s)
+   {
+      size_t i, changed;
+      size_t skip = find_change(old16, new16);
+
+      if (skip >= num16s)
+         break;
+
+      old16  += skip;
+      new16  += skip;
+      num16s -= skip;
+
+      if (skip > UINT16_MAX)
+      {
+         /* This will make it scan the entire thing again,
+          * but it only hits on 8GB unchanged data anyways,
+          * and if you're doing that, you've got bigger problems. */
+         if (skip > UINT32_MAX)
+            skip         = UINT32_MAX;
+
+         *compressed16++ = 0;
+         *compressed16++ = skip;
+         *compressed16++ = skip >> 16;
+         continue;
+      }
+
+      changed         = find_same(old16, new16);
+      if (changed > UINT16_MAX)
+         changed = UINT16_MAX;
+
+      *compressed16++ = changed;
+      *compressed16++ = skip;
+
+      for (i = 0; i < changed; i++)
+         compressed16[i] = old16[i];
+
+      old16        += changed;
+      new16        += changed;
+      num16s       -= changed;
+      compressed16 += changed;
+   }
+
+   compressed16[0]  = 0;
+   compressed16[1]  = 0;
+   compressed16[2]  = 0;
+
+   return (uint8_t*)(compressed16 + 3) - (uint8_t*)patch;
+}
+
+size_t state_delta_size(const void *patch)
+{
+   const uint16_t *patch16 = (const uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged  = *(patch16++);
+
+      if (numchanged)
+         patch16 += 1 + numchanged;
+      else
+      {
+         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+
+         patch16 += 2;
+         if (!numunchanged)
+            break;
+      }
+   }
+
+   return (const uint8_t*)patch16 - (const uint8_t*)patch;
+}
+
+void state_delta_decompress(const void *patch,
+      size_t patchlen, void *data, size_t datalen)
+{
+   uint16_t         *out16 = (uint16_t*)data;
+   const uint16_t *patch16 = (const uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged  = *(patch16++);
+
+      if (numchanged)
+      {
+         uint16_t i;
+
+         out16       += *patch16++;
+
+         /* We could do memcpy, but it seems that memcpy has a
+          * constant-per-call overhead that actually shows up.
+          *
+          * Our average size in here seems to be 8 or something.
+          * Therefore, we do something with lower overhead. */
+         for (i = 0; i < numchanged; i++)
+            out16[i]  = patch16[i];
+
+         patch16     += numchanged;
+         out16       += numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+
+         if (!numunchanged)
+            break;
+         patch16 += 2;
+         out16   += numunchanged;
+      }
+   }
+}
@@ -0,0 +1,99 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *  Copyright (C) 2014-2017 - Alfred Agrell
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STATE_DELTA_H
+#define __STATE_DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Scans 'a' and 'b' and returns the offset (in uint16 units)
+ * of the first changed, respectively unchanged, word.
+ * Both buffers must come from state_delta_alloc(). */
+typedef size_t (*state_delta_scan_t)(const uint16_t *a, const uint16_t *b);
+
+typedef struct state_delta_kernel
+{
+   state_delta_scan_t find_change;
+   state_delta_scan_t find_same;
+   /* RETRO_SIMD_* and CPU_FEATURE_* flags this kernel
+    * needs at runtime */
+   uint64_t simd;
+   const char *ident;
+} state_delta_kernel_t;
+
+/**
+ * state_delta_kernel_get:
+ * @cpu                  : CPU features, as returned by cpu_features_get().
+ *
+ * Returns: the fastest scan kernel usable with @cpu.
+ **/
+const state_delta_kernel_t *state_delta_kernel_get(uint64_t cpu);
+
+/**
+ * state_delta_kernel_get_by_index:
+ * @i                    : Index of kernel.
+ *
+ * Returns: every scan kernel compiled in, fastest first,
+ * or NULL once @i is past the end of the list.
+ **/
+const state_delta_kernel_t *state_delta_kernel_get_by_index(unsigned i);
+
+/* Returns the maximum compressed size of a savestate.
+ * It is very likely to compress to far less. */
+size_t state_delta_maxsize(size_t uncomp);
+
+/*
+ * See state_delta_compress for information about this.
+ * When you're done with it, send it to free().
+ */
+void *state_delta_alloc(size_t len, uint16_t uniq);
+
+/*
+ * Takes two savestates and creates a patch that turns 'dst' into 'src'.
+ * Both 'src' and 'dst' must be returned from state_delta_alloc(),
+ * with the same 'len', and different 'uniq'.
+ *
+ * 'patch' must be size 'state_delta_maxsize(len)' or more.
+ * Returns the number of bytes actually written to 'patch'.
+ */
+size_t state_delta_compress(const state_delta_kernel_t *kernel,
+      const void *src, const void *dst, size_t len, void *patch);
+
+/* Returns the number of bytes 'patch' occupies,
+ * i.e. what state_delta_compress() returned for it. */
+size_t state_delta_size(const void *patch);
+
+/*
+ * Takes 'patch' from a previous call to 'state_delta_compress'
+ * and applies it to 'data' ('dst' from that call),
+ * yielding 'src' in that call.
+ *
+ * If the given arguments do not match a previous call to
+ * state_delta_compress(), anything at all can happen.
+ */
+void state_delta_decompress(const void *patch,
+      size_t patchlen, void *data, size_t datalen);
+
+RETRO_END_DECLS
+
+#endif
@@ -24,10 +24,23 @@
 #include <string.h>
 
 #include <retro_inline.h>
+#include <memmap.h>
 #include <compat/strl.h>
-#include <compat/intrinsics.h>
+#include <string/stdstring.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+#include <streams/trans_stream.h>
+#endif
+#ifdef HAVE_MMAN
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "state_manager.h"
+#include "state_delta.h"
 #include "../msg_hash.h"
 #include "../core.h"
 #include "../retroarch.h"
@@ -41,26 +54,45 @@
 /* Keep it off unless you're chasing a core bug, it slows things down. */
 #define STRICT_BUF_SIZE 0
 
-#ifndef UINT16_MAX
-#define UINT16_MAX 0xffff
+#ifdef HAVE_THREADS
+/* Number of serialize buffers the main thread can fill
+ * while the worker is still encoding older ones. */
+#define STATE_MANAGER_ASYNC_BLOCKS 3
 #endif
 
-#ifndef UINT32_MAX
-#define UINT32_MAX 0xffffffffu
+#ifdef HAVE_MMAN
+#define STATE_MANAGER_MMAP
+/* A disk-backed ring hands written pages back to the kernel
+ * in steps of this size, so only about two of them stay resident. */
+#define STATE_MANAGER_MAP_WINDOW (8 << 20)
 #endif
 
-#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
-#define CPU_X86
-#endif
+#if defined(HAVE_THREADS) && defined(HAVE_ZLIB)
+#define STATE_MANAGER_TIERS
+/* Deltas leave the ring in batches of about this many frames. */
+#define STATE_MANAGER_TIER_CHUNK 64
 
-/* Other arches SIGBUS (usually) on unaligned accesses. */
-#ifndef CPU_X86
-#define NO_UNALIGNED_MEM
+/* A batch of consecutive deltas that aged out of the ring,
+ * stored as [size_t len][patch] from oldest to newest and
+ * deflated as a whole. The data follows the struct. */
+struct state_manager_chunk
+{
+   struct state_manager_chunk *older;
+   struct state_manager_chunk *newer;
+   size_t size;
+   size_t raw_size;
+   bool deflated;
+};
 #endif
 
-#if __SSE2__
-#include <emmintrin.h>
-#endif
+/* A full state stored in the ring, see state_manager_keyframe_add(). */
+struct state_manager_keyframe
+{
+   /* Where the entry starts in the ring */
+   size_t offset;
+   /* Value of state_manager::frame it restores */
+   unsigned frame;
+};
 
 struct state_manager
 {
@@ -85,6 +117,79 @@ struct state_manager
     * (yes, the math is a bit ugly). */
    size_t maxcompsize;
 
+   const state_delta_kernel_t *kernel;
+
+#ifdef HAVE_THREADS
+   /* Threaded capture: the main thread only serializes into
+    * one of the free blocks and queues it, the worker thread
+    * encodes the delta against 'thisblock' into the ring.
+    * Everything but the block lists below is owned by the
+    * worker while 'queue_count' or 'busy' is set. */
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   uint8_t *freeblocks[STATE_MANAGER_ASYNC_BLOCKS];
+   uint8_t *queue[STATE_MANAGER_ASYNC_BLOCKS];
+   unsigned free_count;
+   unsigned queue_ptr;
+   unsigned queue_count;
+   bool busy;
+   bool alive;
+#endif
+
+#ifdef STATE_MANAGER_TIERS
+   /* Second tier: deltas older than 'tier_age' frames (or
+    * whatever no longer fits comfortably in the ring) are
+    * moved to 'tier_pending' by whoever pushes, then deflated
+    * into a chunk by the tier thread. Chunks are evicted oldest
+    * first once they exceed 'tier_capacity'. */
+   struct state_manager_chunk *tier_newest;
+   struct state_manager_chunk *tier_oldest;
+   uint8_t *tier_pending;
+   uint8_t *tier_scratch;
+   void *tier_deflate;
+   void *tier_inflate;
+   sthread_t *tier_thread;
+   slock_t *tier_lock;
+   scond_t *tier_cond;
+   size_t tier_capacity;
+   size_t tier_size;
+   size_t tier_pending_size;
+   size_t tier_pending_capacity;
+   size_t tier_scratch_size;
+   unsigned tier_pending_entries;
+   unsigned tier_age;
+   bool tier_busy;
+   bool tier_alive;
+   /* Frames were dropped from the ring before they could move
+    * to the second tier, so nothing in it connects anymore. */
+   bool tier_reset;
+#endif
+
+#ifdef STATE_MANAGER_MMAP
+   /* Set if 'data' is a shared mapping of a scratch file rather
+    * than heap memory. 'map_window' is the offset of the
+    * STATE_MANAGER_MAP_WINDOW sized part of it 'head' is in. */
+   int map_fd;
+   size_t map_window;
+   bool mapped;
+#endif
+
+   /* Every 'keyframe_interval' frames, the whole new state is
+    * stored as an extra ring entry right after its delta, patched
+    * against the all-zero 'zeroblock'. 'keyframes' indexes them
+    * oldest first, as a circular list. Seeking starts from the
+    * nearest one instead of walking every delta in between. */
+   struct state_manager_keyframe *keyframes;
+   uint8_t *zeroblock;
+   unsigned keyframe_interval;
+   unsigned keyframe_first;
+   unsigned keyframe_count;
+   unsigned keyframe_capacity;
+   /* Counts up with every frame pushed and down with every
+    * frame popped, so it identifies the frame in 'thisblock'. */
+   unsigned frame;
+
    unsigned entries;
    bool thisblock_valid;
 };
@@ -99,20 +204,7 @@ struct state_manager_rewind_state
 /* Format per frame (pseudocode): */
 #if 0
 size nextstart;
-repeat {
-   uint16 numchanged; /* everything is counted in units of uint16 */
-   if (numchanged)
-   {
-      uint16 numunchanged; /* skip these before handling numchanged */
-      uint16[numchanged] changeddata;
-   }
-   else
-   {
-      uint32 numunchanged;
-      if (!numunchanged)
-         break;
-   }
-}
+uint8[] patch; /* see state_delta.c */
 size thisstart;
 #endif
 
@@ -120,301 +212,835 @@ size thisstart;
 static struct state_manager_rewind_state rewind_state;
 static bool frame_is_reversed                         = false;
 
-/* There's no equivalent in libc, you'd think so ...
- * std::mismatch exists, but it's not optimized at all. */
-static size_t find_change(const uint16_t *a, const uint16_t *b)
+/* The start offsets point to 'nextstart' of any given compressed frame.
+ * Each uint16 is stored native endian; anything that claims any other
+ * endianness refers to the endianness of this specific item.
+ * The uint32 is stored little endian.
+ *
+ * Each size value is stored native endian if alignment is not enforced;
+ * if it is, they're little endian.
+ *
+ * The start of the buffer contains a size pointing to the end of the
+ * buffer; the end points to its start.
+ *
+ * Wrapping is handled by returning to the start of the buffer if the
+ * compressed data could potentially hit the edge;
+ *
+ * if the compressed data could potentially overwrite the tail pointer,
+ * the tail retreats until it can no longer collide.
+ *
+ * This means that on average, ~2 * maxcompsize is
+ * unused at any given moment. */
+
+/* These are called very few constant times per frame,
+ * keep it as simple as possible. */
+static INLINE void write_size_t(void *ptr, size_t val)
 {
-#if __SSE2__
-   const __m128i *a128 = (const __m128i*)a;
-   const __m128i *b128 = (const __m128i*)b;
+   memcpy(ptr, &val, sizeof(val));
+}
 
-   for (;;)
-   {
-      __m128i v0    = _mm_loadu_si128(a128);
-      __m128i v1    = _mm_loadu_si128(b128);
-      __m128i c     = _mm_cmpeq_epi32(v0, v1);
-      uint32_t mask = _mm_movemask_epi8(c);
+static INLINE size_t read_size_t(const void *ptr)
+{
+   size_t ret;
 
-      if (mask != 0xffff) /* Something has changed, figure out where. */
-      {
-         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
-               (compat_ctz(~mask))) >> 1;
-         return ret | (a[ret] == b[ret]);
-      }
+   memcpy(&ret, ptr, sizeof(ret));
+   return ret;
+}
+
+#ifdef STATE_MANAGER_TIERS
+static bool state_manager_tier_flush(state_manager_t *state);
+
+static void state_manager_tier_gap(state_manager_t *state)
+{
+   if (!state->tier_thread)
+      return;
 
-      a128++;
-      b128++;
+   slock_lock(state->tier_lock);
+   state->tier_reset = true;
+   if (!state->tier_busy)
+   {
+      state->tier_pending_size    = 0;
+      state->tier_pending_entries = 0;
    }
+   scond_signal(state->tier_cond);
+   slock_unlock(state->tier_lock);
+}
+#endif
+
+#ifdef STATE_MANAGER_MMAP
+/* Creates a scratch file of 'size' bytes at 'path' and maps it.
+ * The file is unlinked right away, so it goes away with the
+ * mapping even if we never get to clean up. */
+static uint8_t *state_manager_map_open(state_manager_t *state,
+      const char *path, size_t size)
+{
+   void *data = MAP_FAILED;
+   int fd     = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+   if (fd < 0)
+      return NULL;
+
+   unlink(path);
+
+   /* Reserve the blocks up front where we can, running out of
+    * disk space halfway through a session would be SIGBUS. */
+#if defined(__linux__)
+   if (     posix_fallocate(fd, 0, (off_t)size) != 0
+         && ftruncate(fd, (off_t)size) != 0)
 #else
-   const uint16_t *a_org = a;
-#ifdef NO_UNALIGNED_MEM
-   while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
+   if (ftruncate(fd, (off_t)size) != 0)
+#endif
+   {
+      close(fd);
+      return NULL;
+   }
+
+   data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (data == MAP_FAILED)
+   {
+      close(fd);
+      return NULL;
+   }
+
+   state->map_fd     = fd;
+   state->map_window = 0;
+   state->capacity   = size;
+   state->mapped     = true;
+   return (uint8_t*)data;
+}
+
+/* Called whenever 'head' moves. Once it leaves a window, that
+ * window is scheduled for writeback and dropped from our resident
+ * set; the page cache can then evict it like any other file data.
+ * When rewinding, we also ask for the window we are entering. */
+static void state_manager_map_advise(state_manager_t *state,
+      bool backwards)
+{
+   size_t len;
+   size_t headpos = state->head - state->data;
+   size_t window  = headpos - headpos % STATE_MANAGER_MAP_WINDOW;
+   uint8_t *start = state->data + state->map_window;
+
+   if (!state->mapped || window == state->map_window)
+      return;
+
+   /* Rewinding, the first patch read from a window usually runs
+    * into the one we just left and faults part of it back in,
+    * so drop that one too. */
+   len            = state->capacity - state->map_window;
+   if (len > STATE_MANAGER_MAP_WINDOW * (backwards ? 2 : 1))
+      len         = STATE_MANAGER_MAP_WINDOW * (backwards ? 2 : 1);
+
+   msync(start, len, MS_ASYNC);
+#ifdef MADV_DONTNEED
+   madvise(start, len, MADV_DONTNEED);
+#endif
+#ifdef MADV_WILLNEED
+   if (backwards)
    {
-      a++;
-      b++;
+      len         = state->capacity - window;
+      if (len > STATE_MANAGER_MAP_WINDOW)
+         len      = STATE_MANAGER_MAP_WINDOW;
+      madvise(state->data + window, len, MADV_WILLNEED);
    }
-   if (*a == *b)
 #endif
+
+   state->map_window = window;
+}
+
+static void state_manager_map_close(state_manager_t *state)
+{
+   if (!state->mapped)
+      return;
+
+   munmap(state->data, state->capacity);
+   close(state->map_fd);
+   state->data   = NULL;
+   state->mapped = false;
+}
+#endif
+
+#define STATE_MANAGER_KEYFRAME(state, i) \
+   (&(state)->keyframes[((state)->keyframe_first + (i)) \
+    % (state)->keyframe_capacity])
+
+static bool state_manager_keyframe_add(state_manager_t *state,
+      size_t offset, unsigned frame)
+{
+   struct state_manager_keyframe *keyframe = NULL;
+
+   if (state->keyframe_count == state->keyframe_capacity)
    {
-      const size_t *a_big = (const size_t*)a;
-      const size_t *b_big = (const size_t*)b;
+      unsigned i;
+      unsigned capacity = state->keyframe_capacity
+         ? state->keyframe_capacity * 2 : 16;
+      struct state_manager_keyframe *keyframes =
+         (struct state_manager_keyframe*)
+         malloc(capacity * sizeof(*keyframes));
+
+      if (!keyframes)
+         return false;
+
+      for (i = 0; i < state->keyframe_count; i++)
+         keyframes[i] = *STATE_MANAGER_KEYFRAME(state, i);
+
+      free(state->keyframes);
+      state->keyframes         = keyframes;
+      state->keyframe_first    = 0;
+      state->keyframe_capacity = capacity;
+   }
+
+   keyframe         = STATE_MANAGER_KEYFRAME(state, state->keyframe_count);
+   keyframe->offset = offset;
+   keyframe->frame  = frame;
+   state->keyframe_count++;
+   return true;
+}
+
+/* Called for every entry leaving the tail of the ring.
+ * Returns true if it was a keyframe, rather than a delta. */
+static bool state_manager_keyframe_drop_oldest(state_manager_t *state,
+      const uint8_t *entry)
+{
+   if (     !state->keyframe_count
+         || STATE_MANAGER_KEYFRAME(state, 0)->offset
+            != (size_t)(entry - state->data))
+      return false;
+
+   state->keyframe_first = (state->keyframe_first + 1)
+      % state->keyframe_capacity;
+   state->keyframe_count--;
+   return true;
+}
+
+/* Same as above, for the head of the ring. */
+static bool state_manager_keyframe_drop_newest(state_manager_t *state,
+      const uint8_t *entry)
+{
+   if (     !state->keyframe_count
+         || STATE_MANAGER_KEYFRAME(state, state->keyframe_count - 1)->offset
+            != (size_t)(entry - state->data))
+      return false;
+
+   state->keyframe_count--;
+   return true;
+}
+
+/* Makes room for one more patch at the head of the ring,
+ * dropping the oldest frames if needed, and returns where
+ * the patch should be written. */
+static uint8_t *state_manager_ring_begin(state_manager_t *state)
+{
+   size_t headpos, tailpos, remaining;
 
-      while (*a_big == *b_big)
+recheckcapacity:;
+   headpos   = state->head - state->data;
+   tailpos   = state->tail - state->data;
+   remaining = (tailpos + state->capacity -
+         sizeof(size_t) - headpos - 1) % state->capacity + 1;
+
+   if (remaining <= state->maxcompsize)
+   {
+#ifdef STATE_MANAGER_TIERS
+      /* Rather hand the tail to the second tier than lose it. */
+      if (state_manager_tier_flush(state))
+         goto recheckcapacity;
+#endif
+      if (state_manager_keyframe_drop_oldest(state, state->tail))
       {
-         a_big++;
-         b_big++;
+         state->tail = state->data + read_size_t(state->tail);
+         goto recheckcapacity;
       }
-      a = (const uint16_t*)a_big;
-      b = (const uint16_t*)b_big;
+      state->tail = state->data + read_size_t(state->tail);
+      state->entries--;
+#ifdef STATE_MANAGER_TIERS
+      state_manager_tier_gap(state);
+#endif
+      goto recheckcapacity;
+   }
 
-      while (*a == *b)
+   return state->head + sizeof(size_t);
+}
+
+/* Links the patch ending at 'compressed' into the ring. */
+static void state_manager_ring_commit(state_manager_t *state,
+      uint8_t *compressed)
+{
+   if (compressed - state->data + state->maxcompsize > state->capacity)
+   {
+      compressed     = state->data;
+      if (state->tail == state->data + sizeof(size_t))
       {
-         a++;
-         b++;
+         bool keyframe = state_manager_keyframe_drop_oldest(
+               state, state->tail);
+
+         state->tail   = state->data + read_size_t(state->tail);
+         if (!keyframe)
+         {
+            state->entries--;
+#ifdef STATE_MANAGER_TIERS
+            state_manager_tier_gap(state);
+#endif
+         }
       }
    }
-   return a - a_org;
+   write_size_t(compressed, state->head-state->data);
+   compressed       += sizeof(size_t);
+   write_size_t(state->head, compressed-state->data);
+   state->head       = compressed;
+
+#ifdef STATE_MANAGER_MMAP
+   state_manager_map_advise(state, false);
 #endif
 }
 
-static size_t find_same(const uint16_t *a, const uint16_t *b)
+#ifdef STATE_MANAGER_TIERS
+static void state_manager_tier_clear(state_manager_t *state)
 {
-   const uint16_t *a_org = a;
-#ifdef NO_UNALIGNED_MEM
-   if (((uintptr_t)a & (sizeof(uint32_t) - 1)) && *a != *b)
+   struct state_manager_chunk *chunk = state->tier_newest;
+
+   while (chunk)
    {
-      a++;
-      b++;
+      struct state_manager_chunk *older = chunk->older;
+      free(chunk);
+      chunk = older;
    }
-   if (*a != *b)
-#endif
+
+   state->tier_newest = NULL;
+   state->tier_oldest = NULL;
+   state->tier_size   = 0;
+}
+
+/* Speed matters more than ratio here, the XOR deltas are mostly
+ * zero runs anyway and level 9 takes an order of magnitude longer
+ * on them for a few percent. */
+static void *state_manager_tier_deflate_new(void)
+{
+   const struct trans_stream_backend *zlib =
+      trans_stream_get_zlib_deflate_backend();
+   void *stream                            = zlib->stream_new();
+
+   if (stream)
+      zlib->define(stream, "level", 1);
+   return stream;
+}
+
+/* Deflates 'tier_pending' into a new chunk. Runs on the tier thread,
+ * which is the only one touching the chunk list while it is alive,
+ * apart from state_manager_tier_restore(). */
+static struct state_manager_chunk *state_manager_tier_pack(
+      state_manager_t *state)
+{
+   uint32_t rd, wn;
+   struct state_manager_chunk *chunk         = NULL;
+   const struct trans_stream_backend *zlib   =
+      trans_stream_get_zlib_deflate_backend();
+   const uint8_t *data                       = state->tier_scratch;
+   size_t size                               = 0;
+   bool deflated                             = false;
+
+   if (state->tier_deflate)
+   {
+      zlib->set_in(state->tier_deflate,
+            state->tier_pending, (uint32_t)state->tier_pending_size);
+      zlib->set_out(state->tier_deflate,
+            state->tier_scratch, (uint32_t)state->tier_scratch_size);
+   }
+
+   if (     state->tier_deflate
+         && zlib->trans(state->tier_deflate, true, &rd, &wn, NULL))
+   {
+      size     = wn;
+      deflated = true;
+   }
+   else
+   {
+      /* Incompressible; keep it as is and start over
+       * with a fresh stream next time. */
+      if (state->tier_deflate)
+         zlib->stream_free(state->tier_deflate);
+      state->tier_deflate = state_manager_tier_deflate_new();
+      data                = state->tier_pending;
+      size                = state->tier_pending_size;
+   }
+
+   chunk = (struct state_manager_chunk*)malloc(sizeof(*chunk) + size);
+   if (!chunk)
+      return NULL;
+
+   chunk->older    = NULL;
+   chunk->newer    = NULL;
+   chunk->size     = size;
+   chunk->raw_size = state->tier_pending_size;
+   chunk->deflated = deflated;
+   memcpy(chunk + 1, data, size);
+
+   return chunk;
+}
+
+static void state_manager_tier_thread(void *data)
+{
+   state_manager_t *state = (state_manager_t*)data;
+
+   slock_lock(state->tier_lock);
+
+   for (;;)
    {
-      /* With this, it's random whether two consecutive identical
-       * words are caught.
-       *
-       * Luckily, compression rate is the same for both cases, and
-       * three is always caught.
-       *
-       * (We prefer to miss two-word blocks, anyways; fewer iterations
-       * of the outer loop, as well as in the decompressor.) */
-      const uint32_t *a_big = (const uint32_t*)a;
-      const uint32_t *b_big = (const uint32_t*)b;
+      struct state_manager_chunk *chunk = NULL;
 
-      while (*a_big != *b_big)
+      while (     state->tier_alive
+               && !state->tier_pending_size
+               && !state->tier_reset)
+         scond_wait(state->tier_cond, state->tier_lock);
+
+      if (!state->tier_alive)
+         break;
+
+      if (state->tier_reset)
+      {
+         state_manager_tier_clear(state);
+         state->tier_reset = false;
+         scond_broadcast(state->tier_cond);
+         continue;
+      }
+
+      state->tier_busy = true;
+      slock_unlock(state->tier_lock);
+
+      chunk = state_manager_tier_pack(state);
+
+      slock_lock(state->tier_lock);
+      state->tier_busy = false;
+
+      /* Anything that got dropped in the meantime was newer
+       * than this batch, so it no longer connects either. */
+      if (chunk && state->tier_reset)
       {
-         a_big++;
-         b_big++;
+         free(chunk);
+         chunk = NULL;
       }
-      a = (const uint16_t*)a_big;
-      b = (const uint16_t*)b_big;
 
-      if (a != a_org && a[-1] == b[-1])
+      if (chunk)
       {
-         a--;
-         b--;
+         chunk->older = state->tier_newest;
+         if (state->tier_newest)
+            state->tier_newest->newer = chunk;
+         else
+            state->tier_oldest        = chunk;
+         state->tier_newest           = chunk;
+         state->tier_size            += chunk->size;
+
+         while (     state->tier_size > state->tier_capacity
+                  && state->tier_oldest != state->tier_newest)
+         {
+            struct state_manager_chunk *oldest = state->tier_oldest;
+            state->tier_oldest                 = oldest->newer;
+            state->tier_oldest->older          = NULL;
+            state->tier_size                  -= oldest->size;
+            free(oldest);
+         }
       }
+      else
+         state->tier_reset = true;
+
+      state->tier_pending_size    = 0;
+      state->tier_pending_entries = 0;
+      scond_broadcast(state->tier_cond);
    }
-   return a - a_org;
+
+   slock_unlock(state->tier_lock);
 }
 
-/* Returns the maximum compressed size of a savestate.
- * It is very likely to compress to far less. */
-static size_t state_manager_raw_maxsize(size_t uncomp)
+/* Called after every push; moves the oldest deltas out of the ring
+ * once they are older than 'tier_age' frames or the ring is getting
+ * full. Only costs a memcpy of the moved patches. */
+static void state_manager_tier_detach(state_manager_t *state)
 {
-   /* bytes covered by a compressed block */
-   const int maxcblkcover = UINT16_MAX * sizeof(uint16_t);
-   /* uncompressed size, rounded to 16 bits */
-   size_t uncomp16        = (uncomp + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   /* number of blocks */
-   size_t maxcblks        = (uncomp + maxcblkcover - 1) / maxcblkcover;
-   return uncomp16 + maxcblks * sizeof(uint16_t) * 2 /* two u16 overhead per block */ + sizeof(uint16_t) *
-      3; /* three u16 to end it */
-}
+   uint8_t *out;
+   size_t headpos, tailpos, used;
 
-/*
- * See state_manager_raw_compress for information about this.
- * When you're done with it, send it to free().
- */
-static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
-{
-   size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
-
-   /* Force in a different byte at the end, so we don't need to check
-    * bounds in the innermost loop (it's expensive).
-    *
-    * There is also a large amount of data that's the same, to stop
-    * the other scan.
-    *
-    * There is also some padding at the end. This is so we don't
-    * read outside the buffer end if we're reading in large blocks;
-    *
-    * It doesn't make any difference to us, but sacrificing 16 bytes to get
-    * Valgrind happy is worth it. */
-   ret[len16/sizeof(uint16_t) + 3] = uniq;
+   if (!state->tier_thread)
+      return;
 
-   return ret;
-}
+   headpos = state->head - state->data;
+   tailpos = state->tail - state->data;
+   used    = (headpos + state->capacity - tailpos) % state->capacity;
 
-/*
- * Takes two savestates and creates a patch that turns 'src' into 'dst'.
- * Both 'src' and 'dst' must be returned from state_manager_raw_alloc(),
- * with the same 'len', and different 'uniq'.
- *
- * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
- * Returns the number of bytes actually written to 'patch'.
- */
-static size_t state_manager_raw_compress(const void *src,
-      const void *dst, size_t len, void *patch)
-{
-   const uint16_t  *old16 = (const uint16_t*)src;
-   const uint16_t  *new16 = (const uint16_t*)dst;
-   uint16_t *compressed16 = (uint16_t*)patch;
-   size_t          num16s = (len + sizeof(uint16_t) - 1)
-      / sizeof(uint16_t);
+   if (     state->entries < state->tier_age + STATE_MANAGER_TIER_CHUNK
+         && used < state->capacity / 2)
+      return;
+
+   slock_lock(state->tier_lock);
 
-   while (num16s)
+   if (state->tier_pending_size || state->tier_busy || state->tier_reset)
    {
-      size_t i, changed;
-      size_t skip = find_change(old16, new16);
+      slock_unlock(state->tier_lock);
+      return;
+   }
 
-      if (skip >= num16s)
-         break;
+   out = state->tier_pending;
 
-      old16  += skip;
-      new16  += skip;
-      num16s -= skip;
+   while (     state->tail != state->head
+            && (state->entries > state->tier_age
+               || used > state->capacity / 4))
+   {
+      const uint8_t *patch = state->tail + sizeof(size_t);
+      size_t len           = state_delta_size(patch);
+      uint8_t *next        = state->data + read_size_t(state->tail);
 
-      if (skip > UINT16_MAX)
+      /* Keyframes are only there to speed up seeking the ring,
+       * there is no point in keeping them around. */
+      if (state_manager_keyframe_drop_oldest(state, state->tail))
       {
-         /* This will make it scan the entire thing again,
-          * but it only hits on 8GB unchanged data anyways,
-          * and if you're doing that, you've got bigger problems. */
-         if (skip > UINT32_MAX)
-            skip         = UINT32_MAX;
-
-         *compressed16++ = 0;
-         *compressed16++ = skip;
-         *compressed16++ = skip >> 16;
+         tailpos     = next - state->data;
+         used        = (headpos + state->capacity - tailpos)
+            % state->capacity;
+         state->tail = next;
          continue;
       }
 
-      changed         = find_same(old16, new16);
-      if (changed > UINT16_MAX)
-         changed = UINT16_MAX;
-
-      *compressed16++ = changed;
-      *compressed16++ = skip;
+      if (out + sizeof(size_t) + len
+            > state->tier_pending + state->tier_pending_capacity)
+         break;
 
-      for (i = 0; i < changed; i++)
-         compressed16[i] = old16[i];
+      write_size_t(out, len);
+      memcpy(out + sizeof(size_t), patch, len);
+      out        += sizeof(size_t) + len;
 
-      old16        += changed;
-      new16        += changed;
-      num16s       -= changed;
-      compressed16 += changed;
+      tailpos     = next - state->data;
+      used        = (headpos + state->capacity - tailpos) % state->capacity;
+      state->tail = next;
+      state->entries--;
+      state->tier_pending_entries++;
    }
 
-   compressed16[0]  = 0;
-   compressed16[1]  = 0;
-   compressed16[2]  = 0;
+   state->tier_pending_size = out - state->tier_pending;
+   if (state->tier_pending_size)
+      scond_signal(state->tier_cond);
 
-   return (uint8_t*)(compressed16 + 3) - (uint8_t*)patch;
+   slock_unlock(state->tier_lock);
 }
 
-/*
- * Takes 'patch' from a previous call to 'state_manager_raw_compress'
- * and applies it to 'data' ('src' from that call),
- * yielding 'dst' in that call.
- *
- * If the given arguments do not match a previous call to
- * state_manager_raw_compress(), anything at all can happen.
- */
-static void state_manager_raw_decompress(const void *patch,
-      size_t patchlen, void *data, size_t datalen)
+/* Waits for the tier thread to catch up, then detaches.
+ * Only needed if the ring fills up faster than the tier thread
+ * can deflate; returns false if nothing could be moved. */
+static bool state_manager_tier_flush(state_manager_t *state)
 {
-   uint16_t         *out16 = (uint16_t*)data;
-   const uint16_t *patch16 = (const uint16_t*)patch;
+   const uint8_t *tail = state->tail;
 
-   for (;;)
-   {
-      uint16_t numchanged  = *(patch16++);
+   if (!state->tier_thread)
+      return false;
 
-      if (numchanged)
-      {
-         uint16_t i;
+   slock_lock(state->tier_lock);
+   while (     state->tier_busy
+            || state->tier_pending_size
+            || state->tier_reset)
+      scond_wait(state->tier_cond, state->tier_lock);
+   slock_unlock(state->tier_lock);
 
-         out16       += *patch16++;
+   state_manager_tier_detach(state);
+   return state->tail != tail;
+}
 
-         /* We could do memcpy, but it seems that memcpy has a
-          * constant-per-call overhead that actually shows up.
-          *
-          * Our average size in here seems to be 8 or something.
-          * Therefore, we do something with lower overhead. */
-         for (i = 0; i < numchanged; i++)
-            out16[i]  = patch16[i];
+/* Moves the newest second tier chunk back into the (empty) ring.
+ * Returns false if there is nothing left to restore. */
+static bool state_manager_tier_restore(state_manager_t *state)
+{
+   uint32_t rd, wn;
+   const uint8_t *in                 = NULL;
+   const uint8_t *end                = NULL;
+   uint8_t *raw                      = NULL;
+   struct state_manager_chunk *chunk = NULL;
 
-         patch16     += numchanged;
-         out16       += numchanged;
-      }
+   if (!state->tier_thread)
+      return false;
+
+   slock_lock(state->tier_lock);
+   while (     state->tier_busy
+            || state->tier_pending_size
+            || state->tier_reset)
+      scond_wait(state->tier_cond, state->tier_lock);
+
+   chunk = state->tier_newest;
+   if (chunk)
+   {
+      state->tier_newest = chunk->older;
+      if (state->tier_newest)
+         state->tier_newest->newer = NULL;
       else
+         state->tier_oldest        = NULL;
+      state->tier_size            -= chunk->size;
+   }
+   slock_unlock(state->tier_lock);
+
+   if (!chunk)
+      return false;
+
+   if (chunk->deflated)
+   {
+      const struct trans_stream_backend *zlib =
+         trans_stream_get_zlib_inflate_backend();
+
+      if (     !state->tier_inflate
+            || !(raw = (uint8_t*)malloc(chunk->raw_size)))
       {
-         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+         free(chunk);
+         return false;
+      }
+
+      zlib->set_in(state->tier_inflate,
+            (const uint8_t*)(chunk + 1), (uint32_t)chunk->size);
+      zlib->set_out(state->tier_inflate, raw, (uint32_t)chunk->raw_size);
 
-         if (!numunchanged)
-            break;
-         patch16 += 2;
-         out16   += numunchanged;
+      if (!zlib->trans(state->tier_inflate, true, &rd, &wn, NULL)
+            || wn != chunk->raw_size)
+      {
+         zlib->stream_free(state->tier_inflate);
+         state->tier_inflate = zlib->stream_new();
+         free(raw);
+         free(chunk);
+         return false;
       }
+
+      in = raw;
    }
+   else
+      in = (const uint8_t*)(chunk + 1);
+
+   for (end = in + chunk->raw_size; in < end; )
+   {
+      size_t len          = read_size_t(in);
+      uint8_t *compressed = state_manager_ring_begin(state);
+
+      memcpy(compressed, in + sizeof(size_t), len);
+      state_manager_ring_commit(state, compressed + len);
+      state->entries++;
+      in += sizeof(size_t) + len;
+   }
+
+   free(raw);
+   free(chunk);
+   return true;
 }
 
-/* The start offsets point to 'nextstart' of any given compressed frame.
- * Each uint16 is stored native endian; anything that claims any other
- * endianness refers to the endianness of this specific item.
- * The uint32 is stored little endian.
- *
- * Each size value is stored native endian if alignment is not enforced;
- * if it is, they're little endian.
- *
- * The start of the buffer contains a size pointing to the end of the
- * buffer; the end points to its start.
- *
- * Wrapping is handled by returning to the start of the buffer if the
- * compressed data could potentially hit the edge;
- *
- * if the compressed data could potentially overwrite the tail pointer,
- * the tail retreats until it can no longer collide.
- *
- * This means that on average, ~2 * maxcompsize is
- * unused at any given moment. */
+/* The ring gets a quarter of the budget, the pending batch, the
+ * deflate scratch area and the chunks share the rest.
+ * Returns the size of the pending batch, or 0 if the budget is too
+ * small for the given state size to bother. */
+static size_t state_manager_tier_pending_size(size_t buffer_size,
+      size_t max_comp_size)
+{
+   size_t pending = buffer_size / 32;
 
-/* These are called very few constant times per frame,
- * keep it as simple as possible. */
-static INLINE void write_size_t(void *ptr, size_t val)
+   if (pending < max_comp_size + sizeof(size_t))
+      pending     = max_comp_size + sizeof(size_t);
+   if (pending * 2 > buffer_size / 4)
+      return 0;
+   return pending;
+}
+
+static bool state_manager_tier_start(state_manager_t *state,
+      unsigned tier_age, size_t buffer_size)
 {
-   memcpy(ptr, &val, sizeof(val));
+   state->tier_age              = tier_age;
+   state->tier_pending_capacity = state_manager_tier_pending_size(
+         buffer_size, state->maxcompsize);
+   state->tier_scratch_size     = state->tier_pending_capacity
+      + (state->tier_pending_capacity >> 10) + 64;
+   state->tier_capacity         = buffer_size - state->capacity
+      - state->tier_pending_capacity - state->tier_scratch_size;
+   state->tier_pending  = (uint8_t*)malloc(state->tier_pending_capacity);
+   state->tier_scratch  = (uint8_t*)malloc(state->tier_scratch_size);
+   state->tier_deflate  = state_manager_tier_deflate_new();
+   state->tier_inflate  = trans_stream_get_zlib_inflate_backend()->stream_new();
+   state->tier_lock     = slock_new();
+   state->tier_cond     = scond_new();
+
+   if (     !state->tier_pending
+         || !state->tier_scratch
+         || !state->tier_deflate
+         || !state->tier_inflate
+         || !state->tier_lock
+         || !state->tier_cond)
+      return false;
+
+   state->tier_alive    = true;
+   state->tier_thread   = sthread_create(state_manager_tier_thread, state);
+
+   return state->tier_thread != NULL;
 }
 
-static INLINE size_t read_size_t(const void *ptr)
+static void state_manager_tier_free(state_manager_t *state)
 {
-   size_t ret;
+   if (state->tier_thread)
+   {
+      slock_lock(state->tier_lock);
+      state->tier_alive = false;
+      scond_broadcast(state->tier_cond);
+      slock_unlock(state->tier_lock);
 
-   memcpy(&ret, ptr, sizeof(ret));
-   return ret;
+      sthread_join(state->tier_thread);
+      state->tier_thread = NULL;
+   }
+
+   state_manager_tier_clear(state);
+
+   if (state->tier_deflate)
+      trans_stream_get_zlib_deflate_backend()->stream_free(
+            state->tier_deflate);
+   if (state->tier_inflate)
+      trans_stream_get_zlib_inflate_backend()->stream_free(
+            state->tier_inflate);
+   if (state->tier_cond)
+      scond_free(state->tier_cond);
+   if (state->tier_lock)
+      slock_free(state->tier_lock);
+   if (state->tier_pending)
+      free(state->tier_pending);
+   if (state->tier_scratch)
+      free(state->tier_scratch);
+
+   state->tier_deflate = NULL;
+   state->tier_inflate = NULL;
+   state->tier_cond    = NULL;
+   state->tier_lock    = NULL;
+   state->tier_pending = NULL;
+   state->tier_scratch = NULL;
 }
+#endif
+
+#ifdef HAVE_THREADS
+static bool state_manager_push_compress(state_manager_t *state,
+      const uint8_t *newb);
+
+/* Waits until the worker has encoded every queued block.
+ * Must be called before touching the ring or 'thisblock'
+ * from the main thread. */
+static void state_manager_wait_idle(state_manager_t *state)
+{
+   if (!state->thread)
+      return;
+
+   slock_lock(state->lock);
+   while (state->queue_count || state->busy)
+      scond_wait(state->cond, state->lock);
+   slock_unlock(state->lock);
+}
+
+static void state_manager_thread(void *data)
+{
+   state_manager_t *state = (state_manager_t*)data;
+
+   slock_lock(state->lock);
+
+   for (;;)
+   {
+      uint8_t *block = NULL;
+      bool pushed    = false;
+
+      while (state->alive && !state->queue_count)
+         scond_wait(state->cond, state->lock);
+
+      if (!state->alive)
+         break;
+
+      block              = state->queue[state->queue_ptr];
+      state->queue_ptr   = (state->queue_ptr + 1)
+         % STATE_MANAGER_ASYNC_BLOCKS;
+      state->queue_count--;
+      state->busy        = true;
+      slock_unlock(state->lock);
+
+      pushed             = state_manager_push_compress(state, block);
+
+      slock_lock(state->lock);
+      if (pushed)
+      {
+         state->freeblocks[state->free_count++] = state->thisblock;
+         state->thisblock   = block;
+         state->entries++;
+         state->frame++;
+      }
+      else
+         state->freeblocks[state->free_count++] = block;
+      state->busy        = false;
+      scond_broadcast(state->cond);
+   }
+
+   slock_unlock(state->lock);
+}
+
+static void state_manager_stop_thread(state_manager_t *state)
+{
+   if (!state->thread)
+      return;
+
+   /* Pending blocks are simply dropped, we are
+    * tearing down the whole history anyway. */
+   slock_lock(state->lock);
+   state->alive = false;
+   scond_broadcast(state->cond);
+   slock_unlock(state->lock);
+
+   sthread_join(state->thread);
+   state->thread = NULL;
+
+   while (state->queue_count)
+   {
+      state->freeblocks[state->free_count++] =
+         state->queue[state->queue_ptr];
+      state->queue_ptr = (state->queue_ptr + 1)
+         % STATE_MANAGER_ASYNC_BLOCKS;
+      state->queue_count--;
+   }
+}
+#endif
 
 static void state_manager_free(state_manager_t *state)
 {
+#ifdef HAVE_THREADS
+   unsigned i;
+#endif
+
    if (!state)
       return;
 
+#ifdef HAVE_THREADS
+   state_manager_stop_thread(state);
+#endif
+
+#ifdef STATE_MANAGER_TIERS
+   state_manager_tier_free(state);
+#endif
+
+#ifdef HAVE_THREADS
+
+   for (i = 0; i < state->free_count; i++)
+      free(state->freeblocks[i]);
+   state->free_count = 0;
+
+   if (state->cond)
+      scond_free(state->cond);
+   if (state->lock)
+      slock_free(state->lock);
+   state->cond       = NULL;
+   state->lock       = NULL;
+#endif
+
+#ifdef STATE_MANAGER_MMAP
+   state_manager_map_close(state);
+#endif
+
    if (state->data)
       free(state->data);
    if (state->thisblock)
       free(state->thisblock);
    if (state->nextblock)
       free(state->nextblock);
+   if (state->zeroblock)
+      free(state->zeroblock);
+   if (state->keyframes)
+      free(state->keyframes);
 #if STRICT_BUF_SIZE
    if (state->debugblock)
       free(state->debugblock);
@@ -423,40 +1049,115 @@ static void state_manager_free(state_manager_t *state)
    state->data       = NULL;
    state->thisblock  = NULL;
    state->nextblock  = NULL;
+   state->zeroblock  = NULL;
+   state->keyframes  = NULL;
 }
 
+#ifdef HAVE_THREADS
+static bool state_manager_start_thread(state_manager_t *state,
+      size_t state_size)
+{
+   unsigned i;
+
+   /* 'nextblock' is handed out from the free list from now on,
+    * every block needs its own 'uniq' so that any two of them
+    * differ at the end marker. */
+   state->freeblocks[state->free_count++] = state->nextblock;
+   state->nextblock = NULL;
+
+   for (i = 1; i < STATE_MANAGER_ASYNC_BLOCKS; i++)
+   {
+      uint8_t *block = (uint8_t*)state_delta_alloc(
+            state_size, (uint16_t)(i + 1));
+      if (!block)
+         return false;
+      state->freeblocks[state->free_count++] = block;
+   }
+
+   state->lock   = slock_new();
+   state->cond   = scond_new();
+
+   if (!state->lock || !state->cond)
+      return false;
+
+   state->alive  = true;
+   state->thread = sthread_create(state_manager_thread, state);
+
+   return state->thread != NULL;
+}
+#endif
+
+/* If 'map_path' is set, the ring lives in a file mapped from there
+ * instead of the heap, see state_manager_map_open().
+ * A 'keyframe_interval' of 0 stores deltas only. */
 static state_manager_t *state_manager_new(
-      size_t state_size, size_t buffer_size)
+      size_t state_size, size_t buffer_size, bool threaded,
+      unsigned tier_age, const char *map_path,
+      unsigned keyframe_interval)
 {
    size_t max_comp_size, block_size;
+   bool next_block_owned  = false;
    uint8_t *next_block    = NULL;
    uint8_t *this_block    = NULL;
    uint8_t *state_data    = NULL;
    state_manager_t *state = (state_manager_t*)calloc(1, sizeof(*state));
+#ifdef STATE_MANAGER_TIERS
+   size_t full_size       = buffer_size;
+#endif
 
    if (!state)
       return NULL;
 
    block_size         = (state_size + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
    /* the compressed data is surrounded by pointers to the other side */
-   max_comp_size      = state_manager_raw_maxsize(state_size) + sizeof(size_t) * 2;
-   state_data         = (uint8_t*)malloc(buffer_size);
+   max_comp_size      = state_delta_maxsize(state_size) + sizeof(size_t) * 2;
+#ifdef STATE_MANAGER_TIERS
+   /* The second tier lives on the heap, which would defeat
+    * the point of a disk-backed ring. */
+   if (map_path)
+      tier_age        = 0;
+   if (tier_age && !state_manager_tier_pending_size(
+            buffer_size, max_comp_size))
+   {
+      RARCH_WARN("[Rewind]: Buffer too small for secondary compression.\n");
+      tier_age        = 0;
+   }
+   if (tier_age)
+      buffer_size    /= 4;
+#endif
+#ifdef STATE_MANAGER_MMAP
+   if (map_path)
+      state->data     = state_data = state_manager_map_open(state,
+            map_path, buffer_size);
+   else
+#endif
+      state_data      = (uint8_t*)malloc(buffer_size);
 
    if (!state_data)
       goto error;
 
-   this_block         = (uint8_t*)state_manager_raw_alloc(state_size, 0);
-   next_block         = (uint8_t*)state_manager_raw_alloc(state_size, 1);
+   this_block         = (uint8_t*)state_delta_alloc(state_size, 0);
+   next_block         = (uint8_t*)state_delta_alloc(state_size, 1);
 
    if (!this_block || !next_block)
       goto error;
 
+   if (keyframe_interval)
+   {
+      /* Comes back zeroed; only ever compared against */
+      state->zeroblock = (uint8_t*)state_delta_alloc(state_size, 0xffff);
+      if (!state->zeroblock)
+         goto error;
+      state->keyframe_interval = keyframe_interval;
+   }
+
    state->blocksize   = block_size;
    state->maxcompsize = max_comp_size;
    state->data        = state_data;
    state->thisblock   = this_block;
    state->nextblock   = next_block;
    state->capacity    = buffer_size;
+   state->kernel      = state_delta_kernel_get(cpu_features_get());
 
    state->head        = state->data + sizeof(size_t);
    state->tail        = state->data + sizeof(size_t);
@@ -466,11 +1167,32 @@ static state_manager_t *state_manager_new(
    state->debugblock  = (uint8_t*)malloc(state_size);
 #endif
 
+#ifdef HAVE_THREADS
+   if (threaded && !state_manager_start_thread(state, state_size))
+      goto error;
+#endif
+
+#ifdef STATE_MANAGER_TIERS
+   if (tier_age && !state_manager_tier_start(state, tier_age,
+            full_size))
+      goto error;
+#endif
+
    return state;
 
 error:
-   if (state_data)
+   /* Owned by the state manager once assigned */
+#ifdef HAVE_THREADS
+   next_block_owned = state->nextblock || state->free_count;
+#else
+   next_block_owned = state->nextblock != NULL;
+#endif
+   if (state_data && !state->data)
       free(state_data);
+   if (this_block && !state->thisblock)
+      free(this_block);
+   if (next_block && !next_block_owned)
+      free(next_block);
    state_manager_free(state);
    free(state);
 
@@ -485,6 +1207,10 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
 
    *data                        = NULL;
 
+#ifdef HAVE_THREADS
+   state_manager_wait_idle(state);
+#endif
+
    if (state->thisblock_valid)
    {
       state->thisblock_valid    = false;
@@ -494,21 +1220,97 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
    }
 
    *data                        = state->thisblock;
+
+nextentry:
    if (state->head == state->tail)
-      return false;
+   {
+#ifdef STATE_MANAGER_TIERS
+      if (!state_manager_tier_restore(state))
+#endif
+         return false;
+   }
 
    start                        = read_size_t(state->head - sizeof(size_t));
    state->head                  = state->data + start;
+
+   /* 'thisblock' already holds what a keyframe would give us */
+   if (state_manager_keyframe_drop_newest(state, state->head))
+      goto nextentry;
+
    compressed                   = state->data + start + sizeof(size_t);
    out                          = state->thisblock;
 
-   state_manager_raw_decompress(compressed,
+#ifdef STATE_MANAGER_MMAP
+   state_manager_map_advise(state, true);
+#endif
+
+   state_delta_decompress(compressed,
          state->maxcompsize, out, state->blocksize);
 
    state->entries--;
+   state->frame--;
    return true;
 }
 
+/* Same as popping 'frames' times in a row, except that it restores
+ * the oldest keyframe within reach first and only walks the deltas
+ * from there. Returns how many frames it actually went back. */
+static unsigned state_manager_pop_many(state_manager_t *state,
+      unsigned frames, const void **data)
+{
+   unsigned i;
+   unsigned best                                 = 0;
+   unsigned done                                 = 0;
+   const struct state_manager_keyframe *keyframe = NULL;
+
+   *data = NULL;
+
+   if (!frames || !state_manager_pop(state, data))
+      return 0;
+   done++;
+
+   for (i = state->keyframe_count; i-- > 0; )
+   {
+      const struct state_manager_keyframe *next =
+         STATE_MANAGER_KEYFRAME(state, i);
+
+      if (state->frame - next->frame > frames - done)
+         break;
+      if (state->frame != next->frame)
+      {
+         keyframe = next;
+         best     = i;
+      }
+   }
+
+   if (keyframe)
+   {
+      unsigned skipped = state->frame - keyframe->frame;
+
+      /* Everything newer than the keyframe goes, and so does
+       * the keyframe itself once it is in 'thisblock'. */
+      state->head      = state->data + keyframe->offset;
+      memset(state->thisblock, 0, state->blocksize);
+      state_delta_decompress(state->head + sizeof(size_t),
+            state->maxcompsize, state->thisblock, state->blocksize);
+
+      state->keyframe_count = best;
+      state->entries       -= skipped;
+      state->frame          = keyframe->frame;
+      done                 += skipped;
+
+#ifdef STATE_MANAGER_MMAP
+      state_manager_map_advise(state, true);
+#endif
+   }
+
+   while (done < frames && state_manager_pop(state, data))
+      done++;
+
+   *data = state->thisblock;
+   return done;
+}
+
 static void state_manager_push_where(state_manager_t *state, void **data)
 {
    /* We need to ensure we have an uncompressed copy of the last
@@ -525,12 +1327,62 @@ static void state_manager_push_where(state_manager_t *state, void **data)
       }
    }
 
+#ifdef HAVE_THREADS
+   if (state->thread && !state->nextblock)
+   {
+      /* Only blocks if the worker has fallen
+       * STATE_MANAGER_ASYNC_BLOCKS frames behind. */
+      slock_lock(state->lock);
+      while (!state->free_count)
+         scond_wait(state->cond, state->lock);
+      state->nextblock = state->freeblocks[--state->free_count];
+      slock_unlock(state->lock);
+   }
+#endif
+
    *data = state->nextblock;
 #if STRICT_BUF_SIZE
    *data = state->debugblock;
 #endif
 }
 
+/* Encodes the delta between 'thisblock' and 'newb' into the ring.
+ * Returns false if the ring cannot hold even one compressed state. */
+static bool state_manager_push_compress(state_manager_t *state,
+      const uint8_t *newb)
+{
+   uint8_t *compressed;
+   if (state->capacity < sizeof(size_t) + state->maxcompsize)
+      return false;
+
+   compressed        = state_manager_ring_begin(state);
+   compressed       += state_delta_compress(state->kernel,
+         state->thisblock, newb, state->blocksize, compressed);
+   state_manager_ring_commit(state, compressed);
+
+   if (     state->keyframe_interval
+         && !((state->frame + 1) % state->keyframe_interval))
+   {
+      size_t offset;
+
+      compressed     = state_manager_ring_begin(state);
+      offset         = state->head - state->data;
+      compressed    += state_delta_compress(state->kernel,
+            newb, state->zeroblock, state->blocksize, compressed);
+      state_manager_ring_commit(state, compressed);
+
+      /* Without an index entry, it would be mistaken for a delta */
+      if (!state_manager_keyframe_add(state, offset, state->frame + 1))
+         state->head = state->data + offset;
+   }
+
+#ifdef STATE_MANAGER_TIERS
+   state_manager_tier_detach(state);
+#endif
+
+   return true;
+}
+
 static void state_manager_push_do(state_manager_t *state)
 {
    uint8_t *swap = NULL;
@@ -539,44 +1391,37 @@ static void state_manager_push_do(state_manager_t *state)
    memcpy(state->nextblock, state->debugblock, state->debugsize);
 #endif
 
-   if (state->thisblock_valid)
+#ifdef HAVE_THREADS
+   if (state->thread)
    {
-      const uint8_t *oldb, *newb;
-      uint8_t *compressed;
-      size_t headpos, tailpos, remaining;
-      if (state->capacity < sizeof(size_t) + state->maxcompsize)
-         return;
-
-recheckcapacity:;
-      headpos   = state->head - state->data;
-      tailpos   = state->tail - state->data;
-      remaining = (tailpos + state->capacity -
-            sizeof(size_t) - headpos - 1) % state->capacity + 1;
-
-      if (remaining <= state->maxcompsize)
+      slock_lock(state->lock);
+      if (state->thisblock_valid)
       {
-         state->tail = state->data + read_size_t(state->tail);
-         state->entries--;
-         goto recheckcapacity;
+         state->queue[(state->queue_ptr + state->queue_count)
+            % STATE_MANAGER_ASYNC_BLOCKS] = state->nextblock;
+         state->queue_count++;
       }
-
-      oldb              = state->thisblock;
-      newb              = state->nextblock;
-      compressed        = state->head + sizeof(size_t);
-
-      compressed       += state_manager_raw_compress(oldb, newb,
-            state->blocksize, compressed);
-
-      if (compressed - state->data + state->maxcompsize > state->capacity)
+      else
       {
-         compressed     = state->data;
-         if (state->tail == state->data + sizeof(size_t))
-            state->tail = state->data + read_size_t(state->tail);
+         /* Nothing to encode against yet; the worker is idle
+          * since the last pop, so take the block over here. */
+         state->freeblocks[state->free_count++] = state->thisblock;
+         state->thisblock       = state->nextblock;
+         state->thisblock_valid = true;
+         state->entries++;
+         state->frame++;
       }
-      write_size_t(compressed, state->head-state->data);
-      compressed       += sizeof(size_t);
-      write_size_t(state->head, compressed-state->data);
-      state->head       = compressed;
+      state->nextblock = NULL;
+      scond_broadcast(state->cond);
+      slock_unlock(state->lock);
+      return;
+   }
+#endif
+
+   if (state->thisblock_valid)
+   {
+      if (!state_manager_push_compress(state, state->nextblock))
+         return;
    }
    else
       state->thisblock_valid = true;
@@ -586,6 +1431,7 @@ recheckcapacity:;
    state->nextblock          = swap;
 
    state->entries++;
+   state->frame++;
 }
 
 #if 0
@@ -606,7 +1452,10 @@ static void state_manager_capacity(state_manager_t *state,
 }
 #endif
 
-void state_manager_event_init(unsigned rewind_buffer_size)
+void state_manager_event_init(unsigned rewind_buffer_size,
+      bool rewind_threaded, unsigned rewind_tier_age,
+      const char *rewind_disk_path, size_t rewind_disk_buffer_size,
+      unsigned rewind_keyframe_interval)
 {
    retro_ctx_serialize_info_t serial_info;
    retro_ctx_size_info_t info;
@@ -632,15 +1481,43 @@ void state_manager_event_init(unsigned rewind_buffer_size)
       return;
    }
 
-   RARCH_LOG("%s: %u MB\n",
-         msg_hash_to_str(MSG_REWIND_INIT),
-         (unsigned)(rewind_buffer_size / 1000000));
+#ifdef STATE_MANAGER_MMAP
+   if (!string_is_empty(rewind_disk_path) && rewind_disk_buffer_size)
+   {
+      RARCH_LOG("%s: %u MB (%s)\n",
+            msg_hash_to_str(MSG_REWIND_INIT),
+            (unsigned)(rewind_disk_buffer_size / 1000000),
+            rewind_disk_path);
+
+      rewind_state.state = state_manager_new(rewind_state.size,
+            rewind_disk_buffer_size, rewind_threaded, 0,
+            rewind_disk_path, rewind_keyframe_interval);
+
+      if (!rewind_state.state)
+         RARCH_WARN("[Rewind]: Could not map disk buffer, "
+               "falling back to memory.\n");
+   }
+
+   if (!rewind_state.state)
+#endif
+   {
+      RARCH_LOG("%s: %u MB\n",
+            msg_hash_to_str(MSG_REWIND_INIT),
+            (unsigned)(rewind_buffer_size / 1000000));
 
-   rewind_state.state = state_manager_new(rewind_state.size,
-         rewind_buffer_size);
+      rewind_state.state = state_manager_new(rewind_state.size,
+            rewind_buffer_size, rewind_threaded, rewind_tier_age, NULL,
+            rewind_keyframe_interval);
+   }
 
    if (!rewind_state.state)
+   {
       RARCH_WARN("%s.\n", msg_hash_to_str(MSG_REWIND_INIT_FAILED));
+      return;
+   }
+
+   RARCH_LOG("[Rewind]: Using %s delta kernel.\n",
+         rewind_state.state->kernel->ident);
 
    state_manager_push_where(rewind_state.state, &state);
 
@@ -668,6 +1545,49 @@ void state_manager_event_deinit(void)
    rewind_state.size  = 0;
 }
 
+/**
+ * state_manager_seek:
+ * @frames               : How many rewind steps to go back.
+ *
+ * Jumps back @frames steps of rewind history at once, loading
+ * only the final state into the core. Keyframes, if enabled,
+ * make this independent of the distance.
+ *
+ * Returns: the number of steps actually gone back, which is
+ * less than @frames if the history does not reach that far.
+ **/
+unsigned state_manager_seek(unsigned frames)
+{
+   retro_ctx_serialize_info_t serial_info;
+   const void *buf = NULL;
+   unsigned done   = 0;
+
+   if (!rewind_state.state || !frames)
+      return 0;
+
+   /* The movie would have to be rewound frame by frame */
+   if (rarch_ctl(RARCH_CTL_BSV_MOVIE_IS_INITED, NULL))
+      return 0;
+
+   done = state_manager_pop_many(rewind_state.state, frames, &buf);
+   if (!done)
+      return 0;
+
+#ifdef HAVE_NETWORKING
+   netplay_driver_ctl(RARCH_NETPLAY_CTL_DESYNC_PUSH, NULL);
+#endif
+
+   serial_info.data_const = buf;
+   serial_info.size       = rewind_state.size;
+   core_unserialize(&serial_info);
+
+#ifdef HAVE_NETWORKING
+   netplay_driver_ctl(RARCH_NETPLAY_CTL_DESYNC_POP, NULL);
+#endif
+
+   return done;
+}
+
 /**
  * check_rewind:
  * @pressed              : was rewind key pressed or held?
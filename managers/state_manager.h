@@ -32,7 +32,20 @@ bool state_manager_frame_is_reversed(void);
 
 void state_manager_event_deinit(void);
 
-void state_manager_event_init(unsigned rewind_buffer_size);
+void state_manager_event_init(unsigned rewind_buffer_size,
+      bool rewind_threaded, unsigned rewind_tier_age,
+      const char *rewind_disk_path, size_t rewind_disk_buffer_size,
+      unsigned rewind_keyframe_interval);
+
+/**
+ * state_manager_seek:
+ * @frames               : How many rewind steps to go back.
+ *
+ * Jumps back @frames steps of rewind history at once.
+ *
+ * Returns: the number of steps actually gone back.
+ **/
+unsigned state_manager_seek(unsigned frames);
 
 /**
  * check_rewind:
@@ -158,6 +158,7 @@ GENERIC_DEFERRED_PUSH(deferred_push_content_history_path,           DISPLAYLIST_
 GENERIC_DEFERRED_PUSH(deferred_push_disc_information,               DISPLAYLIST_DISC_INFO)
 GENERIC_DEFERRED_PUSH(deferred_push_system_information,             DISPLAYLIST_SYSTEM_INFO)
 GENERIC_DEFERRED_PUSH(deferred_push_network_information,            DISPLAYLIST_NETWORK_INFO)
+GENERIC_DEFERRED_PUSH(deferred_push_task_statistics,                 DISPLAYLIST_TASK_STATS)
 GENERIC_DEFERRED_PUSH(deferred_push_achievement_list,               DISPLAYLIST_ACHIEVEMENT_LIST)
 GENERIC_DEFERRED_PUSH(deferred_push_rdb_collection,                 DISPLAYLIST_PLAYLIST_COLLECTION)
 GENERIC_DEFERRED_PUSH(deferred_main_menu_list,                      DISPLAYLIST_MAIN_MENU)
@@ -770,6 +771,7 @@ static int menu_cbs_init_bind_deferred_push_compare_label(
       {MENU_ENUM_LABEL_LOAD_CONTENT_HISTORY, deferred_push_history_list},
       {MENU_ENUM_LABEL_CORE_OPTIONS, deferred_push_core_options},
       {MENU_ENUM_LABEL_NETWORK_INFORMATION, deferred_push_network_information},
+      {MENU_ENUM_LABEL_TASK_STATISTICS, deferred_push_task_statistics},
       {MENU_ENUM_LABEL_ONLINE_UPDATER, deferred_push_options},
       {MENU_ENUM_LABEL_HELP_LIST, deferred_push_help},
       {MENU_ENUM_LABEL_INFORMATION_LIST, deferred_push_information_list},
@@ -1095,6 +1097,9 @@ static int menu_cbs_init_bind_deferred_push_compare_label(
          case MENU_ENUM_LABEL_NETWORK_INFORMATION:
             BIND_ACTION_DEFERRED_PUSH(cbs, deferred_push_network_information);
             break;
+         case MENU_ENUM_LABEL_TASK_STATISTICS:
+            BIND_ACTION_DEFERRED_PUSH(cbs, deferred_push_task_statistics);
+            break;
          case MENU_ENUM_LABEL_ACHIEVEMENT_LIST:
             BIND_ACTION_DEFERRED_PUSH(cbs, deferred_push_achievement_list);
             break;
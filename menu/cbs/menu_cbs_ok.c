@@ -4009,6 +4009,40 @@ static int action_ok_undo_save_state(const char *path,
    return generic_action_ok_command(CMD_EVENT_RESUME);
 }
 
+#ifdef HAVE_REWIND
+static int generic_action_ok_rewind_seek(unsigned seconds)
+{
+   settings_t *settings = config_get_ptr();
+   bool resume          = settings->bools.menu_savestate_resume;
+
+   if (!command_event(CMD_EVENT_REWIND_SEEK, &seconds))
+      return menu_cbs_exit();
+
+   if (resume)
+      return generic_action_ok_command(CMD_EVENT_RESUME);
+
+   return 0;
+}
+
+static int action_ok_rewind_seek_10(const char *path,
+      const char *label, unsigned type, size_t idx, size_t entry_idx)
+{
+   return generic_action_ok_rewind_seek(10);
+}
+
+static int action_ok_rewind_seek_30(const char *path,
+      const char *label, unsigned type, size_t idx, size_t entry_idx)
+{
+   return generic_action_ok_rewind_seek(30);
+}
+
+static int action_ok_rewind_seek_60(const char *path,
+      const char *label, unsigned type, size_t idx, size_t entry_idx)
+{
+   return generic_action_ok_rewind_seek(60);
+}
+#endif
+
 #ifdef HAVE_NETWORKING
 
 #ifdef HAVE_ZLIB
@@ -7265,6 +7299,11 @@ static int menu_cbs_init_bind_ok_compare_label(menu_file_list_cbs_t *cbs,
          {MENU_ENUM_LABEL_LOAD_STATE,                          action_ok_load_state},
          {MENU_ENUM_LABEL_UNDO_LOAD_STATE,                     action_ok_undo_load_state},
          {MENU_ENUM_LABEL_UNDO_SAVE_STATE,                     action_ok_undo_save_state},
+#ifdef HAVE_REWIND
+         {MENU_ENUM_LABEL_REWIND_SEEK_10,                      action_ok_rewind_seek_10},
+         {MENU_ENUM_LABEL_REWIND_SEEK_30,                      action_ok_rewind_seek_30},
+         {MENU_ENUM_LABEL_REWIND_SEEK_60,                      action_ok_rewind_seek_60},
+#endif
          {MENU_ENUM_LABEL_RESUME_CONTENT,                      action_ok_resume_content},
          {MENU_ENUM_LABEL_ADD_TO_FAVORITES_PLAYLIST,           action_ok_add_to_favorites_playlist},
          {MENU_ENUM_LABEL_SET_CORE_ASSOCIATION,                action_ok_set_core_association},
@@ -7369,6 +7408,7 @@ static int menu_cbs_init_bind_ok_compare_label(menu_file_list_cbs_t *cbs,
          {MENU_ENUM_LABEL_DISC_INFORMATION,                    action_ok_push_default},
          {MENU_ENUM_LABEL_SYSTEM_INFORMATION,                  action_ok_push_default},
          {MENU_ENUM_LABEL_NETWORK_INFORMATION,                 action_ok_push_default},
+         {MENU_ENUM_LABEL_TASK_STATISTICS,                     action_ok_push_default},
          {MENU_ENUM_LABEL_ACHIEVEMENT_LIST,                    action_ok_push_default},
          {MENU_ENUM_LABEL_ACHIEVEMENT_LIST_HARDCORE,           action_ok_push_default},
          {MENU_ENUM_LABEL_DISK_OPTIONS,                        action_ok_push_default},
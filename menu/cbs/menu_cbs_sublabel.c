@@ -269,6 +269,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_meta_ui_companion_toggle,   ME
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_meta_recording_toggle,      MENU_ENUM_SUBLABEL_INPUT_META_RECORDING_TOGGLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_meta_streaming_toggle,      MENU_ENUM_SUBLABEL_INPUT_META_STREAMING_TOGGLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_meta_ai_service,            MENU_ENUM_SUBLABEL_INPUT_META_AI_SERVICE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_meta_rewind_seek,           MENU_ENUM_SUBLABEL_INPUT_META_REWIND_SEEK)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_meta_menu_toggle,           MENU_ENUM_SUBLABEL_INPUT_META_MENU_TOGGLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_hotkey_block_delay,         MENU_ENUM_SUBLABEL_INPUT_HOTKEY_BLOCK_DELAY)
 #ifdef HAVE_MATERIALUI
@@ -303,6 +304,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_configurations_list_list,      MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_video_shared_context,          MENU_ENUM_SUBLABEL_VIDEO_SHARED_CONTEXT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_driver_switch_enable,          MENU_ENUM_SUBLABEL_DRIVER_SWITCH_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_audio_latency,                 MENU_ENUM_SUBLABEL_AUDIO_LATENCY)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_audio_process_thread,          MENU_ENUM_SUBLABEL_AUDIO_PROCESS_THREAD)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_audio_rate_control_delta,      MENU_ENUM_SUBLABEL_AUDIO_RATE_CONTROL_DELTA)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_audio_mute,                    MENU_ENUM_SUBLABEL_AUDIO_MUTE)
 #ifdef HAVE_AUDIOMIXER
@@ -378,6 +380,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_content_list,                  MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_content_special,               MENU_ENUM_SUBLABEL_LOAD_CONTENT_SPECIAL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_load_content_history,          MENU_ENUM_SUBLABEL_LOAD_CONTENT_HISTORY)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_network_information,           MENU_ENUM_SUBLABEL_NETWORK_INFORMATION)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_task_statistics,               MENU_ENUM_SUBLABEL_TASK_STATISTICS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_system_information,            MENU_ENUM_SUBLABEL_SYSTEM_INFORMATION)
 #ifdef HAVE_LAKKA
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_quit_retroarch,                MENU_ENUM_SUBLABEL_RESTART_RETROARCH)
@@ -433,6 +436,9 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_vrr_runloop_enable,            MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_slowmotion_ratio,              MENU_ENUM_SUBLABEL_SLOWMOTION_RATIO)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_enabled,             MENU_ENUM_SUBLABEL_RUN_AHEAD_ENABLED)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_secondary_instance,  MENU_ENUM_SUBLABEL_RUN_AHEAD_SECONDARY_INSTANCE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_secondary_thread,    MENU_ENUM_SUBLABEL_RUN_AHEAD_SECONDARY_THREAD)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_preemptive,          MENU_ENUM_SUBLABEL_RUN_AHEAD_PREEMPTIVE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_auto,                MENU_ENUM_SUBLABEL_RUN_AHEAD_AUTO)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_hide_warnings,       MENU_ENUM_SUBLABEL_RUN_AHEAD_HIDE_WARNINGS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_run_ahead_frames,              MENU_ENUM_SUBLABEL_RUN_AHEAD_FRAMES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_block_timeout,           MENU_ENUM_SUBLABEL_INPUT_BLOCK_TIMEOUT)
@@ -478,6 +484,11 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_cheat_file_save_as,
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_granularity,            MENU_ENUM_SUBLABEL_REWIND_GRANULARITY)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_buffer_size,            MENU_ENUM_SUBLABEL_REWIND_BUFFER_SIZE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_buffer_size_step,       MENU_ENUM_SUBLABEL_REWIND_BUFFER_SIZE_STEP)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_threaded,               MENU_ENUM_SUBLABEL_REWIND_THREADED)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_tier_age,               MENU_ENUM_SUBLABEL_REWIND_TIER_AGE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_disk_buffer_size,       MENU_ENUM_SUBLABEL_REWIND_DISK_BUFFER_SIZE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_keyframe_interval,      MENU_ENUM_SUBLABEL_REWIND_KEYFRAME_INTERVAL)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_seek_seconds,           MENU_ENUM_SUBLABEL_REWIND_SEEK_SECONDS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_libretro_log_level,            MENU_ENUM_SUBLABEL_LIBRETRO_LOG_LEVEL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_frontend_log_level,            MENU_ENUM_SUBLABEL_FRONTEND_LOG_LEVEL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_perfcnt_enable,                MENU_ENUM_SUBLABEL_PERFCNT_ENABLE)
@@ -545,6 +556,8 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_require_slaves,        MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_stateless_mode,        MENU_ENUM_SUBLABEL_NETPLAY_STATELESS_MODE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_check_frames,          MENU_ENUM_SUBLABEL_NETPLAY_CHECK_FRAMES)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_nat_traversal,         MENU_ENUM_SUBLABEL_NETPLAY_NAT_TRAVERSAL)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_udp_input,             MENU_ENUM_SUBLABEL_NETPLAY_UDP_INPUT)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_spectator_relay,       MENU_ENUM_SUBLABEL_NETPLAY_SPECTATOR_RELAY)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_stdin_cmd_enable,              MENU_ENUM_SUBLABEL_STDIN_CMD_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_mouse_enable,                  MENU_ENUM_SUBLABEL_MOUSE_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_pointer_enable,                MENU_ENUM_SUBLABEL_POINTER_ENABLE)
@@ -622,6 +635,9 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_save_state,
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_resume_content,                        MENU_ENUM_SUBLABEL_RESUME_CONTENT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_state_slot,                            MENU_ENUM_SUBLABEL_STATE_SLOT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_undo_load_state,                       MENU_ENUM_SUBLABEL_UNDO_LOAD_STATE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_seek_10,                        MENU_ENUM_SUBLABEL_REWIND_SEEK_10)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_seek_30,                        MENU_ENUM_SUBLABEL_REWIND_SEEK_30)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_rewind_seek_60,                        MENU_ENUM_SUBLABEL_REWIND_SEEK_60)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_undo_save_state,                       MENU_ENUM_SUBLABEL_UNDO_SAVE_STATE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_accounts_retro_achievements,           MENU_ENUM_SUBLABEL_ACCOUNTS_RETRO_ACHIEVEMENTS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_accounts_list,                         MENU_ENUM_SUBLABEL_ACCOUNTS_LIST)
@@ -636,6 +652,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_input_remapping_options,
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_core_options,                          MENU_ENUM_SUBLABEL_CORE_OPTIONS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_show_advanced_settings,                MENU_ENUM_SUBLABEL_SHOW_ADVANCED_SETTINGS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_threaded_data_runloop_enable,          MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_ENABLE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_threaded_data_runloop_workers,         MENU_ENUM_SUBLABEL_THREADED_DATA_RUNLOOP_WORKERS)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_entry_rename,                 MENU_ENUM_SUBLABEL_PLAYLIST_ENTRY_RENAME)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_playlist_entry_remove,                 MENU_ENUM_SUBLABEL_PLAYLIST_ENTRY_REMOVE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_system_directory,                      MENU_ENUM_SUBLABEL_SYSTEM_DIRECTORY)
@@ -1688,6 +1705,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
             case RARCH_AI_SERVICE:
                BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_meta_ai_service);
                return 0;
+            case RARCH_REWIND_SEEK:
+               BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_meta_rewind_seek);
+               return 0;
             default:
                break;
          }
@@ -2408,6 +2428,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_ENABLE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_threaded_data_runloop_enable);
             break;
+         case MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_WORKERS:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_threaded_data_runloop_workers);
+            break;
          case MENU_ENUM_LABEL_SHOW_ADVANCED_SETTINGS:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_show_advanced_settings);
             break;
@@ -2465,6 +2488,15 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_UNDO_LOAD_STATE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_undo_load_state);
             break;
+         case MENU_ENUM_LABEL_REWIND_SEEK_10:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_seek_10);
+            break;
+         case MENU_ENUM_LABEL_REWIND_SEEK_30:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_seek_30);
+            break;
+         case MENU_ENUM_LABEL_REWIND_SEEK_60:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_seek_60);
+            break;
          case MENU_ENUM_LABEL_STATE_SLOT:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_state_slot);
             break;
@@ -2675,6 +2707,12 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_nat_traversal);
             break;
+         case MENU_ENUM_LABEL_NETPLAY_UDP_INPUT:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_udp_input);
+            break;
+         case MENU_ENUM_LABEL_NETPLAY_SPECTATOR_RELAY:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_spectator_relay);
+            break;
          case MENU_ENUM_LABEL_NETPLAY_CHECK_FRAMES:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_check_frames);
             break;
@@ -2883,6 +2921,21 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_REWIND_BUFFER_SIZE_STEP:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_buffer_size_step);
             break;
+         case MENU_ENUM_LABEL_REWIND_THREADED:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_threaded);
+            break;
+         case MENU_ENUM_LABEL_REWIND_TIER_AGE:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_tier_age);
+            break;
+         case MENU_ENUM_LABEL_REWIND_DISK_BUFFER_SIZE:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_disk_buffer_size);
+            break;
+         case MENU_ENUM_LABEL_REWIND_KEYFRAME_INTERVAL:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_keyframe_interval);
+            break;
+         case MENU_ENUM_LABEL_REWIND_SEEK_SECONDS:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_rewind_seek_seconds);
+            break;
          case MENU_ENUM_LABEL_CHEAT_IDX:
 #ifdef HAVE_CHEATS
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_cheat_idx);
@@ -3012,6 +3065,15 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_INSTANCE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_run_ahead_secondary_instance);
             break;
+         case MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_run_ahead_secondary_thread);
+            break;
+         case MENU_ENUM_LABEL_RUN_AHEAD_PREEMPTIVE:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_run_ahead_preemptive);
+            break;
+         case MENU_ENUM_LABEL_RUN_AHEAD_AUTO:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_run_ahead_auto);
+            break;
          case MENU_ENUM_LABEL_RUN_AHEAD_HIDE_WARNINGS:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_run_ahead_hide_warnings);
             break;
@@ -3155,6 +3217,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_NETWORK_INFORMATION:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_network_information);
             break;
+         case MENU_ENUM_LABEL_TASK_STATISTICS:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_task_statistics);
+            break;
          case MENU_ENUM_LABEL_SYSTEM_INFORMATION:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_system_information);
             break;
@@ -3327,6 +3392,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_AUDIO_LATENCY:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_audio_latency);
             break;
+         case MENU_ENUM_LABEL_AUDIO_PROCESS_THREAD:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_audio_process_thread);
+            break;
          case MENU_ENUM_LABEL_DRIVER_SWITCH_ENABLE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_driver_switch_enable);
             break;
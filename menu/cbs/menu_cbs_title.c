@@ -593,6 +593,7 @@ DEFAULT_TITLE_MACRO(action_get_database_manager_list,           MENU_ENUM_LABEL_
 DEFAULT_TITLE_MACRO(action_get_system_information_list,         MENU_ENUM_LABEL_VALUE_SYSTEM_INFORMATION)
 DEFAULT_TITLE_MACRO(action_get_disc_information_list,        MENU_ENUM_LABEL_VALUE_DISC_INFORMATION)
 DEFAULT_TITLE_MACRO(action_get_network_information_list,        MENU_ENUM_LABEL_VALUE_NETWORK_INFORMATION)
+DEFAULT_TITLE_MACRO(action_get_task_statistics_list,            MENU_ENUM_LABEL_VALUE_TASK_STATISTICS)
 DEFAULT_TITLE_MACRO(action_get_settings_list,                   MENU_ENUM_LABEL_VALUE_SETTINGS)
 DEFAULT_TITLE_MACRO(action_get_title_information_list,          MENU_ENUM_LABEL_VALUE_INFORMATION_LIST)
 DEFAULT_TITLE_MACRO(action_get_title_information,               MENU_ENUM_LABEL_VALUE_INFORMATION)
@@ -912,6 +913,7 @@ static int menu_cbs_init_bind_title_compare_label(menu_file_list_cbs_t *cbs,
       {MENU_ENUM_LABEL_SYSTEM_INFORMATION,                            action_get_system_information_list},
       {MENU_ENUM_LABEL_DISC_INFORMATION,                              action_get_disc_information_list},
       {MENU_ENUM_LABEL_NETWORK_INFORMATION,                           action_get_network_information_list},
+      {MENU_ENUM_LABEL_TASK_STATISTICS,                               action_get_task_statistics_list},
       {MENU_ENUM_LABEL_DEFERRED_QUICK_MENU_OVERRIDE_OPTIONS,          action_get_quick_menu_override_options},
       {MENU_ENUM_LABEL_DEFERRED_CRT_SWITCHRES_SETTINGS_LIST,          action_get_crt_switchres_settings_list},
       {MENU_ENUM_LABEL_DEFERRED_ACCOUNTS_TWITCH_LIST,                 action_get_user_accounts_twitch_list},
@@ -27,6 +27,7 @@
 #include <file/archive_file.h>
 #include <playlists/label_sanitization.h>
 #include <string/stdstring.h>
+#include <queues/task_queue.h>
 #include <streams/file_stream.h>
 #include <features/features_cpu.h>
 
@@ -2553,6 +2554,37 @@ static int menu_displaylist_parse_load_content_settings(
             count++;
       }
 
+#ifdef HAVE_REWIND
+      if (settings->bools.rewind_enable)
+      {
+#ifdef HAVE_CHEEVOS
+         if (!rcheevos_hardcore_active())
+#endif
+         {
+            if (menu_entries_append_enum(list,
+                  msg_hash_to_str(MENU_ENUM_LABEL_VALUE_REWIND_SEEK_10),
+                  msg_hash_to_str(MENU_ENUM_LABEL_REWIND_SEEK_10),
+                  MENU_ENUM_LABEL_REWIND_SEEK_10,
+                  MENU_SETTING_ACTION_LOADSTATE, 0, 0))
+               count++;
+
+            if (menu_entries_append_enum(list,
+                  msg_hash_to_str(MENU_ENUM_LABEL_VALUE_REWIND_SEEK_30),
+                  msg_hash_to_str(MENU_ENUM_LABEL_REWIND_SEEK_30),
+                  MENU_ENUM_LABEL_REWIND_SEEK_30,
+                  MENU_SETTING_ACTION_LOADSTATE, 0, 0))
+               count++;
+
+            if (menu_entries_append_enum(list,
+                  msg_hash_to_str(MENU_ENUM_LABEL_VALUE_REWIND_SEEK_60),
+                  msg_hash_to_str(MENU_ENUM_LABEL_REWIND_SEEK_60),
+                  MENU_ENUM_LABEL_REWIND_SEEK_60,
+                  MENU_SETTING_ACTION_LOADSTATE, 0, 0))
+               count++;
+         }
+      }
+#endif
+
       if (
             settings->bools.quick_menu_show_add_to_favorites &&
             settings->bools.menu_content_show_favorites
@@ -3050,6 +3082,13 @@ static unsigned menu_displaylist_parse_information_list(file_list_t *info_list)
             MENU_ENUM_LABEL_CORE_COUNTERS,
             MENU_SETTING_ACTION, 0, 0))
          count++;
+
+      if (menu_entries_append_enum(info_list,
+            msg_hash_to_str(MENU_ENUM_LABEL_VALUE_TASK_STATISTICS),
+            msg_hash_to_str(MENU_ENUM_LABEL_TASK_STATISTICS),
+            MENU_ENUM_LABEL_TASK_STATISTICS,
+            MENU_SETTING_ACTION, 0, 0))
+         count++;
    }
 
    return count;
@@ -5541,6 +5580,10 @@ unsigned menu_displaylist_build_list(
                   MENU_ENUM_LABEL_AUDIO_LATENCY,
                   PARSE_ONLY_UINT, false) == 0)
             count++;
+         if (MENU_DISPLAYLIST_PARSE_SETTINGS_ENUM(list,
+                  MENU_ENUM_LABEL_AUDIO_PROCESS_THREAD,
+                  PARSE_ONLY_BOOL, false) == 0)
+            count++;
          if (MENU_DISPLAYLIST_PARSE_SETTINGS_ENUM(list,
                   MENU_ENUM_LABEL_AUDIO_WASAPI_EXCLUSIVE_MODE,
                   PARSE_ONLY_BOOL, false) == 0)
@@ -6177,6 +6220,67 @@ unsigned menu_displaylist_build_list(
          }
 #endif
          break;
+      case DISPLAYLIST_TASK_STATS:
+         {
+            size_t i;
+            const task_queue_stats_t *stats = NULL;
+            size_t stats_count              = task_queue_get_stats(&stats);
+
+            for (i = 0; i < stats_count; i++)
+            {
+               char tmp[255];
+               const task_queue_stats_t *t = &stats[i];
+               uint64_t n                  = t->count;
+
+               tmp[0] = '\0';
+
+               snprintf(tmp, sizeof(tmp), "%s: %u",
+                     string_is_empty(t->name) ? "-" : t->name,
+                     (unsigned)n);
+               if (menu_entries_append_enum(list, tmp, "",
+                        MENU_ENUM_LABEL_TASK_STATS_ENTRY,
+                        MENU_SETTINGS_CORE_INFO_NONE, 0, 0))
+                  count++;
+
+               /* avg / 95th percentile / max, in milliseconds */
+               snprintf(tmp, sizeof(tmp),
+                     "  %s: %.1f / %.1f / %.1f ms",
+                     msg_hash_to_str(MSG_TASK_STATS_WAIT),
+                     t->wait_total / (double)n / 1000.0,
+                     task_queue_stats_percentile(
+                        t->wait_hist, n, t->wait_max, 95) / 1000.0,
+                     t->wait_max / 1000.0);
+               if (menu_entries_append_enum(list, tmp, "",
+                        MENU_ENUM_LABEL_TASK_STATS_ENTRY,
+                        MENU_SETTINGS_CORE_INFO_NONE, 0, 0))
+                  count++;
+
+               snprintf(tmp, sizeof(tmp),
+                     "  %s: %.1f / %.1f / %.1f ms",
+                     msg_hash_to_str(MSG_TASK_STATS_RUN),
+                     t->run_total / (double)n / 1000.0,
+                     task_queue_stats_percentile(
+                        t->run_hist, n, t->run_max, 95) / 1000.0,
+                     t->run_max / 1000.0);
+               if (menu_entries_append_enum(list, tmp, "",
+                        MENU_ENUM_LABEL_TASK_STATS_ENTRY,
+                        MENU_SETTINGS_CORE_INFO_NONE, 0, 0))
+                  count++;
+
+               snprintf(tmp, sizeof(tmp),
+                     "  %s: %u / %u / %u",
+                     msg_hash_to_str(MSG_TASK_STATS_ITERATIONS),
+                     (unsigned)(t->iterations_total / n),
+                     (unsigned)task_queue_stats_percentile(
+                        t->iterations_hist, n, t->iterations_max, 95),
+                     (unsigned)t->iterations_max);
+               if (menu_entries_append_enum(list, tmp, "",
+                        MENU_ENUM_LABEL_TASK_STATS_ENTRY,
+                        MENU_SETTINGS_CORE_INFO_NONE, 0, 0))
+                  count++;
+            }
+         }
+         break;
       case DISPLAYLIST_OPTIONS_CHEATS:
 #ifdef HAVE_CHEATS
          if (cheat_manager_alloc_if_empty())
@@ -6707,6 +6811,8 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_MIN,                      PARSE_ONLY_INT,    true},
                {MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE,                    PARSE_ONLY_INT,    true},
                {MENU_ENUM_LABEL_NETPLAY_NAT_TRAVERSAL,                                 PARSE_ONLY_BOOL,   true},
+               {MENU_ENUM_LABEL_NETPLAY_UDP_INPUT,                                     PARSE_ONLY_BOOL,   true},
+               {MENU_ENUM_LABEL_NETPLAY_SPECTATOR_RELAY,                               PARSE_ONLY_BOOL,   true},
                {MENU_ENUM_LABEL_NETPLAY_SHARE_DIGITAL,                                 PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_NETPLAY_SHARE_ANALOG,                                  PARSE_ONLY_UINT,   true},
             };
@@ -7119,6 +7225,7 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_MOUSE_ENABLE,                                          PARSE_ONLY_BOOL,   true},
                {MENU_ENUM_LABEL_POINTER_ENABLE,                                        PARSE_ONLY_BOOL,   true},
                {MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_ENABLE,                          PARSE_ONLY_BOOL,   true},
+               {MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_WORKERS,                         PARSE_ONLY_UINT,   true},
                {MENU_ENUM_LABEL_PAUSE_NONACTIVE,                                       PARSE_ONLY_BOOL,   true},
                {MENU_ENUM_LABEL_VIDEO_DISABLE_COMPOSITION,                             PARSE_ONLY_BOOL,   true},
                {MENU_ENUM_LABEL_MENU_SCROLL_FAST,                                      PARSE_ONLY_BOOL,   true},
@@ -7708,6 +7815,9 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_RUN_AHEAD_ENABLED,                     PARSE_ONLY_BOOL, true },
                {MENU_ENUM_LABEL_RUN_AHEAD_FRAMES,                      PARSE_ONLY_UINT, false },
                {MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_INSTANCE,          PARSE_ONLY_BOOL, false },
+               {MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD,            PARSE_ONLY_BOOL, false },
+               {MENU_ENUM_LABEL_RUN_AHEAD_PREEMPTIVE,                  PARSE_ONLY_BOOL, false },
+               {MENU_ENUM_LABEL_RUN_AHEAD_AUTO,                        PARSE_ONLY_BOOL, false },
                {MENU_ENUM_LABEL_RUN_AHEAD_HIDE_WARNINGS,               PARSE_ONLY_BOOL, false },
 #endif
             };
@@ -7745,6 +7855,9 @@ unsigned menu_displaylist_build_list(
                      {
                         case MENU_ENUM_LABEL_RUN_AHEAD_FRAMES:
                         case MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_INSTANCE:
+                        case MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD:
+                        case MENU_ENUM_LABEL_RUN_AHEAD_PREEMPTIVE:
+                        case MENU_ENUM_LABEL_RUN_AHEAD_AUTO:
                         case MENU_ENUM_LABEL_RUN_AHEAD_HIDE_WARNINGS:
                            build_list[i].checked = true;
                            break;
@@ -8564,6 +8677,15 @@ unsigned menu_displaylist_build_list(
                {MENU_ENUM_LABEL_REWIND_GRANULARITY,      PARSE_ONLY_UINT, false},
                {MENU_ENUM_LABEL_REWIND_BUFFER_SIZE,      PARSE_ONLY_SIZE, false},
                {MENU_ENUM_LABEL_REWIND_BUFFER_SIZE_STEP, PARSE_ONLY_UINT, false},
+               {MENU_ENUM_LABEL_REWIND_DISK_BUFFER_SIZE, PARSE_ONLY_UINT, false},
+               {MENU_ENUM_LABEL_REWIND_KEYFRAME_INTERVAL,PARSE_ONLY_UINT, false},
+               {MENU_ENUM_LABEL_REWIND_SEEK_SECONDS,     PARSE_ONLY_UINT, false},
+#ifdef HAVE_THREADS
+               {MENU_ENUM_LABEL_REWIND_THREADED,         PARSE_ONLY_BOOL, false},
+#ifdef HAVE_ZLIB
+               {MENU_ENUM_LABEL_REWIND_TIER_AGE,         PARSE_ONLY_UINT, false},
+#endif
+#endif
             };
 
             for (i = 0; i < ARRAY_SIZE(build_list); i++)
@@ -8573,6 +8695,11 @@ unsigned menu_displaylist_build_list(
                   case MENU_ENUM_LABEL_REWIND_GRANULARITY:
                   case MENU_ENUM_LABEL_REWIND_BUFFER_SIZE:
                   case MENU_ENUM_LABEL_REWIND_BUFFER_SIZE_STEP:
+                  case MENU_ENUM_LABEL_REWIND_DISK_BUFFER_SIZE:
+                  case MENU_ENUM_LABEL_REWIND_KEYFRAME_INTERVAL:
+                  case MENU_ENUM_LABEL_REWIND_SEEK_SECONDS:
+                  case MENU_ENUM_LABEL_REWIND_THREADED:
+                  case MENU_ENUM_LABEL_REWIND_TIER_AGE:
                      if (rewind_enable)
                         build_list[i].checked = true;
                      break;
@@ -11016,6 +11143,7 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type,
       case DISPLAYLIST_NETWORK_SETTINGS_LIST:
       case DISPLAYLIST_OPTIONS_CHEATS:
       case DISPLAYLIST_NETWORK_INFO:
+      case DISPLAYLIST_TASK_STATS:
       case DISPLAYLIST_DROPDOWN_LIST_RESOLUTION:
       case DISPLAYLIST_DROPDOWN_LIST_PLAYLIST_DEFAULT_CORE:
       case DISPLAYLIST_DROPDOWN_LIST_PLAYLIST_LABEL_DISPLAY_MODE:
@@ -11089,6 +11217,7 @@ bool menu_displaylist_ctl(enum menu_displaylist_ctl_state type,
                case DISPLAYLIST_DROPDOWN_LIST_DISK_INDEX:
                case DISPLAYLIST_INFORMATION_LIST:
                case DISPLAYLIST_SCAN_DIRECTORY_LIST:
+               case DISPLAYLIST_TASK_STATS:
                   menu_entries_append_enum(info->list,
                         msg_hash_to_str(MENU_ENUM_LABEL_VALUE_NO_ENTRIES_TO_DISPLAY),
                         msg_hash_to_str(MENU_ENUM_LABEL_NO_ENTRIES_TO_DISPLAY),
@@ -138,6 +138,7 @@ enum menu_displaylist_ctl_state
    DISPLAYLIST_SHADER_PRESET_SAVE,
    DISPLAYLIST_SHADER_PRESET_REMOVE,
    DISPLAYLIST_NETWORK_INFO,
+   DISPLAYLIST_TASK_STATS,
    DISPLAYLIST_SYSTEM_INFO,
    DISPLAYLIST_ACHIEVEMENT_LIST,
    DISPLAYLIST_USER_BINDS_LIST,
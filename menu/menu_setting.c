@@ -6035,6 +6035,19 @@ static void setting_get_string_representation_uint_analog_dpad_mode(
 }
 
 #ifdef HAVE_THREADS
+static void setting_get_string_representation_uint_threaded_data_runloop_workers(
+      rarch_setting_t *setting,
+      char *s, size_t len)
+{
+   if (!setting)
+      return;
+
+   if (*setting->value.target.unsigned_integer)
+      snprintf(s, len, "%u", *setting->value.target.unsigned_integer);
+   else
+      strlcpy(s, msg_hash_to_str(MENU_ENUM_LABEL_VALUE_AUTO), len);
+}
+
 static void setting_get_string_representation_uint_autosave_interval(
       rarch_setting_t *setting,
       char *s, size_t len)
@@ -6966,6 +6979,9 @@ static void general_write_handler(rarch_setting_t *setting)
                task_queue_unset_threaded();
          }
          break;
+      case MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_WORKERS:
+         task_queue_set_workers(*setting->value.target.unsigned_integer);
+         break;
       case MENU_ENUM_LABEL_INPUT_POLL_TYPE_BEHAVIOR:
          core_set_poll_type(*setting->value.target.integer);
          break;
@@ -7192,6 +7208,7 @@ static void general_write_handler(rarch_setting_t *setting)
 #endif
          break;
       case MENU_ENUM_LABEL_AUDIO_LATENCY:
+      case MENU_ENUM_LABEL_AUDIO_PROCESS_THREAD:
       case MENU_ENUM_LABEL_AUDIO_OUTPUT_RATE:
       case MENU_ENUM_LABEL_AUDIO_WASAPI_EXCLUSIVE_MODE:
       case MENU_ENUM_LABEL_AUDIO_WASAPI_FLOAT_FORMAT:
@@ -9576,6 +9593,85 @@ static bool setting_append_list(
             (*list)[list_info->index - 1].offset_by     = 1;
             menu_settings_list_current_add_range(list, list_info, 1, 100, 1, true, true);
 
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.rewind_disk_buffer_size,
+                  MENU_ENUM_LABEL_REWIND_DISK_BUFFER_SIZE,
+                  MENU_ENUM_LABEL_VALUE_REWIND_DISK_BUFFER_SIZE,
+                  DEFAULT_REWIND_DISK_BUFFER_SIZE,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].action_ok     = &setting_action_ok_uint;
+            (*list)[list_info->index - 1].offset_by     = 0;
+            menu_settings_list_current_add_range(list, list_info, 0, 65536, 1024, true, true);
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.rewind_keyframe_interval,
+                  MENU_ENUM_LABEL_REWIND_KEYFRAME_INTERVAL,
+                  MENU_ENUM_LABEL_VALUE_REWIND_KEYFRAME_INTERVAL,
+                  DEFAULT_REWIND_KEYFRAME_INTERVAL,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].action_ok     = &setting_action_ok_uint;
+            (*list)[list_info->index - 1].offset_by     = 0;
+            menu_settings_list_current_add_range(list, list_info, 0, 3600, 60, true, true);
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.rewind_seek_seconds,
+                  MENU_ENUM_LABEL_REWIND_SEEK_SECONDS,
+                  MENU_ENUM_LABEL_VALUE_REWIND_SEEK_SECONDS,
+                  DEFAULT_REWIND_SEEK_SECONDS,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].action_ok     = &setting_action_ok_uint;
+            (*list)[list_info->index - 1].offset_by     = 1;
+            menu_settings_list_current_add_range(list, list_info, 1, 600, 1, true, true);
+
+#ifdef HAVE_THREADS
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.rewind_threaded,
+                  MENU_ENUM_LABEL_REWIND_THREADED,
+                  MENU_ENUM_LABEL_VALUE_REWIND_THREADED,
+                  DEFAULT_REWIND_THREADED,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE);
+
+#ifdef HAVE_ZLIB
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.rewind_tier_age,
+                  MENU_ENUM_LABEL_REWIND_TIER_AGE,
+                  MENU_ENUM_LABEL_VALUE_REWIND_TIER_AGE,
+                  DEFAULT_REWIND_TIER_AGE,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].action_ok     = &setting_action_ok_uint;
+            (*list)[list_info->index - 1].offset_by     = 0;
+            menu_settings_list_current_add_range(list, list_info, 0, 36000, 60, true, true);
+#endif
+#endif
+
          END_SUB_GROUP(list, list_info, parent_group);
          END_GROUP(list, list_info, parent_group);
          break;
@@ -11388,6 +11484,25 @@ static bool setting_append_list(
          menu_settings_list_current_add_range(list, list_info, 0, 512, 1.0, true, true);
          SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_LAKKA_ADVANCED);
 
+#ifdef HAVE_THREADS
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.audio_process_thread,
+               MENU_ENUM_LABEL_AUDIO_PROCESS_THREAD,
+               MENU_ENUM_LABEL_VALUE_AUDIO_PROCESS_THREAD,
+               DEFAULT_AUDIO_PROCESS_THREAD,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_NONE
+               );
+         SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_LAKKA_ADVANCED);
+#endif
+
          CONFIG_UINT(
                list, list_info,
                &settings->uints.audio_resampler_quality,
@@ -12484,7 +12599,57 @@ static bool setting_append_list(
                general_read_handler,
                SD_FLAG_NONE
                );
+
+#ifdef HAVE_THREADS
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.run_ahead_secondary_thread,
+               MENU_ENUM_LABEL_RUN_AHEAD_SECONDARY_THREAD,
+               MENU_ENUM_LABEL_VALUE_RUN_AHEAD_SECONDARY_THREAD,
+               DEFAULT_RUN_AHEAD_SECONDARY_THREAD,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_NONE
+               );
 #endif
+#endif
+
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.run_ahead_preemptive,
+               MENU_ENUM_LABEL_RUN_AHEAD_PREEMPTIVE,
+               MENU_ENUM_LABEL_VALUE_RUN_AHEAD_PREEMPTIVE,
+               DEFAULT_RUN_AHEAD_PREEMPTIVE,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_NONE
+               );
+
+         CONFIG_BOOL(
+               list, list_info,
+               &settings->bools.run_ahead_auto,
+               MENU_ENUM_LABEL_RUN_AHEAD_AUTO,
+               MENU_ENUM_LABEL_VALUE_RUN_AHEAD_AUTO,
+               DEFAULT_RUN_AHEAD_AUTO,
+               MENU_ENUM_LABEL_VALUE_OFF,
+               MENU_ENUM_LABEL_VALUE_ON,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler,
+               SD_FLAG_NONE
+               );
 
          CONFIG_BOOL(
                list, list_info,
@@ -14201,6 +14366,23 @@ static bool setting_append_list(
                general_read_handler,
                SD_FLAG_ADVANCED
                );
+
+         CONFIG_UINT(
+               list, list_info,
+               &settings->uints.threaded_data_runloop_workers,
+               MENU_ENUM_LABEL_THREADED_DATA_RUNLOOP_WORKERS,
+               MENU_ENUM_LABEL_VALUE_THREADED_DATA_RUNLOOP_WORKERS,
+               DEFAULT_THREADED_DATA_RUNLOOP_WORKERS,
+               &group_info,
+               &subgroup_info,
+               parent_group,
+               general_write_handler,
+               general_read_handler);
+         (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+         (*list)[list_info->index - 1].get_string_representation =
+            &setting_get_string_representation_uint_threaded_data_runloop_workers;
+         menu_settings_list_current_add_range(list, list_info, 0, 16, 1, true, true);
+         SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
 #endif
 
          END_SUB_GROUP(list, list_info, parent_group);
@@ -17427,6 +17609,38 @@ static bool setting_append_list(
                   SD_FLAG_NONE);
             SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.netplay_udp_input,
+                  MENU_ENUM_LABEL_NETPLAY_UDP_INPUT,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_UDP_INPUT,
+                  netplay_udp_input,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.netplay_spectator_relay,
+                  MENU_ENUM_LABEL_NETPLAY_SPECTATOR_RELAY,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_SPECTATOR_RELAY,
+                  netplay_spectator_relay,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
             CONFIG_UINT(
                   list, list_info,
                   &settings->uints.netplay_share_digital,
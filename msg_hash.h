@@ -399,6 +399,7 @@ enum msg_hash_enums
    MSG_SLOW_MOTION,
    MSG_FAST_FORWARD,
    MSG_REWIND_REACHED_END,
+   MSG_REWIND_SEEK,
    MSG_FAILED_TO_START_MOVIE_RECORD,
    MSG_CHEEVOS_HARDCORE_MODE_ENABLE,
    MSG_STATE_SLOT,
@@ -692,6 +693,7 @@ enum msg_hash_enums
    MENU_ENUM_LABEL_CORE_UPDATER_ENTRY,
    MENU_ENUM_LABEL_CORE_OPTION_ENTRY,
    MENU_ENUM_LABEL_NETWORK_INFO_ENTRY,
+   MENU_ENUM_LABEL_TASK_STATS_ENTRY,
    MENU_ENUM_LABEL_SYSTEM_INFO_ENTRY,
    MENU_ENUM_LABEL_SYSTEM_INFO_CONTROLLER_ENTRY,
    MENU_ENUM_LABEL_CORE_INFO_ENTRY,
@@ -850,6 +852,7 @@ enum msg_hash_enums
    MENU_ENUM_LABEL_VALUE_INPUT_META_RECORDING_TOGGLE,
    MENU_ENUM_LABEL_VALUE_INPUT_META_STREAMING_TOGGLE,
    MENU_ENUM_LABEL_VALUE_INPUT_META_AI_SERVICE,
+   MENU_ENUM_LABEL_VALUE_INPUT_META_REWIND_SEEK,
    MENU_ENUM_LABEL_VALUE_INPUT_META_MENU_TOGGLE,
 
    MENU_ENUM_LABEL_VALUE_INPUT_DEVICE_INDEX,
@@ -902,6 +905,7 @@ enum msg_hash_enums
    MENU_ENUM_SUBLABEL_INPUT_META_RECORDING_TOGGLE,
    MENU_ENUM_SUBLABEL_INPUT_META_STREAMING_TOGGLE,
    MENU_ENUM_SUBLABEL_INPUT_META_AI_SERVICE,
+   MENU_ENUM_SUBLABEL_INPUT_META_REWIND_SEEK,
    MENU_ENUM_SUBLABEL_INPUT_META_MENU_TOGGLE,
 
    MENU_ENUM_LABEL_INPUT_DESCRIPTION,
@@ -1073,6 +1077,7 @@ enum msg_hash_enums
    MENU_LABEL(NAVIGATION_WRAPAROUND),
    MENU_LABEL(SHOW_ADVANCED_SETTINGS),
    MENU_LABEL(THREADED_DATA_RUNLOOP_ENABLE),
+   MENU_LABEL(THREADED_DATA_RUNLOOP_WORKERS),
    MENU_LABEL(XMB_ALPHA_FACTOR),
    MENU_LABEL(MENU_FONT_COLOR_RED),
    MENU_LABEL(MENU_FONT_COLOR_GREEN),
@@ -1569,6 +1574,9 @@ enum msg_hash_enums
    MENU_LABEL(NO_PLAYLISTS),
 
    MSG_INTERFACE,
+   MSG_TASK_STATS_WAIT,
+   MSG_TASK_STATS_RUN,
+   MSG_TASK_STATS_ITERATIONS,
    MSG_MEMORY,
    MSG_IN_BYTES,
    MSG_IN_MEGABYTES,
@@ -1602,6 +1610,7 @@ enum msg_hash_enums
    MENU_LABEL(AUDIO_MIXER_VOLUME),
    MENU_LABEL(AUDIO_RATE_CONTROL_DELTA),
    MENU_LABEL(AUDIO_LATENCY),
+   MENU_LABEL(AUDIO_PROCESS_THREAD),
    MENU_LABEL(AUDIO_RESAMPLER_QUALITY),
    MENU_LABEL(AUDIO_WASAPI_EXCLUSIVE_MODE),
    MENU_LABEL(AUDIO_WASAPI_FLOAT_FORMAT),
@@ -1648,6 +1657,14 @@ enum msg_hash_enums
    MENU_LABEL(REWIND_GRANULARITY),
    MENU_LABEL(REWIND_BUFFER_SIZE),
    MENU_LABEL(REWIND_BUFFER_SIZE_STEP),
+   MENU_LABEL(REWIND_THREADED),
+   MENU_LABEL(REWIND_TIER_AGE),
+   MENU_LABEL(REWIND_DISK_BUFFER_SIZE),
+   MENU_LABEL(REWIND_KEYFRAME_INTERVAL),
+   MENU_LABEL(REWIND_SEEK_SECONDS),
+   MENU_LABEL(REWIND_SEEK_10),
+   MENU_LABEL(REWIND_SEEK_30),
+   MENU_LABEL(REWIND_SEEK_60),
    /* TODO/FIXME: INPUT_META_REWIND is incorrectly defined;
     * the LABEL/SUBLABEL enums should be entered 'manually',
     * like all the other hotkeys. Moreover, the resultant
@@ -1750,6 +1767,8 @@ enum msg_hash_enums
    MENU_LABEL(NETPLAY_SPECTATOR_MODE_ENABLE),
    MENU_LABEL(NETPLAY_TCP_UDP_PORT),
    MENU_LABEL(NETPLAY_NAT_TRAVERSAL),
+   MENU_LABEL(NETPLAY_UDP_INPUT),
+   MENU_LABEL(NETPLAY_SPECTATOR_RELAY),
    MENU_LABEL(NETPLAY_REQUEST_DEVICE_I),
    MENU_ENUM_LABEL_NETPLAY_REQUEST_DEVICE_1,
    MENU_ENUM_LABEL_NETPLAY_REQUEST_DEVICE_LAST = MENU_ENUM_LABEL_NETPLAY_REQUEST_DEVICE_1 + MAX_USERS,
@@ -1858,6 +1877,9 @@ enum msg_hash_enums
    MENU_LABEL(SLOWMOTION_RATIO),
    MENU_LABEL(RUN_AHEAD_ENABLED),
    MENU_LABEL(RUN_AHEAD_SECONDARY_INSTANCE),
+   MENU_LABEL(RUN_AHEAD_SECONDARY_THREAD),
+   MENU_LABEL(RUN_AHEAD_PREEMPTIVE),
+   MENU_LABEL(RUN_AHEAD_AUTO),
    MENU_LABEL(RUN_AHEAD_HIDE_WARNINGS),
    MENU_LABEL(RUN_AHEAD_FRAMES),
    MENU_LABEL(INPUT_BLOCK_TIMEOUT),
@@ -2072,6 +2094,7 @@ enum msg_hash_enums
    MENU_LABEL(LOAD_DISC),
    MENU_LABEL(DUMP_DISC),
    MENU_LABEL(NETWORK_INFORMATION),
+   MENU_LABEL(TASK_STATISTICS),
    MENU_LABEL(SYSTEM_INFORMATION),
    MENU_LABEL(ACHIEVEMENT_LIST),
    MENU_LABEL(ACHIEVEMENT_LIST_HARDCORE),
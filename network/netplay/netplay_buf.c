@@ -64,6 +64,9 @@ bool netplay_init_socket_buffer(
       return false;
    sbuf->bufsz = size;
    sbuf->start = sbuf->read = sbuf->end = 0;
+#ifdef DEBUG_NETPLAY_LOSS
+   sbuf->hold_until = 0;
+#endif
    return true;
 }
 
@@ -191,6 +194,22 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
    if (buf_used(sbuf) == 0)
       return true;
 
+#ifdef DEBUG_NETPLAY_LOSS
+   if (!block)
+   {
+      /* Pretend a segment got lost and everything behind it waits for the
+       * retransmission */
+      retro_time_t now = cpu_features_get_time_usec();
+      if (now < sbuf->hold_until)
+         return true;
+      if (rand() % 100 < DEBUG_NETPLAY_LOSS)
+      {
+         sbuf->hold_until = now + 200000;
+         return true;
+      }
+   }
+#endif
+
    if (sbuf->end > sbuf->start)
    {
       /* Usual case: Everything's in order */
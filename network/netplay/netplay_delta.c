@@ -16,9 +16,11 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <boolean.h>
+#include <retro_endianness.h>
 #include <encodings/crc32.h>
 
 #include "netplay_private.h"
@@ -58,6 +60,7 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
    delta->used  = true;
    delta->frame = frame;
    delta->crc   = 0;
+   delta->hash  = 0;
 
    for (i = 0; i < MAX_INPUT_DEVICES; i++)
    {
@@ -85,6 +88,34 @@ uint32_t netplay_delta_frame_crc(netplay_t *netplay,
          netplay->state_size);
 }
 
+/**
+ * netplay_delta_frame_hash
+ *
+ * Get the netplay_hash() of the serialization of this frame.
+ */
+uint32_t netplay_delta_frame_hash(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   if (!netplay->state_size)
+      return 0;
+   return netplay_hash(netplay->hash_kernel, delta->state,
+         netplay->state_size);
+}
+
+/**
+ * netplay_state_check
+ *
+ * Get the CRC-32 or, if fast, the netplay_hash() of a whole state.
+ */
+uint32_t netplay_state_check(netplay_t *netplay, const void *state,
+      bool fast)
+{
+   if (fast)
+      return netplay_hash(netplay->hash_kernel, state, netplay->state_size);
+   return encoding_crc32(0L, (const unsigned char*)state,
+         netplay->state_size);
+}
+
 /*
  * Free an input state list
  */
@@ -124,6 +155,261 @@ void netplay_delta_frame_free(struct delta_frame *delta)
    }
 }
 
+/**
+ * netplay_state_delta_init
+ *
+ * Allocate the delta scratch space if we haven't yet.
+ */
+static bool netplay_state_delta_init(netplay_t *netplay)
+{
+   if (!netplay->state_size)
+      return false;
+
+   if (!netplay->delta_kernel)
+      netplay->delta_kernel = state_delta_kernel_get(cpu_features_get());
+   if (!netplay->delta_patch)
+      netplay->delta_patch  = (uint8_t*)malloc(
+            state_delta_maxsize(netplay->state_size));
+   /* Bases are allocated with 0, so this needs to differ */
+   if (!netplay->delta_state)
+      netplay->delta_state  = state_delta_alloc(netplay->state_size, 1);
+
+   return netplay->delta_patch && netplay->delta_state;
+}
+
+/**
+ * netplay_state_base_store
+ *
+ * Remember the state of a delta frame whose CRC or hash is known to match on
+ * both sides, as a base for savestate deltas.
+ */
+void netplay_state_base_store(netplay_t *netplay, struct delta_frame *delta)
+{
+   size_t i;
+   struct netplay_state_base *base = NULL;
+
+   if (!netplay->state_size || (!delta->crc && !delta->hash))
+      return;
+
+   /* Only worth the copy if some peer can use it */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active && connection->delta_supported)
+         break;
+   }
+   if (i == netplay->connections_size || !netplay_state_delta_init(netplay))
+      return;
+
+   /* A replayed frame replaces its old state */
+   for (i = 0; i < NETPLAY_STATE_BASES; i++)
+   {
+      if (     netplay->state_bases[i].used
+            && netplay->state_bases[i].frame == delta->frame)
+      {
+         base = &netplay->state_bases[i];
+         break;
+      }
+   }
+
+   if (!base)
+   {
+      base = &netplay->state_bases[netplay->state_base_ptr];
+      netplay->state_base_ptr = (netplay->state_base_ptr + 1)
+         % NETPLAY_STATE_BASES;
+   }
+
+   if (!base->state)
+   {
+      base->state = state_delta_alloc(netplay->state_size, 0);
+      if (!base->state)
+         return;
+   }
+
+   memcpy(base->state, delta->state, netplay->state_size);
+   base->frame = delta->frame;
+   base->crc   = delta->crc;
+   base->hash  = delta->hash;
+   base->used  = true;
+}
+
+/**
+ * netplay_state_base_find
+ *
+ * Find a stored base state by frame and CRC, or hash if fast. With frame and
+ * CRC both 0, find the newest one.
+ *
+ * Returns: The base state, or NULL if there is none.
+ */
+struct netplay_state_base *netplay_state_base_find(netplay_t *netplay,
+      uint32_t frame, uint32_t crc, bool fast)
+{
+   size_t i;
+   struct netplay_state_base *ret = NULL;
+
+   for (i = 0; i < NETPLAY_STATE_BASES; i++)
+   {
+      struct netplay_state_base *base = &netplay->state_bases[i];
+      if (!base->used)
+         continue;
+      if (!frame && !crc)
+      {
+         if (!ret || base->frame > ret->frame)
+            ret = base;
+      }
+      else if (base->frame == frame && (fast ? base->hash : base->crc) == crc)
+         return base;
+   }
+
+   return ret;
+}
+
+/**
+ * netplay_state_bases_clear
+ *
+ * Forget all base states, e.g. after a failed delta.
+ */
+void netplay_state_bases_clear(netplay_t *netplay)
+{
+   size_t i;
+   for (i = 0; i < NETPLAY_STATE_BASES; i++)
+      netplay->state_bases[i].used = false;
+}
+
+/* The patch goes over the wire as little-endian 16-bit words */
+static void netplay_state_delta_swap(uint8_t *patch, size_t size)
+{
+   if (!is_little_endian())
+   {
+      size_t i;
+      uint16_t *patch16 = (uint16_t*)patch;
+      for (i = 0; i < size / sizeof(uint16_t); i++)
+         patch16[i] = SWAP16(patch16[i]);
+   }
+}
+
+/**
+ * netplay_state_delta_encode
+ *
+ * Encode the patch turning base into state into netplay->delta_patch,
+ * as little-endian 16-bit words.
+ *
+ * Returns: The size of the patch in bytes, or 0 on failure.
+ */
+size_t netplay_state_delta_encode(netplay_t *netplay,
+      const struct netplay_state_base *base, const void *state)
+{
+   size_t size;
+
+   if (!netplay_state_delta_init(netplay))
+      return 0;
+
+   /* The scan kernels need both sides padded by state_delta_alloc() */
+   memcpy(netplay->delta_state, state, netplay->state_size);
+   size = state_delta_compress(netplay->delta_kernel, netplay->delta_state,
+         base->state, netplay->state_size, netplay->delta_patch);
+   netplay_state_delta_swap(netplay->delta_patch, size);
+
+   return size;
+}
+
+/**
+ * netplay_state_delta_decode
+ *
+ * Apply the patch of the given size in netplay->delta_patch to base. If the
+ * result has the given CRC, write it to state.
+ *
+ * Returns: True if state was written.
+ */
+bool netplay_state_delta_decode(netplay_t *netplay,
+      const struct netplay_state_base *base, size_t patch_size,
+      uint32_t crc, bool fast, void *state)
+{
+   const uint16_t *patch16;
+   size_t words;
+   size_t i   = 0;
+   size_t out = 0;
+   size_t len = (netplay->state_size + 1) / sizeof(uint16_t);
+
+   if (!netplay_state_delta_init(netplay) ||
+         patch_size > state_delta_maxsize(netplay->state_size))
+      return false;
+
+   netplay_state_delta_swap(netplay->delta_patch, patch_size);
+   patch16 = (const uint16_t*)netplay->delta_patch;
+   words   = patch_size / sizeof(uint16_t);
+
+   /* It came from the network, so make sure it stays in bounds
+    * before state_delta_decompress() trusts it */
+   for (;;)
+   {
+      uint16_t changed;
+      uint32_t skip;
+
+      if (i >= words)
+         return false;
+      changed = patch16[i++];
+
+      if (changed)
+      {
+         if (i >= words)
+            return false;
+         out += patch16[i++];
+         if (i + changed > words || out + changed > len)
+            return false;
+         i   += changed;
+         out += changed;
+      }
+      else
+      {
+         if (i + 2 > words)
+            return false;
+         skip = patch16[i] | ((uint32_t)patch16[i + 1] << 16);
+         i   += 2;
+         if (!skip)
+            break;
+         out += skip;
+         if (out > len)
+            return false;
+      }
+   }
+
+   memcpy(netplay->delta_state, base->state, netplay->state_size);
+   state_delta_decompress(netplay->delta_patch, patch_size,
+         netplay->delta_state, netplay->state_size);
+
+   if (netplay_state_check(netplay, netplay->delta_state, fast) != crc)
+      return false;
+
+   memcpy(state, netplay->delta_state, netplay->state_size);
+   return true;
+}
+
+/**
+ * netplay_state_delta_free
+ *
+ * Free the base states and delta scratch space.
+ */
+void netplay_state_delta_free(netplay_t *netplay)
+{
+   size_t i;
+
+   for (i = 0; i < NETPLAY_STATE_BASES; i++)
+   {
+      if (netplay->state_bases[i].state)
+         free(netplay->state_bases[i].state);
+      netplay->state_bases[i].state = NULL;
+      netplay->state_bases[i].used  = false;
+   }
+
+   if (netplay->delta_patch)
+      free(netplay->delta_patch);
+   if (netplay->delta_state)
+      free(netplay->delta_state);
+   netplay->delta_patch = NULL;
+   netplay->delta_state = NULL;
+}
+
 /**
  * netplay_input_state_for
  *
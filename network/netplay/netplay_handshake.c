@@ -238,7 +238,8 @@ bool netplay_handshake_init_send(netplay_t *netplay,
 
    header[0] = htonl(NETPLAY_MAGIC);
    header[1] = htonl(netplay_platform_magic());
-   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED);
+   header[2] = htonl(netplay->udp_enabled ? NETPLAY_COMPRESSION_SUPPORTED
+         : (NETPLAY_COMPRESSION_SUPPORTED & ~NETPLAY_COMPRESSION_UDP));
    header[3] = 0;
    header[4] = htonl(NETPLAY_PROTOCOL_VERSION);
    header[5] = htonl(netplay_impl_magic());
@@ -372,6 +373,19 @@ bool netplay_handshake_init(netplay_t *netplay,
    compression  = ntohl(header[2]);
    compression &= NETPLAY_COMPRESSION_SUPPORTED;
 
+   connection->delta_supported = !!(compression & NETPLAY_COMPRESSION_DELTA);
+   connection->udp_supported   = netplay->udp_enabled &&
+      (compression & NETPLAY_COMPRESSION_UDP);
+   connection->fast_hash       =
+      !!(compression & NETPLAY_COMPRESSION_FAST_HASH);
+   connection->ping_supported  =
+      !!(compression & NETPLAY_COMPRESSION_PING);
+   connection->ping_time       = 0;
+   connection->ping_outstanding = false;
+   connection->rtt             = 0;
+   connection->rtt_var         = 0;
+   connection->savestate_base  = false;
+
    if (compression & NETPLAY_COMPRESSION_ZLIB)
    {
       ctrans = &netplay->compress_zlib;
@@ -681,7 +695,7 @@ static bool netplay_handshake_sync(netplay_t *netplay,
    connection->mode = NETPLAY_CONNECTION_SPECTATING;
    netplay_handshake_ready(netplay, connection);
 
-   return true;
+   return netplay_udp_offer(netplay, connection);
 }
 
 /**
@@ -872,7 +886,22 @@ static bool netplay_handshake_pre_info(netplay_t *netplay,
       return true;
    }
 
-   RECV(&info_buf.core_name, cmd_size)
+   /* The payload is every field after 'cmd'. Receive them one at
+    * a time, so that each write is bounded by its own field rather
+    * than by 'cmd_size' and the struct layout. */
+   RECV(&info_buf.content_crc, sizeof(info_buf.content_crc))
+   {
+      RARCH_ERR("Failed to receive netplay info payload.\n");
+      return false;
+   }
+
+   RECV(info_buf.core_name, sizeof(info_buf.core_name))
+   {
+      RARCH_ERR("Failed to receive netplay info payload.\n");
+      return false;
+   }
+
+   RECV(info_buf.core_version, sizeof(info_buf.core_version))
    {
       RARCH_ERR("Failed to receive netplay info payload.\n");
       return false;
@@ -0,0 +1,344 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Fast state hash for desync checks. It is not cryptographic, just much
+ * cheaper than CRC32 on large states: the data is consumed as eight
+ * independent little-endian 64-bit lanes using 32x32->64 multiplies, which
+ * map directly onto SSE2, AVX2 and NEON. Every kernel gives the same result,
+ * as do big-endian hosts, so peers may pick different ones. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <retro_inline.h>
+#include <retro_endianness.h>
+#include <retro_miscellaneous.h>
+
+#include "netplay_private.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
+#define CPU_X86
+#endif
+
+/* Wider kernels are compiled for a specific target and only picked at
+ * runtime, so that baseline builds can still use them. */
+#if defined(CPU_X86) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define NETPLAY_HASH_TARGET(x) __attribute__((target(x)))
+#define NETPLAY_HASH_X86_DISPATCH
+#elif defined(CPU_X86) && defined(_MSC_VER) && _MSC_VER >= 1910
+#define NETPLAY_HASH_X86_DISPATCH
+#endif
+
+#ifndef NETPLAY_HASH_TARGET
+#define NETPLAY_HASH_TARGET(x)
+#endif
+
+#if defined(NETPLAY_HASH_X86_DISPATCH) || __SSE2__
+#define NETPLAY_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef NETPLAY_HASH_X86_DISPATCH
+#define NETPLAY_HASH_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#define NETPLAY_HASH_NEON
+#include <arm_neon.h>
+#endif
+
+#define HASH_LANES          8
+#define HASH_STRIPE         (HASH_LANES * sizeof(uint64_t))
+#define HASH_BLOCK_STRIPES  16
+#define HASH_BLOCK          (HASH_STRIPE * HASH_BLOCK_STRIPES)
+
+#define HASH_PRIME32        0x9E3779B1U
+#define HASH_PRIME64_1      UINT64_C(0x9E3779B185EBCA87)
+#define HASH_PRIME64_2      UINT64_C(0xC2B2AE3D27D4EB4F)
+#define HASH_PRIME64_3      UINT64_C(0x165667B19E3779F9)
+#define HASH_PRIME64_4      UINT64_C(0x85EBCA77C2B2AE63)
+
+/* Per-lane keys, also the initial accumulators */
+static const uint64_t hash_keys[HASH_LANES] = {
+   UINT64_C(0xBE4BA423396CFEB8), UINT64_C(0x1CAD21F72C81017C),
+   UINT64_C(0xDB979083E96DD4DE), UINT64_C(0x1F67B3B7A4A44072),
+   UINT64_C(0x78E5C0CC4EE679CB), UINT64_C(0x2172FFCC7DD05A82),
+   UINT64_C(0x8E2443F7744608B8), UINT64_C(0x4C263A81E69035E0)
+};
+
+static INLINE uint64_t hash_rotl64(uint64_t x, unsigned r)
+{
+   return (x << r) | (x >> (64 - r));
+}
+
+/* One stripe: acc += data + lo32(data ^ key) * hi32(data ^ key) */
+static INLINE void hash_stripe_generic(uint64_t *acc, const uint8_t *data)
+{
+   unsigned i;
+
+   for (i = 0; i < HASH_LANES; i++)
+   {
+      uint64_t d;
+      uint64_t dk;
+      memcpy(&d, data + i * sizeof(uint64_t), sizeof(d));
+      d       = retro_le_to_cpu64(d);
+      dk      = d ^ hash_keys[i];
+      acc[i] += d + (uint64_t)(uint32_t)dk * (uint32_t)(dk >> 32);
+   }
+}
+
+static INLINE void hash_scramble_generic(uint64_t *acc)
+{
+   unsigned i;
+
+   for (i = 0; i < HASH_LANES; i++)
+   {
+      uint64_t a = acc[i] ^ (acc[i] >> 47) ^ hash_keys[i];
+      acc[i]     = a * HASH_PRIME32;
+   }
+}
+
+static void hash_accumulate_generic(uint64_t *acc, const uint8_t *data,
+      size_t blocks)
+{
+   for (; blocks; blocks--)
+   {
+      unsigned s;
+      for (s = 0; s < HASH_BLOCK_STRIPES; s++, data += HASH_STRIPE)
+         hash_stripe_generic(acc, data);
+      hash_scramble_generic(acc);
+   }
+}
+
+#ifdef NETPLAY_HASH_SSE2
+NETPLAY_HASH_TARGET("sse2")
+static void hash_accumulate_sse2(uint64_t *acc, const uint8_t *data,
+      size_t blocks)
+{
+   unsigned i;
+   __m128i a[4], k[4];
+   const __m128i prime = _mm_set1_epi32((int)HASH_PRIME32);
+
+   for (i = 0; i < 4; i++)
+   {
+      a[i] = _mm_loadu_si128((const __m128i*)acc + i);
+      k[i] = _mm_loadu_si128((const __m128i*)hash_keys + i);
+   }
+
+   for (; blocks; blocks--)
+   {
+      unsigned s;
+      for (s = 0; s < HASH_BLOCK_STRIPES; s++, data += HASH_STRIPE)
+      {
+         for (i = 0; i < 4; i++)
+         {
+            __m128i d  = _mm_loadu_si128((const __m128i*)data + i);
+            __m128i dk = _mm_xor_si128(d, k[i]);
+            __m128i p  = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+            a[i]       = _mm_add_epi64(a[i], _mm_add_epi64(d, p));
+         }
+      }
+
+      for (i = 0; i < 4; i++)
+      {
+         __m128i x  = _mm_xor_si128(a[i], _mm_srli_epi64(a[i], 47));
+         __m128i lo, hi;
+         x          = _mm_xor_si128(x, k[i]);
+         lo         = _mm_mul_epu32(x, prime);
+         hi         = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+         a[i]       = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+      }
+   }
+
+   for (i = 0; i < 4; i++)
+      _mm_storeu_si128((__m128i*)acc + i, a[i]);
+}
+#endif
+
+#ifdef NETPLAY_HASH_AVX2
+NETPLAY_HASH_TARGET("avx2")
+static void hash_accumulate_avx2(uint64_t *acc, const uint8_t *data,
+      size_t blocks)
+{
+   unsigned i;
+   __m256i a[2], k[2];
+   const __m256i prime = _mm256_set1_epi32((int)HASH_PRIME32);
+
+   for (i = 0; i < 2; i++)
+   {
+      a[i] = _mm256_loadu_si256((const __m256i*)acc + i);
+      k[i] = _mm256_loadu_si256((const __m256i*)hash_keys + i);
+   }
+
+   for (; blocks; blocks--)
+   {
+      unsigned s;
+      for (s = 0; s < HASH_BLOCK_STRIPES; s++, data += HASH_STRIPE)
+      {
+         for (i = 0; i < 2; i++)
+         {
+            __m256i d  = _mm256_loadu_si256((const __m256i*)data + i);
+            __m256i dk = _mm256_xor_si256(d, k[i]);
+            __m256i p  = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+            a[i]       = _mm256_add_epi64(a[i], _mm256_add_epi64(d, p));
+         }
+      }
+
+      for (i = 0; i < 2; i++)
+      {
+         __m256i x  = _mm256_xor_si256(a[i], _mm256_srli_epi64(a[i], 47));
+         __m256i lo, hi;
+         x          = _mm256_xor_si256(x, k[i]);
+         lo         = _mm256_mul_epu32(x, prime);
+         hi         = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+         a[i]       = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+      }
+   }
+
+   for (i = 0; i < 2; i++)
+      _mm256_storeu_si256((__m256i*)acc + i, a[i]);
+}
+#endif
+
+#ifdef NETPLAY_HASH_NEON
+static void hash_accumulate_neon(uint64_t *acc, const uint8_t *data,
+      size_t blocks)
+{
+   unsigned i;
+   uint64x2_t a[4], k[4];
+   const uint32x2_t prime = vdup_n_u32(HASH_PRIME32);
+
+   for (i = 0; i < 4; i++)
+   {
+      a[i] = vld1q_u64(acc + 2 * i);
+      k[i] = vld1q_u64(hash_keys + 2 * i);
+   }
+
+   for (; blocks; blocks--)
+   {
+      unsigned s;
+      for (s = 0; s < HASH_BLOCK_STRIPES; s++, data += HASH_STRIPE)
+      {
+         for (i = 0; i < 4; i++)
+         {
+            uint64x2_t d  = vreinterpretq_u64_u8(vld1q_u8(data + 16 * i));
+            uint64x2_t dk = veorq_u64(d, k[i]);
+            uint64x2_t p  = vmull_u32(vmovn_u64(dk), vshrn_n_u64(dk, 32));
+            a[i]          = vaddq_u64(a[i], vaddq_u64(d, p));
+         }
+      }
+
+      for (i = 0; i < 4; i++)
+      {
+         uint64x2_t x  = veorq_u64(a[i], vshrq_n_u64(a[i], 47));
+         x             = veorq_u64(x, k[i]);
+         a[i]          = vaddq_u64(vmull_u32(vmovn_u64(x), prime),
+               vshlq_n_u64(vmull_u32(vshrn_n_u64(x, 32), prime), 32));
+      }
+   }
+
+   for (i = 0; i < 4; i++)
+      vst1q_u64(acc + 2 * i, a[i]);
+}
+#endif
+
+/* Fastest first */
+static const netplay_hash_kernel_t netplay_hash_kernels[] = {
+#ifdef NETPLAY_HASH_AVX2
+   { hash_accumulate_avx2,    RETRO_SIMD_AVX | RETRO_SIMD_AVX2, "avx2"    },
+#endif
+#ifdef NETPLAY_HASH_NEON
+   /* Always there on AArch64 */
+   { hash_accumulate_neon,    0,                                "neon"    },
+#endif
+#ifdef NETPLAY_HASH_SSE2
+#if __SSE2__
+   { hash_accumulate_sse2,    0,                                "sse2"    },
+#else
+   { hash_accumulate_sse2,    RETRO_SIMD_SSE2,                  "sse2"    },
+#endif
+#endif
+   { hash_accumulate_generic, 0,                                "generic" },
+};
+
+/**
+ * netplay_hash_kernel_get
+ *
+ * Get the fastest hash kernel usable with the given CPU features.
+ */
+const netplay_hash_kernel_t *netplay_hash_kernel_get(uint64_t cpu)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(netplay_hash_kernels); i++)
+   {
+      uint64_t simd = netplay_hash_kernels[i].simd;
+      if ((cpu & simd) == simd)
+         return &netplay_hash_kernels[i];
+   }
+
+   return &netplay_hash_kernels[ARRAY_SIZE(netplay_hash_kernels) - 1];
+}
+
+/**
+ * netplay_hash
+ *
+ * Hash a buffer with the given kernel.
+ */
+uint32_t netplay_hash(const netplay_hash_kernel_t *kernel,
+      const void *data, size_t len)
+{
+   unsigned i;
+   uint64_t h;
+   uint64_t acc[HASH_LANES];
+   uint8_t tail[HASH_STRIPE];
+   const uint8_t *in = (const uint8_t*)data;
+   size_t blocks     = len / HASH_BLOCK;
+   size_t rest       = len % HASH_BLOCK;
+
+   memcpy(acc, hash_keys, sizeof(acc));
+
+   if (blocks)
+      kernel->accumulate(acc, in, blocks);
+   in += blocks * HASH_BLOCK;
+
+   /* Whole stripes of the last partial block, then the rest zero-padded.
+    * The length goes in at the end, so the padding is unambiguous. */
+   for (; rest >= HASH_STRIPE; rest -= HASH_STRIPE, in += HASH_STRIPE)
+      hash_stripe_generic(acc, in);
+   if (rest)
+   {
+      memset(tail, 0, sizeof(tail));
+      memcpy(tail, in, rest);
+      hash_stripe_generic(acc, tail);
+   }
+
+   h = (uint64_t)len * HASH_PRIME64_1;
+   for (i = 0; i < HASH_LANES; i++)
+   {
+      h ^= hash_rotl64(acc[i] * HASH_PRIME64_2, 31) * HASH_PRIME64_1;
+      h  = hash_rotl64(h, 27) * HASH_PRIME64_1 + HASH_PRIME64_4;
+   }
+
+   h ^= h >> 33;
+   h *= HASH_PRIME64_2;
+   h ^= h >> 29;
+   h *= HASH_PRIME64_3;
+   h ^= h >> 32;
+
+   return (uint32_t)h;
+}
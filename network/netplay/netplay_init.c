@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <boolean.h>
@@ -31,6 +32,7 @@
 #include "netplay_discovery.h"
 
 #include "../../autosave.h"
+#include "../../configuration.h"
 #include "../../retroarch.h"
 
 #if defined(AF_INET6) && !defined(HAVE_SOCKET_LEGACY) && !defined(_3DS)
@@ -227,6 +229,13 @@ static bool init_socket(netplay_t *netplay, void *direct_host,
    if (!init_tcp_socket(netplay, direct_host, server, port))
       return false;
 
+   if (netplay->is_server && netplay->udp_enabled &&
+         !netplay_udp_init_server(netplay))
+   {
+      RARCH_WARN("Failed to set up the netplay UDP socket, input will only be sent over TCP.\n");
+      netplay->udp_enabled = false;
+   }
+
    if (netplay->is_server && netplay->nat_traversal)
       netplay_init_nat_traversal(netplay);
 
@@ -376,8 +385,10 @@ static bool netplay_init_buffers(netplay_t *netplay)
    struct delta_frame *delta_frames = NULL;
 
    /* Enough to get ahead or behind by MAX_STALL_FRAMES frames, plus one for
-    * other remote clients, plus one to send the stall message */
-   netplay->buffer_size = NETPLAY_MAX_STALL_FRAMES + 2;
+    * other remote clients, plus one to send the stall message. Once we know
+    * the round-trip time, this shrinks to fit stall_frames instead. */
+   netplay->stall_frames = NETPLAY_MAX_STALL_FRAMES;
+   netplay->buffer_size  = NETPLAY_MAX_STALL_FRAMES + 2;
 
    /* If we're the server, we need enough to get ahead AND behind by
     * MAX_STALL_FRAMES frame */
@@ -398,6 +409,152 @@ static bool netplay_init_buffers(netplay_t *netplay)
    return netplay_init_socket_buffers(netplay);
 }
 
+/* Where the given frame is in a buffer of size old_size, going by self */
+static size_t netplay_buffer_index(netplay_t *netplay, uint32_t frame,
+      size_t old_size)
+{
+   int32_t offset = (int32_t)(frame - netplay->self_frame_count);
+   return (netplay->self_ptr + old_size + offset) % old_size;
+}
+
+/**
+ * netplay_resize_buffer
+ *
+ * Change the number of frames in the state buffer, keeping every frame that
+ * is still in use at the same frame count and as many older ones as fit.
+ *
+ * Returns false if the frames in use don't fit or memory ran out, in which
+ * case nothing changed.
+ */
+bool netplay_resize_buffer(netplay_t *netplay, size_t size)
+{
+   struct delta_frame *buffer = NULL;
+   struct delta_frame *old    = netplay->buffer;
+   size_t old_size            = netplay->buffer_size;
+   void **spare               = NULL;
+   size_t spares              = 0;
+   uint32_t lo, hi, last, first, frame, client;
+   size_t i;
+
+   if (size == old_size)
+      return true;
+   if (netplay->is_replay || size < 3)
+      return false;
+
+   /* Every pointer into the buffer has a frame count to go with it. Find the
+    * range they span. */
+   lo = hi = netplay->self_frame_count;
+#define SPAN(count) do { \
+      if ((int32_t)((count) - lo) < 0) lo = (count); \
+      if ((int32_t)((count) - hi) > 0) hi = (count); \
+   } while (0)
+   SPAN(netplay->run_frame_count);
+   SPAN(netplay->other_frame_count);
+   SPAN(netplay->unread_frame_count);
+   SPAN(netplay->replay_frame_count);
+   if (!netplay->is_server)
+      SPAN(netplay->server_frame_count);
+   for (client = 0; client < MAX_CLIENTS; client++)
+      if (netplay->connected_players & (1 << client))
+         SPAN(netplay->read_frame_count[client]);
+#undef SPAN
+
+   if (hi - lo + 1 > size)
+      return false;
+
+   /* A reader can be a whole buffer ahead while it waits for the oldest
+    * frame's slot, and then its own frame isn't stored yet */
+   last = hi;
+   if (hi - lo + 1 > old_size)
+      last = lo + (uint32_t)old_size - 1;
+
+   buffer = (struct delta_frame*)calloc(size, sizeof(*buffer));
+   if (!buffer)
+      return false;
+
+   /* A bigger buffer needs more states, get them before touching anything */
+   if (netplay->state_size && size > old_size)
+   {
+      spare = (void**)calloc(size - old_size, sizeof(*spare));
+      if (!spare)
+      {
+         free(buffer);
+         return false;
+      }
+      for (spares = 0; spares < size - old_size; spares++)
+      {
+         spare[spares] = calloc(netplay->state_size, 1);
+         if (!spare[spares])
+         {
+            while (spares)
+               free(spare[--spares]);
+            free(spare);
+            free(buffer);
+            return false;
+         }
+      }
+   }
+
+   /* Move the frames in use, and older ones while they fit. The buffer is
+    * laid out afresh so that each frame sits at its count modulo size. */
+   first = (uint32_t)(size < old_size ? size : old_size);
+   first = last + 1 >= first ? last + 1 - first : 0;
+   for (frame = first; frame != last + 1; frame++)
+   {
+      struct delta_frame *src = &old[netplay_buffer_index(netplay, frame,
+            old_size)];
+      struct delta_frame *dst = &buffer[frame % size];
+
+      *dst = *src;
+      memset(src, 0, sizeof(*src));
+
+      /* Anything that isn't this frame is stale, keep just the memory */
+      if (dst->used && dst->frame != frame)
+         dst->used = false;
+   }
+
+   /* Hand out the remaining states to the new slots */
+   for (i = 0; i < size; i++)
+   {
+      if (buffer[i].state || !netplay->state_size)
+         continue;
+      if (spares)
+         buffer[i].state = spare[--spares];
+      else
+      {
+         size_t j;
+         for (j = 0; j < old_size; j++)
+         {
+            if (old[j].state)
+            {
+               buffer[i].state = old[j].state;
+               old[j].state    = NULL;
+               break;
+            }
+         }
+      }
+   }
+
+   for (i = 0; i < old_size; i++)
+      netplay_delta_frame_free(&old[i]);
+   free(old);
+   free(spare);
+
+   netplay->buffer      = buffer;
+   netplay->buffer_size = size;
+
+   netplay->self_ptr    = netplay->self_frame_count   % size;
+   netplay->run_ptr     = netplay->run_frame_count    % size;
+   netplay->other_ptr   = netplay->other_frame_count  % size;
+   netplay->unread_ptr  = netplay->unread_frame_count % size;
+   netplay->replay_ptr  = netplay->replay_frame_count % size;
+   netplay->server_ptr  = netplay->server_frame_count % size;
+   for (client = 0; client < MAX_CLIENTS; client++)
+      netplay->read_ptr[client] = netplay->read_frame_count[client] % size;
+
+   return true;
+}
+
 /**
  * netplay_new:
  * @direct_host          : Netplay host discovered from scanning.
@@ -420,11 +577,15 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
    uint64_t quirks)
 {
-   netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
+   settings_t *settings = config_get_ptr();
+   netplay_t *netplay   = (netplay_t*)calloc(1, sizeof(*netplay));
    if (!netplay)
       return NULL;
 
    netplay->listen_fd            = -1;
+   netplay->udp_fd               = -1;
+   netplay->udp_enabled          = settings->bools.netplay_udp_input;
+   netplay->hash_kernel          = netplay_hash_kernel_get(cpu_features_get());
    netplay->tcp_port             = port;
    netplay->cbs                  = *cb;
    netplay->is_server            = (direct_host == NULL && server == NULL);
@@ -506,12 +667,18 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
          goto error;
    }
 
+   /* Without it, spectators are simply served like anybody else */
+   if (netplay->is_server)
+      netplay_relay_init(netplay);
+
    return netplay;
 
 error:
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   netplay_udp_free(netplay);
+
    if (netplay->connections && netplay->connections[0].fd >= 0)
       socket_close(netplay->connections[0].fd);
 
@@ -529,9 +696,20 @@ void netplay_free(netplay_t *netplay)
 {
    size_t i;
 
+   RARCH_LOG("[netplay] Session: %u frames, %u stall frames, %u rollbacks "
+         "(%u frames replayed), %u resyncs.\n",
+         (unsigned)netplay->stat_frames,
+         (unsigned)netplay->stat_stall_frames,
+         (unsigned)netplay->stat_rollbacks,
+         (unsigned)netplay->cost_total.resim_frames,
+         (unsigned)netplay->stat_resyncs);
+
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   netplay_relay_free(netplay);
+   netplay_udp_free(netplay);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -560,6 +738,8 @@ void netplay_free(netplay_t *netplay)
    if (netplay->zbuffer)
       free(netplay->zbuffer);
 
+   netplay_state_delta_free(netplay);
+
    if (netplay->compress_nil.compression_stream)
    {
       netplay->compress_nil.compression_backend->stream_free(netplay->compress_nil.compression_stream);
@@ -114,6 +114,8 @@ void netplay_hangup(netplay_t *netplay,
    msg[0] = msg[sizeof(msg)-1] = '\0';
    dmsg = msg;
 
+   netplay_relay_detach(netplay, connection, false);
+
    /* Report this disconnection */
    if (netplay->is_server)
    {
@@ -139,7 +141,8 @@ void netplay_hangup(netplay_t *netplay,
    runloop_msg_queue_push(dmsg, 1, 180, false, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
 
    socket_close(connection->fd);
-   connection->active = false;
+   connection->active     = false;
+   connection->udp_active = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
 
@@ -228,13 +231,15 @@ void netplay_delayed_state_change(netplay_t *netplay)
    }
 }
 
-/* Send the specified input data */
-static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
-      struct netplay_connection *only, struct netplay_connection *except,
-      uint32_t client_num, bool slave)
-{
 #define BUFSZ 16 /* FIXME: Arbitrary restriction */
-   uint32_t buffer[BUFSZ], devices, device;
+
+/* Write the INPUT command for the specified input data into buffer, which
+ * must hold BUFSZ words. Returns the number of words used. */
+static size_t encode_input_frame(netplay_t *netplay,
+      struct delta_frame *dframe, uint32_t client_num, bool slave,
+      uint32_t *buffer)
+{
+   uint32_t devices, device;
    size_t bufused, i;
 
    /* Set up the basic buffer */
@@ -263,6 +268,19 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
    }
    buffer[1] = htonl((bufused-2) * sizeof(uint32_t));
 
+   return bufused;
+}
+
+/* Send the specified input data */
+static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
+      struct netplay_connection *only, struct netplay_connection *except,
+      uint32_t client_num, bool slave)
+{
+   uint32_t buffer[BUFSZ];
+   size_t bufused, i;
+
+   bufused = encode_input_frame(netplay, dframe, client_num, slave, buffer);
+
 #ifdef DEBUG_NETPLAY_STEPS
    RARCH_LOG("[netplay] Sending input for client %u\n", (unsigned) client_num);
    print_state(netplay);
@@ -270,6 +288,8 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
 
    if (only)
    {
+      netplay_relay_detach(netplay, only, true);
+
       if (!netplay_send(&only->send_packet_buffer, only->fd, buffer, bufused*sizeof(uint32_t)))
       {
          netplay_hangup(netplay, only);
@@ -281,7 +301,7 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
       for (i = 0; i < netplay->connections_size; i++)
       {
          struct netplay_connection *connection = &netplay->connections[i];
-         if (connection == except)
+         if (connection == except || connection->relayed)
             continue;
          if (connection->active &&
              connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
@@ -293,10 +313,12 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
                netplay_hangup(netplay, connection);
          }
       }
+
+      /* Relayed spectators are never the ones it came from */
+      netplay_relay_send(netplay, buffer, bufused*sizeof(uint32_t), false);
    }
 
    return true;
-#undef BUFSZ
 }
 
 /**
@@ -358,9 +380,52 @@ bool netplay_send_cur_input(netplay_t *netplay,
          false))
       return false;
 
+   netplay_udp_send_input(netplay, connection);
+
    return true;
 }
 
+/**
+ * netplay_send_cur_input_relay
+ *
+ * Send the current input frame to the spectators the relay is serving. It's
+ * the same for all of them, so it's only put together once.
+ */
+void netplay_send_cur_input_relay(netplay_t *netplay)
+{
+   uint32_t buffer[(MAX_CLIENTS + 1) * BUFSZ];
+   uint32_t from_client;
+   size_t bufused             = 0;
+   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+
+   if (!netplay_relay_active(netplay))
+      return;
+
+   for (from_client = 1; from_client < MAX_CLIENTS; from_client++)
+   {
+      if ((netplay->connected_players & (1<<from_client)) &&
+            dframe->have_real[from_client])
+         bufused += encode_input_frame(netplay, dframe, from_client, false,
+               buffer + bufused);
+   }
+
+   if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
+   {
+      buffer[bufused++] = htonl(NETPLAY_CMD_NOINPUT);
+      buffer[bufused++] = htonl(sizeof(uint32_t));
+      buffer[bufused++] = htonl(netplay->self_frame_count);
+   }
+
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING
+         || netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
+      bufused += encode_input_frame(netplay, dframe,
+            netplay->self_client_num,
+            netplay->self_mode == NETPLAY_CONNECTION_SLAVE, buffer + bufused);
+
+   netplay_relay_send(netplay, buffer, bufused * sizeof(uint32_t), false);
+}
+#undef BUFSZ
+
 /**
  * netplay_send_raw_cmd
  *
@@ -374,9 +439,15 @@ bool netplay_send_raw_cmd(netplay_t *netplay,
 {
    uint32_t cmdbuf[2];
 
+   /* It's for this connection alone, so the relay can't send it */
+   netplay_relay_detach(netplay, connection, true);
+
    cmdbuf[0] = htonl(cmd);
    cmdbuf[1] = htonl(size);
 
+   if (netplay_udp_is_barrier(cmd))
+      connection->udp_barrier_sent++;
+
    if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmdbuf,
          sizeof(cmdbuf)))
       return false;
@@ -399,10 +470,15 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
    size_t size)
 {
    size_t i;
+
+   /* The relay's stream goes to all its spectators */
+   if (except)
+      netplay_relay_detach(netplay, except, true);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection == except)
+      if (connection == except || connection->relayed)
          continue;
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
       {
@@ -410,6 +486,44 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
             netplay_hangup(netplay, connection);
       }
    }
+
+   netplay_relay_send_cmd(netplay, cmd, data, size);
+}
+
+/**
+ * netplay_input_received
+ *
+ * Mark a frame of input from the given client as read, after its data was
+ * copied into dframe.
+ */
+void netplay_input_received(netplay_t *netplay,
+   struct netplay_connection *connection, struct delta_frame *dframe,
+   uint32_t client_num)
+{
+   dframe->have_real[client_num] = true;
+
+   /* Slaves may go through several packets of data in the same frame
+    * if latency is choppy, so we advance and send their data after
+    * handling all network data this frame */
+   if (connection->mode == NETPLAY_CONNECTION_PLAYING)
+   {
+      netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
+      netplay->read_frame_count[client_num]++;
+
+      if (netplay->is_server)
+      {
+         /* Forward it on if it's past data */
+         if (dframe->frame <= netplay->self_frame_count)
+            send_input_frame(netplay, dframe, NULL, connection, client_num, false);
+      }
+   }
+
+   /* If this was server data, advance our server pointer too */
+   if (!netplay->is_server && client_num == 0)
+   {
+      netplay->server_ptr = netplay->read_ptr[0];
+      netplay->server_frame_count = netplay->read_frame_count[0];
+   }
 }
 
 /**
@@ -453,13 +567,39 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
    bool success = true;
    size_t i;
    payload[0] = htonl(delta->frame);
-   payload[1] = htonl(delta->crc);
    for (i = 0; i < netplay->connections_size; i++)
    {
-      if (netplay->connections[i].active &&
-            netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED)
-         success = netplay_send_raw_cmd(netplay, &netplay->connections[i],
-            NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active || connection->relayed ||
+            connection->mode < NETPLAY_CONNECTION_CONNECTED)
+         continue;
+
+      /* Each kind is only worked out if some peer wants it */
+      if (connection->fast_hash)
+      {
+         if (!delta->hash)
+            delta->hash = netplay_delta_frame_hash(netplay, delta);
+         payload[1] = htonl(delta->hash);
+      }
+      else
+      {
+         if (!delta->crc)
+            delta->crc = netplay_delta_frame_crc(netplay, delta);
+         payload[1] = htonl(delta->crc);
+      }
+
+      success = netplay_send_raw_cmd(netplay, connection,
+         NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
+   }
+
+   /* Relayed spectators all use the fast hash */
+   if (netplay_relay_active(netplay))
+   {
+      if (!delta->hash)
+         delta->hash = netplay_delta_frame_hash(netplay, delta);
+      payload[1] = htonl(delta->hash);
+      netplay_relay_send_cmd(netplay, NETPLAY_CMD_CRC, payload,
+            sizeof(payload));
    }
    return success;
 }
@@ -467,10 +607,14 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
 /**
  * netplay_cmd_request_savestate
  *
- * Send a savestate request command.
+ * Send a savestate request command. If the peer supports it, name the newest
+ * base state we share with it, so it can send a delta.
  */
 bool netplay_cmd_request_savestate(netplay_t *netplay)
 {
+   uint32_t payload[2];
+   struct netplay_state_base *base = NULL;
+
    if (netplay->connections_size == 0 ||
        !netplay->connections[0].active ||
        netplay->connections[0].mode < NETPLAY_CONNECTION_CONNECTED)
@@ -478,8 +622,18 @@ bool netplay_cmd_request_savestate(netplay_t *netplay)
    if (netplay->savestate_request_outstanding)
       return true;
    netplay->savestate_request_outstanding = true;
+
+   if (netplay->connections[0].delta_supported)
+      base = netplay_state_base_find(netplay, 0, 0, false);
+   if (!base)
+      return netplay_send_raw_cmd(netplay, &netplay->connections[0],
+         NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
+
+   payload[0] = htonl(base->frame);
+   payload[1] = htonl(netplay->connections[0].fast_hash ?
+         base->hash : base->crc);
    return netplay_send_raw_cmd(netplay, &netplay->connections[0],
-      NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
+      NETPLAY_CMD_REQUEST_SAVESTATE, payload, sizeof(payload));
 }
 
 /**
@@ -560,6 +714,81 @@ bool netplay_cmd_stall(netplay_t *netplay,
    return netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_STALL, &frames, sizeof(frames));
 }
 
+/**
+ * netplay_cmd_ping
+ *
+ * Send a PING to measure the round-trip time, if the peer supports it and
+ * it's time for one.
+ */
+void netplay_cmd_ping(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   retro_time_t now;
+   uint32_t cookie;
+   enum rarch_netplay_connection_mode mode = netplay->is_server ?
+      connection->mode : netplay->self_mode;
+
+   /* Only players care how far ahead they may run */
+   if (!connection->active || !connection->ping_supported ||
+         connection->relayed || mode < NETPLAY_CONNECTION_SLAVE)
+      return;
+
+   now = cpu_features_get_time_usec();
+
+   /* One at a time, but don't wait forever for a lost one */
+   if (connection->ping_outstanding)
+   {
+      if (now - connection->ping_time < 4 * NETPLAY_PING_INTERVAL_USEC)
+         return;
+   }
+   else if (connection->rtt &&
+         now - connection->ping_time < NETPLAY_PING_INTERVAL_USEC)
+      return;
+
+   connection->ping_cookie++;
+   connection->ping_time        = now;
+   connection->ping_outstanding = true;
+   cookie                = htonl(connection->ping_cookie);
+   netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_PING,
+         &cookie, sizeof(cookie));
+}
+
+/**
+ * netplay_pong_received
+ *
+ * Take a round-trip time sample from a PONG.
+ */
+static void netplay_pong_received(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t cookie)
+{
+   retro_time_t sample, err;
+
+   if (!connection->ping_outstanding || cookie != connection->ping_cookie)
+      return;
+
+   sample                       = cpu_features_get_time_usec() -
+      connection->ping_time;
+   connection->ping_outstanding = false;
+   if (sample <= 0)
+      sample = 1;
+
+   if (!connection->rtt)
+   {
+      connection->rtt     = sample;
+      connection->rtt_var = sample / 2;
+   }
+   else
+   {
+      err                 = sample - connection->rtt;
+      if (err < 0)
+         err = -err;
+      connection->rtt_var = (3 * connection->rtt_var + err) / 4;
+      connection->rtt     = (7 * connection->rtt + sample) / 8;
+      if (!connection->rtt)
+         connection->rtt  = 1;
+   }
+}
+
 /**
  * announce_play_spectate
  *
@@ -1032,8 +1261,17 @@ static bool netplay_get_cmd(netplay_t *netplay,
             dframe = &netplay->buffer[netplay->read_ptr[client_num]];
             if (!netplay_delta_frame_ready(netplay, dframe, netplay->read_frame_count[client_num]))
             {
-               /* Hopefully we'll be ready after another round of input */
-               goto shrt;
+               /* A peer with a wider window than ours got ahead. Waiting
+                * may not help, as the input we need to free the slot can be
+                * queued behind this */
+               if (!netplay_sync_grow_buffer(netplay))
+               {
+                  /* Hopefully we'll be ready after another round of input */
+                  goto shrt;
+               }
+               dframe = &netplay->buffer[netplay->read_ptr[client_num]];
+               if (!netplay_delta_frame_ready(netplay, dframe, netplay->read_frame_count[client_num]))
+                  goto shrt;
             }
 
             /* Copy in the input */
@@ -1059,30 +1297,9 @@ static bool netplay_get_cmd(netplay_t *netplay,
                for (di = 0; di < dsize; di++)
                   istate->data[di] = ntohl(istate->data[di]);
             }
-            dframe->have_real[client_num] = true;
-
-            /* Slaves may go through several packets of data in the same frame
-             * if latency is choppy, so we advance and send their data after
-             * handling all network data this frame */
+            netplay_input_received(netplay, connection, dframe, client_num);
             if (connection->mode == NETPLAY_CONNECTION_PLAYING)
-            {
-               netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
-               netplay->read_frame_count[client_num]++;
-
-               if (netplay->is_server)
-               {
-                  /* Forward it on if it's past data */
-                  if (dframe->frame <= netplay->self_frame_count)
-                     send_input_frame(netplay, dframe, NULL, connection, client_num, false);
-               }
-            }
-
-            /* If this was server data, advance our server pointer too */
-            if (!netplay->is_server && client_num == 0)
-            {
-               netplay->server_ptr = netplay->read_ptr[0];
-               netplay->server_frame_count = netplay->read_frame_count[0];
-            }
+               netplay->tcp_input_frames++;
 
 #ifdef DEBUG_NETPLAY_STEPS
             RARCH_LOG("[netplay] Received input from %u\n", client_num);
@@ -1544,34 +1761,73 @@ static bool netplay_get_cmd(netplay_t *netplay,
             {
                /* We've already replayed up to this frame, so we can check it
                 * directly */
-               uint32_t local_crc = netplay_delta_frame_crc(
-                     netplay, &netplay->buffer[tmp_ptr]);
+               uint32_t local_crc = connection->fast_hash
+                  ? netplay_delta_frame_hash(netplay, &netplay->buffer[tmp_ptr])
+                  : netplay_delta_frame_crc(netplay, &netplay->buffer[tmp_ptr]);
 
                /* Problem! */
                if (buffer[1] != local_crc)
                   netplay_cmd_request_savestate(netplay);
+               else
+               {
+                  if (connection->fast_hash)
+                     netplay->buffer[tmp_ptr].hash = local_crc;
+                  else
+                     netplay->buffer[tmp_ptr].crc  = local_crc;
+                  netplay_state_base_store(netplay,
+                        &netplay->buffer[tmp_ptr]);
+               }
             }
             else
             {
                /* We'll have to check it when we catch up */
-               netplay->buffer[tmp_ptr].crc = buffer[1];
+               if (connection->fast_hash)
+                  netplay->buffer[tmp_ptr].hash = buffer[1];
+               else
+                  netplay->buffer[tmp_ptr].crc  = buffer[1];
             }
 
             break;
          }
 
       case NETPLAY_CMD_REQUEST_SAVESTATE:
+         connection->savestate_base = false;
+
+         /* A delta-capable peer may name a base state it has */
+         if (cmd_size == 2*sizeof(uint32_t) && connection->delta_supported)
+         {
+            uint32_t base[2];
+
+            RECV(base, sizeof(base))
+            {
+               RARCH_ERR("NETPLAY_CMD_REQUEST_SAVESTATE failed to receive payload.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            connection->savestate_base_frame = ntohl(base[0]);
+            connection->savestate_base_crc   = ntohl(base[1]);
+            connection->savestate_base       = true;
+         }
+         else if (cmd_size)
+         {
+            RARCH_ERR("NETPLAY_CMD_REQUEST_SAVESTATE received unexpected payload size.\n");
+            return netplay_cmd_nak(netplay, connection);
+         }
+
          /* Delay until next frame so we don't send the savestate after the
           * input */
          netplay->force_send_savestate = true;
          break;
 
       case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
       case NETPLAY_CMD_RESET:
          {
             uint32_t frame;
             uint32_t isize;
             uint32_t rd, wn;
+            uint32_t base_info[3];
+            size_t header_size = 2*sizeof(uint32_t);
             uint32_t client;
             uint32_t load_frame_count;
             size_t load_ptr;
@@ -1622,8 +1878,10 @@ static bool netplay_get_cmd(netplay_t *netplay,
              * too many places. */
 
             /* Check the payload size */
-            if ((cmd == NETPLAY_CMD_LOAD_SAVESTATE &&
-                 (cmd_size < 2*sizeof(uint32_t) || cmd_size > netplay->zbuffer_size + 2*sizeof(uint32_t))) ||
+            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+               header_size += sizeof(base_info);
+            if ((cmd != NETPLAY_CMD_RESET &&
+                 (cmd_size < header_size || cmd_size > netplay->zbuffer_size + header_size)) ||
                 (cmd == NETPLAY_CMD_RESET && cmd_size != sizeof(uint32_t)))
             {
                RARCH_ERR("CMD_LOAD_SAVESTATE received an unexpected payload size.\n");
@@ -1661,7 +1919,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
             }
 
             /* Now we switch based on whether we're loading a state or resetting */
-            if (cmd == NETPLAY_CMD_LOAD_SAVESTATE)
+            if (cmd != NETPLAY_CMD_RESET)
             {
                RECV(&isize, sizeof(isize))
                {
@@ -1676,7 +1934,20 @@ static bool netplay_get_cmd(netplay_t *netplay,
                   return netplay_cmd_nak(netplay, connection);
                }
 
-               RECV(netplay->zbuffer, cmd_size - 2*sizeof(uint32_t))
+               /* A delta names its base state and the CRC of the result */
+               if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+               {
+                  RECV(base_info, sizeof(base_info))
+                  {
+                     RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive delta base.\n");
+                     return netplay_cmd_nak(netplay, connection);
+                  }
+                  base_info[0] = ntohl(base_info[0]);
+                  base_info[1] = ntohl(base_info[1]);
+                  base_info[2] = ntohl(base_info[2]);
+               }
+
+               RECV(netplay->zbuffer, cmd_size - header_size)
                {
                   RARCH_ERR("CMD_LOAD_SAVESTATE failed to receive savestate.\n");
                   return netplay_cmd_nak(netplay, connection);
@@ -1692,15 +1963,53 @@ static bool netplay_get_cmd(netplay_t *netplay,
                      ctrans = &netplay->compress_nil;
                }
                ctrans->decompression_backend->set_in(ctrans->decompression_stream,
-                  netplay->zbuffer, cmd_size - 2*sizeof(uint32_t));
-               ctrans->decompression_backend->set_out(ctrans->decompression_stream,
-                  (uint8_t*)netplay->buffer[load_ptr].state,
-                  (unsigned)netplay->state_size);
-               ctrans->decompression_backend->trans(ctrans->decompression_stream,
-                  true, &rd, &wn, NULL);
+                  netplay->zbuffer, (uint32_t)(cmd_size - header_size));
+
+               if (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA)
+               {
+                  struct netplay_state_base *base = netplay_state_base_find(
+                        netplay, base_info[0], base_info[1],
+                        connection->fast_hash);
+                  bool ok = false;
+
+                  if (base && netplay->delta_patch)
+                  {
+                     ctrans->decompression_backend->set_out(
+                        ctrans->decompression_stream, netplay->delta_patch,
+                        (uint32_t)state_delta_maxsize(netplay->state_size));
+                     ok = ctrans->decompression_backend->trans(
+                           ctrans->decompression_stream, true, &rd, &wn, NULL)
+                        && netplay_state_delta_decode(netplay, base, wn,
+                           base_info[2], connection->fast_hash,
+                           netplay->buffer[load_ptr].state);
+                  }
+
+                  /* We don't have the base it was made against after all,
+                   * fall back to a full savestate */
+                  if (!ok)
+                  {
+                     RARCH_WARN("[netplay] Savestate delta against frame %u "
+                           "failed, requesting a full savestate.\n",
+                           base_info[0]);
+                     netplay_state_bases_clear(netplay);
+                     netplay->savestate_request_outstanding = false;
+                     netplay_cmd_request_savestate(netplay);
+                     break;
+                  }
+               }
+               else
+               {
+                  ctrans->decompression_backend->set_out(
+                     ctrans->decompression_stream,
+                     (uint8_t*)netplay->buffer[load_ptr].state,
+                     (unsigned)netplay->state_size);
+                  ctrans->decompression_backend->trans(
+                     ctrans->decompression_stream, true, &rd, &wn, NULL);
+               }
 
                /* Force a rewind to the relevant frame */
                netplay->force_rewind = true;
+               netplay->stat_resyncs++;
             }
             else
             {
@@ -1837,11 +2146,66 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_UDP:
+         {
+            uint32_t token;
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("NETPLAY_CMD_UDP from client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size != sizeof(uint32_t))
+            {
+               RARCH_ERR("NETPLAY_CMD_UDP with incorrect payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(&token, sizeof(token))
+               return false;
+
+            if (!netplay_udp_accept(netplay, connection, ntohl(token)))
+               return netplay_cmd_nak(netplay, connection);
+            break;
+         }
+
+      case NETPLAY_CMD_PING:
+      case NETPLAY_CMD_PONG:
+         {
+            uint32_t cookie;
+
+            if (cmd_size != sizeof(uint32_t))
+            {
+               RARCH_ERR("NETPLAY_CMD_PING with incorrect payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(&cookie, sizeof(cookie))
+               return false;
+
+            if (cmd == NETPLAY_CMD_PING)
+            {
+               /* Answer right away, even if we're stalled, or the round
+                * trip would include our stall */
+               netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_PONG,
+                     &cookie, sizeof(cookie));
+               netplay_send_flush(&connection->send_packet_buffer,
+                     connection->fd, false);
+            }
+            else
+               netplay_pong_received(netplay, connection, ntohl(cookie));
+            break;
+         }
+
       default:
          RARCH_ERR("%s.\n", msg_hash_to_str(MSG_UNKNOWN_NETPLAY_COMMAND_RECEIVED));
          return netplay_cmd_nak(netplay, connection);
    }
 
+   if (netplay_udp_is_barrier(cmd))
+      connection->udp_barrier_recv++;
+
    netplay_recv_flush(&connection->recv_packet_buffer);
    netplay->timeout_cnt = 0;
    if (had_input)
@@ -1867,16 +2231,21 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
    int max_fd = 0;
    size_t i;
 
+   /* Take back any spectators that have something to say */
+   netplay_relay_poll(netplay);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
       if (connection->active && connection->fd >= max_fd)
          max_fd = connection->fd + 1;
    }
-
    if (max_fd == 0)
       return 0;
 
+   if (netplay->udp_fd >= max_fd)
+      max_fd = netplay->udp_fd + 1;
+
    netplay->timeout_cnt = 0;
 
    do
@@ -1885,11 +2254,16 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
 
       netplay->timeout_cnt++;
 
+      /* UDP input first, so that it isn't held up behind TCP */
+      if (netplay_udp_poll(netplay))
+         had_input = true;
+
       /* Read input from each connection */
       for (i = 0; i < netplay->connections_size; i++)
       {
          struct netplay_connection *connection = &netplay->connections[i];
-         if (connection->active && !netplay_get_cmd(netplay, connection, &had_input))
+         if (connection->active && !connection->relayed &&
+               !netplay_get_cmd(netplay, connection, &had_input))
             netplay_hangup(netplay, connection);
       }
 
@@ -1912,9 +2286,11 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
             for (i = 0; i < netplay->connections_size; i++)
             {
                struct netplay_connection *connection = &netplay->connections[i];
-               if (connection->active)
+               if (connection->active && !connection->relayed)
                   FD_SET(connection->fd, &fds);
             }
+            if (netplay->udp_fd >= 0)
+               FD_SET(netplay->udp_fd, &fds);
 
             if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
                return -1;
@@ -27,6 +27,7 @@
 
 #include "../../msg_hash.h"
 #include "../../verbosity.h"
+#include "../../managers/state_delta.h"
 
 #define NETPLAY_PROTOCOL_VERSION 5
 
@@ -54,6 +55,16 @@ typedef uint32_t client_bitmap_t;
 
 #define NETPLAY_MAX_STALL_FRAMES       60
 #define NETPLAY_FRAME_RUN_TIME_WINDOW  120
+
+/* With peers that answer PING, how far we may run ahead of them is sized
+ * from the round-trip time instead: its upper bound in frames plus input
+ * latency plus a margin, at least NETPLAY_MIN_STALL_FRAMES and at most
+ * NETPLAY_MAX_STALL_FRAMES. The state buffer follows, but only shrinks once
+ * the smaller window has held for NETPLAY_BUFFER_SHRINK_USEC. */
+#define NETPLAY_MIN_STALL_FRAMES       12
+#define NETPLAY_STALL_MARGIN_FRAMES    8
+#define NETPLAY_PING_INTERVAL_USEC     (1000*1000)
+#define NETPLAY_BUFFER_SHRINK_USEC     (5*1000*1000)
 #define NETPLAY_MAX_REQ_STALL_TIME     60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
@@ -89,12 +100,33 @@ typedef uint32_t client_bitmap_t;
 
 /* Compression protocols supported */
 #define NETPLAY_COMPRESSION_ZLIB (1<<0)
+/* Savestates can be sent as a delta against a common base state,
+ * see LOAD_SAVESTATE_DELTA */
+#define NETPLAY_COMPRESSION_DELTA (1<<1)
+/* Input may additionally be sent over UDP, see NETPLAY_CMD_UDP */
+#define NETPLAY_COMPRESSION_UDP (1<<2)
+/* States are checked with netplay_hash() instead of CRC-32, see CRC */
+#define NETPLAY_COMPRESSION_FAST_HASH (1<<3)
+/* PING is answered with PONG */
+#define NETPLAY_COMPRESSION_PING (1<<4)
 #if HAVE_ZLIB
-#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_ZLIB
+#define NETPLAY_COMPRESSION_SUPPORTED (NETPLAY_COMPRESSION_ZLIB | NETPLAY_COMPRESSION_DELTA | NETPLAY_COMPRESSION_UDP | NETPLAY_COMPRESSION_FAST_HASH | NETPLAY_COMPRESSION_PING)
 #else
-#define NETPLAY_COMPRESSION_SUPPORTED 0
+#define NETPLAY_COMPRESSION_SUPPORTED (NETPLAY_COMPRESSION_DELTA | NETPLAY_COMPRESSION_UDP | NETPLAY_COMPRESSION_FAST_HASH | NETPLAY_COMPRESSION_PING)
 #endif
 
+/* Number of CRC-checked states kept as bases for savestate deltas */
+#define NETPLAY_STATE_BASES 4
+
+/* UDP input packets: magic, and how many past frames each one repeats so
+ * that a lost packet is covered by the next one */
+#define NETPLAY_UDP_MAGIC      0x52415544 /* RAUD */
+#define NETPLAY_UDP_REDUNDANCY 8
+
+/* Uncomment to simulate a lossy network: drop this percentage of UDP input
+ * packets and hold back TCP sends for a moment at the same rate */
+/* #define DEBUG_NETPLAY_LOSS 3 */
+
 enum netplay_cmd
 {
    /* Basic commands */
@@ -166,6 +198,9 @@ enum netplay_cmd
    /* Sends over cheats enabled on client (unsupported) */
    NETPLAY_CMD_CHEATS         = 0x0047,
 
+   /* Send a savestate as a delta against a state both sides have */
+   NETPLAY_CMD_LOAD_SAVESTATE_DELTA = 0x0048,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -175,7 +210,15 @@ enum netplay_cmd
    /* CMD_CFG streamlines sending multiple
       configurations. This acknowledges
       each one individually */
-   NETPLAY_CMD_CFG_ACK        = 0x0062
+   NETPLAY_CMD_CFG_ACK        = 0x0062,
+
+   /* Server only: Tells the client the token to use for UDP input on the
+    * server's port */
+   NETPLAY_CMD_UDP            = 0x0063,
+
+   /* Round-trip time measurement, PONG echoes the PING */
+   NETPLAY_CMD_PING           = 0x0064,
+   NETPLAY_CMD_PONG           = 0x0065
 };
 
 #define NETPLAY_CMD_SYNC_BIT_PAUSED    (1U<<31)
@@ -304,6 +347,9 @@ struct delta_frame
    /* The CRC-32 of the serialized state if we've calculated it, else 0 */
    uint32_t crc;
 
+   /* Likewise its netplay_hash(), for peers which check states with that */
+   uint32_t hash;
+
    /* The simulated input. is_real here means the simulation is done, i.e.,
     * it's a real simulation, not real input. */
    netplay_input_state_t simlated_input[MAX_INPUT_DEVICES];
@@ -317,6 +363,40 @@ struct delta_frame
    bool used; /* a bit derpy, but this is how we know if the delta's been used at all */
 };
 
+/* Time spent saving, loading and rerunning frames for rollback */
+struct netplay_frame_cost
+{
+   retro_time_t serialize;
+   retro_time_t unserialize;
+   retro_time_t resim;
+
+   /* Frames rerun */
+   uint32_t resim_frames;
+};
+
+/* A state whose CRC was checked against the server's, which
+ * savestates can be sent as a delta against */
+struct netplay_state_base
+{
+   /* From state_delta_alloc() */
+   void *state;
+
+   uint32_t frame;
+   uint32_t crc;
+   uint32_t hash;
+
+   bool used;
+};
+
+typedef struct netplay_hash_kernel
+{
+   /* Consume whole 1KiB blocks into the eight lane accumulators */
+   void (*accumulate)(uint64_t *acc, const uint8_t *data, size_t blocks);
+   /* RETRO_SIMD_* flags this kernel needs at runtime */
+   uint64_t simd;
+   const char *ident;
+} netplay_hash_kernel_t;
+
 struct socket_buffer
 {
    unsigned char *data;
@@ -324,6 +404,9 @@ struct socket_buffer
    size_t start;
    size_t end;
    size_t read;
+#ifdef DEBUG_NETPLAY_LOSS
+   retro_time_t hold_until;
+#endif
 };
 
 /* Each connection gets a connection struct */
@@ -332,9 +415,20 @@ struct netplay_connection
    /* Is this connection stalling? */
    retro_time_t stall_time;
 
+   /* When our outstanding PING was sent (0 if none), and the smoothed
+    * round-trip time to this peer and its mean deviation, in the manner of
+    * TCP (0 until measured) */
+   retro_time_t ping_time;
+   retro_time_t rtt;
+   retro_time_t rtt_var;
+
    /* Address of peer */
    struct sockaddr_storage addr;
 
+   /* Where to send UDP input to this peer */
+   struct sockaddr_storage udp_addr;
+   socklen_t udp_addr_len;
+
    /* Buffers for sending and receiving data */
    struct socket_buffer send_packet_buffer, recv_packet_buffer;
 
@@ -349,6 +443,10 @@ struct netplay_connection
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
+   /* The base state this peer asked for a savestate delta against */
+   uint32_t savestate_base_frame;
+   uint32_t savestate_base_crc;
+
    /* For the server: When was the last time we requested this client to stall?
     * For the client: How many frames of stall do we have left? */
    uint32_t stall_frame;
@@ -356,6 +454,21 @@ struct netplay_connection
    /* Salt associated with password transaction */
    uint32_t salt;
 
+   /* Token identifying this connection's UDP input packets */
+   uint32_t udp_token;
+
+   /* The first frame of our input the peer hasn't acknowledged over UDP */
+   uint32_t udp_ack;
+
+   /* Payload of our outstanding PING */
+   uint32_t ping_cookie;
+
+   /* Number of TCP commands sent to and received from this peer that UDP
+    * input must not overtake. UDP input is only used if the sender had sent
+    * exactly as many of these as we've received. */
+   uint32_t udp_barrier_sent;
+   uint32_t udp_barrier_recv;
+
    /* Is this connection stalling? */
    enum rarch_netplay_stall_reason stall;
 
@@ -373,6 +486,28 @@ struct netplay_connection
 
    /* Is this connection buffer in use? */
    bool active;
+
+   /* Does this peer understand savestate deltas? */
+   bool delta_supported;
+
+   /* Do we check states with this peer using netplay_hash()? */
+   bool fast_hash;
+
+   /* Did this peer ask for a savestate with a base state? */
+   bool savestate_base;
+
+   /* Does this peer accept UDP input? */
+   bool udp_supported;
+
+   /* Is UDP input set up with this peer? */
+   bool udp_active;
+
+   /* Is this spectator being served by the relay thread? */
+   bool relayed;
+
+   /* Does this peer answer PING, and are we waiting for a PONG? */
+   bool ping_supported;
+   bool ping_outstanding;
 };
 
 /* Compression transcoder */
@@ -390,6 +525,8 @@ struct netplay
    retro_time_t catch_up_time;
    /* How long have we been stalled? */
    retro_time_t stall_time;
+   /* Since when could the state buffer be smaller (0 if not) */
+   retro_time_t shrink_time;
 
    /* We stall if we're far enough ahead that we couldn't transparently rewind.
     * To know if we could transparently rewind, we need to know how long
@@ -403,9 +540,36 @@ struct netplay
    /* TCP connection for listening (server only) */
    int listen_fd;
 
+   /* UDP socket for input, on the server bound to the same port as
+    * listen_fd, or -1 */
+   int udp_fd;
+
+   /* Spectator relay (server only), or NULL */
+   struct netplay_relay *relay;
+
+   /* Frames of remote input that arrived first over UDP and TCP */
+   uint32_t udp_input_frames;
+   uint32_t tcp_input_frames;
+
+   /* Rollback cost of the current and the previous frame, and of the whole
+    * session. Also fed to the performance counters if perfcnt_enable. */
+   struct netplay_frame_cost cost_frame;
+   struct netplay_frame_cost cost_last;
+   struct netplay_frame_cost cost_total;
+
+   /* Session statistics, logged when netplay is freed */
+   uint32_t stat_frames;
+   uint32_t stat_stall_frames;
+   uint32_t stat_rollbacks;
+   uint32_t stat_resyncs;
+
    /* Our client number */
    uint32_t self_client_num;
 
+   /* How many frames ahead of the slowest peer we may run before stalling,
+    * see NETPLAY_MIN_STALL_FRAMES */
+   uint32_t stall_frames;
+
    /* All of our connections */
    struct netplay_connection *connections;
    size_t connections_size;
@@ -453,6 +617,20 @@ struct netplay
    uint8_t *zbuffer;
    size_t zbuffer_size;
 
+   /* Base states for savestate deltas, used as a ring */
+   struct netplay_state_base state_bases[NETPLAY_STATE_BASES];
+   size_t state_base_ptr;
+
+   /* Savestate delta scratch space, allocated on first use: the
+    * uncompressed patch and a state_delta_alloc() copy of the state
+    * being encoded or decoded */
+   const state_delta_kernel_t *delta_kernel;
+   uint8_t *delta_patch;
+   void *delta_state;
+
+   /* Kernel for netplay_hash() */
+   const netplay_hash_kernel_t *hash_kernel;
+
    /* The size of our packet buffers */
    size_t packet_buffer_size;
 
@@ -523,6 +701,9 @@ struct netplay
 
    bool nat_traversal, nat_traversal_task_oustanding;
 
+   /* Should we offer or accept UDP input? */
+   bool udp_enabled;
+
    /* Set to true if we have a device that most cores translate to "up/down"
     * actions, typically a keyboard. We need to keep track of this because with
     * such a device, we need to "fix" the input state to the frame BEFORE a
@@ -533,6 +714,9 @@ struct netplay
    /* Are we replaying old frames? */
    bool is_replay;
 
+   /* Are the performance counters on for this frame? */
+   bool perfcnt_enable;
+
    /* We don't want to poll several times on a frame. */
    bool can_poll;
 
@@ -670,6 +854,21 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
  */
 uint32_t netplay_delta_frame_crc(netplay_t *netplay, struct delta_frame *delta);
 
+/**
+ * netplay_delta_frame_hash
+ *
+ * Get the netplay_hash() of the serialization of this frame.
+ */
+uint32_t netplay_delta_frame_hash(netplay_t *netplay, struct delta_frame *delta);
+
+/**
+ * netplay_state_check
+ *
+ * Get the CRC-32 or, if fast, the netplay_hash() of a whole state.
+ */
+uint32_t netplay_state_check(netplay_t *netplay, const void *state,
+      bool fast);
+
 /**
  * netplay_delta_frame_free
  *
@@ -677,6 +876,62 @@ uint32_t netplay_delta_frame_crc(netplay_t *netplay, struct delta_frame *delta);
  */
 void netplay_delta_frame_free(struct delta_frame *delta);
 
+/**
+ * netplay_state_base_store
+ *
+ * Remember the state of a delta frame whose CRC or hash is known to match on
+ * both sides, as a base for savestate deltas.
+ */
+void netplay_state_base_store(netplay_t *netplay, struct delta_frame *delta);
+
+/**
+ * netplay_state_base_find
+ *
+ * Find a stored base state by frame and CRC, or hash if fast. With frame and
+ * CRC both 0, find the newest one.
+ *
+ * Returns: The base state, or NULL if there is none.
+ */
+struct netplay_state_base *netplay_state_base_find(netplay_t *netplay,
+      uint32_t frame, uint32_t crc, bool fast);
+
+/**
+ * netplay_state_bases_clear
+ *
+ * Forget all base states, e.g. after a failed delta.
+ */
+void netplay_state_bases_clear(netplay_t *netplay);
+
+/**
+ * netplay_state_delta_encode
+ *
+ * Encode the patch turning base into state into netplay->delta_patch,
+ * as little-endian 16-bit words.
+ *
+ * Returns: The size of the patch in bytes, or 0 on failure.
+ */
+size_t netplay_state_delta_encode(netplay_t *netplay,
+      const struct netplay_state_base *base, const void *state);
+
+/**
+ * netplay_state_delta_decode
+ *
+ * Apply the patch of the given size in netplay->delta_patch to base. If the
+ * result has the given CRC, or hash if fast, write it to state.
+ *
+ * Returns: True if state was written.
+ */
+bool netplay_state_delta_decode(netplay_t *netplay,
+      const struct netplay_state_base *base, size_t patch_size,
+      uint32_t crc, bool fast, void *state);
+
+/**
+ * netplay_state_delta_free
+ *
+ * Free the base states and delta scratch space.
+ */
+void netplay_state_delta_free(netplay_t *netplay);
+
 /**
  * netplay_input_state_for
  *
@@ -734,6 +989,25 @@ uint8_t netplay_settings_share_mode(unsigned share_digital, unsigned share_analo
  */
 void input_poll_net(void);
 
+/***************************************************************
+ * NETPLAY-HASH.C
+ **************************************************************/
+
+/**
+ * netplay_hash_kernel_get
+ *
+ * Get the fastest hash kernel usable with the given CPU features.
+ */
+const netplay_hash_kernel_t *netplay_hash_kernel_get(uint64_t cpu);
+
+/**
+ * netplay_hash
+ *
+ * Hash a buffer with the given kernel. Every kernel gives the same result.
+ */
+uint32_t netplay_hash(const netplay_hash_kernel_t *kernel,
+      const void *data, size_t len);
+
 /***************************************************************
  * NETPLAY-HANDSHAKE.C
  **************************************************************/
@@ -777,6 +1051,17 @@ bool netplay_try_init_serialization(netplay_t *netplay);
  */
 bool netplay_wait_and_init_serialization(netplay_t *netplay);
 
+/**
+ * netplay_resize_buffer
+ *
+ * Change the number of frames in the state buffer, keeping every frame that
+ * is still in use at the same frame count and as many older ones as fit.
+ *
+ * Returns false if the frames in use don't fit or memory ran out, in which
+ * case nothing changed.
+ */
+bool netplay_resize_buffer(netplay_t *netplay, size_t size);
+
 /**
  * netplay_new:
  * @direct_host          : Netplay host discovered from scanning.
@@ -836,6 +1121,14 @@ void netplay_delayed_state_change(netplay_t *netplay);
 bool netplay_send_cur_input(netplay_t *netplay,
    struct netplay_connection *connection);
 
+/**
+ * netplay_send_cur_input_relay
+ *
+ * Send the current input frame to the spectators the relay is serving. It's
+ * the same for all of them, so it's only put together once.
+ */
+void netplay_send_cur_input_relay(netplay_t *netplay);
+
 /**
  * netplay_send_raw_cmd
  *
@@ -857,6 +1150,16 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
    struct netplay_connection *except, uint32_t cmd, const void *data,
    size_t size);
 
+/**
+ * netplay_input_received
+ *
+ * Mark a frame of input from the given client as read, after its data was
+ * copied into dframe.
+ */
+void netplay_input_received(netplay_t *netplay,
+   struct netplay_connection *connection, struct delta_frame *dframe,
+   uint32_t client_num);
+
 /**
  * netplay_cmd_crc
  *
@@ -889,6 +1192,15 @@ bool netplay_cmd_stall(netplay_t *netplay,
    struct netplay_connection *connection,
    uint32_t frames);
 
+/**
+ * netplay_cmd_ping
+ *
+ * Send a PING to measure the round-trip time, if the peer supports it and
+ * it's time for one.
+ */
+void netplay_cmd_ping(netplay_t *netplay,
+   struct netplay_connection *connection);
+
 /**
  * netplay_poll_net_input
  *
@@ -943,6 +1255,74 @@ uint32_t netplay_key_hton(unsigned key);
  * netplay_key_hton */
 void netplay_key_hton_init(void);
 
+/***************************************************************
+ * NETPLAY-RELAY.C
+ **************************************************************/
+
+/**
+ * netplay_relay_init
+ *
+ * Server only: Start the spectator relay, if enabled.
+ */
+bool netplay_relay_init(netplay_t *netplay);
+
+/**
+ * netplay_relay_free
+ *
+ * Stop the spectator relay. Connections it was serving aren't closed.
+ */
+void netplay_relay_free(netplay_t *netplay);
+
+/**
+ * netplay_relay_active
+ *
+ * Is the relay serving any spectators? If not, there's no need to send it
+ * anything.
+ */
+bool netplay_relay_active(netplay_t *netplay);
+
+/**
+ * netplay_relay_send
+ *
+ * Send data to every spectator the relay is serving. barrier says whether it
+ * starts a command that UDP input must not overtake.
+ */
+void netplay_relay_send(netplay_t *netplay, const void *data, size_t size,
+   bool barrier);
+
+/**
+ * netplay_relay_send_cmd
+ *
+ * Send a command to every spectator the relay is serving.
+ */
+void netplay_relay_send_cmd(netplay_t *netplay, uint32_t cmd,
+   const void *data, size_t size);
+
+/**
+ * netplay_relay_attach_ready
+ *
+ * Hand every spectator that's caught up and has nothing else going on over
+ * to the relay.
+ */
+void netplay_relay_attach_ready(netplay_t *netplay);
+
+/**
+ * netplay_relay_detach
+ *
+ * Take a spectator back from the relay. If keep is set, whatever the relay
+ * hadn't sent it yet is queued in its own send buffer.
+ */
+void netplay_relay_detach(netplay_t *netplay,
+   struct netplay_connection *connection, bool keep);
+
+/**
+ * netplay_relay_poll
+ *
+ * Take back every spectator that needs the main thread's attention. Those the
+ * relay couldn't keep up with are disconnected.
+ */
+void netplay_relay_poll(netplay_t *netplay);
+
 /***************************************************************
  * NETPLAY-SYNC.C
  **************************************************************/
@@ -986,4 +1366,83 @@ bool netplay_sync_pre_frame(netplay_t *netplay);
  */
 void netplay_sync_post_frame(netplay_t *netplay, bool stalled);
 
+/**
+ * netplay_sync_update_window
+ * @netplay              : pointer to netplay object
+ *
+ * Size stall_frames from the measured round-trip times, and the state buffer
+ * with it.
+ */
+void netplay_sync_update_window(netplay_t *netplay);
+
+/**
+ * netplay_sync_grow_buffer
+ * @netplay              : pointer to netplay object
+ *
+ * Grow the state buffer to make room for input from a peer that is further
+ * ahead than our own window allows.
+ *
+ * Returns true if the buffer grew.
+ */
+bool netplay_sync_grow_buffer(netplay_t *netplay);
+
+/***************************************************************
+ * NETPLAY-UDP.C
+ **************************************************************/
+
+/**
+ * netplay_udp_init_server
+ *
+ * Open the server's UDP input socket on the same address and port as the
+ * listening socket.
+ */
+bool netplay_udp_init_server(netplay_t *netplay);
+
+/**
+ * netplay_udp_offer
+ *
+ * Server only: Offer UDP input to a freshly connected client.
+ */
+bool netplay_udp_offer(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_udp_accept
+ *
+ * Client only: Set up UDP input to the server with the offered token.
+ */
+bool netplay_udp_accept(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t token);
+
+/**
+ * netplay_udp_is_barrier
+ *
+ * Is this a command which UDP input must not overtake?
+ */
+bool netplay_udp_is_barrier(uint32_t cmd);
+
+/**
+ * netplay_udp_send_input
+ *
+ * Send our recent input to the given connection over UDP, if set up.
+ */
+void netplay_udp_send_input(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_udp_poll
+ *
+ * Read any pending UDP input.
+ *
+ * Returns true if any new input was received.
+ */
+bool netplay_udp_poll(netplay_t *netplay);
+
+/**
+ * netplay_udp_free
+ *
+ * Close the UDP input socket.
+ */
+void netplay_udp_free(netplay_t *netplay);
+
 #endif
@@ -0,0 +1,818 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Spectator relay. Every spectator which is merely watching gets exactly the
+ * same bytes, so the server writes them once into a shared, append-only
+ * stream, and a thread of its own sends that stream on to each of them from
+ * wherever they're up to. The main thread only takes a spectator back when it
+ * has something to say to it alone, which starts with anything the spectator
+ * says to us. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <boolean.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include "netplay_private.h"
+
+#include "../../configuration.h"
+
+#if defined(__linux__) && !defined(HAVE_SOCKET_LEGACY)
+#define HAVE_RELAY_EPOLL 1
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#ifdef HAVE_THREADS
+
+#define RELAY_CHUNK_SIZE  (64 * 1024)
+#define RELAY_MAX_EVENTS  64
+/* Without epoll, how often the thread looks for something said by the
+ * spectators it's serving */
+#define RELAY_WAIT_USEC   2000
+#define RELAY_WAKE_EVENT  0xFFFFFFFF
+
+struct relay_chunk
+{
+   struct relay_chunk *next;
+   uint64_t start; /* Stream offset of data[0] */
+   size_t used, size;
+   uint8_t data[1];
+};
+
+struct relay_peer
+{
+   struct relay_chunk *chunk; /* The chunk holding sent */
+   uint64_t sent;             /* Stream offset sent so far */
+   uint32_t barriers;         /* relay->barriers when attached */
+   int fd;
+   bool active;    /* This connection is ours */
+   bool busy;      /* The thread is sending to it */
+   bool blocked;   /* Waiting for the socket to be writable */
+   bool detaching; /* The main thread is taking it back */
+   bool attention; /* The main thread needs to take it back */
+   bool failed;    /* It fell too far behind */
+};
+
+struct netplay_relay
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+
+   /* The stream, head to tail, and its total length */
+   struct relay_chunk *head, *tail;
+   uint64_t end;
+
+   /* How far behind a spectator may fall before we give up on it */
+   size_t limit;
+
+   /* Number of commands in the stream UDP input must not overtake */
+   uint32_t barriers;
+
+   /* Indexed like netplay->connections */
+   struct relay_peer *peers;
+   size_t peers_size;
+
+   /* Main thread only: How many peers are active */
+   size_t count;
+
+   /* Some peer has attention set */
+   bool attention;
+
+   /* The thread is waiting, and must be woken for new data */
+   bool sleeping;
+   bool quit;
+
+#ifdef HAVE_RELAY_EPOLL
+   int epoll_fd, wake_fd;
+#endif
+};
+
+/* Move the peer onto the next chunk if it's done with this one */
+static void relay_peer_advance(struct netplay_relay *relay,
+      struct relay_peer *peer)
+{
+   while (peer->chunk->next &&
+         peer->sent == peer->chunk->start + peer->chunk->used)
+      peer->chunk = peer->chunk->next;
+}
+
+/* Free every chunk no peer needs anymore. The tail always stays. */
+static void relay_trim(struct netplay_relay *relay)
+{
+   while (relay->head != relay->tail)
+   {
+      size_t i;
+      for (i = 0; i < relay->peers_size; i++)
+      {
+         struct relay_peer *peer = &relay->peers[i];
+         if (peer->active && peer->chunk == relay->head)
+            break;
+      }
+      if (i < relay->peers_size)
+         break;
+
+      {
+         struct relay_chunk *chunk = relay->head;
+         relay->head               = chunk->next;
+         free(chunk);
+      }
+   }
+}
+
+/* Wake the thread if it's waiting. Must hold the lock. */
+static void relay_wake(struct netplay_relay *relay)
+{
+   if (!relay->sleeping)
+      return;
+   relay->sleeping = false;
+#ifdef HAVE_RELAY_EPOLL
+   {
+      uint64_t one = 1;
+      if (write(relay->wake_fd, &one, sizeof(one)) < 0) { }
+   }
+#endif
+   scond_broadcast(relay->cond);
+}
+
+/* Flag a peer for the main thread. Must hold the lock. */
+static void relay_need_attention(struct netplay_relay *relay,
+      struct relay_peer *peer, bool failed)
+{
+#ifdef HAVE_RELAY_EPOLL
+   /* Otherwise we'd hear about it again and again until it's taken back */
+   epoll_ctl(relay->epoll_fd, EPOLL_CTL_DEL, peer->fd, NULL);
+#endif
+   peer->attention  = true;
+   peer->failed     = peer->failed || failed;
+   relay->attention = true;
+}
+
+/* Send as much as the socket takes to one peer. Must hold the lock, which is
+ * dropped while sending. */
+static void relay_send_peer(struct netplay_relay *relay, size_t idx)
+{
+   struct relay_peer *peer = &relay->peers[idx];
+
+   if (!peer->active || peer->attention || peer->detaching)
+      return;
+
+   if (relay->end - peer->sent > relay->limit)
+   {
+      relay_need_attention(relay, peer, true);
+      return;
+   }
+
+   while (peer->active && !peer->attention && !peer->detaching &&
+          !peer->blocked && peer->sent < relay->end)
+   {
+      ssize_t sent;
+      struct relay_chunk *chunk;
+      size_t offset, len;
+      int fd;
+
+      relay_peer_advance(relay, peer);
+      chunk  = peer->chunk;
+      offset = (size_t)(peer->sent - chunk->start);
+      len    = chunk->used - offset;
+      fd     = peer->fd;
+
+      /* The chunk can't go away while we're busy with it, nor can the peer */
+      peer->busy = true;
+      slock_unlock(relay->lock);
+      sent = socket_send_all_nonblocking(fd, chunk->data + offset, len,
+            true);
+      slock_lock(relay->lock);
+      peer       = &relay->peers[idx];
+      peer->busy = false;
+      scond_broadcast(relay->cond);
+
+      /* The main thread will find out what's wrong by itself */
+      if (sent < 0)
+      {
+         relay_need_attention(relay, peer, false);
+         return;
+      }
+
+      peer->sent += sent;
+      if ((size_t)sent < len)
+      {
+         peer->blocked = true;
+#ifdef HAVE_RELAY_EPOLL
+         {
+            struct epoll_event event;
+            event.events   = EPOLLIN | EPOLLOUT;
+            event.data.u32 = (uint32_t)idx;
+            epoll_ctl(relay->epoll_fd, EPOLL_CTL_MOD, peer->fd, &event);
+         }
+#endif
+      }
+   }
+}
+
+/* Is there anything we could send right away? Must hold the lock. */
+static bool relay_pending(struct netplay_relay *relay)
+{
+   size_t i;
+   for (i = 0; i < relay->peers_size; i++)
+   {
+      struct relay_peer *peer = &relay->peers[i];
+      if (peer->active && !peer->attention && !peer->detaching &&
+            !peer->blocked && peer->sent < relay->end)
+         return true;
+   }
+   return false;
+}
+
+#ifdef HAVE_RELAY_EPOLL
+/* Wait for something to do. Must hold the lock, which is dropped while
+ * waiting. */
+static void relay_wait(struct netplay_relay *relay)
+{
+   struct epoll_event events[RELAY_MAX_EVENTS];
+   int i, n;
+   /* Everything it waits for, the sockets included, wakes it */
+   int timeout     = relay_pending(relay) ? 0 : -1;
+
+   relay->sleeping = timeout != 0;
+   slock_unlock(relay->lock);
+   n = epoll_wait(relay->epoll_fd, events, RELAY_MAX_EVENTS, timeout);
+   slock_lock(relay->lock);
+   relay->sleeping = false;
+
+   for (i = 0; i < n; i++)
+   {
+      struct relay_peer *peer;
+      uint32_t idx = events[i].data.u32;
+
+      if (idx == RELAY_WAKE_EVENT)
+      {
+         uint64_t val;
+         if (read(relay->wake_fd, &val, sizeof(val)) < 0) { }
+         continue;
+      }
+
+      /* It may have been taken back since */
+      if (idx >= relay->peers_size)
+         continue;
+      peer = &relay->peers[idx];
+      if (!peer->active || peer->attention || peer->detaching)
+         continue;
+
+      if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+         relay_need_attention(relay, peer, false);
+      else if ((events[i].events & EPOLLOUT) && peer->blocked)
+      {
+         struct epoll_event event;
+         event.events   = EPOLLIN;
+         event.data.u32 = idx;
+         epoll_ctl(relay->epoll_fd, EPOLL_CTL_MOD, peer->fd, &event);
+         peer->blocked  = false;
+      }
+   }
+}
+#else
+static void relay_wait(struct netplay_relay *relay)
+{
+   fd_set readfds, writefds;
+   struct timeval tv = {0};
+   size_t i;
+   int ret;
+   int max_fd        = 0;
+   bool blocked      = false;
+   bool serving      = false;
+
+   for (i = 0; i < relay->peers_size; i++)
+   {
+      struct relay_peer *peer = &relay->peers[i];
+      if (peer->active)
+         serving = true;
+      if (peer->active && peer->blocked)
+         blocked = true;
+   }
+
+   /* Nobody to serve, so there's nothing to look out for either */
+   if (!serving)
+   {
+      relay->sleeping = true;
+      scond_wait(relay->cond, relay->lock);
+      relay->sleeping = false;
+      return;
+   }
+
+   /* Nothing to send, so sleep until there is */
+   if (!blocked && !relay_pending(relay))
+   {
+      relay->sleeping = true;
+      scond_wait_timeout(relay->cond, relay->lock, RELAY_WAIT_USEC);
+      relay->sleeping = false;
+   }
+
+   FD_ZERO(&readfds);
+   FD_ZERO(&writefds);
+   for (i = 0; i < relay->peers_size; i++)
+   {
+      struct relay_peer *peer = &relay->peers[i];
+      if (!peer->active || peer->attention || peer->detaching)
+         continue;
+      FD_SET(peer->fd, &readfds);
+      if (peer->blocked)
+         FD_SET(peer->fd, &writefds);
+      if (peer->fd >= max_fd)
+         max_fd = peer->fd + 1;
+   }
+   if (!max_fd)
+      return;
+   if (blocked && !relay_pending(relay))
+      tv.tv_usec = RELAY_WAIT_USEC;
+
+   slock_unlock(relay->lock);
+   ret = socket_select(max_fd, &readfds, &writefds, NULL, &tv);
+   slock_lock(relay->lock);
+   if (ret <= 0)
+      return;
+
+   for (i = 0; i < relay->peers_size; i++)
+   {
+      struct relay_peer *peer = &relay->peers[i];
+      if (!peer->active || peer->attention || peer->detaching)
+         continue;
+      if (FD_ISSET(peer->fd, &readfds))
+         relay_need_attention(relay, peer, false);
+      else if (FD_ISSET(peer->fd, &writefds))
+         peer->blocked = false;
+   }
+}
+#endif
+
+static void relay_thread(void *data)
+{
+   struct netplay_relay *relay = (struct netplay_relay*)data;
+
+   slock_lock(relay->lock);
+   while (!relay->quit)
+   {
+      size_t i;
+
+      for (i = 0; i < relay->peers_size; i++)
+         relay_send_peer(relay, i);
+
+      relay_trim(relay);
+      relay_wait(relay);
+   }
+   slock_unlock(relay->lock);
+}
+
+/* Append to the stream. Must hold the lock. */
+static bool relay_append(struct netplay_relay *relay, const void *data,
+      size_t size)
+{
+   struct relay_chunk *tail = relay->tail;
+
+   if (!tail || tail->size - tail->used < size)
+   {
+      size_t chunk_size = size > RELAY_CHUNK_SIZE ? size : RELAY_CHUNK_SIZE;
+      struct relay_chunk *chunk = (struct relay_chunk*)
+         malloc(sizeof(struct relay_chunk) + chunk_size);
+      if (!chunk)
+         return false;
+      chunk->next  = NULL;
+      chunk->start = relay->end;
+      chunk->used  = 0;
+      chunk->size  = chunk_size;
+      if (tail)
+         tail->next  = chunk;
+      else
+         relay->head = chunk;
+      relay->tail = tail = chunk;
+   }
+
+   if (size)
+      memcpy(tail->data + tail->used, data, size);
+   tail->used += size;
+   relay->end += size;
+   return true;
+}
+
+#endif
+
+/**
+ * netplay_relay_init
+ *
+ * Server only: Start the spectator relay, if enabled.
+ */
+bool netplay_relay_init(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   settings_t *settings = config_get_ptr();
+   struct netplay_relay *relay;
+
+   if (!netplay->is_server || !settings->bools.netplay_spectator_relay)
+      return false;
+
+   relay = (struct netplay_relay*)calloc(1, sizeof(*relay));
+   if (!relay)
+      return false;
+
+#ifdef HAVE_RELAY_EPOLL
+   relay->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+   relay->wake_fd  = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+   if (relay->epoll_fd >= 0 && relay->wake_fd >= 0)
+   {
+      struct epoll_event event;
+      event.events   = EPOLLIN;
+      event.data.u32 = RELAY_WAKE_EVENT;
+      if (epoll_ctl(relay->epoll_fd, EPOLL_CTL_ADD, relay->wake_fd,
+               &event) < 0)
+         goto error;
+   }
+   else
+      goto error;
+#endif
+
+   relay->lock  = slock_new();
+   relay->cond  = scond_new();
+   if (!relay->lock || !relay->cond)
+      goto error;
+
+   /* The thread is only started once there's a spectator to serve */
+   netplay->relay = relay;
+   RARCH_LOG("[netplay] Spectators will be served by the relay thread.\n");
+   return true;
+
+error:
+   RARCH_WARN("[netplay] Could not start the spectator relay, spectators "
+         "will be served directly.\n");
+   if (relay->cond)
+      scond_free(relay->cond);
+   if (relay->lock)
+      slock_free(relay->lock);
+#ifdef HAVE_RELAY_EPOLL
+   if (relay->wake_fd >= 0)
+      close(relay->wake_fd);
+   if (relay->epoll_fd >= 0)
+      close(relay->epoll_fd);
+#endif
+   free(relay);
+#endif
+   return false;
+}
+
+/**
+ * netplay_relay_free
+ *
+ * Stop the spectator relay. Connections it was serving aren't closed.
+ */
+void netplay_relay_free(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   struct netplay_relay *relay = netplay->relay;
+   size_t i;
+
+   if (!relay)
+      return;
+
+   if (relay->thread)
+   {
+      slock_lock(relay->lock);
+      relay->quit = true;
+      relay_wake(relay);
+      slock_unlock(relay->lock);
+      sthread_join(relay->thread);
+   }
+
+   for (i = 0; i < netplay->connections_size; i++)
+      netplay->connections[i].relayed = false;
+
+   while (relay->head)
+   {
+      struct relay_chunk *chunk = relay->head;
+      relay->head               = chunk->next;
+      free(chunk);
+   }
+
+#ifdef HAVE_RELAY_EPOLL
+   close(relay->wake_fd);
+   close(relay->epoll_fd);
+#endif
+   scond_free(relay->cond);
+   slock_free(relay->lock);
+   free(relay->peers);
+   free(relay);
+   netplay->relay = NULL;
+#endif
+}
+
+/**
+ * netplay_relay_active
+ *
+ * Is the relay serving any spectators? If not, there's no need to send it
+ * anything.
+ */
+bool netplay_relay_active(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   return netplay->relay && netplay->relay->count;
+#else
+   return false;
+#endif
+}
+
+/**
+ * netplay_relay_send
+ *
+ * Send data to every spectator the relay is serving. barrier says whether it
+ * starts a command that UDP input must not overtake.
+ */
+void netplay_relay_send(netplay_t *netplay, const void *data, size_t size,
+   bool barrier)
+{
+#ifdef HAVE_THREADS
+   struct netplay_relay *relay = netplay->relay;
+
+   if (!netplay_relay_active(netplay))
+      return;
+
+   slock_lock(relay->lock);
+   if (relay_append(relay, data, size))
+   {
+      if (barrier)
+         relay->barriers++;
+   }
+   else
+   {
+      /* Nobody can follow the stream from here on */
+      size_t i;
+      for (i = 0; i < relay->peers_size; i++)
+      {
+         struct relay_peer *peer = &relay->peers[i];
+         if (peer->active && !peer->attention)
+            relay_need_attention(relay, peer, true);
+      }
+   }
+   relay_wake(relay);
+   slock_unlock(relay->lock);
+#endif
+}
+
+/**
+ * netplay_relay_send_cmd
+ *
+ * Send a command to every spectator the relay is serving.
+ */
+void netplay_relay_send_cmd(netplay_t *netplay, uint32_t cmd,
+   const void *data, size_t size)
+{
+#ifdef HAVE_THREADS
+   uint32_t cmdbuf[2];
+
+   if (!netplay_relay_active(netplay))
+      return;
+
+   cmdbuf[0] = htonl(cmd);
+   cmdbuf[1] = htonl(size);
+
+   netplay_relay_send(netplay, cmdbuf, sizeof(cmdbuf),
+         netplay_udp_is_barrier(cmd));
+   if (size > 0)
+      netplay_relay_send(netplay, data, size, false);
+#endif
+}
+
+/**
+ * netplay_relay_attach_ready
+ *
+ * Hand every spectator that's caught up and has nothing else going on over
+ * to the relay.
+ */
+void netplay_relay_attach_ready(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   struct netplay_relay *relay = netplay->relay;
+   size_t i;
+
+   if (!relay)
+      return;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct relay_peer *peer;
+      struct netplay_connection *connection = &netplay->connections[i];
+
+      /* The stream is the same for everybody, so only those peers that
+       * expect it exactly as we write it may follow it */
+      if (!connection->active || connection->relayed ||
+            connection->mode != NETPLAY_CONNECTION_SPECTATING ||
+            connection->delay_frame || connection->paused ||
+            connection->savestate_base ||
+            connection->compression_supported != NETPLAY_COMPRESSION_ZLIB ||
+            !connection->fast_hash)
+         continue;
+
+      /* Nor may anything be left over to send or read */
+      if (connection->send_packet_buffer.start !=
+               connection->send_packet_buffer.end ||
+            connection->recv_packet_buffer.read !=
+               connection->recv_packet_buffer.end)
+         continue;
+
+      if (!relay->thread &&
+            !(relay->thread = sthread_create(relay_thread, relay)))
+      {
+         RARCH_WARN("[netplay] Could not start the spectator relay, "
+               "spectators will be served directly.\n");
+         netplay_relay_free(netplay);
+         return;
+      }
+
+      slock_lock(relay->lock);
+
+      if (i >= relay->peers_size)
+      {
+         size_t new_size = netplay->connections_size;
+         struct relay_peer *new_peers = (struct relay_peer*)
+            realloc(relay->peers, new_size * sizeof(*new_peers));
+         if (!new_peers)
+         {
+            slock_unlock(relay->lock);
+            return;
+         }
+         memset(new_peers + relay->peers_size, 0,
+               (new_size - relay->peers_size) * sizeof(*new_peers));
+         relay->peers      = new_peers;
+         relay->peers_size = new_size;
+      }
+
+      /* Make sure there's a tail to start from */
+      if (!relay->tail && !relay_append(relay, NULL, 0))
+      {
+         slock_unlock(relay->lock);
+         return;
+      }
+
+      peer = &relay->peers[i];
+      memset(peer, 0, sizeof(*peer));
+      peer->chunk    = relay->tail;
+      peer->sent     = relay->end;
+      peer->barriers = relay->barriers;
+      peer->fd       = connection->fd;
+
+#ifdef HAVE_RELAY_EPOLL
+      {
+         struct epoll_event event;
+         event.events   = EPOLLIN;
+         event.data.u32 = (uint32_t)i;
+         if (epoll_ctl(relay->epoll_fd, EPOLL_CTL_ADD, peer->fd, &event) < 0)
+         {
+            slock_unlock(relay->lock);
+            continue;
+         }
+      }
+#endif
+
+      peer->active = true;
+      relay->limit = 2 * netplay->packet_buffer_size;
+      relay->count++;
+      connection->relayed = true;
+      relay_wake(relay);
+
+      slock_unlock(relay->lock);
+   }
+#endif
+}
+
+/**
+ * netplay_relay_detach
+ *
+ * Take a spectator back from the relay. If keep is set, whatever the relay
+ * hadn't sent it yet is queued in its own send buffer.
+ */
+void netplay_relay_detach(netplay_t *netplay,
+   struct netplay_connection *connection, bool keep)
+{
+#ifdef HAVE_THREADS
+   struct netplay_relay *relay = netplay->relay;
+   struct relay_peer *peer;
+   struct relay_chunk *chunk;
+   uint64_t sent, end;
+   size_t i = (size_t)(connection - netplay->connections);
+
+   if (!relay || !connection->relayed)
+      return;
+
+   slock_lock(relay->lock);
+   peer = &relay->peers[i];
+   while (peer->busy)
+   {
+      scond_wait(relay->cond, relay->lock);
+      peer = &relay->peers[i];
+   }
+
+#ifdef HAVE_RELAY_EPOLL
+   epoll_ctl(relay->epoll_fd, EPOLL_CTL_DEL, peer->fd, NULL);
+#endif
+
+   /* The thread leaves it alone from here on, and its chunks stay put */
+   peer->detaching = true;
+   relay_peer_advance(relay, peer);
+   chunk = peer->chunk;
+   sent  = peer->sent;
+   end   = relay->end;
+   connection->udp_barrier_sent += relay->barriers - peer->barriers;
+   slock_unlock(relay->lock);
+
+   while (keep && sent < end)
+   {
+      size_t offset = (size_t)(sent - chunk->start);
+      size_t len    = chunk->used - offset;
+      if (chunk->start + chunk->used > end)
+         len = (size_t)(end - sent);
+      if (len && !netplay_send(&connection->send_packet_buffer,
+               connection->fd, chunk->data + offset, len))
+         break;
+      sent += len;
+      chunk = chunk->next;
+   }
+
+   slock_lock(relay->lock);
+   peer         = &relay->peers[i];
+   peer->active = false;
+   slock_unlock(relay->lock);
+
+   relay->count--;
+   connection->relayed = false;
+#endif
+}
+
+/**
+ * netplay_relay_poll
+ *
+ * Take back every spectator that needs the main thread's attention. Those the
+ * relay couldn't keep up with are disconnected.
+ */
+void netplay_relay_poll(netplay_t *netplay)
+{
+#ifdef HAVE_THREADS
+   struct netplay_relay *relay = netplay->relay;
+   size_t i;
+
+   if (!netplay_relay_active(netplay))
+      return;
+
+   slock_lock(relay->lock);
+   if (!relay->attention)
+   {
+      slock_unlock(relay->lock);
+      return;
+   }
+   relay->attention = false;
+   slock_unlock(relay->lock);
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      bool attention, failed;
+      struct netplay_connection *connection = &netplay->connections[i];
+
+      if (!connection->relayed)
+         continue;
+
+      slock_lock(relay->lock);
+      attention = relay->peers[i].attention;
+      failed    = relay->peers[i].failed;
+      slock_unlock(relay->lock);
+
+      if (!attention)
+         continue;
+
+      if (failed)
+      {
+         RARCH_WARN("[netplay] Spectator %u can't keep up, disconnecting.\n",
+               (unsigned)(i + 1));
+         netplay_hangup(netplay, connection);
+      }
+      else
+         netplay_relay_detach(netplay, connection, true);
+   }
+#endif
+}
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include <boolean.h>
@@ -25,6 +26,8 @@
 
 #include "../../autosave.h"
 #include "../../driver.h"
+#include "../../performance_counters.h"
+#include "../../retroarch.h"
 #include "../../input/input_driver.h"
 
 struct vote_count
@@ -32,6 +35,74 @@ struct vote_count
    uint16_t votes[32];
 };
 
+/* Rollback costs for the performance counter list. These outlive any one
+ * netplay session, since registered counters can't be unregistered. */
+static struct retro_perf_counter netplay_serialize_perf;
+static struct retro_perf_counter netplay_unserialize_perf;
+static struct retro_perf_counter netplay_resim_perf;
+
+static retro_time_t netplay_cost_start(netplay_t *netplay,
+      struct retro_perf_counter *perf)
+{
+   performance_counter_start_plus(netplay->perfcnt_enable, (*perf));
+   return cpu_features_get_time_usec();
+}
+
+static retro_time_t netplay_cost_stop(netplay_t *netplay,
+      struct retro_perf_counter *perf, retro_time_t start)
+{
+   performance_counter_stop_plus(netplay->perfcnt_enable, (*perf));
+   return cpu_features_get_time_usec() - start;
+}
+
+static bool netplay_sync_serialize(netplay_t *netplay,
+      retro_ctx_serialize_info_t *serial_info)
+{
+   retro_time_t start = netplay_cost_start(netplay, &netplay_serialize_perf);
+   bool ret           = core_serialize(serial_info);
+   retro_time_t tm    = netplay_cost_stop(netplay, &netplay_serialize_perf,
+         start);
+
+   netplay->cost_frame.serialize += tm;
+   netplay->cost_total.serialize += tm;
+   return ret;
+}
+
+static bool netplay_sync_unserialize(netplay_t *netplay,
+      retro_ctx_serialize_info_t *serial_info)
+{
+   retro_time_t start = netplay_cost_start(netplay,
+         &netplay_unserialize_perf);
+   bool ret           = core_unserialize(serial_info);
+   retro_time_t tm    = netplay_cost_stop(netplay,
+         &netplay_unserialize_perf, start);
+
+   netplay->cost_frame.unserialize += tm;
+   netplay->cost_total.unserialize += tm;
+   return ret;
+}
+
+/* Rerun a frame, with the input already resolved */
+static void netplay_sync_resim(netplay_t *netplay)
+{
+   retro_time_t start = netplay_cost_start(netplay, &netplay_resim_perf);
+   retro_time_t tm;
+
+#ifdef HAVE_THREADS
+   autosave_lock();
+#endif
+   core_run();
+#ifdef HAVE_THREADS
+   autosave_unlock();
+#endif
+
+   tm = netplay_cost_stop(netplay, &netplay_resim_perf, start);
+   netplay->cost_frame.resim += tm;
+   netplay->cost_total.resim += tm;
+   netplay->cost_frame.resim_frames++;
+   netplay->cost_total.resim_frames++;
+}
+
 #if 0
 #define DEBUG_NONDETERMINISTIC_CORES
 #endif
@@ -505,6 +576,36 @@ bool netplay_resolve_input(netplay_t *netplay, size_t sim_ptr, bool resim)
    return ret;
 }
 
+/* Compare our CRC or hash of a frame with the server's */
+static void netplay_check_frame_hash(netplay_t *netplay,
+      struct delta_frame *delta, uint32_t local, uint32_t remote)
+{
+   if (local != remote)
+   {
+      /* If the very first check frame is wrong,
+       * they probably just don't work */
+      if (!netplay->crc_validity_checked)
+         netplay->crcs_valid = false;
+      else if (netplay->crcs_valid)
+      {
+         /* Fix this! */
+         if (netplay->check_frames < 0)
+         {
+            /* Just report */
+            RARCH_ERR("Netplay CRCs mismatch!\n");
+         }
+         else
+            netplay_cmd_request_savestate(netplay);
+      }
+   }
+   else
+   {
+      if (!netplay->crc_validity_checked)
+         netplay->crc_validity_checked = true;
+      netplay_state_base_store(netplay, delta);
+   }
+}
+
 static void netplay_handle_frame_hash(netplay_t *netplay,
       struct delta_frame *delta)
 {
@@ -513,35 +614,20 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
       if (netplay->check_frames &&
           delta->frame % abs(netplay->check_frames) == 0)
       {
-         delta->crc = netplay_delta_frame_crc(netplay, delta);
+         /* Works out the CRC and/or hash, as the peers need */
          netplay_cmd_crc(netplay, delta);
+         netplay_state_base_store(netplay, delta);
       }
    }
-   else if (delta->crc && netplay->crcs_valid)
+   else if (netplay->connections_size && netplay->connections[0].fast_hash)
    {
-      /* We have a remote CRC, so check it */
-      uint32_t local_crc = netplay_delta_frame_crc(netplay, delta);
-      if (local_crc != delta->crc)
-      {
-         /* If the very first check frame is wrong,
-          * they probably just don't work */
-         if (!netplay->crc_validity_checked)
-            netplay->crcs_valid = false;
-         else if (netplay->crcs_valid)
-         {
-            /* Fix this! */
-            if (netplay->check_frames < 0)
-            {
-               /* Just report */
-               RARCH_ERR("Netplay CRCs mismatch!\n");
-            }
-            else
-               netplay_cmd_request_savestate(netplay);
-         }
-      }
-      else if (!netplay->crc_validity_checked)
-         netplay->crc_validity_checked = true;
+      if (delta->hash && netplay->crcs_valid)
+         netplay_check_frame_hash(netplay, delta,
+               netplay_delta_frame_hash(netplay, delta), delta->hash);
    }
+   else if (delta->crc && netplay->crcs_valid)
+      netplay_check_frame_hash(netplay, delta,
+            netplay_delta_frame_crc(netplay, delta), delta->crc);
 }
 
 /**
@@ -554,6 +640,18 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
 {
    retro_ctx_serialize_info_t serial_info;
 
+   netplay->cost_last = netplay->cost_frame;
+   memset(&netplay->cost_frame, 0, sizeof(netplay->cost_frame));
+
+   netplay->perfcnt_enable = rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL);
+   if (netplay->perfcnt_enable)
+   {
+      performance_counter_init(netplay_serialize_perf, "netplay_serialize");
+      performance_counter_init(netplay_unserialize_perf,
+            "netplay_unserialize");
+      performance_counter_init(netplay_resim_perf, "netplay_resim");
+   }
+
    if (netplay_delta_frame_ready(netplay,
             &netplay->buffer[netplay->run_ptr], netplay->run_frame_count))
    {
@@ -568,7 +666,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
          /* Don't serialize until it's safe */
       }
       else if (!(netplay->quirks & NETPLAY_QUIRK_NO_SAVESTATES)
-            && core_serialize(&serial_info))
+            && netplay_sync_serialize(netplay, &serial_info))
       {
          if (netplay->force_send_savestate && !netplay->stall
                && !netplay->remote_paused)
@@ -711,6 +809,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
          memset(connection, 0, sizeof(*connection));
          connection->active = true;
          connection->fd     = new_fd;
+         connection->addr   = their_addr;
          connection->mode   = NETPLAY_CONNECTION_INIT;
 
          if (!netplay_init_socket_buffer(&connection->send_packet_buffer,
@@ -737,6 +836,119 @@ process:
    return (netplay->stall != NETPLAY_STALL_NO_CONNECTION);
 }
 
+/**
+ * netplay_sync_update_window
+ * @netplay              : pointer to netplay object
+ *
+ * Size stall_frames from the measured round-trip times, and the state buffer
+ * with it.
+ */
+void netplay_sync_update_window(netplay_t *netplay)
+{
+   struct retro_system_av_info *av_info = video_viewport_get_system_av_info();
+   double fps          = av_info && av_info->timing.fps > 0 ?
+      av_info->timing.fps : 60.0;
+   retro_time_t bound  = 0;
+   bool known          = false;
+   uint32_t frames     = NETPLAY_MAX_STALL_FRAMES;
+   size_t size, i;
+
+   /* We only have to wait on players, so the slowest of their links bounds
+    * how far ahead we may get */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      enum rarch_netplay_connection_mode mode = netplay->is_server ?
+         connection->mode : netplay->self_mode;
+
+      if (!connection->active || mode < NETPLAY_CONNECTION_SLAVE)
+         continue;
+      if (!connection->ping_supported || !connection->rtt)
+      {
+         known = false;
+         break;
+      }
+      if (connection->rtt + 4 * connection->rtt_var > bound)
+         bound = connection->rtt + 4 * connection->rtt_var;
+      known = true;
+   }
+
+   if (known)
+   {
+      frames = (uint32_t)(bound * fps / 1000000.0) + 1 +
+         netplay->input_latency_frames + NETPLAY_STALL_MARGIN_FRAMES;
+      if (frames < NETPLAY_MIN_STALL_FRAMES)
+         frames = NETPLAY_MIN_STALL_FRAMES;
+      else if (frames > NETPLAY_MAX_STALL_FRAMES)
+         frames = NETPLAY_MAX_STALL_FRAMES;
+   }
+
+   size = frames + 2;
+   if (netplay->is_server)
+      size *= 2;
+
+   if (size > netplay->buffer_size)
+   {
+      /* Growing can't wait, but if it fails we have to make do */
+      netplay->shrink_time = 0;
+      if (netplay_resize_buffer(netplay, size))
+         RARCH_LOG("[netplay] Resized the state buffer to %u frames.\n",
+               (unsigned)size);
+      else
+      {
+         size = netplay->buffer_size;
+         if (netplay->is_server)
+            size /= 2;
+         if (frames > size - 2)
+            frames = (uint32_t)(size - 2);
+      }
+   }
+   else if (size < netplay->buffer_size)
+   {
+      /* Only shrink once the smaller window has held for a while */
+      retro_time_t now = cpu_features_get_time_usec();
+
+      if (!netplay->shrink_time)
+         netplay->shrink_time = now;
+      else if (now - netplay->shrink_time >= NETPLAY_BUFFER_SHRINK_USEC &&
+            netplay_resize_buffer(netplay, size))
+      {
+         RARCH_LOG("[netplay] Resized the state buffer to %u frames.\n",
+               (unsigned)size);
+         netplay->shrink_time = 0;
+      }
+   }
+   else
+      netplay->shrink_time = 0;
+
+   netplay->stall_frames = frames;
+}
+
+/**
+ * netplay_sync_grow_buffer
+ * @netplay              : pointer to netplay object
+ *
+ * Every peer sizes its own window, so input from one with a wider window
+ * than ours may want a slot we still need. Grow the state buffer back to
+ * its size without round-trip times to make room.
+ *
+ * Returns true if the buffer grew.
+ */
+bool netplay_sync_grow_buffer(netplay_t *netplay)
+{
+   size_t size = NETPLAY_MAX_STALL_FRAMES + 2;
+
+   if (netplay->is_server)
+      size *= 2;
+   if (size <= netplay->buffer_size || !netplay_resize_buffer(netplay, size))
+      return false;
+
+   RARCH_LOG("[netplay] Resized the state buffer to %u frames.\n",
+         (unsigned)size);
+   netplay->shrink_time = 0;
+   return true;
+}
+
 /**
  * netplay_sync_post_frame
  * @netplay              : pointer to netplay object
@@ -748,12 +960,17 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
 {
    uint32_t lo_frame_count, hi_frame_count;
 
+   netplay_sync_update_window(netplay);
+
    /* Unless we're stalling, we've just finished running a frame */
    if (!stalled)
    {
       netplay->run_ptr = NEXT_PTR(netplay->run_ptr);
       netplay->run_frame_count++;
+      netplay->stat_frames++;
    }
+   else
+      netplay->stat_stall_frames++;
 
    /* We've finished an input frame even if we're stalling */
    if ((!stalled || netplay->stall == NETPLAY_STALL_INPUT_LATENCY) &&
@@ -839,6 +1056,7 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
 
       /* Replay frames. */
       netplay->is_replay = true;
+      netplay->stat_rollbacks++;
 
       /* If we have a keyboard device, we replay the previous frame's input
        * just to assert that the keydown/keyup events work if the core
@@ -847,13 +1065,7 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
       {
          netplay->replay_ptr = PREV_PTR(netplay->replay_ptr);
          netplay->replay_frame_count--;
-#ifdef HAVE_THREADS
-         autosave_lock();
-#endif
-         core_run();
-#ifdef HAVE_THREADS
-         autosave_unlock();
-#endif
+         netplay_sync_resim(netplay);
          netplay->replay_ptr = NEXT_PTR(netplay->replay_ptr);
          netplay->replay_frame_count++;
       }
@@ -866,7 +1078,7 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
       serial_info.data_const = netplay->buffer[netplay->replay_ptr].state;
       serial_info.size       = netplay->state_size;
 
-      if (!core_unserialize(&serial_info))
+      if (!netplay_sync_unserialize(netplay, &serial_info))
       {
          RARCH_ERR("Netplay savestate loading failed: Prepare for desync!\n");
       }
@@ -884,20 +1096,14 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
 
          /* Remember the current state */
          memset(serial_info.data, 0, serial_info.size);
-         core_serialize(&serial_info);
+         netplay_sync_serialize(netplay, &serial_info);
          if (netplay->replay_frame_count < netplay->unread_frame_count)
             netplay_handle_frame_hash(netplay, ptr);
 
          /* Re-simulate this frame's input */
          netplay_resolve_input(netplay, netplay->replay_ptr, true);
+         netplay_sync_resim(netplay);
 
-#ifdef HAVE_THREADS
-         autosave_lock();
-#endif
-         core_run();
-#ifdef HAVE_THREADS
-         autosave_unlock();
-#endif
          netplay->replay_ptr = NEXT_PTR(netplay->replay_ptr);
          netplay->replay_frame_count++;
 
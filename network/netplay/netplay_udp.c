@@ -0,0 +1,494 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* UDP input transport. TCP stays authoritative and carries everything,
+ * including all input. On top of that, each side sends its own input for the
+ * last few frames in every UDP packet, so a single lost packet is covered by
+ * the next one instead of stalling everything behind a TCP retransmission.
+ * Whichever copy of a frame arrives first is used, the other is ignored. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <boolean.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+#include "netplay_private.h"
+
+#if defined(AF_INET6) && !defined(HAVE_SOCKET_LEGACY) && !defined(_3DS)
+#define HAVE_INET6 1
+#endif
+
+/* magic, token, barrier, ack, client number, first frame, frame count,
+ * words per frame */
+#define UDP_HEADER_WORDS    8
+#define UDP_MAX_FRAME_WORDS 16
+#define UDP_MAX_PACKETS     64
+
+#define UDP_PACKET_WORDS \
+   (UDP_HEADER_WORDS + NETPLAY_UDP_REDUNDANCY * UDP_MAX_FRAME_WORDS)
+
+static void udp_set_cloexec(int fd)
+{
+#if defined(F_SETFD) && defined(FD_CLOEXEC)
+   if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0)
+      RARCH_WARN("Cannot set Netplay UDP socket to close-on-exec.\n");
+#endif
+}
+
+static bool udp_same_host(const struct sockaddr_storage *a,
+      const struct sockaddr_storage *b)
+{
+   if (a->ss_family != b->ss_family)
+      return false;
+
+   switch (a->ss_family)
+   {
+      case AF_INET:
+         return ((const struct sockaddr_in *) a)->sin_addr.s_addr ==
+                ((const struct sockaddr_in *) b)->sin_addr.s_addr;
+#ifdef HAVE_INET6
+      case AF_INET6:
+         return !memcmp(&((const struct sockaddr_in6 *) a)->sin6_addr,
+                        &((const struct sockaddr_in6 *) b)->sin6_addr,
+                        sizeof(struct in6_addr));
+#endif
+      default:
+         break;
+   }
+
+   return false;
+}
+
+/**
+ * netplay_udp_init_server
+ *
+ * Open the server's UDP input socket on the same address and port as the
+ * listening socket.
+ */
+bool netplay_udp_init_server(netplay_t *netplay)
+{
+   struct sockaddr_storage addr;
+   socklen_t addr_len = sizeof(addr);
+   int fd;
+
+   memset(&addr, 0, sizeof(addr));
+   if (getsockname(netplay->listen_fd, (struct sockaddr *) &addr,
+            &addr_len) < 0)
+      return false;
+
+   fd = socket(addr.ss_family, SOCK_DGRAM, 0);
+   if (fd < 0)
+      return false;
+
+#if defined(HAVE_INET6) && defined(IPPROTO_IPV6) && defined(IPV6_V6ONLY)
+   /* Accept input from IPv4 peers as well, like the TCP socket */
+   if (addr.ss_family == AF_INET6)
+   {
+      int on = 0;
+      if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&on,
+               sizeof(on)) < 0)
+         RARCH_WARN("Failed to receive UDP input on both IPv6 and IPv4\n");
+   }
+#endif
+
+   udp_set_cloexec(fd);
+
+   if (bind(fd, (struct sockaddr *) &addr, addr_len) < 0 ||
+       !socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return false;
+   }
+
+   netplay->udp_fd = fd;
+   return true;
+}
+
+/**
+ * netplay_udp_offer
+ *
+ * Server only: Offer UDP input to a freshly connected client.
+ */
+bool netplay_udp_offer(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   uint32_t token;
+
+   if (netplay->udp_fd < 0 || !connection->udp_supported)
+      return true;
+
+   do
+   {
+      connection->udp_token = ((uint32_t) rand() << 16) ^ (uint32_t) rand() ^
+         (uint32_t) cpu_features_get_time_usec();
+   } while (!connection->udp_token);
+
+   token = htonl(connection->udp_token);
+   return netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_UDP,
+         &token, sizeof(token));
+}
+
+/**
+ * netplay_udp_accept
+ *
+ * Client only: Set up UDP input to the server with the offered token.
+ */
+bool netplay_udp_accept(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t token)
+{
+   int fd;
+
+   /* We never asked for it, or already have it */
+   if (!netplay->udp_enabled || netplay->udp_fd >= 0)
+      return true;
+
+   /* The server receives UDP on its TCP port */
+   connection->udp_addr_len = sizeof(connection->udp_addr);
+   if (getpeername(connection->fd, (struct sockaddr *) &connection->udp_addr,
+            &connection->udp_addr_len) < 0)
+   {
+      RARCH_WARN("[netplay] Could not find the server's address for UDP input.\n");
+      return true;
+   }
+
+   fd = socket(connection->udp_addr.ss_family, SOCK_DGRAM, 0);
+   if (fd < 0)
+   {
+      RARCH_WARN("[netplay] Could not open a UDP socket, input will only be sent over TCP.\n");
+      return true;
+   }
+
+   udp_set_cloexec(fd);
+
+   if (!socket_nonblock(fd))
+   {
+      socket_close(fd);
+      return true;
+   }
+
+   netplay->udp_fd        = fd;
+   connection->udp_token  = token;
+   connection->udp_active = true;
+
+   RARCH_LOG("[netplay] Sending input over UDP as well as TCP.\n");
+   return true;
+}
+
+/**
+ * netplay_udp_is_barrier
+ *
+ * Is this a command which UDP input must not overtake?
+ */
+bool netplay_udp_is_barrier(uint32_t cmd)
+{
+   switch (cmd)
+   {
+      case NETPLAY_CMD_MODE:
+      case NETPLAY_CMD_RESET:
+      case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
+         return true;
+      default:
+         break;
+   }
+
+   return false;
+}
+
+/* Copy our own input for this frame into a packet */
+static bool udp_pack_frame(netplay_t *netplay, struct delta_frame *dframe,
+      uint32_t devices, uint32_t *out)
+{
+   uint32_t device, i;
+
+   for (device = 0; device < MAX_INPUT_DEVICES; device++)
+   {
+      netplay_input_state_t istate;
+      if (!(devices & (1<<device)))
+         continue;
+      istate = dframe->real_input[device];
+      while (istate && (!istate->used ||
+               istate->client_num != netplay->self_client_num))
+         istate = istate->next;
+      if (!istate ||
+            istate->size != netplay_expected_input_size(netplay, 1<<device))
+         return false;
+      for (i = 0; i < istate->size; i++)
+         *out++ = htonl(istate->data[i]);
+   }
+
+   return true;
+}
+
+/**
+ * netplay_udp_send_input
+ *
+ * Send our recent input to the given connection over UDP, if set up.
+ */
+void netplay_udp_send_input(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   uint32_t packet[UDP_PACKET_WORDS];
+   uint32_t peer, first = 0, count = 0, words = 0;
+   size_t used = UDP_HEADER_WORDS;
+
+   /* Relayed spectators are better off waiting for TCP than costing the
+    * main thread a packet each */
+   if (netplay->udp_fd < 0 || !connection->udp_active || connection->relayed)
+      return;
+
+   peer = netplay->is_server ?
+      (uint32_t)(connection - netplay->connections + 1) : 0;
+
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING)
+   {
+      uint32_t frame;
+      uint32_t last    = netplay->self_frame_count;
+      uint32_t window  = NETPLAY_UDP_REDUNDANCY;
+      uint32_t devices = netplay->client_devices[netplay->self_client_num];
+
+      words = netplay_expected_input_size(netplay, devices);
+      if (words > UDP_MAX_FRAME_WORDS)
+         return;
+
+      if (window > last + 1)
+         window = (uint32_t)(last + 1);
+      first = last + 1 - window;
+
+      /* Don't repeat what the peer already has */
+      if (connection->udp_ack > first && connection->udp_ack <= last)
+         first = connection->udp_ack;
+
+      for (frame = first; frame <= last; frame++)
+      {
+         struct delta_frame *dframe = &netplay->buffer[
+            (netplay->self_ptr + netplay->buffer_size - (last - frame))
+               % netplay->buffer_size];
+
+         if (  !dframe->used || dframe->frame != frame ||
+               !dframe->have_real[netplay->self_client_num] ||
+               !udp_pack_frame(netplay, dframe, devices, packet + used))
+         {
+            /* The frames have to be contiguous, start over after this one */
+            used  = UDP_HEADER_WORDS;
+            count = 0;
+            first = frame + 1;
+            continue;
+         }
+
+         used += words;
+         count++;
+      }
+   }
+
+   /* Playing clients always send, so that the server learns their address and
+    * our acknowledgements get through. Spectators have nothing to say. */
+   if (!count && (netplay->is_server ||
+            netplay->self_mode != NETPLAY_CONNECTION_PLAYING))
+      return;
+
+   packet[0] = htonl(NETPLAY_UDP_MAGIC);
+   packet[1] = htonl(connection->udp_token);
+   packet[2] = htonl(connection->udp_barrier_sent);
+   packet[3] = htonl(netplay->read_frame_count[peer]);
+   packet[4] = htonl(netplay->self_client_num);
+   packet[5] = htonl(first);
+   packet[6] = htonl(count);
+   packet[7] = htonl(words);
+
+#ifdef DEBUG_NETPLAY_LOSS
+   if (rand() % 100 < DEBUG_NETPLAY_LOSS)
+      return;
+#endif
+
+   /* Best effort, TCP has it too */
+   sendto(netplay->udp_fd, (const char*)packet, used * sizeof(uint32_t), 0,
+         (struct sockaddr *) &connection->udp_addr, connection->udp_addr_len);
+}
+
+/* Find the connection a UDP packet belongs to */
+static struct netplay_connection *udp_connection_for(netplay_t *netplay,
+      uint32_t token, const struct sockaddr_storage *from,
+      socklen_t from_len)
+{
+   size_t i;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active ||
+            connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+            !connection->udp_token ||
+            connection->udp_token != token)
+         continue;
+
+      if (netplay->is_server)
+      {
+         /* The token is only good from the client's own host. Its port may
+          * well differ from the TCP one behind NAT, so learn it here. */
+         if (!connection->udp_supported ||
+               !udp_same_host(&connection->addr, from))
+            return NULL;
+         memcpy(&connection->udp_addr, from, from_len);
+         connection->udp_addr_len = from_len;
+         connection->udp_active   = true;
+      }
+
+      return connection;
+   }
+
+   return NULL;
+}
+
+/* Take whatever new input a UDP packet holds */
+static bool udp_recv_input(netplay_t *netplay,
+      struct netplay_connection *connection, const uint32_t *packet,
+      size_t packet_words)
+{
+   uint32_t barrier    = ntohl(packet[2]);
+   uint32_t ack        = ntohl(packet[3]);
+   uint32_t client_num = ntohl(packet[4]);
+   uint32_t frame      = ntohl(packet[5]);
+   uint32_t count      = ntohl(packet[6]);
+   uint32_t words      = ntohl(packet[7]);
+   uint32_t devices, i;
+   const uint32_t *data = packet + UDP_HEADER_WORDS;
+   bool had_input       = false;
+
+   if (count > NETPLAY_UDP_REDUNDANCY || words > UDP_MAX_FRAME_WORDS ||
+         packet_words < UDP_HEADER_WORDS + count * words)
+      return false;
+
+   if (ack > connection->udp_ack)
+      connection->udp_ack = ack;
+
+   /* Anything sent before a mode change or state load we've seen, or after
+    * one we haven't seen yet, is meaningless */
+   if (!count || barrier != connection->udp_barrier_recv ||
+         connection->mode != NETPLAY_CONNECTION_PLAYING)
+      return false;
+
+   if (netplay->is_server)
+      client_num = (uint32_t)(connection - netplay->connections + 1);
+   else if (client_num != 0)
+      return false;
+
+   if (!(netplay->connected_players & (1<<client_num)))
+      return false;
+
+   devices = netplay->client_devices[client_num];
+   if (words != netplay_expected_input_size(netplay, devices))
+      return false;
+
+   for (i = 0; i < count; i++, frame++, data += words)
+   {
+      uint32_t device;
+      struct delta_frame *dframe;
+
+      if (frame < netplay->read_frame_count[client_num])
+         continue;
+      if (frame > netplay->read_frame_count[client_num])
+         break;
+
+      dframe = &netplay->buffer[netplay->read_ptr[client_num]];
+      if (!netplay_delta_frame_ready(netplay, dframe, frame))
+         break;
+
+      for (device = 0; device < MAX_INPUT_DEVICES; device++)
+      {
+         netplay_input_state_t istate;
+         uint32_t dsize, di;
+         if (!(devices & (1<<device)))
+            continue;
+
+         dsize  = netplay_expected_input_size(netplay, 1 << device);
+         istate = netplay_input_state_for(&dframe->real_input[device],
+               client_num, dsize, false, false);
+         if (!istate)
+            return had_input;
+         for (di = 0; di < dsize; di++)
+            istate->data[di] = ntohl(data[di]);
+         data += dsize;
+      }
+      data -= words;
+
+      netplay_input_received(netplay, connection, dframe, client_num);
+      netplay->udp_input_frames++;
+      had_input = true;
+   }
+
+   return had_input;
+}
+
+/**
+ * netplay_udp_poll
+ *
+ * Read any pending UDP input.
+ *
+ * Returns true if any new input was received.
+ */
+bool netplay_udp_poll(netplay_t *netplay)
+{
+   uint32_t packet[UDP_PACKET_WORDS];
+   bool had_input = false;
+   int packets;
+
+   if (netplay->udp_fd < 0)
+      return false;
+
+   for (packets = 0; packets < UDP_MAX_PACKETS; packets++)
+   {
+      struct netplay_connection *connection;
+      struct sockaddr_storage from;
+      socklen_t from_len = sizeof(from);
+      ssize_t recvd      = recvfrom(netplay->udp_fd, (char*)packet,
+            sizeof(packet), 0, (struct sockaddr *) &from, &from_len);
+
+      if (recvd < 0)
+         break;
+
+      if ((size_t)recvd < UDP_HEADER_WORDS * sizeof(uint32_t) ||
+            ntohl(packet[0]) != NETPLAY_UDP_MAGIC)
+         continue;
+
+      connection = udp_connection_for(netplay, ntohl(packet[1]), &from,
+            from_len);
+      if (connection && udp_recv_input(netplay, connection, packet,
+               (size_t)recvd / sizeof(uint32_t)))
+         had_input = true;
+   }
+
+   return had_input;
+}
+
+/**
+ * netplay_udp_free
+ *
+ * Close the UDP input socket.
+ */
+void netplay_udp_free(netplay_t *netplay)
+{
+   if (netplay->udp_input_frames)
+      RARCH_LOG("[netplay] Remote input frames received first over UDP: %u, "
+            "over TCP: %u.\n", (unsigned)netplay->udp_input_frames,
+            (unsigned)netplay->tcp_input_frames);
+
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+   netplay->udp_fd = -1;
+}
@@ -24,7 +24,7 @@
 #include <compat/strl.h>
 
 #include <boolean.h>
-#include <queues/fifo_queue.h>
+#include <queues/spsc_queue.h>
 #include <rthreads/rthreads.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
@@ -235,16 +235,15 @@ typedef struct ffmpeg
 
    struct record_params params;
 
-   scond_t *cond;
-   slock_t *cond_lock;
-   slock_t *lock;
-   fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
+   /* Filled by the frontend, drained by the encoder thread.
+    * A frame's pixels go in before its attributes, so the
+    * attributes say when a whole frame is there. */
+   spsc_queue_t *audio_fifo;
+   spsc_queue_t *video_fifo;
+   spsc_queue_t *attr_fifo;
    sthread_t *thread;
 
    volatile bool alive;
-   volatile bool can_sleep;
 } ffmpeg_t;
 
 AVFormatContext *ctx;
@@ -927,21 +926,16 @@ static void ffmpeg_thread(void *data);
 
 static bool init_thread(ffmpeg_t *handle)
 {
-   handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
-   handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
+   handle->audio_fifo = spsc_queue_new(32000 * sizeof(int16_t) *
          handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct record_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
+   handle->attr_fifo = spsc_queue_new(sizeof(struct record_video_data) * MAX_FRAMES);
+   handle->video_fifo = spsc_queue_new(handle->params.fb_width * handle->params.fb_height *
             handle->video.pix_size * MAX_FRAMES);
 
    handle->alive = true;
-   handle->can_sleep = true;
    handle->thread = sthread_create(ffmpeg_thread, handle);
 
-   retro_assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
+   retro_assert(handle->audio_fifo &&
       handle->attr_fifo && handle->video_fifo && handle->thread);
 
    return true;
@@ -952,18 +946,11 @@ static void deinit_thread(ffmpeg_t *handle)
    if (!handle->thread)
       return;
 
-   slock_lock(handle->cond_lock);
    handle->alive = false;
-   handle->can_sleep = false;
-   slock_unlock(handle->cond_lock);
-
-   scond_signal(handle->cond);
+   /* The thread only ever sleeps on frame attributes */
+   spsc_queue_close(handle->attr_fifo);
    sthread_join(handle->thread);
 
-   slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
-
    handle->thread = NULL;
 }
 
@@ -971,19 +958,19 @@ static void deinit_thread_buf(ffmpeg_t *handle)
 {
    if (handle->audio_fifo)
    {
-      fifo_free(handle->audio_fifo);
+      spsc_queue_free(handle->audio_fifo);
       handle->audio_fifo = NULL;
    }
 
    if (handle->attr_fifo)
    {
-      fifo_free(handle->attr_fifo);
+      spsc_queue_free(handle->attr_fifo);
       handle->attr_fifo = NULL;
    }
 
    if (handle->video_fifo)
    {
-      fifo_free(handle->video_fifo);
+      spsc_queue_free(handle->video_fifo);
       handle->video_fifo = NULL;
    }
 }
@@ -1116,35 +1103,6 @@ static bool ffmpeg_push_video(void *data,
    if (drop_frame)
       return true;
 
-   for (;;)
-   {
-      unsigned avail;
-
-      slock_lock(handle->lock);
-      avail = FIFO_WRITE_AVAIL(handle->attr_fifo);
-      slock_unlock(handle->lock);
-
-      if (!handle->alive)
-         return false;
-
-      if (avail >= sizeof(*vid))
-         break;
-
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
-
-      slock_unlock(handle->cond_lock);
-   }
-
-   slock_lock(handle->lock);
-
    /* Tightly pack our frame to conserve memory.
     * libretro tends to use a very large pitch.
     */
@@ -1155,14 +1113,20 @@ static bool ffmpeg_push_video(void *data,
    else
       attr_data.pitch = attr_data.width * handle->video.pix_size;
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+   if (!handle->alive)
+      return false;
+
+   /* The encoder thread stays awake while frames are queued,
+    * so it will make room */
+   spsc_queue_wait_write(handle->attr_fifo, sizeof(attr_data));
+   spsc_queue_wait_write(handle->video_fifo,
+         attr_data.height * attr_data.pitch);
 
    for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
+      spsc_queue_write(handle->video_fifo,
             (const uint8_t*)vid->data + offset, attr_data.pitch);
 
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   spsc_queue_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
 
    return true;
 }
@@ -1170,6 +1134,8 @@ static bool ffmpeg_push_video(void *data,
 static bool ffmpeg_push_audio(void *data,
       const struct record_audio_data *audio_data)
 {
+   size_t written   = 0;
+   size_t size      = 0;
    ffmpeg_t *handle = (ffmpeg_t*)data;
 
    if (!handle || !audio_data)
@@ -1178,40 +1144,23 @@ static bool ffmpeg_push_audio(void *data,
    if (!handle->config.audio_enable)
       return true;
 
-   for (;;)
-   {
-      unsigned avail;
-
-      slock_lock(handle->lock);
-      avail = FIFO_WRITE_AVAIL(handle->audio_fifo);
-      slock_unlock(handle->lock);
+   if (!handle->alive)
+      return false;
 
-      if (!handle->alive)
-         return false;
+   size = audio_data->frames * handle->params.channels * sizeof(int16_t);
 
-      if (avail >= audio_data->frames * handle->params.channels
-            * sizeof(int16_t))
+   for (;;)
+   {
+      written += spsc_queue_write(handle->audio_fifo,
+            (const uint8_t*)audio_data->data + written, size - written);
+      /* The thread sleeps on the video attributes */
+      spsc_queue_wake_reader(handle->attr_fifo);
+      if (written >= size)
          break;
-
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
-
-      slock_unlock(handle->cond_lock);
+      /* Full, so the thread is busy draining it */
+      spsc_queue_wait_write(handle->audio_fifo, 1);
    }
 
-   slock_lock(handle->lock);
-   fifo_write(handle->audio_fifo, audio_data->data,
-         audio_data->frames * handle->params.channels * sizeof(int16_t));
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
-
    return true;
 }
 
@@ -1578,13 +1527,13 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
 static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
       size_t audio_buf_size)
 {
-   size_t avail = FIFO_READ_AVAIL(handle->audio_fifo);
+   size_t avail = spsc_queue_read_avail(handle->audio_fifo);
 
    if (avail)
    {
       struct record_audio_data aud = {0};
 
-      fifo_read(handle->audio_fifo, audio_buf, avail);
+      spsc_queue_read(handle->audio_fifo, audio_buf, avail);
 
       aud.frames = avail / (sizeof(int16_t) * handle->params.channels);
       aud.data = audio_buf;
@@ -1624,11 +1573,11 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
       if (handle->config.audio_enable)
       {
-         if (FIFO_READ_AVAIL(handle->audio_fifo) >= audio_buf_size)
+         if (spsc_queue_read_avail(handle->audio_fifo) >= audio_buf_size)
          {
             struct record_audio_data aud = {0};
 
-            fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
+            spsc_queue_read(handle->audio_fifo, audio_buf, audio_buf_size);
             aud.frames = handle->audio.codec->frame_size;
             aud.data   = audio_buf;
             ffmpeg_push_audio_thread(handle, &aud, true);
@@ -1637,10 +1586,10 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
          }
       }
 
-      if (FIFO_READ_AVAIL(handle->attr_fifo) >= sizeof(attr_buf))
+      if (spsc_queue_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf,
+         spsc_queue_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
+         spsc_queue_read(handle->video_fifo, video_buf,
                attr_buf.height * attr_buf.pitch);
          attr_buf.data = video_buf;
          ffmpeg_push_video_thread(handle, &attr_buf);
@@ -1704,38 +1653,22 @@ static void ffmpeg_thread(void *data)
       bool avail_video = false;
       bool avail_audio = false;
 
-      slock_lock(ff->lock);
-      if (FIFO_READ_AVAIL(ff->attr_fifo) >= sizeof(attr_buf))
+      if (spsc_queue_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
          avail_video = true;
 
       if (ff->config.audio_enable)
-         if (FIFO_READ_AVAIL(ff->audio_fifo) >= audio_buf_size)
+         if (spsc_queue_read_avail(ff->audio_fifo) >= audio_buf_size)
             avail_audio = true;
-      slock_unlock(ff->lock);
 
+      /* Pushed audio wakes this up too */
       if (!avail_video && !avail_audio)
-      {
-         slock_lock(ff->cond_lock);
-         if (ff->can_sleep)
-         {
-            ff->can_sleep = false;
-            scond_wait(ff->cond, ff->cond_lock);
-            ff->can_sleep = true;
-         }
-         else
-            scond_signal(ff->cond);
-
-         slock_unlock(ff->cond_lock);
-      }
+         spsc_queue_wait_read(ff->attr_fifo, sizeof(attr_buf));
 
       if (avail_video && video_buf)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
+         spsc_queue_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
+         spsc_queue_read(ff->video_fifo, video_buf,
                attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
 
          attr_buf.data = video_buf;
          ffmpeg_push_video_thread(ff, &attr_buf);
@@ -1745,10 +1678,7 @@ static void ffmpeg_thread(void *data)
       {
          struct record_audio_data aud = {0};
 
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
+         spsc_queue_read(ff->audio_fifo, audio_buf, audio_buf_size);
 
          aud.frames = ff->audio.codec->frame_size;
          aud.data   = audio_buf;
@@ -82,6 +82,16 @@
 #include <vfs/vfs_implementation.h>
 
 #include <features/features_cpu.h>
+#ifdef HAVE_RUNAHEAD
+#include <memmap.h>
+#include <memalign.h>
+#if defined(HAVE_DYNAMIC) && defined(__linux__) && !defined(ANDROID)
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <sys/syscall.h>
+#endif
+#endif
 
 #include <compat/strl.h>
 #include <compat/strcasestr.h>
@@ -97,10 +107,12 @@
 #include <compat/posix_string.h>
 #include <streams/file_stream.h>
 #include <streams/interface_stream.h>
+#include <formats/jsonsax_full.h>
 #include <file/file_path.h>
 #include <retro_assert.h>
 #include <retro_miscellaneous.h>
 #include <queues/message_queue.h>
+#include <queues/spsc_queue.h>
 #include <queues/task_queue.h>
 #include <lists/dir_list.h>
 #ifdef HAVE_NETWORKING
@@ -142,6 +154,7 @@
 #ifdef HAVE_NETWORKING
 #include <net/net_compat.h>
 #include <net/net_socket.h>
+#include <encodings/crc32.h>
 #endif
 
 #include <audio/audio_resampler.h>
@@ -195,6 +208,7 @@
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
+#include <rthreads/parallel.h>
 #endif
 
 #if defined(HAVE_OPENGL)
@@ -1247,6 +1261,19 @@ static const camera_driver_t *camera_drivers[] = {
 
 #define VIDEO_DRIVER_GET_HW_CONTEXT_INTERNAL() (&p_rarch->hw_render)
 
+#ifdef HAVE_THREADS
+#define AUDIO_PROCESS_LOCK() \
+   if (p_rarch->audio_process_lock) \
+      slock_lock(p_rarch->audio_process_lock)
+
+#define AUDIO_PROCESS_UNLOCK() \
+   if (p_rarch->audio_process_lock) \
+      slock_unlock(p_rarch->audio_process_lock)
+#else
+#define AUDIO_PROCESS_LOCK()           ((void)0)
+#define AUDIO_PROCESS_UNLOCK()         ((void)0)
+#endif
+
 #ifdef HAVE_THREADS
 #define RUNLOOP_MSG_QUEUE_LOCK() slock_lock(p_rarch->runloop_msg_queue_lock)
 #define RUNLOOP_MSG_QUEUE_UNLOCK() slock_unlock(p_rarch->runloop_msg_queue_lock)
@@ -1284,6 +1311,19 @@ static const camera_driver_t *camera_drivers[] = {
       p_rarch->runahead_secondary_core_available = false
 #endif
 
+#if defined(HAVE_RUNAHEAD) && defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+/* The secondary instance can run on a worker thread */
+#define RUNAHEAD_SECONDARY_THREAD
+#endif
+
+#if defined(HAVE_RUNAHEAD) && defined(HAVE_DYNAMIC) && defined(SYS_memfd_create)
+/* The secondary instance can be loaded from an anonymous file */
+#define RUNAHEAD_SECONDARY_MEMFD
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#endif
+
 #define RUNAHEAD_RESUME_VIDEO() \
    if (p_rarch->runahead_video_driver_is_active) \
       p_rarch->video_driver_active = true; \
@@ -1473,8 +1513,10 @@ static const camera_driver_t *camera_drivers[] = {
 
 #ifdef _WIN32
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %I64u ticks, %I64u runs.\n"
+#define RUNAHEAD_BYTES_LOG_FMT "[PERF]: Runahead (%s): %I64u bytes, %I64u per frame over %I64u frames.\n"
 #else
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %llu ticks, %llu runs.\n"
+#define RUNAHEAD_BYTES_LOG_FMT "[PERF]: Runahead (%s): %llu bytes, %llu per frame over %llu frames.\n"
 #endif
 
 #ifdef HAVE_MENU
@@ -1681,6 +1723,15 @@ typedef struct my_list_t
    int size;
 } my_list;
 
+#ifdef RUNAHEAD_SECONDARY_THREAD
+/* A core option as it was when the runahead worker was started */
+typedef struct runahead_thread_var
+{
+   const char *key;
+   const char *value;
+} runahead_thread_var_t;
+#endif
+
 #ifdef HAVE_OVERLAY
 typedef struct input_overlay_state
 {
@@ -1979,6 +2030,16 @@ struct rarch_state
 
 #ifdef HAVE_RUNAHEAD
    uint64_t runahead_last_frame_count;
+   /* Savestate bytes written by, and loaded back into,
+    * the core(s) over 'runahead_stats_frames' frames */
+   uint64_t runahead_bytes_serialized;
+   uint64_t runahead_bytes_unserialized;
+   uint64_t runahead_stats_frames;
+   /* Sum of the frame counts automatic mode picked, over
+    * 'runahead_auto_frames' frames */
+   uint64_t runahead_auto_count_total;
+   uint64_t runahead_auto_frames;
+   retro_time_t runahead_auto_last_time;
 #endif
 
    uint64_t video_driver_frame_time_count;
@@ -2071,6 +2132,16 @@ struct rarch_state
    int16_t *audio_driver_rewind_buf;
 #endif
    int16_t *audio_driver_output_samples_conv_buf;
+#ifdef HAVE_THREADS
+   /* Audio processing thread, the samples queued for it, its
+    * own input and output buffers, and the lock it holds while
+    * it uses the resampler, DSP filter, mixer and driver */
+   sthread_t *audio_process_thread;
+   slock_t *audio_process_lock;
+   spsc_queue_t *audio_process_queue;
+   int16_t *audio_process_input_buf;
+   int16_t *audio_process_conv_buf;
+#endif
 
 #ifdef HAVE_DSP_FILTER
    retro_dsp_filter_t *audio_driver_dsp;
@@ -2116,9 +2187,23 @@ struct rarch_state
 #endif
    frontend_ctx_driver_t *current_frontend_ctx;
 #ifdef HAVE_RUNAHEAD
-   my_list *runahead_save_state_list;
+   /* Every runahead savestate slot lives in here,
+    * 'runahead_state_stride' bytes apart */
+   uint8_t *runahead_state_arena;
    my_list *input_state_list;
 #endif
+#ifdef RUNAHEAD_SECONDARY_THREAD
+   /* Worker running the secondary instance, the input it
+    * plays back and the last frame it rendered */
+   sthread_t *runahead_thread;
+   slock_t *runahead_thread_lock;
+   scond_t *runahead_thread_cond;
+   my_list *runahead_thread_input;
+   uint8_t *runahead_thread_frame;
+   /* The worker answers GET_VARIABLE from these, so that it
+    * never reads the option manager the main instance updates */
+   runahead_thread_var_t *runahead_thread_vars;
+#endif
 
    struct retro_perf_counter *perf_counters_rarch[MAX_COUNTERS];
    struct retro_perf_counter *perf_counters_libretro[MAX_COUNTERS];
@@ -2210,6 +2295,14 @@ struct rarch_state
 
 #ifdef HAVE_RUNAHEAD
    size_t runahead_save_state_size;
+   size_t runahead_state_stride;
+   size_t runahead_state_arena_size;
+#endif
+#ifdef RUNAHEAD_SECONDARY_THREAD
+   size_t runahead_thread_frame_size;
+   size_t runahead_thread_pitch;
+   size_t runahead_thread_vars_size;
+   size_t runahead_thread_vars_capacity;
 #endif
 
    jmp_buf error_sjlj_context;              /* 4-byte alignment, 
@@ -2279,6 +2372,30 @@ struct rarch_state
 #ifdef HAVE_NETWORKING
    unsigned server_port_deferred;
 #endif
+#ifdef HAVE_RUNAHEAD
+   /* Slots allocated in, and slots in use of,
+    * 'runahead_state_arena' */
+   unsigned runahead_state_capacity;
+   unsigned runahead_state_slots;
+   /* Preemptive frames: consecutive states held in
+    * 'runahead_state_arena', and the slot written next */
+   unsigned runahead_preempt_frames;
+   unsigned runahead_preempt_ptr;
+   /* Automatic runahead: frame count in use, core runs timed
+    * so far, frames the next count up has fit in a row, and
+    * frames that missed their deadline in the current window */
+   unsigned runahead_auto_count;
+   unsigned runahead_auto_samples;
+   unsigned runahead_auto_settle;
+   unsigned runahead_auto_late;
+   unsigned runahead_auto_window;
+#endif
+#ifdef RUNAHEAD_SECONDARY_THREAD
+   /* Frames the worker runs for the current job */
+   unsigned runahead_thread_frames;
+   unsigned runahead_thread_width;
+   unsigned runahead_thread_height;
+#endif
 
    unsigned audio_driver_free_samples_buf[
       AUDIO_BUFFER_FREE_SAMPLES_COUNT];
@@ -2299,6 +2416,16 @@ struct rarch_state
 
    float input_driver_axis_threshold;
 
+#ifdef HAVE_RUNAHEAD
+   /* Automatic runahead: smoothed cost of one core run,
+    * serialize and unserialize in usec, and the share of
+    * frames on which input changed */
+   float runahead_auto_run_usec;
+   float runahead_auto_serialize_usec;
+   float runahead_auto_unserialize_usec;
+   float runahead_auto_dirty_rate;
+#endif
+
    enum osk_type osk_idx;
    enum rarch_core_type current_core_type;
    enum rarch_core_type explicit_current_core_type;
@@ -2513,6 +2640,7 @@ struct rarch_state
    bool audio_driver_control;
    bool audio_driver_mute_enable;
    bool audio_driver_use_float;
+   bool audio_driver_nonblock;
 
    bool audio_suspended;
 
@@ -2566,6 +2694,25 @@ struct rarch_state
    bool runahead_available;
    bool runahead_secondary_core_available;
    bool runahead_force_input_dirty;
+   bool runahead_auto;
+   bool runahead_auto_secondary;
+#endif
+#ifdef RUNAHEAD_SECONDARY_THREAD
+   /* A job is running, or the worker is asked to quit */
+   bool runahead_thread_busy;
+   bool runahead_thread_quit;
+   /* The job loads the state in slot 0 first */
+   bool runahead_thread_load;
+   bool runahead_thread_ok;
+   /* Keep the frame rendered while this is set; the one kept
+    * was a dupe if 'runahead_thread_dupe' is set */
+   bool runahead_thread_capture;
+   bool runahead_thread_captured;
+   bool runahead_thread_dupe;
+   /* The secondary instance has the worker's callbacks set */
+   bool runahead_thread_hooked;
+   /* What GET_VARIABLE_UPDATE tells the worker */
+   bool runahead_thread_vars_update;
 #endif
 
 #ifdef HAVE_AUDIOMIXER
@@ -2718,6 +2865,7 @@ static const struct input_bind_map input_config_bind_map[RARCH_BIND_LIST_END_NUL
       DECLARE_META_BIND(2, recording_toggle,      RARCH_RECORDING_TOGGLE,      MENU_ENUM_LABEL_VALUE_INPUT_META_RECORDING_TOGGLE),
       DECLARE_META_BIND(2, streaming_toggle,      RARCH_STREAMING_TOGGLE,      MENU_ENUM_LABEL_VALUE_INPUT_META_STREAMING_TOGGLE),
       DECLARE_META_BIND(2, ai_service,            RARCH_AI_SERVICE,            MENU_ENUM_LABEL_VALUE_INPUT_META_AI_SERVICE),
+      DECLARE_META_BIND(2, rewind_seek,           RARCH_REWIND_SEEK,           MENU_ENUM_LABEL_VALUE_INPUT_META_REWIND_SEEK),
 };
 
 /* TODO/FIXME - turn these into static global variable */
@@ -2794,6 +2942,9 @@ static void rarch_init_core_options(
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
 static bool secondary_core_create(struct rarch_state *p_rarch);
 #endif
+#ifdef RUNAHEAD_SECONDARY_THREAD
+static void runahead_thread_stop(struct rarch_state *p_rarch);
+#endif
 static int16_t input_state_get_last(unsigned port,
       unsigned device, unsigned index, unsigned id);
 #endif
@@ -2824,6 +2975,12 @@ static void ui_companion_driver_init_first(
 static bool audio_driver_stop(struct rarch_state *p_rarch);
 static bool audio_driver_start(struct rarch_state *p_rarch,
       bool is_shutdown);
+static void audio_driver_set_nonblock(struct rarch_state *p_rarch,
+      bool enable);
+#ifdef HAVE_THREADS
+static bool audio_driver_process_thread_init(struct rarch_state *p_rarch);
+static void audio_driver_process_thread_deinit(struct rarch_state *p_rarch);
+#endif
 
 static bool recording_init(settings_t *settings,
       struct rarch_state *p_rarch);
@@ -2850,6 +3007,9 @@ static void audio_mixer_play_stop_cb(
       audio_mixer_sound_t *sound, unsigned reason);
 static void audio_mixer_menu_stop_cb(
       audio_mixer_sound_t *sound, unsigned reason);
+static void audio_driver_mixer_play_stream_internal(
+      struct rarch_state *p_rarch,
+      unsigned i, unsigned type);
 #endif
 
 static void video_driver_gpu_record_deinit(struct rarch_state *p_rarch);
@@ -9366,9 +9526,11 @@ static bool get_self_input_state(
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
+      if (connection->active && !connection->relayed &&
+            connection->mode >= NETPLAY_CONNECTION_CONNECTED)
          netplay_send_cur_input(netplay, &netplay->connections[i]);
    }
+   netplay_send_cur_input_relay(netplay);
 
    /* Handle any delayed state changes */
    if (netplay->is_server)
@@ -9499,7 +9661,7 @@ static bool netplay_poll(
    {
       case NETPLAY_STALL_RUNNING_FAST:
          {
-            if (netplay->unread_frame_count + NETPLAY_MAX_STALL_FRAMES - 2
+            if (netplay->unread_frame_count + netplay->stall_frames - 2
                   > netplay->self_frame_count)
             {
                netplay->stall = NETPLAY_STALL_NONE;
@@ -9554,7 +9716,7 @@ static bool netplay_poll(
       }
 
       /* Are we too far ahead? */
-      if (netplay->unread_frame_count + NETPLAY_MAX_STALL_FRAMES
+      if (netplay->unread_frame_count + netplay->stall_frames
             <= netplay->self_frame_count)
       {
          netplay->stall      = NETPLAY_STALL_RUNNING_FAST;
@@ -10071,6 +10233,7 @@ static void netplay_frontend_paused(netplay_t *netplay, bool paused)
    {
       struct netplay_connection *connection = &netplay->connections[i];
       if (     connection->active 
+            && !connection->relayed
             && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
       {
          if (paused)
@@ -10086,6 +10249,13 @@ static void netplay_frontend_paused(netplay_t *netplay, bool paused)
                connection->fd, true);
       }
    }
+
+   /* The relay thread sends it on by itself */
+   if (paused)
+      netplay_relay_send_cmd(netplay, NETPLAY_CMD_PAUSE,
+            netplay->nick, NETPLAY_NICK_LEN);
+   else
+      netplay_relay_send_cmd(netplay, NETPLAY_CMD_RESUME, NULL, 0);
 }
 
 /**
@@ -10222,12 +10392,16 @@ static void netplay_post_frame(
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
+      netplay_cmd_ping(netplay, connection);
       if (connection->active &&
           !netplay_send_flush(&connection->send_packet_buffer, connection->fd,
             false))
          netplay_hangup(netplay, connection);
    }
 
+   /* Spectators that have caught up can go to the relay */
+   netplay_relay_attach_ready(netplay);
+
    /* If we're disconnected, deinitialize */
    if (!netplay->is_server && !netplay->connections[0].active)
       netplay_disconnect(p_rarch, netplay);
@@ -10278,6 +10452,70 @@ static void netplay_force_future(netplay_t *netplay)
    }
 }
 
+/**
+ * netplay_send_savestate_delta
+ * @netplay              : pointer to netplay object
+ * @connection           : peer that asked for the savestate
+ * @serial_info          : the savestate being loaded
+ * @z                    : compression backend to use
+ *
+ * Send a loaded savestate as a delta against the base state the peer named
+ * in its request, if we still have that state.
+ *
+ * Returns: true if the peer has been taken care of, false if it needs the
+ * full savestate.
+ */
+static bool netplay_send_savestate_delta(netplay_t *netplay,
+   struct netplay_connection *connection,
+   retro_ctx_serialize_info_t *serial_info,
+   struct compression_transcoder *z)
+{
+   uint32_t header[7];
+   uint32_t rd, wn;
+   size_t patch_size;
+   struct netplay_state_base *base = netplay_state_base_find(netplay,
+         connection->savestate_base_frame, connection->savestate_base_crc,
+         connection->fast_hash);
+
+   if (!base || serial_info->size != netplay->state_size)
+      return false;
+
+   if (!(patch_size = netplay_state_delta_encode(netplay, base,
+               serial_info->data_const)))
+      return false;
+
+   /* The patch compresses far better than the state itself */
+   z->compression_backend->set_in(z->compression_stream,
+      netplay->delta_patch, (uint32_t)patch_size);
+   z->compression_backend->set_out(z->compression_stream,
+      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+   if (!z->compression_backend->trans(z->compression_stream, true, &rd,
+         &wn, NULL))
+      return false;
+
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+   header[1] = htonl(wn + 5*sizeof(uint32_t));
+   header[2] = htonl(netplay->run_frame_count);
+   header[3] = htonl(serial_info->size);
+   header[4] = htonl(base->frame);
+   header[5] = htonl(connection->fast_hash ? base->hash : base->crc);
+   header[6] = htonl(netplay_state_check(netplay, serial_info->data_const,
+            connection->fast_hash));
+
+   RARCH_LOG("[netplay] Sending savestate as a delta against frame %u "
+         "(%u of %u bytes).\n", base->frame, wn,
+         (unsigned)serial_info->size);
+
+   connection->udp_barrier_sent++;
+   if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
+         sizeof(header)) ||
+       !netplay_send(&connection->send_packet_buffer, connection->fd,
+         netplay->zbuffer, wn))
+      netplay_hangup(netplay, connection);
+
+   return true;
+}
+
 /**
  * netplay_send_savestate
  * @netplay              : pointer to netplay object
@@ -10286,7 +10524,8 @@ static void netplay_force_future(netplay_t *netplay)
  * @z                    : compression backend to use
  *
  * Send a loaded savestate to those connected peers using the given compression
- * scheme.
+ * scheme. Peers that asked for it against a base state we share get a delta,
+ * the rest the whole state.
  */
 void netplay_send_savestate(netplay_t *netplay,
    retro_ctx_serialize_info_t *serial_info, uint32_t cx,
@@ -10295,34 +10534,78 @@ void netplay_send_savestate(netplay_t *netplay,
    uint32_t header[4];
    uint32_t rd, wn;
    size_t i;
+   bool compressed = false;
 
-   /* Compress it */
-   z->compression_backend->set_in(z->compression_stream,
-      (const uint8_t*)serial_info->data_const, (uint32_t)serial_info->size);
-   z->compression_backend->set_out(z->compression_stream,
-      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
-   if (!z->compression_backend->trans(z->compression_stream, true, &rd,
-         &wn, NULL))
+   /* Deltas first, they need the compression buffer too */
+   for (i = 0; i < netplay->connections_size; i++)
    {
-      /* Catastrophe! */
-      for (i = 0; i < netplay->connections_size; i++)
-         netplay_hangup(netplay, &netplay->connections[i]);
-      return;
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active ||
+          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+          connection->compression_supported != cx ||
+          !connection->savestate_base) continue;
+
+      if (!netplay_send_savestate_delta(netplay, connection, serial_info, z))
+         connection->savestate_base = false;
    }
 
-   /* Send it to relevant peers */
+   /* Send the full state to the other relevant peers */
    header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
-   header[1] = htonl(wn + 2*sizeof(uint32_t));
    header[2] = htonl(netplay->run_frame_count);
    header[3] = htonl(serial_info->size);
 
-   for (i = 0; i < netplay->connections_size; i++)
+   for (i = 0; i <= netplay->connections_size; i++)
    {
-      struct netplay_connection *connection = &netplay->connections[i];
-      if (!connection->active ||
-          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
-          connection->compression_supported != cx) continue;
+      struct netplay_connection *connection = NULL;
+
+      /* After the peers, the spectators the relay is serving, all at once */
+      if (i == netplay->connections_size)
+      {
+         if (cx != NETPLAY_COMPRESSION_ZLIB || !netplay_relay_active(netplay))
+            break;
+      }
+      else
+      {
+         connection = &netplay->connections[i];
+         if (!connection->active || connection->relayed ||
+             connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+             connection->compression_supported != cx) continue;
 
+         if (connection->savestate_base)
+         {
+            connection->savestate_base = false;
+            continue;
+         }
+      }
+
+      /* Compress it */
+      if (!compressed)
+      {
+         z->compression_backend->set_in(z->compression_stream,
+            (const uint8_t*)serial_info->data_const,
+            (uint32_t)serial_info->size);
+         z->compression_backend->set_out(z->compression_stream,
+            netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+         if (!z->compression_backend->trans(z->compression_stream, true, &rd,
+               &wn, NULL))
+         {
+            /* Catastrophe! */
+            for (i = 0; i < netplay->connections_size; i++)
+               netplay_hangup(netplay, &netplay->connections[i]);
+            return;
+         }
+         header[1]  = htonl(wn + 2*sizeof(uint32_t));
+         compressed = true;
+      }
+
+      if (!connection)
+      {
+         netplay_relay_send(netplay, header, sizeof(header), true);
+         netplay_relay_send(netplay, netplay->zbuffer, wn, false);
+         break;
+      }
+
+      connection->udp_barrier_sent++;
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
             sizeof(header)) ||
           !netplay_send(&connection->send_packet_buffer, connection->fd,
@@ -10415,13 +10698,16 @@ static void netplay_core_reset(netplay_t *netplay)
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (!connection->active ||
+      if (!connection->active || connection->relayed ||
             connection->mode < NETPLAY_CONNECTION_CONNECTED) continue;
 
+      connection->udp_barrier_sent++;
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmd,
                sizeof(cmd)))
          netplay_hangup(netplay, connection);
    }
+
+   netplay_relay_send(netplay, cmd, sizeof(cmd), true);
 }
 
 /**
@@ -10773,6 +11059,182 @@ static void rarch_perf_log(struct rarch_state *p_rarch)
 {
    RARCH_LOG("[PERF]: Performance counters (RetroArch):\n");
    log_counters(p_rarch->perf_counters_rarch, p_rarch->perf_ptr_rarch);
+
+#ifdef HAVE_RUNAHEAD
+   /* Byte and frame counts, not ticks, so not perf counters */
+   if (p_rarch->runahead_stats_frames)
+   {
+      uint64_t frames = p_rarch->runahead_stats_frames;
+
+      RARCH_LOG(RUNAHEAD_BYTES_LOG_FMT, "serialized",
+            p_rarch->runahead_bytes_serialized,
+            p_rarch->runahead_bytes_serialized / frames, frames);
+      RARCH_LOG(RUNAHEAD_BYTES_LOG_FMT, "unserialized",
+            p_rarch->runahead_bytes_unserialized,
+            p_rarch->runahead_bytes_unserialized / frames, frames);
+   }
+   if (p_rarch->runahead_auto_frames)
+      RARCH_LOG("[PERF]: Runahead (automatic): %.2f frames ahead on average.\n",
+            (double)p_rarch->runahead_auto_count_total
+            / p_rarch->runahead_auto_frames);
+#endif
+}
+
+static JSON_Writer_HandlerResult task_stats_json_output_handler(
+      JSON_Writer writer, const char *pBytes, size_t length)
+{
+   RFILE *file = (RFILE*)JSON_Writer_GetUserData(writer);
+
+   return filestream_write(file, pBytes, length) == (int64_t)length
+      ? JSON_Writer_Continue
+      : JSON_Writer_Abort;
+}
+
+static void task_stats_json_key(JSON_Writer writer, const char *key)
+{
+   JSON_Writer_WriteString(writer, key, strlen(key), JSON_UTF8);
+   JSON_Writer_WriteColon(writer);
+   JSON_Writer_WriteSpace(writer, 1);
+}
+
+static void task_stats_json_number(JSON_Writer writer, uint64_t value)
+{
+   char buf[32];
+   int n = snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+   JSON_Writer_WriteNumber(writer, buf, n, JSON_UTF8);
+}
+
+static void task_stats_json_series(JSON_Writer writer, const char *key,
+      uint64_t count, uint64_t total, uint64_t max, const uint32_t *hist)
+{
+   unsigned i;
+
+   JSON_Writer_WriteComma(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 6);
+   task_stats_json_key(writer, key);
+   JSON_Writer_WriteStartObject(writer);
+
+   task_stats_json_key(writer, "avg");
+   task_stats_json_number(writer, total / count);
+   JSON_Writer_WriteComma(writer);
+   task_stats_json_key(writer, "p50");
+   task_stats_json_number(writer,
+         task_queue_stats_percentile(hist, count, max, 50));
+   JSON_Writer_WriteComma(writer);
+   task_stats_json_key(writer, "p95");
+   task_stats_json_number(writer,
+         task_queue_stats_percentile(hist, count, max, 95));
+   JSON_Writer_WriteComma(writer);
+   task_stats_json_key(writer, "max");
+   task_stats_json_number(writer, max);
+   JSON_Writer_WriteComma(writer);
+   task_stats_json_key(writer, "histogram");
+   JSON_Writer_WriteStartArray(writer);
+   for (i = 0; i < TASK_STATS_BUCKETS; i++)
+   {
+      if (i)
+         JSON_Writer_WriteComma(writer);
+      task_stats_json_number(writer, hist[i]);
+   }
+   JSON_Writer_WriteEndArray(writer);
+
+   JSON_Writer_WriteEndObject(writer);
+}
+
+/* Writes what the task queue spent to task_stats.json
+ * in the log directory. Times are in microseconds,
+ * histogram bucket i counts values from 2^i to 2^(i+1). */
+static void rarch_task_stats_log(settings_t *settings)
+{
+   size_t i, count;
+   char path[PATH_MAX_LENGTH];
+   const task_queue_stats_t *stats = NULL;
+   const char *dir                 = settings->paths.log_dir;
+   JSON_Writer writer              = NULL;
+   RFILE *file                     = NULL;
+
+   if (!(count = task_queue_get_stats(&stats)))
+      return;
+
+   if (string_is_empty(dir))
+      dir = g_defaults.dirs[DEFAULT_DIR_LOGS];
+   if (string_is_empty(dir))
+      return;
+
+   path[0] = '\0';
+   fill_pathname_join(path, dir, "task_stats.json", sizeof(path));
+
+   if (!(file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_ERR("[PERF]: Failed to open task statistics file: %s\n", path);
+      return;
+   }
+
+   if (!(writer = JSON_Writer_Create(NULL)))
+   {
+      filestream_close(file);
+      return;
+   }
+
+   JSON_Writer_SetOutputEncoding(writer, JSON_UTF8);
+   JSON_Writer_SetOutputHandler(writer, &task_stats_json_output_handler);
+   JSON_Writer_SetUserData(writer, file);
+
+   JSON_Writer_WriteStartObject(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   task_stats_json_key(writer, "tasks");
+   JSON_Writer_WriteStartArray(writer);
+
+   for (i = 0; i < count; i++)
+   {
+      const task_queue_stats_t *t = &stats[i];
+
+      if (i)
+         JSON_Writer_WriteComma(writer);
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 4);
+      JSON_Writer_WriteStartObject(writer);
+      JSON_Writer_WriteNewLine(writer);
+
+      JSON_Writer_WriteSpace(writer, 6);
+      task_stats_json_key(writer, "name");
+      JSON_Writer_WriteString(writer, t->name, strlen(t->name), JSON_UTF8);
+      JSON_Writer_WriteComma(writer);
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 6);
+      task_stats_json_key(writer, "count");
+      task_stats_json_number(writer, t->count);
+
+      task_stats_json_series(writer, "wait_us", t->count,
+            t->wait_total, t->wait_max, t->wait_hist);
+      task_stats_json_series(writer, "run_us", t->count,
+            t->run_total, t->run_max, t->run_hist);
+      task_stats_json_series(writer, "iterations", t->count,
+            t->iterations_total, t->iterations_max, t->iterations_hist);
+
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 4);
+      JSON_Writer_WriteEndObject(writer);
+   }
+
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   JSON_Writer_WriteEndArray(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteEndObject(writer);
+   JSON_Writer_WriteNewLine(writer);
+
+   if (JSON_Writer_GetError(writer) != JSON_Error_None)
+      RARCH_ERR("[PERF]: Failed to write task statistics: %s\n",
+            JSON_ErrorString(JSON_Writer_GetError(writer)));
+   else
+      RARCH_LOG("[PERF]: Task statistics written to: %s\n", path);
+
+   JSON_Writer_Free(writer);
+   filestream_close(file);
 }
 
 static void retro_perf_log(void)
@@ -12879,12 +13341,161 @@ static bool command_read_ram(const char *arg);
 static bool command_write_ram(const char *arg);
 #endif
 
+#ifdef HAVE_REWIND
+static bool command_rewind_seek(const char *arg)
+{
+   unsigned seconds;
+
+   if (string_is_empty(arg))
+      return command_event(CMD_EVENT_REWIND_SEEK, NULL);
+
+   seconds = (unsigned)strtoul(arg, NULL, 10);
+   return command_event(CMD_EVENT_REWIND_SEEK, &seconds);
+}
+#endif
+
+#ifdef HAVE_NETWORKING
+static bool command_get_netplay_stats(const char *arg)
+{
+   char reply[512];
+   struct rarch_state *p_rarch = &rarch_st;
+   netplay_t          *netplay = p_rarch->netplay_data;
+
+   if (!netplay)
+      strcpy_literal(reply, "GET_NETPLAY_STATS DISABLED\n");
+   else
+   {
+      const struct netplay_frame_cost *last  = &netplay->cost_last;
+      const struct netplay_frame_cost *total = &netplay->cost_total;
+      retro_time_t rtt                       = 0;
+      unsigned frames                        = total->resim_frames ?
+         total->resim_frames : 1;
+      size_t i;
+
+      for (i = 0; i < netplay->connections_size; i++)
+         if (netplay->connections[i].active &&
+               netplay->connections[i].rtt > rtt)
+            rtt = netplay->connections[i].rtt;
+
+      /* Times in microseconds: the last frame's, then the session's
+       * totals and its per-replayed-frame resimulation average */
+      snprintf(reply, sizeof(reply),
+            "GET_NETPLAY_STATS rtt_us=%u stall_frames=%u buffer_size=%u "
+            "serialize=%u unserialize=%u resim=%u resim_frames=%u "
+            "total_serialize=%llu total_unserialize=%llu total_resim=%llu "
+            "total_resim_frames=%u resim_per_frame=%u rollbacks=%u\n",
+            (unsigned)rtt,
+            (unsigned)netplay->stall_frames,
+            (unsigned)netplay->buffer_size,
+            (unsigned)last->serialize,
+            (unsigned)last->unserialize,
+            (unsigned)last->resim,
+            (unsigned)last->resim_frames,
+            (unsigned long long)total->serialize,
+            (unsigned long long)total->unserialize,
+            (unsigned long long)total->resim,
+            (unsigned)total->resim_frames,
+            (unsigned)(total->resim / frames),
+            (unsigned)netplay->stat_rollbacks);
+   }
+
+   command_reply(p_rarch, reply, strlen(reply));
+   return true;
+}
+#endif
+
+static bool command_get_task_stats(const char *arg)
+{
+   size_t i, count;
+   size_t len                      = 0;
+   size_t size                     = 0;
+   char *reply                     = NULL;
+   const task_queue_stats_t *stats = NULL;
+   struct rarch_state *p_rarch     = &rarch_st;
+
+   count = task_queue_get_stats(&stats);
+   size  = 64 + count * 1024;
+   reply = (char*)malloc(size);
+   if (!reply)
+      return false;
+
+   if (!count)
+      len = strlcpy(reply, "GET_TASK_STATS NONE\n", size);
+
+   /* One line per handler. Times in microseconds; each histogram
+    * lists its base 2 buckets up to the last non-empty one */
+   for (i = 0; i < count && len < size; i++)
+   {
+      const task_queue_stats_t *t = &stats[i];
+      const uint32_t *hists[3];
+      static const char *keys[3]  = { "wait_hist", "run_hist", "iter_hist" };
+      unsigned j;
+
+      hists[0] = t->wait_hist;
+      hists[1] = t->run_hist;
+      hists[2] = t->iterations_hist;
+
+      len += snprintf(reply + len, size - len,
+            "GET_TASK_STATS count=%llu "
+            "wait_avg=%llu wait_p50=%llu wait_p95=%llu wait_max=%llu "
+            "run_avg=%llu run_p50=%llu run_p95=%llu run_max=%llu "
+            "iter_avg=%llu iter_max=%llu",
+            (unsigned long long)t->count,
+            (unsigned long long)(t->wait_total / t->count),
+            (unsigned long long)task_queue_stats_percentile(
+               t->wait_hist, t->count, t->wait_max, 50),
+            (unsigned long long)task_queue_stats_percentile(
+               t->wait_hist, t->count, t->wait_max, 95),
+            (unsigned long long)t->wait_max,
+            (unsigned long long)(t->run_total / t->count),
+            (unsigned long long)task_queue_stats_percentile(
+               t->run_hist, t->count, t->run_max, 50),
+            (unsigned long long)task_queue_stats_percentile(
+               t->run_hist, t->count, t->run_max, 95),
+            (unsigned long long)t->run_max,
+            (unsigned long long)(t->iterations_total / t->count),
+            (unsigned long long)t->iterations_max);
+
+      for (j = 0; j < 3 && len < size; j++)
+      {
+         unsigned k;
+         unsigned last = TASK_STATS_BUCKETS - 1;
+
+         while (last && !hists[j][last])
+            last--;
+
+         len += snprintf(reply + len, size - len, " %s=", keys[j]);
+         for (k = 0; k <= last && len < size; k++)
+            len += snprintf(reply + len, size - len,
+                  k ? ",%u" : "%u", (unsigned)hists[j][k]);
+      }
+
+      if (len < size)
+         len += snprintf(reply + len, size - len, " name=%s\n",
+               string_is_empty(t->name) ? "-" : t->name);
+   }
+
+   if (len > size - 1)
+      len = size - 1;
+
+   command_reply(p_rarch, reply, len);
+   free(reply);
+   return true;
+}
+
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER",       command_set_shader,       "<shader path>" },
    { "VERSION",          command_version,          "No argument"},
    { "GET_STATUS",       command_get_status,       "No argument" },
    { "GET_CONFIG_PARAM", command_get_config_param, "<param name>" },
    { "SHOW_MSG",         command_show_osd_msg,     "No argument" },
+#ifdef HAVE_REWIND
+   { "REWIND_SEEK",      command_rewind_seek,      "<seconds>" },
+#endif
+#ifdef HAVE_NETWORKING
+   { "GET_NETPLAY_STATS", command_get_netplay_stats, "No argument" },
+#endif
+   { "GET_TASK_STATS",   command_get_task_stats,   "No argument" },
 #if defined(HAVE_CHEEVOS)
    { "READ_CORE_RAM",   command_read_ram,    "<address> <number of bytes>" },
    { "WRITE_CORE_RAM",  command_write_ram,   "<address> <byte1> <byte2> ..." },
@@ -12939,6 +13550,7 @@ static const struct cmd_map map[] = {
    { "MENU_A",                 RETRO_DEVICE_ID_JOYPAD_A },
    { "MENU_B",                 RETRO_DEVICE_ID_JOYPAD_B },
    { "AI_SERVICE",             RARCH_AI_SERVICE },
+   { "REWIND_SEEK",            RARCH_REWIND_SEEK },
 };
 #endif
 
@@ -13550,6 +14162,7 @@ static bool call_auto_translate_task(
       *mode                              = ai_service_mode;
 
       t->handler                         = task_auto_translate_handler;
+      t->stats_name                      = "AI service";
       t->user_data                       = mode;
       t->mute                            = true;
       task_queue_push(t);
@@ -15907,6 +16520,8 @@ static void runahead_clear_variables(struct rarch_state *p_rarch)
    p_rarch->runahead_secondary_core_available = true;
    p_rarch->runahead_force_input_dirty        = true;
    p_rarch->runahead_last_frame_count         = 0;
+   p_rarch->runahead_preempt_frames           = 0;
+   p_rarch->runahead_preempt_ptr              = 0;
 }
 #endif
 
@@ -16324,6 +16939,11 @@ bool command_event(enum event_command cmd, void *data)
 #ifdef HAVE_REWIND
          {
             bool rewind_enable        = settings->bools.rewind_enable;
+            bool rewind_threaded      = settings->bools.rewind_threaded;
+            unsigned rewind_tier_age  = settings->uints.rewind_tier_age;
+            unsigned rewind_disk_size = settings->uints.rewind_disk_buffer_size;
+            unsigned rewind_keyframes = settings->uints.rewind_keyframe_interval;
+            const char *dir_cache     = settings->paths.directory_cache;
             unsigned rewind_buf_size  = settings->sizes.rewind_buffer_size;
 #ifdef HAVE_CHEEVOS
             if (rcheevos_hardcore_active())
@@ -16338,7 +16958,22 @@ bool command_event(enum event_command cmd, void *data)
                         RARCH_NETPLAY_CTL_IS_ENABLED, NULL))
 #endif
                {
-                  state_manager_event_init((unsigned)rewind_buf_size);
+                  char disk_path[PATH_MAX_LENGTH];
+
+                  disk_path[0] = '\0';
+
+                  /* The scratch file goes to the cache directory,
+                   * or next to the savestates if there is none */
+                  if (rewind_disk_size)
+                     fill_pathname_join(disk_path,
+                           path_is_directory(dir_cache)
+                           ? dir_cache : p_rarch->dir_savestate,
+                           "rewind.tmp", sizeof(disk_path));
+
+                  state_manager_event_init((unsigned)rewind_buf_size,
+                        rewind_threaded, rewind_tier_age,
+                        disk_path, (size_t)rewind_disk_size << 20,
+                        rewind_keyframes);
                }
             }
          }
@@ -16353,6 +16988,47 @@ bool command_event(enum event_command cmd, void *data)
             else
                command_event(CMD_EVENT_REWIND_DEINIT, NULL);
          }
+#endif
+         break;
+      case CMD_EVENT_REWIND_SEEK:
+#ifdef HAVE_REWIND
+         {
+            char msg[128];
+            unsigned frames, done;
+            unsigned granularity      = settings->uints.rewind_granularity;
+            unsigned seconds          = data
+               ? *(const unsigned*)data
+               : settings->uints.rewind_seek_seconds;
+            double fps                =
+               p_rarch->video_driver_av_info.timing.fps;
+
+#ifdef HAVE_CHEEVOS
+            if (rcheevos_hardcore_active())
+               return false;
+#endif
+            if (!granularity)
+               granularity            = 1;
+            if (fps <= 0.0)
+               fps                    = 60.0;
+
+            /* Each rewind step is 'granularity' frames apart */
+            frames = (unsigned)(seconds * fps / granularity + 0.5);
+            done   = state_manager_seek(frames ? frames : 1);
+
+            if (!done)
+               strlcpy(msg, msg_hash_to_str(MSG_REWIND_REACHED_END),
+                     sizeof(msg));
+            else
+               snprintf(msg, sizeof(msg),
+                     msg_hash_to_str(MSG_REWIND_SEEK),
+                     done * granularity / fps);
+
+            runloop_msg_queue_push(msg, 1, 180, true, NULL,
+                  MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+
+            if (!done)
+               return false;
+         }
 #endif
          break;
       case CMD_EVENT_AUTOSAVE_INIT:
@@ -17680,7 +18356,10 @@ void main_exit(void *args)
    rarch_ctl(RARCH_CTL_MAIN_DEINIT, NULL);
 
    if (p_rarch->runloop_perfcnt_enable)
+   {
       rarch_perf_log(p_rarch);
+      rarch_task_stats_log(p_rarch->configuration_settings);
+   }
 
 #if defined(HAVE_LOGGER) && !defined(ANDROID)
    logger_shutdown();
@@ -17706,6 +18385,9 @@ void main_exit(void *args)
    rarch_ctl(RARCH_CTL_STATE_FREE,  NULL);
    global_free(p_rarch);
    task_queue_deinit();
+#ifdef HAVE_THREADS
+   parallel_deinit();
+#endif
 
    if (p_rarch->configuration_settings)
       free(p_rarch->configuration_settings);
@@ -18991,6 +19673,12 @@ static void rarch_log_libretro(
    va_end(vp);
 }
 
+/* Cores only get the RETRO_SIMD_* part */
+static uint64_t core_get_cpu_features(void)
+{
+   return cpu_features_get() & CPU_FEATURES_LIBRETRO_MASK;
+}
+
 static void core_performance_counter_start(
       struct retro_perf_counter *perf)
 {
@@ -19927,7 +20615,7 @@ static bool rarch_environment_cb(unsigned cmd, void *data)
 
          RARCH_LOG("[Environ]: GET_PERF_INTERFACE.\n");
          cb->get_time_usec    = cpu_features_get_time_usec;
-         cb->get_cpu_features = cpu_features_get;
+         cb->get_cpu_features = core_get_cpu_features;
          cb->get_perf_counter = cpu_features_get_perf_counter;
 
          cb->perf_register    = performance_counter_register;
@@ -20717,8 +21405,10 @@ static bool init_libretro_symbols_custom(
                 * primary library loaded, so we can skip
                 * some checks and just load the library */
                retro_assert(lib_path != NULL && lib_handle_p != NULL);
-               lib_handle_local = dylib_load(lib_path);
+               lib_handle_local = *lib_handle_p;
 
+               if (!lib_handle_local)
+                  lib_handle_local = dylib_load(lib_path);
                if (!lib_handle_local)
                   return false;
                *lib_handle_p = lib_handle_local;
@@ -20955,6 +21645,10 @@ static void secondary_core_destroy(struct rarch_state *p_rarch)
    if (!p_rarch || !p_rarch->secondary_lib_handle)
       return;
 
+#ifdef RUNAHEAD_SECONDARY_THREAD
+   runahead_thread_stop(p_rarch);
+#endif
+
    /* unload game from core */
    if (p_rarch->secondary_core.retro_unload_game)
       p_rarch->secondary_core.retro_unload_game();
@@ -20967,9 +21661,11 @@ static void secondary_core_destroy(struct rarch_state *p_rarch)
 
    dylib_close(p_rarch->secondary_lib_handle);
    p_rarch->secondary_lib_handle = NULL;
-   filestream_delete(p_rarch->secondary_library_path);
    if (p_rarch->secondary_library_path)
+   {
+      filestream_delete(p_rarch->secondary_library_path);
       free(p_rarch->secondary_library_path);
+   }
    p_rarch->secondary_library_path = NULL;
 }
 
@@ -21175,11 +21871,174 @@ end:
    return NULL;
 }
 
+#ifdef RUNAHEAD_SECONDARY_MEMFD
+/* Copies the core into an anonymous in-memory file and loads
+ * that. The dynamic linker tells libraries apart by inode, so
+ * this gets a second instance without touching the disk. */
+static dylib_t secondary_core_load_memfd(const char *core_path)
+{
+   char buf[16384];
+   char fd_path[64];
+   ssize_t len;
+   int in_fd;
+   dylib_t lib = NULL;
+   int fd      = (int)syscall(SYS_memfd_create,
+         "retroarch_secondary_core", MFD_CLOEXEC);
+
+   if (fd < 0)
+      return NULL;
+
+   if ((in_fd = open(core_path, O_RDONLY)) < 0)
+   {
+      close(fd);
+      return NULL;
+   }
+
+   while ((len = read(in_fd, buf, sizeof(buf))) > 0)
+   {
+      if (write(fd, buf, len) != len)
+      {
+         len = -1;
+         break;
+      }
+   }
+
+   close(in_fd);
+
+   if (len == 0)
+   {
+      void *stale;
+
+      snprintf(fd_path, sizeof(fd_path), "/proc/self/fd/%d", fd);
+
+      /* The fd number, and so the path, is reused between loads.
+       * A previous copy that stayed mapped (RTLD_NODELETE, unique
+       * symbols in C++ cores) would be matched by name and handed
+       * back instead of a new instance, maybe of another core. */
+      if ((stale = dlopen(fd_path, RTLD_LAZY | RTLD_NOLOAD)))
+      {
+         dlclose(stale);
+         RARCH_LOG("[Runahead]: %s is still loaded, not using an in-memory copy.\n",
+               fd_path);
+      }
+      else
+         lib = dylib_load(fd_path);
+   }
+
+   /* The mapping keeps the file alive */
+   close(fd);
+   return lib;
+}
+#endif
+
+/* Loads a second instance of the core library. Tries an
+ * in-memory copy, then a copy in the temp directory, in which
+ * case 'secondary_library_path' is set to the copy, and only
+ * then a new link-map namespace. */
+static bool secondary_core_load_library(struct rarch_state *p_rarch)
+{
+   const char *core_path = path_get(RARCH_PATH_CORE);
+
+   if (string_is_empty(core_path))
+      return false;
+
+#ifdef RUNAHEAD_SECONDARY_MEMFD
+   if ((p_rarch->secondary_lib_handle =
+            secondary_core_load_memfd(core_path)))
+   {
+      RARCH_LOG("[Runahead]: Loaded second instance from memory.\n");
+      return true;
+   }
+#endif
+
+   p_rarch->secondary_lib_handle   = NULL;
+   p_rarch->secondary_library_path = copy_core_to_temp_file(p_rarch);
+
+   if (p_rarch->secondary_library_path)
+      p_rarch->secondary_lib_handle = dylib_load(
+            p_rarch->secondary_library_path);
+
+   if (!p_rarch->secondary_lib_handle)
+   {
+      if (p_rarch->secondary_library_path)
+      {
+         filestream_delete(p_rarch->secondary_library_path);
+         free(p_rarch->secondary_library_path);
+      }
+      p_rarch->secondary_library_path = NULL;
+
+      /* A namespace comes with its own libc and its own state
+       * (malloc arenas, stdio, locale), and glibc only has a
+       * handful of them, so this is the last resort */
+      if (!(p_rarch->secondary_lib_handle =
+               dylib_load_isolated(core_path)))
+         return false;
+
+      RARCH_WARN("[Runahead]: Could not copy the core, loaded second "
+            "instance with dlmopen() in a new namespace.\n");
+      return true;
+   }
+
+   RARCH_LOG("[Runahead]: Loaded second instance from \"%s\".\n",
+         p_rarch->secondary_library_path);
+   return true;
+}
+
 static bool rarch_environment_secondary_core_hook(
       unsigned cmd, void *data)
 {
    struct rarch_state *p_rarch = &rarch_st;
-   bool                 result = rarch_environment_cb(cmd, data);
+   bool                 result = false;
+
+#ifdef RUNAHEAD_SECONDARY_THREAD
+   /* On the worker thread, only answer queries that do not
+    * touch the drivers, and core options from the snapshot
+    * taken before the worker was started */
+   if (     p_rarch->runahead_thread
+         && sthread_isself(p_rarch->runahead_thread))
+   {
+      switch (cmd)
+      {
+         case RETRO_ENVIRONMENT_GET_VARIABLE:
+            {
+               size_t i;
+               struct retro_variable *var = (struct retro_variable*)data;
+
+               if (!var)
+                  return true;
+
+               var->value = NULL;
+
+               for (i = 0; i < p_rarch->runahead_thread_vars_size; i++)
+               {
+                  if (string_is_equal(
+                           p_rarch->runahead_thread_vars[i].key, var->key))
+                  {
+                     var->value = p_rarch->runahead_thread_vars[i].value;
+                     break;
+                  }
+               }
+            }
+            return true;
+         case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+            if (data)
+               *(bool*)data = p_rarch->runahead_thread_vars_update;
+            p_rarch->runahead_thread_vars_update = false;
+            return true;
+         case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+         case RETRO_ENVIRONMENT_GET_PERF_INTERFACE:
+         case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+         case RETRO_ENVIRONMENT_GET_INPUT_BITMASKS:
+         case RETRO_ENVIRONMENT_GET_LANGUAGE:
+         case RETRO_ENVIRONMENT_GET_CORE_OPTIONS_VERSION:
+            return rarch_environment_cb(cmd, data);
+         default:
+            return false;
+      }
+   }
+#endif
+
+   result = rarch_environment_cb(cmd, data);
 
    if (p_rarch->has_variable_update)
    {
@@ -21214,15 +22073,16 @@ static bool secondary_core_create(struct rarch_state *p_rarch)
    if (p_rarch->secondary_library_path)
       free(p_rarch->secondary_library_path);
    p_rarch->secondary_library_path = NULL;
-   p_rarch->secondary_library_path = copy_core_to_temp_file(p_rarch);
 
-   if (!p_rarch->secondary_library_path)
+   if (!secondary_core_load_library(p_rarch))
       return false;
 
    /* Load Core */
    if (!init_libretro_symbols_custom(p_rarch,
             CORE_TYPE_PLAIN, &p_rarch->secondary_core,
-            p_rarch->secondary_library_path, 
+            p_rarch->secondary_library_path
+            ? p_rarch->secondary_library_path
+            : path_get(RARCH_PATH_CORE),
             &p_rarch->secondary_lib_handle))
       return false;
 
@@ -29908,6 +30768,9 @@ static bool audio_driver_free_devices_list(struct rarch_state *p_rarch)
 
 static bool audio_driver_deinit(struct rarch_state *p_rarch)
 {
+#ifdef HAVE_THREADS
+   audio_driver_process_thread_deinit(p_rarch);
+#endif
 #ifdef HAVE_AUDIOMIXER
    audio_driver_mixer_deinit(p_rarch);
 #endif
@@ -30065,12 +30928,11 @@ static bool audio_driver_init_internal(
             p_rarch->audio_driver_context_audio_data))
       p_rarch->audio_driver_use_float = true;
 
+   p_rarch->audio_driver_nonblock     = false;
+
    if (!audio_sync && p_rarch->audio_driver_active)
    {
-      if (p_rarch->audio_driver_active &&
-            p_rarch->audio_driver_context_audio_data)
-         p_rarch->current_audio->set_nonblock_state(
-               p_rarch->audio_driver_context_audio_data, true);
+      audio_driver_set_nonblock(p_rarch, true);
 
       p_rarch->audio_driver_chunk_size =
          p_rarch->audio_driver_chunk_nonblock_size;
@@ -30152,6 +31014,15 @@ static bool audio_driver_init_internal(
       audio_driver_start(p_rarch,
             false);
 
+#ifdef HAVE_THREADS
+   if (
+            settings->bools.audio_process_thread
+         && p_rarch->audio_driver_active
+         && !audio_cb_inited
+      )
+      audio_driver_process_thread_init(p_rarch);
+#endif
+
    return true;
 
 error:
@@ -30159,24 +31030,24 @@ error:
 }
 
 /**
- * audio_driver_flush:
+ * audio_driver_process:
  * @data                 : pointer to audio buffer.
- * @right                : amount of samples to write.
+ * @samples              : amount of samples to write.
+ * @audio_volume_gain    : gain to apply to the samples.
+ * @ratio_scale          : factor to apply to the resampling ratio.
+ * @conv_buf             : buffer for the converted output.
  *
- * Writes audio samples to audio driver. Will first
- * perform DSP processing (if enabled) and resampling.
+ * Performs DSP processing (if enabled), resampling and
+ * mixing, then writes the result to the audio driver.
+ * Runs on the audio processing thread when there is one.
  **/
-static void audio_driver_flush(
+static void audio_driver_process(
       struct rarch_state *p_rarch,
-      float slowmotion_ratio,
-      bool audio_fastforward_mute,
       const int16_t *data, size_t samples,
-      bool is_slowmotion, bool is_fastmotion)
+      float audio_volume_gain, float ratio_scale,
+      int16_t *conv_buf)
 {
    struct resampler_data src_data;
-   float audio_volume_gain           = (p_rarch->audio_driver_mute_enable ||
-         (audio_fastforward_mute && is_fastmotion)) ?
-               0.0f : p_rarch->audio_driver_volume_gain;
 
    src_data.data_out                 = NULL;
    src_data.output_frames            = 0;
@@ -30246,10 +31117,8 @@ static void audio_driver_flush(
 #endif
    }
 
-   src_data.ratio           = p_rarch->audio_source_ratio_current;
-
-   if (is_slowmotion)
-      src_data.ratio       *= slowmotion_ratio;
+   src_data.ratio           = p_rarch->audio_source_ratio_current
+      * ratio_scale;
 
    /* Note: Ideally we would divide by the user-configured
     * 'fastforward_ratio' when fast forward is enabled,
@@ -30300,10 +31169,10 @@ static void audio_driver_flush(
          output_frames       *= sizeof(float);
       else
       {
-         convert_float_to_s16(p_rarch->audio_driver_output_samples_conv_buf,
+         convert_float_to_s16(conv_buf,
                (const float*)output_data, output_frames * 2);
 
-         output_data          = p_rarch->audio_driver_output_samples_conv_buf;
+         output_data          = conv_buf;
          output_frames       *= sizeof(int16_t);
       }
 
@@ -30314,6 +31183,184 @@ static void audio_driver_flush(
    }
 }
 
+#ifdef HAVE_THREADS
+/* Queued in front of each chunk of samples for the
+ * audio processing thread */
+struct audio_process_packet
+{
+   uint32_t samples;
+   float volume_gain;
+   float ratio_scale;
+};
+
+static void audio_driver_process_thread_loop(void *data)
+{
+   struct rarch_state *p_rarch = (struct rarch_state*)data;
+   spsc_queue_t *queue         = p_rarch->audio_process_queue;
+
+   for (;;)
+   {
+      struct audio_process_packet packet;
+      size_t size;
+
+      if (!spsc_queue_wait_read(queue, sizeof(packet)))
+         break;
+      spsc_queue_read(queue, &packet, sizeof(packet));
+
+      size = packet.samples * sizeof(int16_t);
+      if (!spsc_queue_wait_read(queue, size))
+         break;
+      spsc_queue_read(queue, p_rarch->audio_process_input_buf, size);
+
+      slock_lock(p_rarch->audio_process_lock);
+      /* Drop what was still queued when the driver was stopped,
+       * a paused driver may block on it forever. */
+      if (     p_rarch->audio_driver_active
+            && (!p_rarch->current_audio->alive
+               || p_rarch->current_audio->alive(
+                  p_rarch->audio_driver_context_audio_data)))
+         audio_driver_process(p_rarch,
+               p_rarch->audio_process_input_buf, packet.samples,
+               packet.volume_gain, packet.ratio_scale,
+               p_rarch->audio_process_conv_buf);
+      slock_unlock(p_rarch->audio_process_lock);
+   }
+}
+
+/**
+ * audio_driver_process_push:
+ *
+ * Queues samples for the audio processing thread.
+ * When blocking, waits until the thread has taken
+ * everything queued before, so that at most one chunk
+ * is waiting while another one is being processed.
+ * When not blocking, drops what doesn't fit, as a
+ * nonblocking driver would.
+ **/
+static void audio_driver_process_push(
+      struct rarch_state *p_rarch,
+      const int16_t *data, size_t samples,
+      float audio_volume_gain, float ratio_scale)
+{
+   struct audio_process_packet packet;
+   spsc_queue_t *queue = p_rarch->audio_process_queue;
+   size_t size         = samples * sizeof(int16_t);
+
+   packet.samples      = (uint32_t)samples;
+   packet.volume_gain  = audio_volume_gain;
+   packet.ratio_scale  = ratio_scale;
+
+   if (p_rarch->audio_driver_nonblock)
+   {
+      if (spsc_queue_write_avail(queue) < sizeof(packet) + size)
+         return;
+   }
+   else if (!spsc_queue_wait_write(queue, spsc_queue_size(queue)))
+      return;
+
+   spsc_queue_write(queue, &packet, sizeof(packet));
+   spsc_queue_write(queue, data, size);
+}
+
+static bool audio_driver_process_thread_init(struct rarch_state *p_rarch)
+{
+   settings_t *settings   = p_rarch->configuration_settings;
+   float slowmotion_ratio = settings->floats.slowmotion_ratio;
+   size_t in_samples      = AUDIO_CHUNK_SIZE_NONBLOCKING * 2;
+   size_t out_samples     = AUDIO_CHUNK_SIZE_NONBLOCKING * 2
+      * AUDIO_MAX_RATIO * slowmotion_ratio;
+
+   p_rarch->audio_process_input_buf = (int16_t*)
+      malloc(in_samples * sizeof(int16_t));
+   p_rarch->audio_process_conv_buf  = (int16_t*)
+      malloc(out_samples * sizeof(int16_t));
+   p_rarch->audio_process_queue     = spsc_queue_new(
+         sizeof(struct audio_process_packet)
+         + in_samples * sizeof(int16_t));
+   p_rarch->audio_process_lock      = slock_new();
+
+   if (     !p_rarch->audio_process_input_buf
+         || !p_rarch->audio_process_conv_buf
+         || !p_rarch->audio_process_queue
+         || !p_rarch->audio_process_lock)
+      goto error;
+
+   p_rarch->audio_process_thread    = sthread_create(
+         audio_driver_process_thread_loop, p_rarch);
+   if (!p_rarch->audio_process_thread)
+      goto error;
+
+   RARCH_LOG("[Audio]: Processing audio on a separate thread.\n");
+   return true;
+
+error:
+   RARCH_ERR("[Audio]: Failed to start the audio processing thread.\n");
+   audio_driver_process_thread_deinit(p_rarch);
+   return false;
+}
+
+static void audio_driver_process_thread_deinit(struct rarch_state *p_rarch)
+{
+   if (p_rarch->audio_process_thread)
+   {
+      spsc_queue_close(p_rarch->audio_process_queue);
+      sthread_join(p_rarch->audio_process_thread);
+   }
+   p_rarch->audio_process_thread = NULL;
+
+   if (p_rarch->audio_process_queue)
+      spsc_queue_free(p_rarch->audio_process_queue);
+   p_rarch->audio_process_queue  = NULL;
+
+   if (p_rarch->audio_process_lock)
+      slock_free(p_rarch->audio_process_lock);
+   p_rarch->audio_process_lock   = NULL;
+
+   if (p_rarch->audio_process_input_buf)
+      free(p_rarch->audio_process_input_buf);
+   p_rarch->audio_process_input_buf = NULL;
+
+   if (p_rarch->audio_process_conv_buf)
+      free(p_rarch->audio_process_conv_buf);
+   p_rarch->audio_process_conv_buf  = NULL;
+}
+#endif
+
+/**
+ * audio_driver_flush:
+ * @data                 : pointer to audio buffer.
+ * @right                : amount of samples to write.
+ *
+ * Writes audio samples to audio driver. Will first
+ * perform DSP processing (if enabled) and resampling,
+ * or leave that to the audio processing thread.
+ **/
+static void audio_driver_flush(
+      struct rarch_state *p_rarch,
+      float slowmotion_ratio,
+      bool audio_fastforward_mute,
+      const int16_t *data, size_t samples,
+      bool is_slowmotion, bool is_fastmotion)
+{
+   float audio_volume_gain           = (p_rarch->audio_driver_mute_enable ||
+         (audio_fastforward_mute && is_fastmotion)) ?
+               0.0f : p_rarch->audio_driver_volume_gain;
+   float ratio_scale                 = is_slowmotion ? slowmotion_ratio : 1.0f;
+
+#ifdef HAVE_THREADS
+   if (p_rarch->audio_process_thread)
+   {
+      audio_driver_process_push(p_rarch, data, samples,
+            audio_volume_gain, ratio_scale);
+      return;
+   }
+#endif
+
+   audio_driver_process(p_rarch, data, samples,
+         audio_volume_gain, ratio_scale,
+         p_rarch->audio_driver_output_samples_conv_buf);
+}
+
 /**
  * audio_driver_sample:
  * @left                 : value of the left audio channel.
@@ -30523,9 +31570,11 @@ static size_t audio_driver_sample_batch_rewind(
 void audio_driver_dsp_filter_free(void)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_PROCESS_LOCK();
    if (p_rarch->audio_driver_dsp)
       retro_dsp_filter_free(p_rarch->audio_driver_dsp);
    p_rarch->audio_driver_dsp = NULL;
+   AUDIO_PROCESS_UNLOCK();
 }
 
 bool audio_driver_dsp_filter_init(const char *device)
@@ -30553,7 +31602,9 @@ bool audio_driver_dsp_filter_init(const char *device)
    if (!audio_driver_dsp)
       return false;
 
+   AUDIO_PROCESS_LOCK();
    p_rarch->audio_driver_dsp = audio_driver_dsp;
+   AUDIO_PROCESS_UNLOCK();
 
    return true;
 }
@@ -30781,7 +31832,12 @@ static void audio_mixer_play_stop_sequential_cb(
                if (p_rarch->audio_mixer_streams[i].state
                      == AUDIO_STREAM_STATE_STOPPED)
                {
-                  audio_driver_mixer_play_stream_sequential(i);
+                  /* Called from the mix, which already holds
+                   * the audio processing lock */
+                  p_rarch->audio_mixer_streams[i].stop_cb =
+                     audio_mixer_play_stop_sequential_cb;
+                  audio_driver_mixer_play_stream_internal(p_rarch,
+                        i, AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL);
                   break;
                }
             }
@@ -30886,6 +31942,8 @@ bool audio_driver_mixer_add_stream(audio_mixer_stream_params_t *params)
       return false;
    }
 
+   AUDIO_PROCESS_LOCK();
+
    switch (params->state)
    {
       case AUDIO_STREAM_STATE_PLAYING_LOOPED:
@@ -30916,6 +31974,8 @@ bool audio_driver_mixer_add_stream(audio_mixer_stream_params_t *params)
    p_rarch->audio_mixer_streams[free_slot].volume      = params->volume;
    p_rarch->audio_mixer_streams[free_slot].stop_cb     = stop_cb;
 
+   AUDIO_PROCESS_UNLOCK();
+
    return true;
 }
 
@@ -31072,41 +32132,51 @@ end:
 void audio_driver_mixer_play_stream(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_PROCESS_LOCK();
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING);
+   AUDIO_PROCESS_UNLOCK();
 }
 
 void audio_driver_mixer_play_menu_sound_looped(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_PROCESS_LOCK();
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_menu_stop_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING_LOOPED);
+   AUDIO_PROCESS_UNLOCK();
 }
 
 void audio_driver_mixer_play_menu_sound(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_PROCESS_LOCK();
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_menu_stop_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING);
+   AUDIO_PROCESS_UNLOCK();
 }
 
 void audio_driver_mixer_play_stream_looped(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_PROCESS_LOCK();
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING_LOOPED);
+   AUDIO_PROCESS_UNLOCK();
 }
 
 void audio_driver_mixer_play_stream_sequential(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_PROCESS_LOCK();
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_sequential_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL);
+   AUDIO_PROCESS_UNLOCK();
 }
 
 float audio_driver_mixer_get_stream_volume(unsigned i)
@@ -31128,20 +32198,19 @@ void audio_driver_mixer_set_stream_volume(unsigned i, float vol)
 
    p_rarch->audio_mixer_streams[i].volume = vol;
 
+   AUDIO_PROCESS_LOCK();
    voice                                  =
       p_rarch->audio_mixer_streams[i].voice;
 
    if (voice)
       audio_mixer_voice_set_volume(voice, DB_TO_GAIN(vol));
+   AUDIO_PROCESS_UNLOCK();
 }
 
-void audio_driver_mixer_stop_stream(unsigned i)
+static void audio_driver_mixer_stop_stream_internal(
+      struct rarch_state *p_rarch, unsigned i)
 {
    bool set_state                         = false;
-   struct rarch_state *p_rarch            = &rarch_st;
-
-   if (i >= AUDIO_MIXER_MAX_SYSTEM_STREAMS)
-      return;
 
    switch (p_rarch->audio_mixer_streams[i].state)
    {
@@ -31166,6 +32235,18 @@ void audio_driver_mixer_stop_stream(unsigned i)
    }
 }
 
+void audio_driver_mixer_stop_stream(unsigned i)
+{
+   struct rarch_state *p_rarch            = &rarch_st;
+
+   if (i >= AUDIO_MIXER_MAX_SYSTEM_STREAMS)
+      return;
+
+   AUDIO_PROCESS_LOCK();
+   audio_driver_mixer_stop_stream_internal(p_rarch, i);
+   AUDIO_PROCESS_UNLOCK();
+}
+
 void audio_driver_mixer_remove_stream(unsigned i)
 {
    bool destroy                = false;
@@ -31174,12 +32255,16 @@ void audio_driver_mixer_remove_stream(unsigned i)
    if (i >= AUDIO_MIXER_MAX_SYSTEM_STREAMS)
       return;
 
+   /* Held throughout, a finishing stream could otherwise
+    * free itself on the audio processing thread meanwhile */
+   AUDIO_PROCESS_LOCK();
+
    switch (p_rarch->audio_mixer_streams[i].state)
    {
       case AUDIO_STREAM_STATE_PLAYING:
       case AUDIO_STREAM_STATE_PLAYING_LOOPED:
       case AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL:
-         audio_driver_mixer_stop_stream(i);
+         audio_driver_mixer_stop_stream_internal(p_rarch, i);
          destroy = true;
          break;
       case AUDIO_STREAM_STATE_STOPPED:
@@ -31205,6 +32290,8 @@ void audio_driver_mixer_remove_stream(unsigned i)
       p_rarch->audio_mixer_streams[i].voice   = NULL;
       p_rarch->audio_mixer_streams[i].name    = NULL;
    }
+
+   AUDIO_PROCESS_UNLOCK();
 }
 #endif
 
@@ -31237,8 +32324,10 @@ static void audio_driver_monitor_set_rate(struct rarch_state *p_rarch)
    double new_src_ratio                 = (double)audio_out_rate /
       p_rarch->audio_driver_input;
 
+   AUDIO_PROCESS_LOCK();
    p_rarch->audio_source_ratio_original = new_src_ratio;
    p_rarch->audio_source_ratio_current  = new_src_ratio;
+   AUDIO_PROCESS_UNLOCK();
 }
 
 bool audio_driver_callback(void)
@@ -31283,14 +32372,19 @@ static INLINE bool audio_driver_alive(struct rarch_state *p_rarch)
 static bool audio_driver_start(struct rarch_state *p_rarch,
       bool is_shutdown)
 {
+   bool ret;
+
    if (!p_rarch->current_audio || !p_rarch->current_audio->start
          || !p_rarch->audio_driver_context_audio_data)
       goto error;
-   if (!p_rarch->current_audio->start(
-            p_rarch->audio_driver_context_audio_data, is_shutdown))
-      goto error;
 
-   return true;
+   AUDIO_PROCESS_LOCK();
+   ret = p_rarch->current_audio->start(
+         p_rarch->audio_driver_context_audio_data, is_shutdown);
+   AUDIO_PROCESS_UNLOCK();
+
+   if (ret)
+      return true;
 
 error:
    RARCH_ERR("%s\n",
@@ -31301,14 +32395,35 @@ error:
 
 static bool audio_driver_stop(struct rarch_state *p_rarch)
 {
+   bool ret;
+
    if (     !p_rarch->current_audio 
          || !p_rarch->current_audio->stop
          || !p_rarch->audio_driver_context_audio_data
          || !audio_driver_alive(p_rarch)
       )
       return false;
-   return p_rarch->current_audio->stop(
+
+   AUDIO_PROCESS_LOCK();
+   ret = p_rarch->current_audio->stop(
          p_rarch->audio_driver_context_audio_data);
+   AUDIO_PROCESS_UNLOCK();
+
+   return ret;
+}
+
+static void audio_driver_set_nonblock(struct rarch_state *p_rarch,
+      bool enable)
+{
+   p_rarch->audio_driver_nonblock = enable;
+
+   if (!p_rarch->audio_driver_context_audio_data)
+      return;
+
+   AUDIO_PROCESS_LOCK();
+   p_rarch->current_audio->set_nonblock_state(
+         p_rarch->audio_driver_context_audio_data, enable);
+   AUDIO_PROCESS_UNLOCK();
 }
 
 #ifdef HAVE_REWIND
@@ -34920,10 +36035,8 @@ void driver_set_nonblock_state(void)
       }
    }
 
-   if (audio_driver_active && p_rarch->audio_driver_context_audio_data)
-      p_rarch->current_audio->set_nonblock_state(
-            p_rarch->audio_driver_context_audio_data,
-            audio_sync ? enable : true);
+   if (audio_driver_active)
+      audio_driver_set_nonblock(p_rarch, audio_sync ? enable : true);
 
    p_rarch->audio_driver_chunk_size = enable
       ? p_rarch->audio_driver_chunk_nonblock_size
@@ -35513,20 +36626,18 @@ static void input_state_set_last(unsigned port, unsigned device,
    element->state[id] = value;
 }
 
-static int16_t input_state_get_last(unsigned port,
+static int16_t input_state_list_get(my_list *list, unsigned port,
       unsigned device, unsigned index, unsigned id)
 {
    unsigned i;
-   struct rarch_state      *p_rarch = &rarch_st;
 
-   if (!p_rarch->input_state_list)
+   if (!list)
       return 0;
 
    /* find list item */
-   for (i = 0; i < (unsigned)p_rarch->input_state_list->size; i++)
+   for (i = 0; i < (unsigned)list->size; i++)
    {
-      input_list_element *element =
-         (input_list_element*)p_rarch->input_state_list->data[i];
+      input_list_element *element = (input_list_element*)list->data[i];
 
       if (  (element->port   == port)   &&
             (element->device == device) &&
@@ -35540,6 +36651,14 @@ static int16_t input_state_get_last(unsigned port,
    return 0;
 }
 
+static int16_t input_state_get_last(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   struct rarch_state      *p_rarch = &rarch_st;
+   return input_state_list_get(p_rarch->input_state_list,
+         port, device, index, id);
+}
+
 static int16_t input_state_with_logging(unsigned port,
       unsigned device, unsigned index, unsigned id)
 {
@@ -35566,7 +36685,9 @@ static void reset_hook(void)
 {
    struct rarch_state     *p_rarch = &rarch_st;
 
-   p_rarch->input_is_dirty         = true;
+   /* Older preemptive states can not be rolled back to */
+   p_rarch->input_is_dirty             = true;
+   p_rarch->runahead_force_input_dirty = true;
 
    if (p_rarch->retro_reset_callback_original)
       p_rarch->retro_reset_callback_original();
@@ -35576,7 +36697,8 @@ static bool unserialize_hook(const void *buf, size_t size)
 {
    struct rarch_state     *p_rarch = &rarch_st;
 
-   p_rarch->input_is_dirty         = true;
+   p_rarch->input_is_dirty             = true;
+   p_rarch->runahead_force_input_dirty = true;
 
    if (p_rarch->retro_unserialize_callback_original)
       return p_rarch->retro_unserialize_callback_original(buf, size);
@@ -35636,48 +36758,131 @@ static void remove_input_state_hook(void)
    }
 }
 
-static void *runahead_save_state_alloc(void)
+#if defined(HAVE_MMAN) && !defined(_WIN32)
+#define RUNAHEAD_STATE_MMAP
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+/* Fault the arena in up front rather than on the first frames */
+#ifdef MAP_POPULATE
+#define RUNAHEAD_STATE_MAP_POPULATE MAP_POPULATE
+#else
+#define RUNAHEAD_STATE_MAP_POPULATE 0
+#endif
+#endif
+
+/* Savestate slots start on page boundaries */
+#define RUNAHEAD_STATE_ALIGN     4096
+/* Arenas at least this big are backed by huge pages if possible */
+#define RUNAHEAD_STATE_HUGE_PAGE (2 << 20)
+
+static void runahead_state_arena_free(struct rarch_state *p_rarch)
+{
+   if (!p_rarch->runahead_state_arena)
+      return;
+
+#ifdef RUNAHEAD_STATE_MMAP
+   munmap(p_rarch->runahead_state_arena,
+         p_rarch->runahead_state_arena_size);
+#else
+   memalign_free(p_rarch->runahead_state_arena);
+#endif
+
+   p_rarch->runahead_state_arena      = NULL;
+   p_rarch->runahead_state_arena_size = 0;
+   p_rarch->runahead_state_capacity   = 0;
+   p_rarch->runahead_state_slots      = 0;
+}
+
+static bool runahead_state_arena_alloc(struct rarch_state *p_rarch,
+      size_t size)
 {
-   struct rarch_state *p_rarch           = &rarch_st;
-   retro_ctx_serialize_info_t *savestate = (retro_ctx_serialize_info_t*)
-      malloc(sizeof(retro_ctx_serialize_info_t));
+#ifdef RUNAHEAD_STATE_MMAP
+   void *arena = MAP_FAILED;
 
-   if (!savestate)
-      return NULL;
+#ifdef MAP_HUGETLB
+   /* Only succeeds if the administrator reserved huge pages,
+    * otherwise fall back to normal pages below */
+   if (size >= RUNAHEAD_STATE_HUGE_PAGE)
+   {
+      size_t huge_size = (size + RUNAHEAD_STATE_HUGE_PAGE - 1)
+         & ~(size_t)(RUNAHEAD_STATE_HUGE_PAGE - 1);
 
-   savestate->data          = NULL;
-   savestate->data_const    = NULL;
-   savestate->size          = 0;
+      arena = mmap(NULL, huge_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB
+            | RUNAHEAD_STATE_MAP_POPULATE, -1, 0);
 
-   if (  (p_rarch->runahead_save_state_size > 0) &&
-         p_rarch->runahead_save_state_size_known)
+      if (arena != MAP_FAILED)
+         size = huge_size;
+   }
+#endif
+
+   if (arena == MAP_FAILED)
    {
-      savestate->data       = malloc(p_rarch->runahead_save_state_size);
-      savestate->data_const = savestate->data;
-      savestate->size       = p_rarch->runahead_save_state_size;
+      arena = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | RUNAHEAD_STATE_MAP_POPULATE,
+            -1, 0);
+
+      if (arena == MAP_FAILED)
+         return false;
+
+#ifdef MADV_HUGEPAGE
+      /* Transparent huge pages, if the kernel has them */
+      if (size >= RUNAHEAD_STATE_HUGE_PAGE)
+         madvise(arena, size, MADV_HUGEPAGE);
+#endif
    }
+#else
+   void *arena = memalign_alloc(RUNAHEAD_STATE_ALIGN, size);
 
-   return savestate;
+   if (!arena)
+      return false;
+#endif
+
+   p_rarch->runahead_state_arena      = (uint8_t*)arena;
+   p_rarch->runahead_state_arena_size = size;
+   return true;
 }
 
-static void runahead_save_state_free(void *data)
+/* Makes room for 'slots' savestates. The arena is sized once,
+ * when runahead starts, for what the current mode needs;
+ * it is only reallocated if more frames are asked for later,
+ * which loses the states it held. */
+static bool runahead_state_arena_reserve(struct rarch_state *p_rarch,
+      unsigned slots)
 {
-   retro_ctx_serialize_info_t *savestate = (retro_ctx_serialize_info_t*)data;
-   if (!savestate)
-      return;
-   free(savestate->data);
-   free(savestate);
+   if (slots <= p_rarch->runahead_state_capacity)
+   {
+      p_rarch->runahead_state_slots = slots;
+      return true;
+   }
+
+   runahead_state_arena_free(p_rarch);
+
+   p_rarch->runahead_state_stride =
+        (p_rarch->runahead_save_state_size + RUNAHEAD_STATE_ALIGN - 1)
+      & ~(size_t)(RUNAHEAD_STATE_ALIGN - 1);
+
+   if (!runahead_state_arena_alloc(p_rarch,
+            p_rarch->runahead_state_stride * slots))
+      return false;
+
+   p_rarch->runahead_state_capacity   = slots;
+   p_rarch->runahead_state_slots      = slots;
+
+   RARCH_LOG("[Runahead]: %u savestate slot(s) of %u bytes, %u KB arena.\n",
+         slots, (unsigned)p_rarch->runahead_save_state_size,
+         (unsigned)(p_rarch->runahead_state_arena_size >> 10));
+   return true;
 }
 
-static void runahead_save_state_list_init(
-      struct rarch_state *p_rarch,
-      size_t save_state_size)
+static void runahead_state_slot(struct rarch_state *p_rarch,
+      unsigned slot, retro_ctx_serialize_info_t *info)
 {
-   p_rarch->runahead_save_state_size       = save_state_size;
-   p_rarch->runahead_save_state_size_known = true;
-
-   mylist_create(&p_rarch->runahead_save_state_list, 16,
-         runahead_save_state_alloc, runahead_save_state_free);
+   info->data       = p_rarch->runahead_state_arena
+      + slot * p_rarch->runahead_state_stride;
+   info->data_const = info->data;
+   info->size       = p_rarch->runahead_save_state_size;
 }
 
 /* Hooks - Hooks to cleanup, and add dirty input hooks */
@@ -35699,7 +36904,7 @@ static void runahead_remove_hooks(struct rarch_state *p_rarch)
 
 static void runahead_destroy(struct rarch_state *p_rarch)
 {
-   mylist_destroy(&p_rarch->runahead_save_state_list);
+   runahead_state_arena_free(p_rarch);
    runahead_remove_hooks(p_rarch);
    runahead_clear_variables(p_rarch);
 }
@@ -35748,13 +36953,14 @@ static void runahead_add_hooks(struct rarch_state *p_rarch)
 static void runahead_error(struct rarch_state *p_rarch)
 {
    p_rarch->runahead_available             = false;
-   mylist_destroy(&p_rarch->runahead_save_state_list);
+   runahead_state_arena_free(p_rarch);
    runahead_remove_hooks(p_rarch);
    p_rarch->runahead_save_state_size       = 0;
    p_rarch->runahead_save_state_size_known = true;
 }
 
-static bool runahead_create(struct rarch_state *p_rarch)
+static bool runahead_create(struct rarch_state *p_rarch,
+      unsigned slots)
 {
    /* get savestate size and allocate buffer */
    retro_ctx_size_info_t info;
@@ -35763,12 +36969,13 @@ static bool runahead_create(struct rarch_state *p_rarch)
    core_serialize_size(&info);
    p_rarch->request_fast_savestate          = false;
 
-   runahead_save_state_list_init(p_rarch, info.size);
+   p_rarch->runahead_save_state_size        = info.size;
+   p_rarch->runahead_save_state_size_known  = true;
    p_rarch->runahead_video_driver_is_active = 
       p_rarch->video_driver_active;
 
    if (  (p_rarch->runahead_save_state_size == 0) ||
-         !p_rarch->runahead_save_state_size_known)
+         !runahead_state_arena_reserve(p_rarch, slots))
    {
       runahead_error(p_rarch);
       return false;
@@ -35776,51 +36983,297 @@ static bool runahead_create(struct rarch_state *p_rarch)
 
    runahead_add_hooks(p_rarch);
    p_rarch->runahead_force_input_dirty = true;
-   mylist_resize(p_rarch->runahead_save_state_list, 1, true);
+
+   /* Automatic runahead starts over with every core */
+   p_rarch->runahead_auto_count            = 1;
+   p_rarch->runahead_auto_samples          = 0;
+   p_rarch->runahead_auto_settle           = 0;
+   p_rarch->runahead_auto_late             = 0;
+   p_rarch->runahead_auto_window           = 0;
+   p_rarch->runahead_auto_last_time        = 0;
+   p_rarch->runahead_auto_run_usec         = 0.0f;
+   p_rarch->runahead_auto_serialize_usec   = 0.0f;
+   p_rarch->runahead_auto_unserialize_usec = 0.0f;
+   p_rarch->runahead_auto_dirty_rate       = 0.0f;
+   p_rarch->runahead_auto_secondary        = false;
    return true;
 }
 
-static bool runahead_save_state(struct rarch_state *p_rarch)
+/* Automatic runahead: the measured times are averaged over
+ * about this many samples, a frame count is not picked before
+ * this many core runs were timed, and the next count up has to
+ * fit for this many frames in a row before it is used */
+#define RUNAHEAD_AUTO_SMOOTH   16
+#define RUNAHEAD_AUTO_SAMPLES  30
+#define RUNAHEAD_AUTO_SETTLE   120
+/* Share of the frame time the core may use,
+ * the rest is left to the drivers */
+#define RUNAHEAD_AUTO_BUDGET   0.75f
+/* The next count up is only tried if it leaves this much
+ * of the budget unused */
+#define RUNAHEAD_AUTO_HEADROOM 0.85f
+/* This many frames missing their deadline within
+ * RUNAHEAD_AUTO_SETTLE frames make it back off */
+#define RUNAHEAD_AUTO_LATE     3
+
+static void runahead_auto_sample(float *avg, retro_time_t start_time)
+{
+   float sample = (float)(cpu_features_get_time_usec() - start_time);
+
+   if (*avg <= 0.0f)
+      *avg      = sample;
+   else
+      *avg     += (sample - *avg) / RUNAHEAD_AUTO_SMOOTH;
+}
+
+/* core_run(), timed for automatic runahead */
+static void runahead_core_run(struct rarch_state *p_rarch)
+{
+   retro_time_t start_time;
+
+   if (!p_rarch->runahead_auto)
+   {
+      core_run();
+      return;
+   }
+
+   start_time = cpu_features_get_time_usec();
+   core_run();
+   runahead_auto_sample(&p_rarch->runahead_auto_run_usec, start_time);
+   if (p_rarch->runahead_auto_samples <= RUNAHEAD_AUTO_SAMPLES)
+      p_rarch->runahead_auto_samples++;
+}
+
+static void runahead_auto_input(struct rarch_state *p_rarch, bool dirty)
+{
+   if (p_rarch->runahead_auto)
+      p_rarch->runahead_auto_dirty_rate +=
+         ((dirty ? 1.0f : 0.0f) - p_rarch->runahead_auto_dirty_rate)
+         / RUNAHEAD_AUTO_SMOOTH;
+}
+
+/* Worst case time one frame takes with 'count' frames of
+ * runahead: a frame on which input changed. That is the same
+ * for one and two instances, preemptive frames also save
+ * a state for each frame replayed. */
+static float runahead_auto_cost(struct rarch_state *p_rarch,
+      unsigned count, bool use_preempt)
+{
+   float unserialize = p_rarch->runahead_auto_unserialize_usec;
+   float cost;
+
+   /* Preemptive frames and a second instance only load
+    * states on input changes, assume it is as slow as saving
+    * until one has been timed */
+   if (unserialize <= 0.0f)
+      unserialize    = p_rarch->runahead_auto_serialize_usec;
+
+   if (count == 0)
+      return p_rarch->runahead_auto_run_usec;
+
+   cost = (count + 1) * p_rarch->runahead_auto_run_usec
+      + p_rarch->runahead_auto_serialize_usec + unserialize;
+   if (use_preempt)
+      cost += (count - 1) * p_rarch->runahead_auto_serialize_usec;
+   return cost;
+}
+
+/* Average time a frame takes with a second instance; it only
+ * reloads and catches up when input changed. On its own thread
+ * it runs at the same time as the main instance. */
+static float runahead_auto_cost_secondary(struct rarch_state *p_rarch,
+      unsigned count, bool threaded)
+{
+   unsigned runs  = threaded ? 1 : 2;
+   float catch_up = runahead_auto_cost(p_rarch, count, false)
+      - runs * p_rarch->runahead_auto_run_usec;
+
+   return runs * p_rarch->runahead_auto_run_usec
+      + p_rarch->runahead_auto_dirty_rate * catch_up;
+}
+
+/* Picks the frame count and instance for this frame.
+ * Steps down as soon as the current count no longer fits in
+ * the frame time or frames start missing their deadline,
+ * steps up one frame at a time once the next count has fit
+ * for a while. */
+static unsigned runahead_auto_update(struct rarch_state *p_rarch,
+      unsigned max_count, bool use_preempt, bool can_secondary,
+      bool threaded, retro_time_t frame_time, bool frame_skipped)
+{
+   float budget;
+   unsigned count              = p_rarch->runahead_auto_count;
+   bool use_secondary          = p_rarch->runahead_auto_secondary;
+   retro_time_t current_time   = cpu_features_get_time_usec();
+   retro_time_t last_time      = p_rarch->runahead_auto_last_time;
+
+   p_rarch->runahead_auto_last_time = current_time;
+
+   if (count > max_count)
+      count                    = max_count;
+
+   /* Hold while the timings say nothing about normal play */
+   if (     p_rarch->runahead_auto_samples < RUNAHEAD_AUTO_SAMPLES
+         || p_rarch->runloop_fastmotion
+         || p_rarch->runloop_slowmotion
+         || frame_time <= 0)
+      goto end;
+
+   if (++p_rarch->runahead_auto_window >= RUNAHEAD_AUTO_SETTLE)
+   {
+      p_rarch->runahead_auto_window = 0;
+      p_rarch->runahead_auto_late   = 0;
+   }
+
+   if (!frame_skipped && last_time
+         && current_time - last_time > frame_time + frame_time / 2)
+      p_rarch->runahead_auto_late++;
+
+   budget                      = frame_time * RUNAHEAD_AUTO_BUDGET;
+
+   if (p_rarch->runahead_auto_samples == RUNAHEAD_AUTO_SAMPLES)
+   {
+      /* First pick, go straight to the largest count that fits */
+      count                    = max_count;
+      while (count > 0 && runahead_auto_cost(p_rarch,
+               count, use_preempt) > budget)
+         count--;
+      p_rarch->runahead_auto_settle = 0;
+      p_rarch->runahead_auto_late   = 0;
+   }
+   else if (count > 0 && (
+            runahead_auto_cost(p_rarch, count, use_preempt) > budget
+         || p_rarch->runahead_auto_late >= RUNAHEAD_AUTO_LATE))
+   {
+      count--;
+      p_rarch->runahead_auto_settle = 0;
+      p_rarch->runahead_auto_late   = 0;
+   }
+   else if (count < max_count
+         && !p_rarch->runahead_auto_late
+         && runahead_auto_cost(p_rarch, count + 1, use_preempt)
+         <= budget * RUNAHEAD_AUTO_HEADROOM)
+   {
+      if (++p_rarch->runahead_auto_settle >= RUNAHEAD_AUTO_SETTLE)
+      {
+         count++;
+         p_rarch->runahead_auto_settle = 0;
+         p_rarch->runahead_auto_late   = 0;
+      }
+   }
+   else
+      p_rarch->runahead_auto_settle = 0;
+
+   /* Only switch instances for a clear win */
+   use_secondary = false;
+   if (can_secondary && !use_preempt && count > 1)
+   {
+      float single    = runahead_auto_cost(p_rarch, count, false);
+      float secondary = runahead_auto_cost_secondary(p_rarch, count,
+            threaded);
+
+      use_secondary   = p_rarch->runahead_auto_secondary
+         ? secondary < single
+         : secondary < single * 0.9f;
+   }
+
+end:
+   if (     count         != p_rarch->runahead_auto_count
+         || use_secondary != p_rarch->runahead_auto_secondary)
+   {
+      RARCH_LOG("[Runahead]: Auto: %u frame(s)%s (run %.0f us,"
+            " save %.0f us, load %.0f us, budget %.0f us).\n",
+            count, use_secondary ? ", second instance" : "",
+            p_rarch->runahead_auto_run_usec,
+            p_rarch->runahead_auto_serialize_usec,
+            p_rarch->runahead_auto_unserialize_usec,
+            frame_time * RUNAHEAD_AUTO_BUDGET);
+
+      p_rarch->runahead_auto_count        = count;
+      p_rarch->runahead_auto_secondary    = use_secondary;
+      p_rarch->runahead_force_input_dirty = true;
+   }
+
+   if (p_rarch->runloop_perfcnt_enable)
+   {
+      p_rarch->runahead_auto_count_total += count;
+      p_rarch->runahead_auto_frames++;
+   }
+
+   return count;
+}
+
+static bool runahead_save_state(struct rarch_state *p_rarch,
+      unsigned slot)
 {
-   retro_ctx_serialize_info_t *serialize_info;
+   retro_ctx_serialize_info_t serialize_info;
+   retro_time_t start_time         = 0;
    bool okay                       = false;
 
-   if (!p_rarch->runahead_save_state_list)
+   if (!p_rarch->runahead_state_arena)
       return false;
 
-   serialize_info                  =
-      (retro_ctx_serialize_info_t*)p_rarch->runahead_save_state_list->data[0];
+   runahead_state_slot(p_rarch, slot, &serialize_info);
 
+   if (p_rarch->runahead_auto)
+      start_time                   = cpu_features_get_time_usec();
+
+   /* The core writes straight into the arena */
    p_rarch->request_fast_savestate = true;
-   okay                            = core_serialize(serialize_info);
+   okay                            = core_serialize(&serialize_info);
    p_rarch->request_fast_savestate = false;
 
    if (okay)
+   {
+      if (p_rarch->runahead_auto)
+         runahead_auto_sample(&p_rarch->runahead_auto_serialize_usec,
+               start_time);
+      if (p_rarch->runloop_perfcnt_enable)
+         p_rarch->runahead_bytes_serialized += serialize_info.size;
       return true;
+   }
 
    runahead_error(p_rarch);
    return false;
 }
 
-static bool runahead_load_state(struct rarch_state *p_rarch)
+static bool runahead_load_state(struct rarch_state *p_rarch,
+      unsigned slot)
 {
+   retro_ctx_serialize_info_t serialize_info;
+   retro_time_t start_time                    = 0;
    bool okay                                  = false;
-   retro_ctx_serialize_info_t *serialize_info = (retro_ctx_serialize_info_t*)
-      p_rarch->runahead_save_state_list->data[0];
    bool last_dirty                            = p_rarch->input_is_dirty;
+   bool last_force_dirty                      =
+      p_rarch->runahead_force_input_dirty;
+
+   runahead_state_slot(p_rarch, slot, &serialize_info);
+
+   if (p_rarch->runahead_auto)
+      start_time                              = cpu_features_get_time_usec();
 
    p_rarch->request_fast_savestate            = true;
    /* calling core_unserialize has side effects with
     * netplay (it triggers transmitting your save state)
       call retro_unserialize directly from the core instead */
    okay = p_rarch->current_core.retro_unserialize(
-         serialize_info->data_const, serialize_info->size);
+         serialize_info.data_const, serialize_info.size);
 
    p_rarch->request_fast_savestate            = false;
    p_rarch->input_is_dirty                    = last_dirty;
+   p_rarch->runahead_force_input_dirty        = last_force_dirty;
 
    if (!okay)
+   {
       runahead_error(p_rarch);
+      return false;
+   }
+
+   if (p_rarch->runahead_auto)
+      runahead_auto_sample(&p_rarch->runahead_auto_unserialize_usec,
+            start_time);
+   if (p_rarch->runloop_perfcnt_enable)
+      p_rarch->runahead_bytes_unserialized += serialize_info.size;
 
    return okay;
 }
@@ -35828,14 +37281,20 @@ static bool runahead_load_state(struct rarch_state *p_rarch)
 #if HAVE_DYNAMIC
 static bool runahead_load_state_secondary(struct rarch_state *p_rarch)
 {
+   retro_ctx_serialize_info_t serialize_info;
+   retro_time_t start_time                    = 0;
    bool okay                                  = false;
-   retro_ctx_serialize_info_t *serialize_info =
-      (retro_ctx_serialize_info_t*)p_rarch->runahead_save_state_list->data[0];
 
+   runahead_state_slot(p_rarch, 0, &serialize_info);
+
+   if (p_rarch->runahead_auto)
+      start_time                              = cpu_features_get_time_usec();
+
+   /* Straight from the state the primary core just wrote */
    p_rarch->request_fast_savestate            = true;
    okay                                       = secondary_core_deserialize(
          p_rarch,
-         serialize_info->data_const, (int)serialize_info->size);
+         serialize_info.data_const, (int)serialize_info.size);
    p_rarch->request_fast_savestate            = false;
 
    if (!okay)
@@ -35845,6 +37304,11 @@ static bool runahead_load_state_secondary(struct rarch_state *p_rarch)
       return false;
    }
 
+   if (p_rarch->runahead_auto)
+      runahead_auto_sample(&p_rarch->runahead_auto_unserialize_usec,
+            start_time);
+   if (p_rarch->runloop_perfcnt_enable)
+      p_rarch->runahead_bytes_unserialized += serialize_info.size;
    return true;
 }
 #endif
@@ -35872,13 +37336,485 @@ static bool runahead_core_run_use_last_input(struct rarch_state *p_rarch)
    return true;
 }
 
+/* Polls input and compares it against what the core saw on the
+ * previous frame, updating the recorded values as it goes so the
+ * frames replayed after a rollback see the new input.
+ * Only controls the core has queried before are looked at. */
+static bool runahead_input_changed(struct rarch_state *p_rarch)
+{
+   int i;
+   bool changed           = false;
+   my_list *list          = p_rarch->input_state_list;
+   retro_input_state_t cb = p_rarch->input_state_callback_original;
+
+   if (!list || !cb)
+      return false;
+
+   input_driver_poll();
+
+   for (i = 0; i < list->size; i++)
+   {
+      unsigned id;
+      input_list_element *element = (input_list_element*)list->data[i];
+
+      for (id = 0; id < element->state_size; id++)
+      {
+         int16_t value = cb(element->port, element->device,
+               element->index, id);
+
+         if (value != element->state[id])
+         {
+            element->state[id] = value;
+            changed            = true;
+         }
+      }
+   }
+
+   return changed;
+}
+
+/* Preemptive frames: instead of saving, running ahead and loading
+ * back on every frame, keep the states of the last 'runahead_count'
+ * frames. Only when input changes, roll back to the oldest one and
+ * replay up to now as if the new input had come in that much
+ * earlier. Frames without input changes cost one serialize. */
+static bool runahead_preempt(struct rarch_state *p_rarch,
+      unsigned runahead_count)
+{
+   unsigned i;
+   bool changed;
+
+   if (p_rarch->runahead_state_slots != runahead_count)
+   {
+      if (!runahead_state_arena_reserve(p_rarch, runahead_count))
+      {
+         runahead_error(p_rarch);
+         return false;
+      }
+      p_rarch->runahead_force_input_dirty = true;
+   }
+
+   /* Anything that moved the core behind our back
+    * invalidates the history */
+   if (p_rarch->runahead_force_input_dirty)
+   {
+      p_rarch->runahead_preempt_frames = 0;
+      p_rarch->runahead_preempt_ptr    = 0;
+   }
+
+   changed = runahead_input_changed(p_rarch);
+   runahead_auto_input(p_rarch, changed);
+
+   if (changed && p_rarch->runahead_preempt_frames == runahead_count)
+   {
+      /* 'runahead_preempt_ptr' is the oldest state */
+      if (!runahead_load_state(p_rarch, p_rarch->runahead_preempt_ptr))
+         return false;
+
+      for (i = 0; i < runahead_count; i++)
+      {
+         unsigned slot = (p_rarch->runahead_preempt_ptr + i)
+            % runahead_count;
+
+         if (i > 0 && !runahead_save_state(p_rarch, slot))
+            return false;
+
+         p_rarch->audio_suspended     = true;
+         p_rarch->video_driver_active = false;
+         runahead_core_run_use_last_input(p_rarch);
+         RUNAHEAD_RESUME_VIDEO();
+         p_rarch->audio_suspended     = false;
+      }
+   }
+
+   if (!runahead_save_state(p_rarch, p_rarch->runahead_preempt_ptr))
+      return false;
+
+   p_rarch->runahead_preempt_ptr    = (p_rarch->runahead_preempt_ptr + 1)
+      % runahead_count;
+   if (p_rarch->runahead_preempt_frames < runahead_count)
+      p_rarch->runahead_preempt_frames++;
+
+   runahead_core_run(p_rarch);
+   return true;
+}
+
+#ifdef RUNAHEAD_SECONDARY_THREAD
+/* Threaded secondary instance: while the main instance runs
+ * the current frame, a worker thread runs the secondary
+ * instance ahead with the same input. When input changed, the
+ * secondary loads the state the main instance had before this
+ * frame and replays it as well, so neither waits on the other.
+ * The worker keeps the last frame it renders, which the main
+ * thread hands to the video driver once both are done. */
+
+static void runahead_thread_video_cb(const void *data,
+      unsigned width, unsigned height, size_t pitch)
+{
+   size_t size                 = pitch * height;
+   struct rarch_state *p_rarch = &rarch_st;
+
+   /* Once captured, the main thread may be showing the frame */
+   if (     !p_rarch->runahead_thread_capture
+         ||  p_rarch->runahead_thread_captured)
+      return;
+
+   p_rarch->runahead_thread_dupe     = !data;
+   p_rarch->runahead_thread_width    = width;
+   p_rarch->runahead_thread_height   = height;
+   p_rarch->runahead_thread_pitch    = pitch;
+
+   if (data && size > p_rarch->runahead_thread_frame_size)
+   {
+      uint8_t *frame = (uint8_t*)realloc(
+            p_rarch->runahead_thread_frame, size);
+
+      if (frame)
+      {
+         p_rarch->runahead_thread_frame      = frame;
+         p_rarch->runahead_thread_frame_size = size;
+      }
+      else
+         p_rarch->runahead_thread_dupe       = true;
+   }
+
+   if (!p_rarch->runahead_thread_dupe)
+      memcpy(p_rarch->runahead_thread_frame, data, size);
+
+   /* Let the main thread show it while the rest of the
+    * frame runs */
+   slock_lock(p_rarch->runahead_thread_lock);
+   p_rarch->runahead_thread_captured = true;
+   scond_signal(p_rarch->runahead_thread_cond);
+   slock_unlock(p_rarch->runahead_thread_lock);
+}
+
+static void runahead_thread_audio_sample(int16_t left, int16_t right) { }
+
+static size_t runahead_thread_audio_sample_batch(
+      const int16_t *data, size_t frames)
+{
+   return frames;
+}
+
+static int16_t runahead_thread_input_state(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   struct rarch_state *p_rarch = &rarch_st;
+   return input_state_list_get(p_rarch->runahead_thread_input,
+         port, device, index, id);
+}
+
+/* The main instance keeps writing 'input_state_list' while
+ * the worker runs, so the worker plays back a copy */
+static void runahead_thread_copy_input(struct rarch_state *p_rarch)
+{
+   int i;
+   my_list *list = p_rarch->input_state_list;
+
+   if (!p_rarch->runahead_thread_input)
+      mylist_create(&p_rarch->runahead_thread_input, 16,
+            input_list_element_constructor,
+            input_list_element_destructor);
+
+   mylist_resize(p_rarch->runahead_thread_input,
+         list ? list->size : 0, true);
+
+   for (i = 0; list && i < list->size; i++)
+   {
+      input_list_element *src = (input_list_element*)list->data[i];
+      input_list_element *dst = (input_list_element*)
+         p_rarch->runahead_thread_input->data[i];
+
+      dst->port               = src->port;
+      dst->device             = src->device;
+      dst->index              = src->index;
+      input_list_element_realloc(dst, src->state_size);
+      memcpy(dst->state, src->state,
+            src->state_size * sizeof(int16_t));
+   }
+}
+
+static void runahead_thread_hook(struct rarch_state *p_rarch, bool enable)
+{
+   struct retro_core_t *core = &p_rarch->secondary_core;
+
+   if (enable == p_rarch->runahead_thread_hooked)
+      return;
+
+   if (enable)
+   {
+      core->retro_set_video_refresh(runahead_thread_video_cb);
+      core->retro_set_audio_sample(runahead_thread_audio_sample);
+      core->retro_set_audio_sample_batch(
+            runahead_thread_audio_sample_batch);
+      core->retro_set_input_poll(secondary_core_input_poll_null);
+      core->retro_set_input_state(runahead_thread_input_state);
+   }
+   else
+   {
+      core->retro_set_video_refresh(p_rarch->secondary_callbacks.frame_cb);
+      core->retro_set_audio_sample(p_rarch->secondary_callbacks.sample_cb);
+      core->retro_set_audio_sample_batch(
+            p_rarch->secondary_callbacks.sample_batch_cb);
+      core->retro_set_input_poll(p_rarch->secondary_callbacks.poll_cb);
+      core->retro_set_input_state(p_rarch->secondary_callbacks.state_cb);
+   }
+
+   p_rarch->runahead_thread_hooked = enable;
+}
+
+static bool runahead_thread_run(struct rarch_state *p_rarch)
+{
+   unsigned i;
+   struct retro_core_t *core = &p_rarch->secondary_core;
+
+   if (p_rarch->runahead_thread_load)
+   {
+      retro_ctx_serialize_info_t serialize_info;
+
+      runahead_state_slot(p_rarch, 0, &serialize_info);
+
+      if (!core->retro_unserialize(serialize_info.data_const,
+               serialize_info.size))
+         return false;
+   }
+
+   for (i = 0; i < p_rarch->runahead_thread_frames; i++)
+   {
+      p_rarch->runahead_thread_capture =
+         (i + 1 == p_rarch->runahead_thread_frames);
+      core->retro_run();
+   }
+
+   p_rarch->runahead_thread_capture = false;
+   return true;
+}
+
+static void runahead_thread_loop(void *data)
+{
+   struct rarch_state *p_rarch = (struct rarch_state*)data;
+
+   slock_lock(p_rarch->runahead_thread_lock);
+
+   for (;;)
+   {
+      bool okay;
+
+      while (!p_rarch->runahead_thread_busy
+            && !p_rarch->runahead_thread_quit)
+         scond_wait(p_rarch->runahead_thread_cond,
+               p_rarch->runahead_thread_lock);
+
+      if (p_rarch->runahead_thread_quit)
+         break;
+
+      slock_unlock(p_rarch->runahead_thread_lock);
+      okay = runahead_thread_run(p_rarch);
+      slock_lock(p_rarch->runahead_thread_lock);
+
+      p_rarch->runahead_thread_ok   = okay;
+      p_rarch->runahead_thread_busy = false;
+      scond_signal(p_rarch->runahead_thread_cond);
+   }
+
+   slock_unlock(p_rarch->runahead_thread_lock);
+}
+
+static void runahead_thread_stop(struct rarch_state *p_rarch)
+{
+   if (p_rarch->runahead_thread)
+   {
+      slock_lock(p_rarch->runahead_thread_lock);
+      p_rarch->runahead_thread_quit = true;
+      scond_signal(p_rarch->runahead_thread_cond);
+      slock_unlock(p_rarch->runahead_thread_lock);
+
+      sthread_join(p_rarch->runahead_thread);
+   }
+
+   if (p_rarch->runahead_thread_cond)
+      scond_free(p_rarch->runahead_thread_cond);
+   if (p_rarch->runahead_thread_lock)
+      slock_free(p_rarch->runahead_thread_lock);
+   if (p_rarch->runahead_thread_frame)
+      free(p_rarch->runahead_thread_frame);
+   if (p_rarch->runahead_thread_vars)
+      free(p_rarch->runahead_thread_vars);
+   mylist_destroy(&p_rarch->runahead_thread_input);
+
+   if (p_rarch->secondary_lib_handle)
+      runahead_thread_hook(p_rarch, false);
+
+   p_rarch->runahead_thread            = NULL;
+   p_rarch->runahead_thread_cond       = NULL;
+   p_rarch->runahead_thread_lock       = NULL;
+   p_rarch->runahead_thread_frame      = NULL;
+   p_rarch->runahead_thread_frame_size = 0;
+   p_rarch->runahead_thread_vars       = NULL;
+   p_rarch->runahead_thread_vars_size  = 0;
+   p_rarch->runahead_thread_vars_capacity = 0;
+   p_rarch->runahead_thread_vars_update   = false;
+   p_rarch->runahead_thread_busy       = false;
+   p_rarch->runahead_thread_quit       = false;
+   p_rarch->runahead_thread_hooked     = false;
+}
+
+static bool runahead_thread_start(struct rarch_state *p_rarch)
+{
+   p_rarch->runahead_thread_busy = false;
+   p_rarch->runahead_thread_quit = false;
+   p_rarch->runahead_thread_lock = slock_new();
+   p_rarch->runahead_thread_cond = scond_new();
+
+   if (p_rarch->runahead_thread_lock && p_rarch->runahead_thread_cond)
+      p_rarch->runahead_thread    = sthread_create(
+            runahead_thread_loop, p_rarch);
+
+   if (p_rarch->runahead_thread)
+      return true;
+
+   RARCH_ERR("[Runahead]: Could not start the secondary instance thread.\n");
+   runahead_thread_stop(p_rarch);
+   return false;
+}
+
+/* Copies what the worker may ask about the core options, while
+ * neither instance is running */
+static bool runahead_thread_snapshot_vars(struct rarch_state *p_rarch)
+{
+   size_t i;
+   core_option_manager_t *opts = p_rarch->runloop_core_options;
+   size_t size                 = opts ? opts->size : 0;
+
+   if (size > p_rarch->runahead_thread_vars_capacity)
+   {
+      runahead_thread_var_t *vars = (runahead_thread_var_t*)realloc(
+            p_rarch->runahead_thread_vars, size * sizeof(*vars));
+
+      if (!vars)
+         return false;
+
+      p_rarch->runahead_thread_vars          = vars;
+      p_rarch->runahead_thread_vars_capacity = size;
+   }
+
+   for (i = 0; i < size; i++)
+   {
+      struct core_option *option = &opts->opts[i];
+
+      p_rarch->runahead_thread_vars[i].key   = option->key;
+      p_rarch->runahead_thread_vars[i].value = option->vals
+         ? option->vals->elems[option->index].data : NULL;
+   }
+   p_rarch->runahead_thread_vars_size = size;
+
+   /* An update the main instance has seen is handed over here;
+    * one it has yet to see is reported to both */
+   if (p_rarch->has_variable_update || (opts && opts->updated))
+      p_rarch->runahead_thread_vars_update = true;
+   p_rarch->has_variable_update          = false;
+   return true;
+}
+
+/* Returns false if this frame can not be run threaded,
+ * in which case nothing was done */
+static bool runahead_thread_frame(struct rarch_state *p_rarch,
+      unsigned runahead_count)
+{
+   bool dirty;
+   bool captured;
+   bool okay;
+
+   /* The worker has no graphics context of its own */
+   if (p_rarch->hw_render.context_type != RETRO_HW_CONTEXT_NONE)
+      return false;
+
+   if (!p_rarch->runahead_thread && !runahead_thread_start(p_rarch))
+      return false;
+
+   if (!runahead_thread_snapshot_vars(p_rarch))
+      return false;
+
+   runahead_thread_hook(p_rarch, true);
+
+   /* Poll before either instance runs,
+    * so both get the same input */
+   dirty = runahead_input_changed(p_rarch)
+      || p_rarch->input_is_dirty
+      || p_rarch->runahead_force_input_dirty;
+   runahead_auto_input(p_rarch, dirty);
+   p_rarch->input_is_dirty = false;
+
+   if (dirty && !runahead_save_state(p_rarch, 0))
+   {
+      runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      return true;
+   }
+
+   runahead_thread_copy_input(p_rarch);
+
+   slock_lock(p_rarch->runahead_thread_lock);
+   p_rarch->runahead_thread_frames   = dirty ? runahead_count + 1 : 1;
+   p_rarch->runahead_thread_load     = dirty;
+   p_rarch->runahead_thread_captured = false;
+   p_rarch->runahead_thread_busy     = true;
+   scond_signal(p_rarch->runahead_thread_cond);
+   slock_unlock(p_rarch->runahead_thread_lock);
+
+   /* run main core with video suspended, meanwhile */
+   p_rarch->video_driver_active      = false;
+   runahead_core_run(p_rarch);
+   RUNAHEAD_RESUME_VIDEO();
+
+   /* Show the frame as soon as the worker has it, and only then
+    * wait for the rest of its retro_run() */
+   slock_lock(p_rarch->runahead_thread_lock);
+   while (     p_rarch->runahead_thread_busy
+         &&   !p_rarch->runahead_thread_captured)
+      scond_wait(p_rarch->runahead_thread_cond,
+            p_rarch->runahead_thread_lock);
+   captured = p_rarch->runahead_thread_captured;
+   slock_unlock(p_rarch->runahead_thread_lock);
+
+   /* If the main instance saw other input than was polled
+    * above, 'input_is_dirty' is set and next frame resyncs */
+   if (captured)
+      video_driver_frame(p_rarch->runahead_thread_dupe
+            ? NULL : p_rarch->runahead_thread_frame,
+            p_rarch->runahead_thread_width,
+            p_rarch->runahead_thread_height,
+            p_rarch->runahead_thread_pitch);
+
+   slock_lock(p_rarch->runahead_thread_lock);
+   while (p_rarch->runahead_thread_busy)
+      scond_wait(p_rarch->runahead_thread_cond,
+            p_rarch->runahead_thread_lock);
+   okay = p_rarch->runahead_thread_ok;
+   slock_unlock(p_rarch->runahead_thread_lock);
+
+   if (!okay)
+   {
+      p_rarch->runahead_secondary_core_available = false;
+      runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+   }
+   else if (dirty && p_rarch->runloop_perfcnt_enable)
+      p_rarch->runahead_bytes_unserialized +=
+         p_rarch->runahead_save_state_size;
+
+   return true;
+}
+#endif
+
 static void do_runahead(
       struct rarch_state *p_rarch,
-      int runahead_count, bool use_secondary)
+      int runahead_count, bool use_secondary, bool use_thread,
+      bool use_preempt, bool use_auto, retro_time_t frame_time)
 {
    int frame_number        = 0;
    bool last_frame         = false;
    bool suspended_frame    = false;
+   bool frame_skipped      = false;
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
    const bool have_dynamic = true;
 #else
@@ -35886,12 +37822,14 @@ static void do_runahead(
 #endif
    uint64_t frame_count    = p_rarch->video_driver_frame_count;
 
+   p_rarch->runahead_auto  = use_auto;
+
    if (runahead_count <= 0 || !p_rarch->runahead_available)
       goto force_input_dirty;
 
    if (!p_rarch->runahead_save_state_size_known)
    {
-      if (!runahead_create(p_rarch))
+      if (!runahead_create(p_rarch, use_preempt ? runahead_count : 1))
       {
          settings_t *settings        = p_rarch->configuration_settings;
          bool runahead_hide_warnings = settings->bools.run_ahead_hide_warnings;
@@ -35902,19 +37840,50 @@ static void do_runahead(
       }
    }
 
+   if (p_rarch->runloop_perfcnt_enable)
+      p_rarch->runahead_stats_frames++;
+
    /* Check for GUI */
    /* Hack: If we were in the GUI, force a resync. */
    if (frame_count != p_rarch->runahead_last_frame_count + 1)
+   {
       p_rarch->runahead_force_input_dirty = true;
+      frame_skipped                       = true;
+   }
 
    p_rarch->runahead_last_frame_count     = frame_count;
 
+   /* 'runahead_count' is the upper limit in automatic mode */
+   if (use_auto)
+   {
+      runahead_count = runahead_auto_update(p_rarch, runahead_count,
+            use_preempt,
+            have_dynamic && p_rarch->runahead_secondary_core_available,
+            use_thread, frame_time, frame_skipped);
+      use_secondary  = p_rarch->runahead_auto_secondary;
+
+      if (runahead_count == 0)
+         goto force_input_dirty;
+   }
+
+   if (use_preempt)
+   {
+      if (!runahead_preempt(p_rarch, runahead_count))
+      {
+         runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         return;
+      }
+      p_rarch->runahead_force_input_dirty = false;
+      return;
+   }
+
+   /* The other modes load states of their own */
+   p_rarch->runahead_preempt_frames       = 0;
+
    if (     !use_secondary 
          || !have_dynamic 
          || !p_rarch->runahead_secondary_core_available)
    {
-      /* TODO: multiple savestates for higher performance
-       * when not using secondary core */
       for (frame_number = 0; frame_number <= runahead_count; frame_number++)
       {
          last_frame      = frame_number == runahead_count;
@@ -35927,7 +37896,7 @@ static void do_runahead(
          }
 
          if (frame_number == 0)
-            core_run();
+            runahead_core_run(p_rarch);
          else
             runahead_core_run_use_last_input(p_rarch);
 
@@ -35939,7 +37908,15 @@ static void do_runahead(
 
          if (frame_number == 0)
          {
-            if (!runahead_save_state(p_rarch))
+            /* Only the second instance looks at this,
+             * automatic mode counts input changes with it */
+            if (use_auto)
+            {
+               runahead_auto_input(p_rarch, p_rarch->input_is_dirty);
+               p_rarch->input_is_dirty = false;
+            }
+
+            if (!runahead_save_state(p_rarch, 0))
             {
                runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
                return;
@@ -35948,7 +37925,7 @@ static void do_runahead(
 
          if (last_frame)
          {
-            if (!runahead_load_state(p_rarch))
+            if (!runahead_load_state(p_rarch, 0))
             {
                runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
                return;
@@ -35967,17 +37944,29 @@ static void do_runahead(
          goto force_input_dirty;
       }
 
+#ifdef RUNAHEAD_SECONDARY_THREAD
+      if (use_thread && runahead_thread_frame(p_rarch, runahead_count))
+      {
+         p_rarch->runahead_force_input_dirty = false;
+         return;
+      }
+      runahead_thread_hook(p_rarch, false);
+#endif
+
       /* run main core with video suspended */
       p_rarch->video_driver_active     = false;
-      core_run();
+      runahead_core_run(p_rarch);
       RUNAHEAD_RESUME_VIDEO();
 
+      runahead_auto_input(p_rarch, p_rarch->input_is_dirty
+            || p_rarch->runahead_force_input_dirty);
+
       if (     p_rarch->input_is_dirty 
             || p_rarch->runahead_force_input_dirty)
       {
          p_rarch->input_is_dirty       = false;
 
-         if (!runahead_save_state(p_rarch))
+         if (!runahead_save_state(p_rarch, 0))
          {
             runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
             return;
@@ -36011,7 +38000,7 @@ static void do_runahead(
    return;
 
 force_input_dirty:
-   core_run();
+   runahead_core_run(p_rarch);
    p_rarch->runahead_force_input_dirty   = true;
 }
 #endif
@@ -37185,6 +39174,9 @@ bool retroarch_main_init(int argc, char *argv[])
 
    retroarch_validate_cpu_features();
    retroarch_init_task_queue();
+#ifdef HAVE_THREADS
+   parallel_init(0);
+#endif
 
    {
       const char    *fullpath  = path_get(RARCH_PATH_CONTENT);
@@ -37740,6 +39732,8 @@ void retroarch_init_task_queue(void)
    struct rarch_state *p_rarch = &rarch_st;
    settings_t *settings        = p_rarch->configuration_settings;
    bool threaded_enable        = settings->bools.threaded_data_runloop_enable;
+
+   task_queue_set_workers(settings->uints.threaded_data_runloop_workers);
 #else
    bool threaded_enable        = false;
 #endif
@@ -38446,6 +40440,10 @@ int retroarch_get_capabilities(enum rarch_capabilities type,
                strlcat(s, " AVX", len);
             if (cpu & RETRO_SIMD_AVX2)
                strlcat(s, " AVX2", len);
+            if (cpu & CPU_FEATURE_FMA3)
+               strlcat(s, " FMA3", len);
+            if (cpu & CPU_FEATURE_AVX512F)
+               strlcat(s, " AVX512", len);
             if (cpu & RETRO_SIMD_NEON)
                strlcat(s, " NEON", len);
             if (cpu & RETRO_SIMD_VFPV3)
@@ -39780,6 +41778,11 @@ static enum runloop_state runloop_check_state(
    }
 #endif
 
+#ifdef HAVE_REWIND
+   /* Check rewind seek, it checks for hardcore mode itself */
+   HOTKEY_CHECK(RARCH_REWIND_SEEK, CMD_EVENT_REWIND_SEEK, true, NULL);
+#endif
+
    /* Checks if slowmotion toggle/hold was being pressed and/or held. */
 #ifdef HAVE_CHEEVOS
    if (!rcheevos_hardcore_active())
@@ -40085,6 +42088,9 @@ int runloop_iterate(void)
       retro_sleep(video_frame_delay);
 
    {
+      /* Also the time budget of automatic runahead */
+      retro_time_t frame_time       = rarch_core_runtime_tick(
+            p_rarch, current_time);
 #ifdef HAVE_RUNAHEAD
       unsigned run_ahead_num_frames = settings->uints.run_ahead_frames;
       /* Run Ahead Feature replaces the call to core_run in this loop */
@@ -40097,16 +42103,19 @@ int runloop_iterate(void)
          do_runahead(
                p_rarch,
                run_ahead_num_frames,
-               settings->bools.run_ahead_secondary_instance);
+               settings->bools.run_ahead_secondary_instance,
+               settings->bools.run_ahead_secondary_thread,
+               settings->bools.run_ahead_preemptive,
+               settings->bools.run_ahead_auto,
+               frame_time);
       else
 #endif
          core_run();
-   }
 
-   /* Increment runtime tick counter after each call to
-    * core_run() or run_ahead() */
-   p_rarch->libretro_core_runtime_usec += rarch_core_runtime_tick(
-         p_rarch, current_time);
+      /* Increment runtime tick counter after each call to
+       * core_run() or run_ahead() */
+      p_rarch->libretro_core_runtime_usec += frame_time;
+   }
 
 #ifdef HAVE_CHEEVOS
    if (settings->bools.cheevos_enable)
@@ -40174,10 +42183,8 @@ end:
          if (p_rarch->fastforward_after_frames == 1)
          {
             /* Nonblocking audio */
-            if (p_rarch->audio_driver_active &&
-                  p_rarch->audio_driver_context_audio_data)
-               p_rarch->current_audio->set_nonblock_state(
-                     p_rarch->audio_driver_context_audio_data, true);
+            if (p_rarch->audio_driver_active)
+               audio_driver_set_nonblock(p_rarch, true);
             p_rarch->audio_driver_chunk_size =
                p_rarch->audio_driver_chunk_nonblock_size;
          }
@@ -40187,10 +42194,8 @@ end:
          if (p_rarch->fastforward_after_frames == 6)
          {
             /* Blocking audio */
-            if (p_rarch->audio_driver_active &&
-                  p_rarch->audio_driver_context_audio_data)
-               p_rarch->current_audio->set_nonblock_state(
-                     p_rarch->audio_driver_context_audio_data,
+            if (p_rarch->audio_driver_active)
+               audio_driver_set_nonblock(p_rarch,
                      audio_sync ? false : true);
 
             p_rarch->audio_driver_chunk_size  =
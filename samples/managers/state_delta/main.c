@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libretro.h>
+#include <features/features_cpu.h>
+
+#include "../../../managers/state_delta.h"
+
+/* Feeds synthetic savestate pairs through every compiled-in
+ * delta kernel and reports the scan throughput of each.
+ *
+ * The second state is a copy of the first with 'density' of its
+ * uint16s changed, in runs of 'run' words, which is roughly what
+ * consecutive frames of a real core look like. */
+
+static unsigned rand_state = 1;
+
+static unsigned bench_rand(void)
+{
+   rand_state = rand_state * 1103515245u + 12345u;
+   return rand_state >> 8;
+}
+
+static void make_pair(uint8_t *a, uint8_t *b, size_t len,
+      double density, unsigned run)
+{
+   size_t i;
+   size_t words   = len / sizeof(uint16_t);
+   size_t changes = (size_t)(words * density);
+   uint16_t *b16  = (uint16_t*)b;
+
+   for (i = 0; i < len; i++)
+      a[i] = bench_rand();
+   memcpy(b, a, len);
+
+   for (i = 0; i < changes; i += run)
+   {
+      unsigned j;
+      size_t pos = ((size_t)bench_rand() << 8 ^ bench_rand()) % words;
+
+      for (j = 0; j < run && pos + j < words; j++)
+         b16[pos + j] ^= 0x5a5a;
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, s;
+   unsigned run       = 8;
+   unsigned iters     = 20;
+   double density     = 0.01;
+   uint64_t cpu       = cpu_features_get();
+   static const unsigned sizes_mb[] = { 1, 2, 4, 8, 16 };
+
+   if (argc > 1)
+      density = atof(argv[1]);
+   if (argc > 2)
+      run     = atoi(argv[2]);
+   if (argc > 3)
+      iters   = atoi(argv[3]);
+
+   if (density < 0.0 || density > 1.0 || !run || !iters)
+   {
+      fprintf(stderr, "Usage: %s [density (0-1)] [run length] [iterations]\n",
+            argv[0]);
+      return 1;
+   }
+
+   printf("Change density %g, run length %u, %u iterations\n",
+         density, run, iters);
+
+   for (s = 0; s < sizeof(sizes_mb) / sizeof(sizes_mb[0]); s++)
+   {
+      const state_delta_kernel_t *kernel;
+      size_t len          = (size_t)sizes_mb[s] << 20;
+      size_t patchlen_ref = 0;
+      uint8_t *a          = (uint8_t*)state_delta_alloc(len, 0);
+      uint8_t *b          = (uint8_t*)state_delta_alloc(len, 1);
+      uint8_t *check      = (uint8_t*)state_delta_alloc(len, 1);
+      uint8_t *patch      = (uint8_t*)malloc(state_delta_maxsize(len));
+      uint8_t *patch_ref  = (uint8_t*)malloc(state_delta_maxsize(len));
+
+      if (!a || !b || !check || !patch || !patch_ref)
+      {
+         fprintf(stderr, "Out of memory.\n");
+         return 1;
+      }
+
+      make_pair(a, b, len, density, run);
+
+      for (i = 0; (kernel = state_delta_kernel_get_by_index(i)); i++)
+      {
+         unsigned j;
+         retro_time_t start, elapsed;
+         size_t patchlen = 0;
+
+         if ((cpu & kernel->simd) != kernel->simd)
+         {
+            printf("%2u MB  %-8s  unsupported on this CPU\n",
+                  sizes_mb[s], kernel->ident);
+            continue;
+         }
+
+         start = cpu_features_get_time_usec();
+         for (j = 0; j < iters; j++)
+            patchlen = state_delta_compress(kernel, a, b, len, patch);
+         elapsed = cpu_features_get_time_usec() - start;
+
+         /* Every kernel has to produce the exact same patch,
+          * and the patch has to turn 'b' back into 'a'. */
+         memcpy(check, b, len);
+         state_delta_decompress(patch, patchlen, check, len);
+
+         if (!patchlen_ref)
+         {
+            patchlen_ref = patchlen;
+            memcpy(patch_ref, patch, patchlen);
+         }
+
+         printf("%2u MB  %-8s  %8.2f GB/s  patch %9u bytes  %s\n",
+               sizes_mb[s], kernel->ident,
+               elapsed ? (double)len * iters / elapsed / 1000.0 : 0.0,
+               (unsigned)patchlen,
+               (memcmp(check, a, len)
+                || patchlen != patchlen_ref
+                || memcmp(patch, patch_ref, patchlen)) ? "MISMATCH" : "ok");
+      }
+
+      free(a);
+      free(b);
+      free(check);
+      free(patch);
+      free(patch_ref);
+   }
+
+   return 0;
+}
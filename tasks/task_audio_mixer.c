@@ -552,6 +552,7 @@ bool task_push_audio_mixer_load_and_play(
 
    t->state           = nbio;
    t->handler         = task_file_load_handler;
+   t->stats_name      = "Audio mixer load";
    t->cleanup         = task_audio_mixer_load_free;
    t->user_data       = user;
 
@@ -684,6 +685,7 @@ bool task_push_audio_mixer_load(
 
    t->state                  = nbio;
    t->handler                = task_file_load_handler;
+   t->stats_name             = "Audio mixer load";
    t->cleanup                = task_audio_mixer_load_free;
    t->user_data              = user;
 
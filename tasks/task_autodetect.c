@@ -720,12 +720,13 @@ void input_autoconfigure_connect(
    if (!task)
       goto error;
 
-   task->handler  = input_autoconfigure_connect_handler;
-   task->state    = autoconfig_handle;
-   task->mute     = false;
-   task->title    = NULL;
-   task->callback = cb_input_autoconfigure_connect;
-   task->cleanup  = input_autoconfigure_free;
+   task->handler    = input_autoconfigure_connect_handler;
+   task->stats_name = "Input autoconfig";
+   task->state      = autoconfig_handle;
+   task->mute       = false;
+   task->title      = NULL;
+   task->callback   = cb_input_autoconfigure_connect;
+   task->cleanup    = input_autoconfigure_free;
 
    task_queue_push(task);
 
@@ -881,11 +882,12 @@ bool input_autoconfigure_disconnect(unsigned port, const char *name)
    if (!task)
       goto error;
 
-   task->handler  = input_autoconfigure_disconnect_handler;
-   task->state    = autoconfig_handle;
-   task->title    = NULL;
-   task->callback = cb_input_autoconfigure_disconnect;
-   task->cleanup  = input_autoconfigure_free;
+   task->handler    = input_autoconfigure_disconnect_handler;
+   task->stats_name = "Input autoconfig";
+   task->state      = autoconfig_handle;
+   task->title      = NULL;
+   task->callback   = cb_input_autoconfigure_disconnect;
+   task->cleanup    = input_autoconfigure_free;
 
    task_queue_push(task);
 
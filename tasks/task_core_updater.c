@@ -1519,6 +1519,7 @@ void task_push_update_installed_cores(
 
    /* Configure task */
    task->handler          = task_update_installed_cores_handler;
+   task->priority         = TASK_PRIORITY_BULK;
    task->state            = update_installed_handle;
    task->title            = strdup(msg_hash_to_str(MSG_FETCHING_CORE_LIST));
    task->alternative_look = true;
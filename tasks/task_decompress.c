@@ -320,6 +320,7 @@ void *task_push_decompress(
 
    t->state            = s;
    t->handler          = task_decompress_handler;
+   t->priority         = TASK_PRIORITY_IO;
 
    if (!string_is_empty(subdir))
    {
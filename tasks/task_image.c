@@ -461,6 +461,8 @@ bool task_push_image_load(const char *fullpath,
 
    t->state           = nbio;
    t->handler         = task_file_load_handler;
+   t->stats_name      = "Image load";
+   t->priority        = TASK_PRIORITY_INTERACTIVE;
    t->cleanup         = task_image_load_free;
    t->callback        = cb;
    t->user_data       = user_data;
@@ -502,6 +502,7 @@ bool task_push_netplay_crc_scan(uint32_t crc, char* name,
    task->type           = TASK_TYPE_BLOCKING;
    task->state          = state;
    task->handler        = task_netplay_crc_scan_handler;
+   task->priority       = TASK_PRIORITY_BULK;
    task->callback       = netplay_crc_scan_callback;
    task->title          = strdup("Looking for matching content...");
 
@@ -86,6 +86,7 @@ bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port)
 
    task->type                = TASK_TYPE_BLOCKING;
    task->handler             = task_netplay_nat_traversal_handler;
+   task->stats_name          = "NAT traversal";
    task->callback            = netplay_nat_traversal_callback;
    task->task_data           = ntsd;
 
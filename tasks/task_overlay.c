@@ -852,6 +852,7 @@ bool task_push_overlay_load_default(
    loader->overlay_path         = strdup(overlay_path);
 
    t->handler                   = task_overlay_handler;
+   t->stats_name                = "Overlay load";
    t->cleanup                   = task_overlay_free;
    t->state                     = loader;
    t->callback                  = cb;
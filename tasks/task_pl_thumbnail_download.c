@@ -533,6 +533,7 @@ bool task_push_pl_thumbnail_download(
    
    /* Configure task */
    task->handler                 = task_pl_thumbnail_download_handler;
+   task->priority                = TASK_PRIORITY_BULK;
    task->state                   = pl_thumb;
    task->title                   = strdup(system);
    task->alternative_look        = true;
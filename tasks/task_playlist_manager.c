@@ -337,6 +337,7 @@ bool task_push_pl_manager_reset_cores(const playlist_config_t *playlist_config)
    strlcat(task_title, playlist_name, sizeof(task_title));
    
    task->handler                 = task_pl_manager_reset_cores_handler;
+   task->priority                = TASK_PRIORITY_BULK;
    task->state                   = pl_manager;
    task->title                   = strdup(task_title);
    task->alternative_look        = true;
@@ -860,6 +861,7 @@ bool task_push_pl_manager_clean_playlist(const playlist_config_t *playlist_confi
    strlcat(task_title, playlist_name, sizeof(task_title));
    
    task->handler                 = task_pl_manager_clean_playlist_handler;
+   task->priority                = TASK_PRIORITY_BULK;
    task->state                   = pl_manager;
    task->title                   = strdup(task_title);
    task->alternative_look        = true;
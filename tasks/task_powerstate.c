@@ -84,11 +84,12 @@ void task_push_get_powerstate(void)
       return;
    }
 
-   task->type     = TASK_TYPE_NONE;
-   task->state    = state;
-   task->handler  = task_powerstate_handler;
-   task->callback = task_powerstate_cb;
-   task->mute     = true;
+   task->type       = TASK_TYPE_NONE;
+   task->state      = state;
+   task->handler    = task_powerstate_handler;
+   task->stats_name = "Power state";
+   task->callback   = task_powerstate_cb;
+   task->mute       = true;
 
    task_queue_push(task);
 }
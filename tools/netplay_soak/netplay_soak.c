@@ -0,0 +1,1060 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Headless netplay soak test.
+ *
+ * Starts a RetroArch host and a number of clients as child processes, all
+ * running soak_core with the null drivers, and puts a proxy between each
+ * client and the host on loopback. The proxy delays everything by the
+ * configured latency plus jitter and loses packets:
+ *
+ *  - UDP datagrams are really dropped and may be reordered by jitter.
+ *  - TCP can't lose data, so a lost segment instead holds up its direction
+ *    for a retransmission timeout, which is what the application would see.
+ *
+ * Every instance is fed a scripted pseudo-random button sequence through its
+ * network remote pad. Once all of them have run the requested number of
+ * frames, their logs are scanned for the netplay session statistics and the
+ * soak_core checkpoints, and a report is printed. The exit status is 1 if the
+ * instances ended up with different checkpoints or one of them failed. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_CLIENTS      15
+#define MAX_INSTANCES    (MAX_CLIENTS + 1)
+#define MAX_CHECKPOINTS  1024
+#define CHUNK_SIZE       65536
+#define REMOTE_PORT_BASE 100
+
+/* Must match struct remote_message in retroarch.c */
+struct remote_message
+{
+   int port;
+   int device;
+   int index;
+   int id;
+   uint16_t state;
+};
+
+struct chunk
+{
+   struct chunk *next;
+   uint64_t due;
+   size_t len, off;
+   char data[1];
+};
+
+/* One direction of a proxied connection */
+struct queue
+{
+   struct chunk *head, *tail;
+   uint64_t last_due;
+   uint64_t bytes;
+};
+
+struct link
+{
+   int listen_fd;
+   int fd[2];       /* client side, host side */
+   bool eof[2];
+   struct queue tcp[2]; /* 0: client to host, 1: host to client */
+
+   int udp_fd[2];   /* bound for the client, connected to the host */
+   struct sockaddr_in udp_client;
+   bool have_udp_client;
+   struct queue udp[2];
+   uint64_t udp_dropped;
+};
+
+struct instance
+{
+   pid_t pid;
+   bool running;
+   int status;
+   struct rusage usage;
+   char name[32];
+   char log_path[512];
+
+   /* Input script */
+   uint32_t rng;
+   uint64_t next_input;
+   uint16_t buttons;
+   int remote_fd;
+   unsigned remote_port;
+
+   /* Parsed from the log */
+   unsigned frames, stall_frames, rollbacks, replayed, resyncs;
+   unsigned sessions;
+   unsigned core_frame, core_runs, serializes, unserializes;
+   unsigned udp_first, tcp_first;
+   unsigned checkpoints;
+   uint32_t checkpoint[MAX_CHECKPOINTS];
+};
+
+static struct instance instances[MAX_INSTANCES];
+static struct link links[MAX_CLIENTS];
+static unsigned num_instances;
+
+static const char *retroarch_path = "../../retroarch";
+static const char *core_path      = "./soak_libretro.so";
+static char work_dir[256];
+static unsigned clients           = 1;
+static unsigned spectators        = 0;
+static unsigned frames            = 3600;
+static unsigned latency_ms        = 0;
+static unsigned jitter_ms         = 0;
+static double loss                = 0.0;
+static unsigned rto_ms            = 200;
+static unsigned hold_min          = 2;
+static unsigned hold_max          = 30;
+static unsigned port              = 55470;
+static unsigned seed              = 1;
+static unsigned cost_us           = 0;
+static unsigned state_size        = 0;
+static bool udp                   = false;
+static bool keep                  = false;
+
+static uint32_t net_rng;
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: netplay_soak [options]\n"
+      "Options:\n"
+      "    -r|--retroarch <path>: RetroArch binary. Defaults to ../../retroarch.\n"
+      "    -L|--core <path>:      Core. Defaults to ./soak_libretro.so.\n"
+      "    -n|--clients <n>:      Number of playing clients. Defaults to 1.\n"
+      "    -S|--spectators <n>:   Number of spectating clients. Defaults to 0.\n"
+      "    -f|--frames <n>:       Frames each instance runs. Defaults to 3600.\n"
+      "    -l|--latency <ms>:     One-way latency. Defaults to 0.\n"
+      "    -j|--jitter <ms>:      Random extra one-way latency. Defaults to 0.\n"
+      "    -d|--loss <percent>:   Packet loss. Defaults to 0.\n"
+      "    -t|--rto <ms>:         Stall of a TCP direction on loss. Defaults to 200.\n"
+      "    -i|--hold <min>:<max>: Frames a button state is held. Defaults to 2:30.\n"
+      "    -u|--udp:              Enable the UDP input transport.\n"
+      "    -c|--cost <us>:        Core CPU time per frame.\n"
+      "    -z|--state-size <n>:   Core savestate size in bytes.\n"
+      "    -p|--port <port>:      First port to use. Defaults to 55470.\n"
+      "    -s|--seed <n>:         Seed for the input script and the network.\n"
+      "    -w|--work-dir <dir>:   Directory for configs and logs.\n"
+      "    -k|--keep:             Keep the work directory.\n"
+      "\n");
+}
+
+static void die(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+   exit(2);
+}
+
+static uint64_t now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint32_t next_rand(uint32_t *rng)
+{
+   *rng ^= *rng << 13;
+   *rng ^= *rng >> 17;
+   *rng ^= *rng << 5;
+   return *rng;
+}
+
+static unsigned rand_range(uint32_t *rng, unsigned lo, unsigned hi)
+{
+   if (hi <= lo)
+      return lo;
+   return lo + next_rand(rng) % (hi - lo + 1);
+}
+
+static bool rand_lost(void)
+{
+   return loss > 0.0 &&
+      (next_rand(&net_rng) % 1000000) < (uint32_t)(loss * 10000.0);
+}
+
+static void set_nonblock(int fd)
+{
+   fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void loopback_addr(struct sockaddr_in *addr, unsigned p)
+{
+   memset(addr, 0, sizeof(*addr));
+   addr->sin_family      = AF_INET;
+   addr->sin_port        = htons(p);
+   addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+static int bound_socket(int type, unsigned p)
+{
+   struct sockaddr_in addr;
+   int yes = 1;
+   int fd  = socket(AF_INET, type, 0);
+
+   if (fd < 0)
+      die("socket: %s\n", strerror(errno));
+   setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+   loopback_addr(&addr, p);
+   if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+      die("Cannot bind port %u: %s\n", p, strerror(errno));
+   return fd;
+}
+
+/* Queues data for delivery after the simulated network delay. A stream must
+ * stay in order, so TCP chunks are never due before the previous one. */
+static void queue_push(struct queue *queue, const void *data, size_t len,
+      bool stream)
+{
+   uint64_t due      = now_ms() + latency_ms +
+      rand_range(&net_rng, 0, jitter_ms);
+   struct chunk *chunk;
+
+   if (stream)
+   {
+      if (rand_lost())
+         due += rto_ms;
+      if (due < queue->last_due)
+         due = queue->last_due;
+      queue->last_due = due;
+   }
+
+   chunk = (struct chunk*)malloc(sizeof(*chunk) + len);
+   if (!chunk)
+      die("Out of memory.\n");
+   chunk->next = NULL;
+   chunk->due  = due;
+   chunk->len  = len;
+   chunk->off  = 0;
+   memcpy(chunk->data, data, len);
+
+   /* Datagrams may overtake each other */
+   if (!stream && queue->tail && queue->tail->due > due)
+   {
+      struct chunk **prev = &queue->head;
+      while ((*prev)->due <= due)
+         prev = &(*prev)->next;
+      chunk->next = *prev;
+      *prev       = chunk;
+      return;
+   }
+
+   if (queue->tail)
+      queue->tail->next = chunk;
+   else
+      queue->head = chunk;
+   queue->tail = chunk;
+}
+
+static void queue_pop(struct queue *queue)
+{
+   struct chunk *chunk = queue->head;
+   queue->head         = chunk->next;
+   if (!queue->head)
+      queue->tail      = NULL;
+   free(chunk);
+}
+
+static void queue_clear(struct queue *queue)
+{
+   while (queue->head)
+      queue_pop(queue);
+}
+
+static uint64_t queue_next_due(const struct queue *queue, uint64_t next)
+{
+   if (queue->head && queue->head->due < next)
+      return queue->head->due;
+   return next;
+}
+
+static void link_close(struct link *link)
+{
+   unsigned i;
+   for (i = 0; i < 2; i++)
+   {
+      if (link->fd[i] >= 0)
+         close(link->fd[i]);
+      link->fd[i] = -1;
+      queue_clear(&link->tcp[i]);
+   }
+}
+
+static void link_accept(struct link *link)
+{
+   struct sockaddr_in addr;
+   int one = 1;
+   int fd  = accept(link->listen_fd, NULL, NULL);
+
+   if (fd < 0)
+      return;
+
+   /* One connection per client */
+   if (link->fd[0] >= 0)
+   {
+      close(fd);
+      return;
+   }
+
+   link->fd[0] = fd;
+   link->fd[1] = socket(AF_INET, SOCK_STREAM, 0);
+   loopback_addr(&addr, port);
+   if (link->fd[1] < 0 ||
+         connect(link->fd[1], (struct sockaddr*)&addr, sizeof(addr)) < 0)
+   {
+      fprintf(stderr, "Proxy cannot reach the host: %s\n", strerror(errno));
+      link_close(link);
+      return;
+   }
+
+   setsockopt(link->fd[0], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+   setsockopt(link->fd[1], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+   set_nonblock(link->fd[0]);
+   set_nonblock(link->fd[1]);
+   link->eof[0] = link->eof[1] = false;
+}
+
+static void link_read(struct link *link, unsigned side)
+{
+   char buf[CHUNK_SIZE];
+   ssize_t len = read(link->fd[side], buf, sizeof(buf));
+
+   if (len > 0)
+      queue_push(&link->tcp[side], buf, len, true);
+   else if (len == 0 || (errno != EAGAIN && errno != EINTR))
+      link->eof[side] = true;
+}
+
+static void link_write(struct link *link, unsigned side, uint64_t now)
+{
+   struct queue *queue = &link->tcp[side];
+   int to              = link->fd[!side];
+
+   while (queue->head && queue->head->due <= now)
+   {
+      struct chunk *chunk = queue->head;
+      ssize_t len = write(to, chunk->data + chunk->off,
+            chunk->len - chunk->off);
+
+      if (len < 0)
+      {
+         if (errno != EAGAIN && errno != EINTR)
+            link->eof[!side] = true;
+         return;
+      }
+
+      queue->bytes += len;
+      chunk->off   += len;
+      if (chunk->off < chunk->len)
+         return;
+      queue_pop(queue);
+   }
+}
+
+static void link_udp_read(struct link *link, unsigned side)
+{
+   char buf[CHUNK_SIZE];
+   struct sockaddr_in from;
+   socklen_t from_len = sizeof(from);
+   ssize_t len        = recvfrom(link->udp_fd[side], buf, sizeof(buf), 0,
+         (struct sockaddr*)&from, &from_len);
+
+   if (len <= 0)
+      return;
+
+   if (side == 0)
+   {
+      link->udp_client      = from;
+      link->have_udp_client = true;
+   }
+
+   if (rand_lost())
+   {
+      link->udp_dropped++;
+      return;
+   }
+   queue_push(&link->udp[side], buf, len, false);
+}
+
+static void link_udp_write(struct link *link, unsigned side, uint64_t now)
+{
+   struct queue *queue = &link->udp[side];
+
+   while (queue->head && queue->head->due <= now)
+   {
+      struct chunk *chunk = queue->head;
+
+      if (side == 0)
+         send(link->udp_fd[1], chunk->data, chunk->len, 0);
+      else if (link->have_udp_client)
+         sendto(link->udp_fd[0], chunk->data, chunk->len, 0,
+               (struct sockaddr*)&link->udp_client,
+               sizeof(link->udp_client));
+      queue->bytes += chunk->len;
+      queue_pop(queue);
+   }
+}
+
+static void link_init(struct link *link, unsigned p)
+{
+   struct sockaddr_in addr;
+
+   memset(link, 0, sizeof(*link));
+   link->fd[0] = link->fd[1] = -1;
+
+   link->listen_fd = bound_socket(SOCK_STREAM, p);
+   if (listen(link->listen_fd, 4) < 0)
+      die("listen: %s\n", strerror(errno));
+   set_nonblock(link->listen_fd);
+
+   link->udp_fd[0] = bound_socket(SOCK_DGRAM, p);
+   link->udp_fd[1] = socket(AF_INET, SOCK_DGRAM, 0);
+   loopback_addr(&addr, port);
+   if (link->udp_fd[1] < 0 ||
+         connect(link->udp_fd[1], (struct sockaddr*)&addr, sizeof(addr)) < 0)
+      die("UDP socket: %s\n", strerror(errno));
+   set_nonblock(link->udp_fd[0]);
+   set_nonblock(link->udp_fd[1]);
+}
+
+static void write_config(const char *path, unsigned index)
+{
+   FILE *file = fopen(path, "w");
+
+   if (!file)
+      die("%s: %s\n", path, strerror(errno));
+
+   fprintf(file,
+         "config_save_on_exit = \"false\"\n"
+         "video_driver = \"null\"\n"
+         "audio_driver = \"null\"\n"
+         "input_driver = \"null\"\n"
+         "input_joypad_driver = \"null\"\n"
+         "menu_driver = \"rgui\"\n"
+         "video_vsync = \"false\"\n"
+         "vrr_runloop_enable = \"true\"\n"
+         "pause_nonactive = \"false\"\n"
+         "auto_overrides_enable = \"false\"\n"
+         "auto_remaps_enable = \"false\"\n"
+         "history_list_enable = \"false\"\n"
+         "savestate_auto_load = \"false\"\n"
+         "savestate_auto_save = \"false\"\n"
+         "savefile_directory = \"%s\"\n"
+         "savestate_directory = \"%s\"\n"
+         "cheat_database_path = \"%s\"\n"
+         "network_cmd_enable = \"false\"\n"
+         "network_remote_enable = \"true\"\n"
+         "network_remote_enable_user_p1 = \"true\"\n"
+         "network_remote_base_port = \"%u\"\n"
+         "netplay_public_announce = \"false\"\n"
+         "netplay_nat_traversal = \"false\"\n"
+         "netplay_use_mitm_server = \"false\"\n"
+         "netplay_check_frames = \"30\"\n"
+         "netplay_udp_input = \"%s\"\n"
+         "netplay_start_as_spectator = \"%s\"\n"
+         "netplay_ip_port = \"%u\"\n"
+         "netplay_nickname = \"%s\"\n",
+         work_dir, work_dir, work_dir,
+         instances[index].remote_port,
+         udp ? "true" : "false",
+         index > clients ? "true" : "false",
+         port,
+         instances[index].name);
+
+   fclose(file);
+}
+
+static void spawn(unsigned index, const char *content)
+{
+   struct instance *inst = &instances[index];
+   char config[512], connect_port[16], max_frames[32], append[600];
+   pid_t pid;
+
+   snprintf(config, sizeof(config), "%s/%s.cfg", work_dir, inst->name);
+   strcpy(inst->log_path, config);
+   strcpy(inst->log_path + strlen(config) - 3, "log");
+   snprintf(max_frames, sizeof(max_frames), "--max-frames=%u", frames);
+   snprintf(connect_port, sizeof(connect_port), "%u",
+         index ? port + index : port);
+   snprintf(append, sizeof(append), "--config=%s", config);
+   write_config(config, index);
+
+   pid = fork();
+   if (pid < 0)
+      die("fork: %s\n", strerror(errno));
+
+   if (!pid)
+   {
+      int fd = open(inst->log_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      char cost[16], size[16];
+
+      if (fd >= 0)
+      {
+         dup2(fd, STDOUT_FILENO);
+         dup2(fd, STDERR_FILENO);
+         close(fd);
+      }
+
+      snprintf(cost, sizeof(cost), "%u", cost_us);
+      setenv("SOAK_COST_US", cost, 1);
+      if (state_size)
+      {
+         snprintf(size, sizeof(size), "%u", state_size);
+         setenv("SOAK_STATE_SIZE", size, 1);
+      }
+
+      if (index)
+         execl(retroarch_path, retroarch_path, append, "-v", max_frames,
+               "--connect", "127.0.0.1", "--port", connect_port,
+               "-L", core_path, content, (char*)NULL);
+      else
+         execl(retroarch_path, retroarch_path, append, "-v", max_frames,
+               "--host", "--port", connect_port,
+               "-L", core_path, content, (char*)NULL);
+      fprintf(stderr, "%s: %s\n", retroarch_path, strerror(errno));
+      _exit(127);
+   }
+
+   inst->pid     = pid;
+   inst->running = true;
+}
+
+/* Waits until the given instance has written the line to its log */
+static bool wait_for_log(unsigned index, const char *needle,
+      unsigned timeout_ms)
+{
+   uint64_t end = now_ms() + timeout_ms;
+
+   while (now_ms() < end)
+   {
+      char line[1024];
+      FILE *file = fopen(instances[index].log_path, "r");
+      bool found = false;
+
+      if (file)
+      {
+         while (!found && fgets(line, sizeof(line), file))
+            found = strstr(line, needle) != NULL;
+         fclose(file);
+      }
+      if (found)
+         return true;
+
+      if (waitpid(instances[index].pid, NULL, WNOHANG) ==
+            instances[index].pid)
+         return false;
+      usleep(20000);
+   }
+
+   return false;
+}
+
+static void send_input(struct instance *inst, uint64_t now)
+{
+   static const int script_buttons[] = { 0, 1, 8, 9, 4, 5, 6, 7, 10, 11 };
+   struct remote_message msg;
+   struct sockaddr_in addr;
+   unsigned button = next_rand(&inst->rng) %
+      (sizeof(script_buttons) / sizeof(script_buttons[0]));
+
+   inst->buttons ^= 1 << button;
+
+   memset(&msg, 0, sizeof(msg));
+   msg.port   = 0;
+   msg.device = 1; /* RETRO_DEVICE_JOYPAD */
+   msg.index  = 0;
+   msg.id     = script_buttons[button];
+   msg.state  = (inst->buttons >> button) & 1;
+
+   loopback_addr(&addr, inst->remote_port);
+   sendto(inst->remote_fd, &msg, sizeof(msg), 0,
+         (struct sockaddr*)&addr, sizeof(addr));
+
+   inst->next_input = now +
+      rand_range(&inst->rng, hold_min, hold_max) * 1000 / 60;
+}
+
+static void reap(void)
+{
+   unsigned i;
+
+   for (i = 0; i < num_instances; i++)
+   {
+      struct instance *inst = &instances[i];
+
+      if (inst->running &&
+            wait4(inst->pid, &inst->status, WNOHANG, &inst->usage)
+            == inst->pid)
+         inst->running = false;
+   }
+}
+
+static unsigned count_running(void)
+{
+   unsigned i, n = 0;
+   for (i = 0; i < num_instances; i++)
+      if (instances[i].running)
+         n++;
+   return n;
+}
+
+static void run_loop(uint64_t deadline)
+{
+   struct pollfd fds[MAX_CLIENTS * 5];
+
+   while (count_running())
+   {
+      uint64_t now  = now_ms();
+      uint64_t next = now + 10;
+      int timeout;
+      unsigned i, n = 0;
+
+      if (now >= deadline)
+      {
+         fprintf(stderr, "Timed out, killing the remaining instances.\n");
+         for (i = 0; i < num_instances; i++)
+            if (instances[i].running)
+               kill(instances[i].pid, SIGKILL);
+         while (count_running())
+         {
+            reap();
+            usleep(10000);
+         }
+         break;
+      }
+
+      /* Scripted input */
+      for (i = 0; i < num_instances; i++)
+      {
+         struct instance *inst = &instances[i];
+
+         /* Spectators have no input to speak of */
+         if (!inst->running || i > clients)
+            continue;
+         if (inst->next_input <= now)
+            send_input(inst, now);
+         if (inst->next_input < next)
+            next = inst->next_input;
+      }
+
+      /* Delayed delivery */
+      for (i = 0; i < clients + spectators; i++)
+      {
+         struct link *link = &links[i];
+         unsigned side;
+
+         for (side = 0; side < 2; side++)
+         {
+            if (link->fd[0] >= 0)
+            {
+               link_write(link, side, now);
+               next = queue_next_due(&link->tcp[side], next);
+            }
+            link_udp_write(link, side, now);
+            next = queue_next_due(&link->udp[side], next);
+         }
+
+         /* Pass a hangup on once everything before it was delivered */
+         if (link->fd[0] >= 0 &&
+               ((link->eof[0] && !link->tcp[0].head) ||
+                (link->eof[1] && !link->tcp[1].head)))
+            link_close(link);
+      }
+
+      for (i = 0; i < clients + spectators; i++)
+      {
+         struct link *link = &links[i];
+
+         fds[n].fd       = link->listen_fd;
+         fds[n++].events = POLLIN;
+         fds[n].fd       = link->udp_fd[0];
+         fds[n++].events = POLLIN;
+         fds[n].fd       = link->udp_fd[1];
+         fds[n++].events = POLLIN;
+         fds[n].fd       = link->eof[0] ? -1 : link->fd[0];
+         fds[n++].events = POLLIN;
+         fds[n].fd       = link->eof[1] ? -1 : link->fd[1];
+         fds[n++].events = POLLIN;
+      }
+
+      timeout = next > now ? (int)(next - now) : 0;
+      if (timeout > 10)
+         timeout = 10;
+      if (poll(fds, n, timeout) > 0)
+      {
+         for (i = 0; i < clients + spectators; i++)
+         {
+            struct pollfd *pfd = &fds[i * 5];
+            struct link *link  = &links[i];
+
+            if (pfd[0].revents & POLLIN)
+               link_accept(link);
+            if (pfd[1].revents & POLLIN)
+               link_udp_read(link, 0);
+            if (pfd[2].revents & POLLIN)
+               link_udp_read(link, 1);
+            if (pfd[3].fd >= 0 && pfd[3].revents && link->fd[0] >= 0)
+               link_read(link, 0);
+            if (pfd[4].fd >= 0 && pfd[4].revents && link->fd[1] >= 0)
+               link_read(link, 1);
+         }
+      }
+
+      reap();
+   }
+}
+
+static void parse_log(struct instance *inst)
+{
+   char line[1024];
+   FILE *file = fopen(inst->log_path, "r");
+
+   if (!file)
+      return;
+
+   while (fgets(line, sizeof(line), file))
+   {
+      unsigned a, b, c, d, e;
+      const char *p;
+
+      if ((p = strstr(line, "[netplay] Session: ")) &&
+            sscanf(p, "[netplay] Session: %u frames, %u stall frames, "
+               "%u rollbacks (%u frames replayed), %u resyncs",
+               &a, &b, &c, &d, &e) == 5)
+      {
+         inst->frames       += a;
+         inst->stall_frames += b;
+         inst->rollbacks    += c;
+         inst->replayed     += d;
+         inst->resyncs      += e;
+         inst->sessions++;
+      }
+      else if ((p = strstr(line, "received first over UDP: ")) &&
+            sscanf(p, "received first over UDP: %u, over TCP: %u",
+               &a, &b) == 2)
+      {
+         inst->udp_first += a;
+         inst->tcp_first += b;
+      }
+      else if (sscanf(line, "soak_core: checkpoint %u %x", &a, &b) == 2)
+      {
+         unsigned idx = a / 256 - 1;
+         if (idx < MAX_CHECKPOINTS)
+         {
+            inst->checkpoint[idx] = b;
+            if (idx + 1 > inst->checkpoints)
+               inst->checkpoints = idx + 1;
+         }
+      }
+      else if (sscanf(line, "soak_core: frame %u runs %u serialize %u "
+               "unserialize %u", &a, &b, &c, &d) == 4)
+      {
+         inst->core_frame   = a;
+         inst->core_runs    = b;
+         inst->serializes   = c;
+         inst->unserializes = d;
+      }
+   }
+
+   fclose(file);
+}
+
+static double cpu_ms(const struct instance *inst)
+{
+   return (inst->usage.ru_utime.tv_sec + inst->usage.ru_stime.tv_sec) *
+      1000.0 + (inst->usage.ru_utime.tv_usec +
+            inst->usage.ru_stime.tv_usec) / 1000.0;
+}
+
+/* Only compares checkpoints which every instance has reached with a frame
+ * to spare, since the newest one may still be based on predicted input.
+ * Any mismatch fails the soak, and so does a run where none could be
+ * compared although it was long enough for a few, stalls included. */
+static int check_sync(void)
+{
+   unsigned i, c, common = MAX_CHECKPOINTS;
+
+   for (i = 0; i < num_instances; i++)
+      if (instances[i].checkpoints < common)
+         common = instances[i].checkpoints;
+   if (common)
+      common--;
+
+   if (!common && frames >= 4 * 256)
+   {
+      printf("sync: FAILED, no checkpoint reached by every instance\n");
+      return 1;
+   }
+
+   for (c = 0; c < common; c++)
+      for (i = 1; i < num_instances; i++)
+         if (instances[i].checkpoint[c] != instances[0].checkpoint[c])
+         {
+            printf("sync: MISMATCH at frame %u (%s %08x, %s %08x)\n",
+                  (c + 1) * 256, instances[0].name,
+                  (unsigned)instances[0].checkpoint[c], instances[i].name,
+                  (unsigned)instances[i].checkpoint[c]);
+            return 1;
+         }
+
+   printf("sync: %u checkpoints agree\n", common);
+   return 0;
+}
+
+static int report(void)
+{
+   unsigned i;
+   int ret = 0;
+
+   printf("%u clients, %u spectators, %u frames, latency %u ms, "
+         "jitter %u ms, loss %.2f%%, %s input\n",
+         clients, spectators, frames, latency_ms, jitter_ms, loss,
+         udp ? "UDP" : "TCP");
+   printf("%-12s %7s %8s %8s %11s %8s %8s %8s %10s\n",
+         "instance", "frames", "stalls", "rollb/s", "replay/rb", "resyncs",
+         "runs/fr", "CPU ms", "CPU us/fr");
+
+   for (i = 0; i < num_instances; i++)
+   {
+      struct instance *inst = &instances[i];
+      double seconds;
+
+      parse_log(inst);
+      seconds = inst->frames / 60.0;
+
+      printf("%-12s %7u %8u %8.2f %11.2f %8u %8.2f %8.0f %10.0f\n",
+            inst->name, inst->frames, inst->stall_frames,
+            seconds > 0 ? inst->rollbacks / seconds : 0.0,
+            inst->rollbacks ? (double)inst->replayed / inst->rollbacks : 0.0,
+            inst->resyncs,
+            inst->core_frame ? (double)inst->core_runs / inst->core_frame
+               : 0.0,
+            cpu_ms(inst),
+            inst->core_frame ? cpu_ms(inst) * 1000.0 / inst->core_frame
+               : 0.0);
+
+      if (udp && i && i <= clients)
+         printf("%-12s input frames first over UDP %u, over TCP %u\n",
+               "", inst->udp_first, inst->tcp_first);
+
+      if (!WIFEXITED(inst->status) || WEXITSTATUS(inst->status) ||
+            !inst->sessions)
+      {
+         printf("%-12s FAILED (status %d, %u sessions), see %s\n", "",
+               inst->status, inst->sessions, inst->log_path);
+         ret = 1;
+      }
+   }
+
+   for (i = 0; i < clients + spectators; i++)
+   {
+      const struct link *link = &links[i];
+      double seconds          = instances[i + 1].frames / 60.0;
+      uint64_t up   = link->tcp[0].bytes + link->udp[0].bytes;
+      uint64_t down = link->tcp[1].bytes + link->udp[1].bytes;
+
+      printf("%-12s wire: up %llu bytes (UDP %llu), down %llu bytes "
+            "(UDP %llu), %.1f kbit/s, %llu datagrams dropped\n",
+            instances[i + 1].name,
+            (unsigned long long)up, (unsigned long long)link->udp[0].bytes,
+            (unsigned long long)down, (unsigned long long)link->udp[1].bytes,
+            seconds > 0 ? (up + down) * 8 / 1000.0 / seconds : 0.0,
+            (unsigned long long)link->udp_dropped);
+   }
+
+   if (check_sync())
+      ret = 1;
+
+   return ret;
+}
+
+int main(int argc, char **argv)
+{
+   char content[600];
+   unsigned i;
+   int remote_fd, ret;
+   FILE *file;
+
+   const struct option opt[] = {
+      {"retroarch",  1, NULL, 'r'},
+      {"core",       1, NULL, 'L'},
+      {"clients",    1, NULL, 'n'},
+      {"spectators", 1, NULL, 'S'},
+      {"frames",     1, NULL, 'f'},
+      {"latency",    1, NULL, 'l'},
+      {"jitter",     1, NULL, 'j'},
+      {"loss",       1, NULL, 'd'},
+      {"rto",        1, NULL, 't'},
+      {"hold",       1, NULL, 'i'},
+      {"udp",        0, NULL, 'u'},
+      {"cost",       1, NULL, 'c'},
+      {"state-size", 1, NULL, 'z'},
+      {"port",       1, NULL, 'p'},
+      {"seed",       1, NULL, 's'},
+      {"work-dir",   1, NULL, 'w'},
+      {"keep",       0, NULL, 'k'},
+      {NULL,         0, NULL, 0}
+   };
+
+   work_dir[0] = '\0';
+
+   for (;;)
+   {
+      int c = getopt_long(argc, argv, "r:L:n:S:f:l:j:d:t:i:uc:z:p:s:w:k",
+            opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'r': retroarch_path = optarg; break;
+         case 'L': core_path      = optarg; break;
+         case 'n': clients        = atoi(optarg); break;
+         case 'S': spectators     = atoi(optarg); break;
+         case 'f': frames         = atoi(optarg); break;
+         case 'l': latency_ms     = atoi(optarg); break;
+         case 'j': jitter_ms      = atoi(optarg); break;
+         case 'd': loss           = atof(optarg); break;
+         case 't': rto_ms         = atoi(optarg); break;
+         case 'i':
+            if (sscanf(optarg, "%u:%u", &hold_min, &hold_max) != 2 ||
+                  !hold_min || hold_max < hold_min)
+            {
+               usage();
+               return 2;
+            }
+            break;
+         case 'u': udp            = true; break;
+         case 'c': cost_us        = atoi(optarg); break;
+         case 'z': state_size     = atoi(optarg); break;
+         case 'p': port           = atoi(optarg); break;
+         case 's': seed           = atoi(optarg); break;
+         case 'w':
+            snprintf(work_dir, sizeof(work_dir), "%s", optarg);
+            break;
+         case 'k': keep           = true; break;
+         default:
+            usage();
+            return 2;
+      }
+   }
+
+   if (!clients || clients + spectators > MAX_CLIENTS || !frames)
+   {
+      usage();
+      return 2;
+   }
+
+   if (!work_dir[0])
+   {
+      snprintf(work_dir, sizeof(work_dir), "/tmp/netplay_soak.XXXXXX");
+      if (!mkdtemp(work_dir))
+         die("mkdtemp: %s\n", strerror(errno));
+   }
+   else
+      mkdir(work_dir, 0755);
+
+   /* Some dummy content, so that everyone agrees on the CRC */
+   snprintf(content, sizeof(content), "%s/soak.bin", work_dir);
+   file = fopen(content, "wb");
+   if (!file)
+      die("%s: %s\n", content, strerror(errno));
+   fputs("netplay soak\n", file);
+   fclose(file);
+
+   signal(SIGPIPE, SIG_IGN);
+   net_rng     = seed * 2654435761u + 1;
+   remote_fd   = socket(AF_INET, SOCK_DGRAM, 0);
+   num_instances = 1 + clients + spectators;
+
+   for (i = 0; i < num_instances; i++)
+   {
+      struct instance *inst = &instances[i];
+
+      if (!i)
+         snprintf(inst->name, sizeof(inst->name), "host");
+      else if (i <= clients)
+         snprintf(inst->name, sizeof(inst->name), "client%u", i);
+      else
+         snprintf(inst->name, sizeof(inst->name), "spectator%u",
+               i - clients);
+
+      inst->rng         = (seed + i) * 2654435761u + 1;
+      inst->remote_fd   = remote_fd;
+      inst->remote_port = port + REMOTE_PORT_BASE + i;
+   }
+
+   for (i = 0; i < clients + spectators; i++)
+      link_init(&links[i], port + 1 + i);
+
+   spawn(0, content);
+   if (!wait_for_log(0, "Waiting for client", 10000))
+      die("The host did not come up, see %s\n", instances[0].log_path);
+
+   for (i = 1; i < num_instances; i++)
+      spawn(i, content);
+
+   /* Generously allow for stalls and startup */
+   run_loop(now_ms() + frames * 1000 / 60 * 4 + 30000);
+
+   ret = report();
+   if (ret)
+      printf("Soak FAILED\n");
+
+   if (keep || ret)
+      printf("Logs are in %s\n", work_dir);
+   else
+   {
+      char path[600];
+
+      for (i = 0; i < num_instances; i++)
+      {
+         unlink(instances[i].log_path);
+         snprintf(path, sizeof(path), "%s/%s.cfg", work_dir,
+               instances[i].name);
+         unlink(path);
+      }
+      unlink(content);
+      rmdir(work_dir);
+   }
+
+   return ret;
+}
@@ -0,0 +1,264 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Deterministic test core for netplay_soak.
+ *
+ * Every frame folds the joypad state of all ports into a running hash and
+ * scribbles over a few bytes of a filler block, so that savestates look
+ * roughly like those of a real core. Every CHECKPOINT_INTERVAL frames the
+ * hash is stored in the state itself, which means replays overwrite it, and
+ * on exit all checkpoints are printed so that the harness can compare the
+ * timelines of all instances.
+ *
+ * SOAK_STATE_SIZE sets the size of the savestate in bytes and SOAK_COST_US
+ * the CPU time each frame takes, both from the environment. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libretro.h>
+
+#define CHECKPOINT_INTERVAL 256
+#define CHECKPOINTS         1024
+#define PORTS               4
+#define WIDTH               64
+#define HEIGHT              64
+#define AUDIO_FRAMES        800
+
+struct soak_header
+{
+   uint32_t frame;
+   uint32_t hash;
+   uint32_t checkpoints[CHECKPOINTS];
+};
+
+static retro_video_refresh_t video_cb;
+static retro_audio_sample_batch_t audio_batch_cb;
+static retro_environment_t environ_cb;
+static retro_input_poll_t input_poll_cb;
+static retro_input_state_t input_state_cb;
+
+static uint8_t *state;
+static size_t state_size = 256 * 1024;
+static unsigned cost_us;
+static unsigned runs, serializes, unserializes;
+
+static uint16_t framebuffer[WIDTH * HEIGHT];
+static int16_t audio_buffer[2 * AUDIO_FRAMES];
+
+static void burn_cpu(void)
+{
+   struct timespec start, now;
+
+   if (!cost_us)
+      return;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   do
+   {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+   } while ((now.tv_sec - start.tv_sec) * 1000000 +
+         (now.tv_nsec - start.tv_nsec) / 1000 < (long)cost_us);
+}
+
+void retro_init(void)
+{
+   const char *env = getenv("SOAK_STATE_SIZE");
+
+   if (env && (size_t)atol(env) > sizeof(struct soak_header))
+      state_size = (size_t)atol(env);
+   if (state_size < sizeof(struct soak_header))
+      state_size = sizeof(struct soak_header);
+
+   env = getenv("SOAK_COST_US");
+   if (env)
+      cost_us = (unsigned)atoi(env);
+
+   state = (uint8_t*)calloc(1, state_size);
+}
+
+void retro_deinit(void)
+{
+   if (state)
+   {
+      const struct soak_header *header = (const struct soak_header*)state;
+      unsigned i;
+
+      for (i = 0; i < CHECKPOINTS &&
+            (i + 1) * CHECKPOINT_INTERVAL <= header->frame; i++)
+         fprintf(stderr, "soak_core: checkpoint %u %08x\n",
+               (i + 1) * CHECKPOINT_INTERVAL,
+               (unsigned)header->checkpoints[i]);
+
+      fprintf(stderr, "soak_core: frame %u runs %u serialize %u "
+            "unserialize %u\n", (unsigned)header->frame,
+            runs, serializes, unserializes);
+   }
+
+   free(state);
+   state = NULL;
+}
+
+unsigned retro_api_version(void)
+{
+   return RETRO_API_VERSION;
+}
+
+void retro_set_controller_port_device(unsigned port, unsigned device) { }
+
+void retro_get_system_info(struct retro_system_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->library_name     = "Netplay Soak";
+   info->library_version  = "1";
+   info->valid_extensions = "bin";
+   info->need_fullpath    = false;
+}
+
+void retro_get_system_av_info(struct retro_system_av_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->timing.fps            = 60.0;
+   info->timing.sample_rate    = AUDIO_FRAMES * 60.0;
+   info->geometry.base_width   = WIDTH;
+   info->geometry.base_height  = HEIGHT;
+   info->geometry.max_width    = WIDTH;
+   info->geometry.max_height   = HEIGHT;
+   info->geometry.aspect_ratio = 1.0f;
+}
+
+void retro_set_environment(retro_environment_t cb)
+{
+   bool no_game = true;
+
+   environ_cb = cb;
+   cb(RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME, &no_game);
+}
+
+void retro_set_audio_sample(retro_audio_sample_t cb) { }
+void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) { audio_batch_cb = cb; }
+void retro_set_input_poll(retro_input_poll_t cb) { input_poll_cb = cb; }
+void retro_set_input_state(retro_input_state_t cb) { input_state_cb = cb; }
+void retro_set_video_refresh(retro_video_refresh_t cb) { video_cb = cb; }
+
+void retro_reset(void)
+{
+   memset(state, 0, state_size);
+}
+
+void retro_run(void)
+{
+   struct soak_header *header = (struct soak_header*)state;
+   uint8_t *filler            = state + sizeof(*header);
+   size_t filler_size         = state_size - sizeof(*header);
+   unsigned port, id;
+
+   input_poll_cb();
+
+   for (port = 0; port < PORTS; port++)
+   {
+      uint32_t buttons = 0;
+
+      for (id = 0; id <= RETRO_DEVICE_ID_JOYPAD_R3; id++)
+         if (input_state_cb(port, RETRO_DEVICE_JOYPAD, 0, id))
+            buttons |= 1 << id;
+
+      header->hash = (header->hash ^ (buttons + port)) * 16777619u;
+   }
+
+   header->frame++;
+   header->hash = (header->hash ^ header->frame) * 16777619u;
+
+   /* Touch a few scattered bytes like a real core would */
+   if (filler_size)
+   {
+      uint32_t x = header->hash;
+
+      for (id = 0; id < 16; id++)
+      {
+         x = x * 1103515245u + 12345u;
+         filler[x % filler_size] ^= (uint8_t)(x >> 24);
+      }
+   }
+
+   if (!(header->frame % CHECKPOINT_INTERVAL) &&
+         header->frame / CHECKPOINT_INTERVAL <= CHECKPOINTS)
+      header->checkpoints[header->frame / CHECKPOINT_INTERVAL - 1] =
+         header->hash;
+
+   runs++;
+   burn_cpu();
+
+   video_cb(framebuffer, WIDTH, HEIGHT, WIDTH * sizeof(uint16_t));
+   audio_batch_cb(audio_buffer, AUDIO_FRAMES);
+}
+
+size_t retro_serialize_size(void)
+{
+   return state_size;
+}
+
+bool retro_serialize(void *data, size_t size)
+{
+   if (size < state_size)
+      return false;
+   serializes++;
+   memcpy(data, state, state_size);
+   return true;
+}
+
+bool retro_unserialize(const void *data, size_t size)
+{
+   if (size < state_size)
+      return false;
+   unserializes++;
+   memcpy(state, data, state_size);
+   return true;
+}
+
+void retro_cheat_reset(void) { }
+void retro_cheat_set(unsigned index, bool enabled, const char *code) { }
+
+bool retro_load_game(const struct retro_game_info *info)
+{
+   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_RGB565;
+
+   return environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt);
+}
+
+bool retro_load_game_special(unsigned type,
+      const struct retro_game_info *info, size_t num)
+{
+   return false;
+}
+
+void retro_unload_game(void) { }
+
+unsigned retro_get_region(void)
+{
+   return RETRO_REGION_NTSC;
+}
+
+void *retro_get_memory_data(unsigned id)
+{
+   return NULL;
+}
+
+size_t retro_get_memory_size(unsigned id)
+{
+   return 0;
+}